@@ -0,0 +1,47 @@
+#!/bin/sh
+# ============================================================================
+# TCP SYN Flood Detector - Origin AS block rule template (iptables + ipset)
+# ============================================================================
+#
+# Drops sources in the hash:net set that asn_block fills with the prefixes
+# of an origin AS over asn_threshold.
+#
+# Values must match synflood-detector.conf:
+#   detection.asn_block, enforcement.asn_ipset, enforcement.block_duration_s
+#
+# Whitelisted addresses inside a blocked prefix are dropped by this rule
+# too: list them in WHITELIST so they are accepted before it.
+#
+# Usage: sudo sh asn-iptables.sh [add|del]
+# ============================================================================
+
+ASN_SET=synflood_blacklist_asn
+BLOCK_DURATION=300
+WHITELIST=""
+
+set -e
+
+case "${1:-add}" in
+    add)
+        ipset create -exist "$ASN_SET" hash:net timeout "$BLOCK_DURATION"
+
+        # Rules are inserted in reverse order, each at position 1
+        iptables -C INPUT -m set --match-set "$ASN_SET" src -j DROP 2>/dev/null ||
+            iptables -I INPUT 1 -m set --match-set "$ASN_SET" src -j DROP
+        for net in $WHITELIST; do
+            iptables -C INPUT -s "$net" -j ACCEPT 2>/dev/null ||
+                iptables -I INPUT 1 -s "$net" -j ACCEPT
+        done
+        ;;
+    del)
+        for net in $WHITELIST; do
+            iptables -D INPUT -s "$net" -j ACCEPT || true
+        done
+        iptables -D INPUT -m set --match-set "$ASN_SET" src -j DROP || true
+        ipset destroy "$ASN_SET" 2>/dev/null || true
+        ;;
+    *)
+        echo "Usage: $0 [add|del]" >&2
+        exit 1
+        ;;
+esac
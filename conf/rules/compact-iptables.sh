@@ -0,0 +1,36 @@
+#!/bin/sh
+# ============================================================================
+# TCP SYN Flood Detector - Blocklist compaction rule template (iptables + ipset)
+# ============================================================================
+#
+# Drops sources in the hash:net set that blocklist compaction fills with
+# CIDR entries. Each entry replaces many /32 entries of the blacklist, so
+# this rule must sit next to the blacklist DROP rule.
+#
+# Values must match the enforcement section of synflood-detector.conf:
+#   compact_ipset, block_duration_s
+#
+# Usage: sudo sh compact-iptables.sh [add|del]
+# ============================================================================
+
+COMPACT_SET=synflood_blacklist_net
+BLOCK_DURATION=300
+
+set -e
+
+case "${1:-add}" in
+    add)
+        ipset create -exist "$COMPACT_SET" hash:net timeout "$BLOCK_DURATION"
+
+        iptables -C INPUT -m set --match-set "$COMPACT_SET" src -j DROP 2>/dev/null ||
+            iptables -I INPUT 1 -m set --match-set "$COMPACT_SET" src -j DROP
+        ;;
+    del)
+        iptables -D INPUT -m set --match-set "$COMPACT_SET" src -j DROP || true
+        ipset destroy "$COMPACT_SET" 2>/dev/null || true
+        ;;
+    *)
+        echo "Usage: $0 [add|del]" >&2
+        exit 1
+        ;;
+esac
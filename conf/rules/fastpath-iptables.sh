@@ -0,0 +1,60 @@
+#!/bin/sh
+# ============================================================================
+# TCP SYN Flood Detector - Fast-path rule template (iptables + ipset)
+# ============================================================================
+#
+# Lets known-good sources (whitelisted, or well below syn_threshold) skip
+# NFQUEUE in the kernel for fastpath_timeout_s seconds.
+#
+# How it works:
+#   1. The detector returns NF_REPEAT with FASTPATH_MARK set for a
+#      known-good source.
+#   2. The packet re-runs INPUT, matches the mark, the source is added to
+#      FASTPATH_SET (with the set's timeout) and the packet is accepted.
+#   3. Later SYNs from that source match FASTPATH_SET and never reach
+#      NFQUEUE until the entry times out.
+#
+# Values must match the capture section of synflood-detector.conf:
+#   fastpath_mark, fastpath_ipset, fastpath_timeout_s, nfqueue_num
+#
+# The blacklist DROP rule must stay first so blocked sources never take
+# the fast path.
+#
+# Usage: sudo sh fastpath-iptables.sh [add|del]
+# ============================================================================
+
+FASTPATH_MARK=0x10000
+FASTPATH_SET=synflood_fastpath
+FASTPATH_TIMEOUT=60
+BLACKLIST_SET=synflood_blacklist
+QUEUE_NUM=0
+
+set -e
+
+case "${1:-add}" in
+    add)
+        ipset create -exist "$FASTPATH_SET" hash:ip timeout "$FASTPATH_TIMEOUT"
+
+        # Rules are inserted in reverse order, each at position 1
+        iptables -C INPUT -p tcp --syn -j NFQUEUE --queue-num "$QUEUE_NUM" 2>/dev/null ||
+            iptables -I INPUT 1 -p tcp --syn -j NFQUEUE --queue-num "$QUEUE_NUM"
+        iptables -I INPUT 1 -p tcp --syn -m mark --mark "$FASTPATH_MARK/$FASTPATH_MARK" -j ACCEPT
+        iptables -I INPUT 1 -p tcp --syn -m mark --mark "$FASTPATH_MARK/$FASTPATH_MARK" \
+            -j SET --add-set "$FASTPATH_SET" src --exist
+        iptables -I INPUT 1 -p tcp --syn -m set --match-set "$FASTPATH_SET" src -j ACCEPT
+        iptables -C INPUT -m set --match-set "$BLACKLIST_SET" src -j DROP 2>/dev/null &&
+            iptables -D INPUT -m set --match-set "$BLACKLIST_SET" src -j DROP
+        iptables -I INPUT 1 -m set --match-set "$BLACKLIST_SET" src -j DROP
+        ;;
+    del)
+        iptables -D INPUT -p tcp --syn -m set --match-set "$FASTPATH_SET" src -j ACCEPT || true
+        iptables -D INPUT -p tcp --syn -m mark --mark "$FASTPATH_MARK/$FASTPATH_MARK" \
+            -j SET --add-set "$FASTPATH_SET" src --exist || true
+        iptables -D INPUT -p tcp --syn -m mark --mark "$FASTPATH_MARK/$FASTPATH_MARK" -j ACCEPT || true
+        ipset destroy "$FASTPATH_SET" 2>/dev/null || true
+        ;;
+    *)
+        echo "Usage: $0 [add|del]" >&2
+        exit 1
+        ;;
+esac
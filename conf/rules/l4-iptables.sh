@@ -0,0 +1,55 @@
+#!/bin/sh
+# ============================================================================
+# TCP SYN Flood Detector - UDP/ICMP flood rule template (iptables + ipset)
+# ============================================================================
+#
+# Queues new UDP flows and ICMP echo requests to the detector and drops
+# them from sources in the per-protocol blacklists.
+#
+# Values must match synflood-detector.conf:
+#   detection.udp_threshold, detection.icmp_threshold,
+#   enforcement.udp_ipset, enforcement.icmp_ipset, capture.nfqueue_num
+#
+# Only packets starting a new conntrack flow are queued, so replies and
+# established UDP exchanges never reach the detector. Each datagram of a
+# spoofed or one-shot flood is a new flow and is counted.
+#
+# The DROP rules must stay ahead of the NFQUEUE rules so blocked sources
+# are dropped in the kernel.
+#
+# Usage: sudo sh l4-iptables.sh [add|del]
+# ============================================================================
+
+UDP_SET=synflood_blacklist_udp
+ICMP_SET=synflood_blacklist_icmp
+BLOCK_TIMEOUT=300
+QUEUE_NUM=0
+
+set -e
+
+case "${1:-add}" in
+    add)
+        # The daemon creates the sets too; creating them here lets the
+        # rules load before it starts
+        ipset create -exist "$UDP_SET" hash:ip timeout "$BLOCK_TIMEOUT"
+        ipset create -exist "$ICMP_SET" hash:ip timeout "$BLOCK_TIMEOUT"
+
+        # Rules are inserted in reverse order, each at position 1
+        iptables -I INPUT 1 -p icmp --icmp-type echo-request -j NFQUEUE --queue-num "$QUEUE_NUM"
+        iptables -I INPUT 1 -p udp -m conntrack --ctstate NEW -j NFQUEUE --queue-num "$QUEUE_NUM"
+        iptables -I INPUT 1 -p icmp -m set --match-set "$ICMP_SET" src -j DROP
+        iptables -I INPUT 1 -p udp -m set --match-set "$UDP_SET" src -j DROP
+        ;;
+    del)
+        iptables -D INPUT -p udp -m set --match-set "$UDP_SET" src -j DROP || true
+        iptables -D INPUT -p icmp -m set --match-set "$ICMP_SET" src -j DROP || true
+        iptables -D INPUT -p udp -m conntrack --ctstate NEW -j NFQUEUE --queue-num "$QUEUE_NUM" || true
+        iptables -D INPUT -p icmp --icmp-type echo-request -j NFQUEUE --queue-num "$QUEUE_NUM" || true
+        ipset destroy "$UDP_SET" 2>/dev/null || true
+        ipset destroy "$ICMP_SET" 2>/dev/null || true
+        ;;
+    *)
+        echo "Usage: $0 [add|del]" >&2
+        exit 1
+        ;;
+esac
@@ -27,6 +27,28 @@
 #define DEFAULT_HASH_BUCKETS 4096
 #define DEFAULT_NFQUEUE_NUM 0
 #define DEFAULT_IPSET_NAME "synflood_blacklist"
+#define DEFAULT_FASTPATH_IPSET_NAME "synflood_fastpath"
+#define DEFAULT_FASTPATH_MAX_SYN 10
+#define DEFAULT_FASTPATH_TIMEOUT_S 60
+#define DEFAULT_OVERLOAD_MAX_SAMPLE 64
+#define DEFAULT_COMPACT_IPSET_NAME "synflood_blacklist_net"
+#define DEFAULT_COMPACT_MIN_DENSITY 50
+#define DEFAULT_COMPACT_MIN_ENTRIES 256
+#define DEFAULT_VICTIM_SOURCE_THRESHOLD 20
+#define DEFAULT_VICTIM_HOLD_S 10
+#define DEFAULT_MAX_TRACKED_VICTIMS 1024
+#define DEFAULT_SCAN_WINDOW_S 60
+#define DEFAULT_MAX_TRACKED_SCANNERS 4096
+#define DEFAULT_ASN_SOURCE_THRESHOLD 20
+#define DEFAULT_ASN_HOLD_S 30
+#define DEFAULT_MAX_TRACKED_ASNS 1024
+#define DEFAULT_ASN_IPSET_NAME "synflood_blacklist_asn"
+#define DEFAULT_NETNS_WORKERS 1
+#define SYNFLOOD_MAX_NETNS 32
+#define DEFAULT_PEERSYNC_BATCH_MS 200
+#define DEFAULT_PEERSYNC_MAX_AGE_S 30
+#define DEFAULT_PEERSYNC_TTL 1
+#define SYNFLOOD_MAX_PEERS 32
 #define DEFAULT_CONFIG_PATH "/etc/synflood-detector/synflood-detector.conf"
 #define DEFAULT_WHITELIST_PATH "/etc/synflood-detector/whitelist.conf"
 #define DEFAULT_METRICS_SOCKET "/var/run/synflood-detector.sock"
@@ -45,6 +67,25 @@
 #define TCP_STATE_TIME_WAIT 0x06
 #define TCP_STATE_LISTEN 0x0A
 
+/* Packet classes counted separately per source: TCP flag classes, then
+ * whole L4 protocols */
+typedef enum
+{
+    FLOOD_CLASS_SYN = 0, /* SYN without ACK/RST: connection attempts */
+    FLOOD_CLASS_SYNACK,  /* SYN+ACK: reflection of SYNs spoofed with our address */
+    FLOOD_CLASS_ACK,     /* ACK without SYN/RST */
+    FLOOD_CLASS_RST,     /* Any RST */
+    FLOOD_CLASS_UDP,     /* Any UDP datagram */
+    FLOOD_CLASS_ICMP,    /* Any ICMP message */
+    FLOOD_CLASS_COUNT,
+    FLOOD_CLASS_NONE = FLOOD_CLASS_COUNT, /* Not counted (other protocol or TCP flags) */
+} flood_class_t;
+
+/* Classes from here on are whole L4 protocols rather than TCP flag classes;
+ * each can be blocked in an ipset of its own (udp_ipset, icmp_ipset) */
+#define FLOOD_CLASS_FIRST_PROTO FLOOD_CLASS_UDP
+#define FLOOD_PROTO_COUNT (FLOOD_CLASS_COUNT - FLOOD_CLASS_FIRST_PROTO)
+
 /* Utility macros */
 #define NSEC_PER_SEC 1000000000ULL
 #define MSEC_PER_SEC 1000ULL
@@ -71,8 +112,27 @@ typedef enum
     EVENT_BLOCKED,
     EVENT_UNBLOCKED,
     EVENT_WHITELISTED,
+    EVENT_PEER_BLOCKED, /* Block announced by another node */
+    EVENT_SCAN,         /* Port scan; counts are estimated distinct ports and hosts */
 } event_type_t;
 
+/* Per-namespace settings, 0 / empty string = inherit the global value */
+typedef struct
+{
+    char name[64];           /* Label used in logs and metrics */
+    char path[256];          /* e.g. /var/run/netns/NAME or /proc/PID/ns/net */
+    uint32_t syn_threshold;
+    uint32_t block_duration_s;
+    char ipset_name[256];    /* Set created inside the namespace */
+} netns_config_t;
+
+/* Unicast destination for blocklist sharing */
+typedef struct
+{
+    uint32_t ip;   /* Network byte order */
+    uint16_t port; /* Host byte order */
+} peer_addr_t;
+
 /* Configuration structure */
 typedef struct
 {
@@ -80,19 +140,92 @@ typedef struct
     uint32_t syn_threshold;
     uint32_t window_ms;
     uint32_t proc_check_interval_s;
+    bool validate_syn_recv; /* Confirm detections against /proc/net/tcp */
+
+    /* Per-source packets per window of the other flag classes, 0 = ignored */
+    uint32_t synack_threshold;
+    uint32_t ack_threshold;
+    uint32_t rst_threshold;
+    uint32_t udp_threshold;
+    uint32_t icmp_threshold;
+
+    /* Victim (destination IP/port) detection, victim_threshold 0 = disabled */
+    uint32_t victim_threshold;        /* SYNs per window to one destination */
+    uint32_t victim_source_threshold; /* Per-source threshold towards a victim */
+    uint32_t victim_hold_s;           /* Attack state lingers this long */
+
+    /* Port scan detection, both thresholds 0 = disabled */
+    uint32_t scan_port_threshold; /* Distinct destination ports per scan window */
+    uint32_t scan_host_threshold; /* Distinct destination hosts per scan window */
+    uint32_t scan_window_s;
+    bool scan_block;              /* Block scanners like flooding sources */
+
+    /* Per-origin-AS aggregation, empty asn_map_file = disabled */
+    char asn_map_file[PATH_MAX];      /* Snapshot built by synflood-asnmap */
+    uint32_t asn_threshold;           /* SYNs per window from one AS, 0 = rates only */
+    uint32_t asn_source_threshold;    /* Per-source threshold inside such an AS */
+    uint32_t asn_hold_s;              /* Over-threshold state lingers this long */
+    bool asn_block;                   /* Block the AS's prefixes in asn_ipset */
+
+    /* Timestamp source: 0 = read CLOCK_MONOTONIC every time, else cache it */
+    uint32_t clock_resolution_us;
 
     /* Enforcement parameters */
     uint32_t block_duration_s;
     char ipset_name[256];
+    bool inpath_drop; /* NF_DROP queued packets from blocked sources */
+
+    /* Blacklists for UDP and ICMP floods, empty = ipset_name (block everything) */
+    char udp_ipset[256];
+    char icmp_ipset[256];
+
+    /* hash:net set receiving whole-AS blocks (asn_block) */
+    char asn_ipset[256];
+
+    /* Blocklist compaction into CIDR entries, compact_min_prefix 0 = disabled */
+    uint32_t compact_min_prefix;  /* Widest aggregate allowed (8-31) */
+    uint32_t compact_min_density; /* Percent of a prefix that must be blocked */
+    uint32_t compact_min_entries; /* Leave the set alone while it is smaller */
+    char compact_ipset[256];      /* hash:net set holding the aggregates */
 
     /* Resource limits */
     uint32_t max_tracked_ips;
     uint32_t hash_buckets;
+    uint32_t max_tracked_victims; /* Destination table size (power of 2) */
+    uint32_t max_tracked_scanners; /* Scan table size (power of 2) */
+    uint32_t max_tracked_asns;    /* AS rate table size (power of 2) */
+    uint32_t idle_timeout_s;      /* Free unblocked entries idle this long, 0 = never */
+    char tracker_shm[256];        /* Shared tracker segment name, empty = private */
 
     /* Capture configuration */
     uint16_t nfqueue_num;
     bool use_raw_socket;
 
+    /* Kernel fast path for known-good sources (NFQUEUE only) */
+    uint32_t fastpath_mark;       /* skb mark set in the verdict, 0 = disabled */
+    uint32_t fastpath_max_syn;    /* Max SYNs per completed window to qualify */
+    uint32_t fastpath_timeout_s;  /* How long a source bypasses NFQUEUE */
+    char fastpath_ipset[256];
+
+    /* Load shedding: largest 1-in-N sample rate under overload (1 = off) */
+    uint32_t overload_max_sample;
+
+    /* Additional network namespaces monitored by this daemon */
+    netns_config_t namespaces[SYNFLOOD_MAX_NETNS];
+    uint32_t netns_count;
+    uint32_t netns_workers; /* Threads servicing all namespace sockets */
+
+    /* Blocklist sharing with other nodes, peersync_port 0 = disabled */
+    uint16_t peersync_port;            /* UDP port listened on and sent to */
+    char peersync_group[64];           /* IPv4 multicast group, empty = peers only */
+    char peersync_bind[64];            /* Local address (and multicast interface), empty = any */
+    peer_addr_t peersync_peers[SYNFLOOD_MAX_PEERS];
+    uint32_t peersync_peer_count;
+    char peersync_key_file[PATH_MAX];  /* Shared 128-bit key, hex */
+    uint32_t peersync_batch_ms;        /* Announcements are batched this long */
+    uint32_t peersync_max_age_s;       /* Older announcements are rejected */
+    uint32_t peersync_ttl;             /* Multicast hop limit */
+
     /* Whitelist */
     char whitelist_file[PATH_MAX];
 
@@ -110,7 +243,13 @@ typedef struct
     uint64_t window_start_ns; /* Window start (CLOCK_MONOTONIC) */
     uint64_t last_seen_ns;    /* For LRU eviction */
     uint8_t blocked;          /* Currently in blacklist */
+    uint8_t whitelisted;      /* Cached whitelist verdict */
+    uint32_t whitelist_gen;   /* Whitelist generation the verdict was computed against */
     uint64_t block_expiry_ns; /* When to remove from blacklist */
+    uint32_t flood_count[FLOOD_CLASS_COUNT - 1]; /* Other classes' packets in current window */
+    uint64_t set_block_expiry_ns[FLOOD_PROTO_COUNT]; /* Blocked in udp_ipset / icmp_ipset until */
+    uint32_t asn;             /* Cached origin AS, 0 = not routed */
+    uint32_t asn_gen;         /* ASN map generation the origin was looked up in */
 } ip_tracker_t;
 
 /* Hash table entry with chaining */
@@ -118,6 +257,7 @@ typedef struct tracker_node
 {
     ip_tracker_t data;
     struct tracker_node *next;
+    uint32_t generation;   /* Table generation at creation */
 } tracker_node_t;
 
 /* Main tracking hash table */
@@ -127,7 +267,18 @@ typedef struct
     size_t bucket_count; /* Power of 2 for fast modulo */
     size_t entry_count;
     size_t max_entries;    /* LRU eviction threshold */
+    uint32_t generation;      /* Bumped by tracker_clear(); older nodes are stale */
+    uint64_t stale_before_ns; /* Entries last seen before this are stale */
+    size_t stale_count;       /* Cleared nodes not yet reclaimed */
+    size_t sweep_bucket;      /* Next bucket tracker_sweep() visits */
+    size_t sweep_pending;     /* Buckets left to sweep since the last clear */
     pthread_rwlock_t lock; /* Reader-writer lock for concurrency */
+    uint64_t *wl_cache;    /* Whitelisted sources: generation << 32 | IP, direct-mapped */
+    size_t wl_mask;
+    volatile uint32_t *whitelist_gen; /* Bumped on every whitelist load, never 0 */
+    volatile uint32_t *asnmap_gen;    /* Bumped on every ASN map load, never 0 */
+    volatile uint32_t local_gen[2];   /* Backs the generations of a private table */
+    struct tracker_shm *shm; /* Shared-memory backend, NULL = private table */
 } tracker_table_t;
 
 /* Whitelist entry (Patricia trie node) */
@@ -140,32 +291,57 @@ typedef struct whitelist_node
     struct whitelist_node *right;
 } whitelist_node_t;
 
+/* Flattened whitelist for batch lookups (parallel arrays, see simd_cidr_any) */
+typedef struct
+{
+    uint32_t *prefixes;
+    uint32_t *masks;
+    size_t count;
+} whitelist_flat_t;
+
 /* Metrics structure */
 typedef struct
 {
     uint64_t packets_total;
     uint64_t syn_packets_total;
+    uint64_t class_packets_total[FLOOD_CLASS_COUNT];    /* Analysed packets per class */
+    uint64_t class_detections_total[FLOOD_CLASS_COUNT]; /* Blocks per class */
     uint64_t blocked_ips_current;
     uint64_t detections_total;
     uint64_t false_positives_total;
     uint64_t whitelist_hits_total;
+    uint64_t packets_dropped_total;
+    uint64_t fastpath_marked_total;
+    uint64_t capture_drops_total;  /* Kernel-side queue/ring drops */
+    uint64_t shed_packets_total;   /* Packets skipped by load shedding */
+    uint32_t sample_rate;          /* Current 1-in-N sample rate */
     uint64_t proc_parse_errors;
     double latency_p99_ms;
     double cpu_percent;
     uint64_t memory_kb;
 } metrics_t;
 
+/* Handles a detection context uses to act inside another network namespace */
+typedef struct
+{
+    int ns_fd;              /* setns() target for ipset commands */
+    int proc_tcp_fd;        /* /proc/net/tcp opened inside the namespace */
+    const char *ipset_name; /* Blacklist inside the namespace */
+} netns_binding_t;
+
 /* Global context structure */
 typedef struct
 {
     synflood_config_t *config;
     tracker_table_t *tracker;
     whitelist_node_t *whitelist_root;
+    struct asnmap *asnmap;           /* Prefix to origin AS snapshot, NULL = none */
     metrics_t metrics;
     pthread_mutex_t metrics_lock;
     volatile bool running;
     int nfqueue_fd;
     int metrics_socket_fd;
+    const netns_binding_t *netns; /* NULL = the daemon's own namespace */
 } app_context_t;
 
 /* Function return codes */
@@ -178,14 +354,30 @@ typedef enum
     SYNFLOOD_ENOTFOUND = -4,
 } synflood_ret_t;
 
+/* Pluggable time source behind get_monotonic_ns() (see src/clock.h).
+ * Implementations embed this as their first member. */
+typedef struct synflood_clock
+{
+    uint64_t (*now_ns)(struct synflood_clock *clock);
+} synflood_clock_t;
+
+/* Installed time source; NULL reads CLOCK_MONOTONIC */
+extern synflood_clock_t *synflood_clock;
+
 /* Time utilities */
-static inline uint64_t get_monotonic_ns(void)
+static inline uint64_t clock_system_ns(void)
 {
     struct timespec ts;
     clock_gettime(CLOCK_MONOTONIC, &ts);
     return (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
 }
 
+static inline uint64_t get_monotonic_ns(void)
+{
+    synflood_clock_t *clock = __atomic_load_n(&synflood_clock, __ATOMIC_ACQUIRE);
+    return clock ? clock->now_ns(clock) : clock_system_ns();
+}
+
 static inline uint64_t ms_to_ns(uint32_t ms)
 {
     return (uint64_t)ms * NSEC_PER_MSEC;
@@ -331,6 +331,12 @@ install_binary() {
     install -D -m 0755 "${extract_dir}/bin/synflood-detector" "${BIN_DIR}/synflood-detector"
 
     success "Binary installed to ${BIN_DIR}/synflood-detector"
+
+    # Compiled control client (optional in older tarballs)
+    if [[ -f "${extract_dir}/bin/synflood-ctl-native" ]]; then
+        install -D -m 0755 "${extract_dir}/bin/synflood-ctl-native" "${BIN_DIR}/synflood-ctl-native"
+        success "Control client installed to ${BIN_DIR}/synflood-ctl-native"
+    fi
 }
 
 install_config_files() {
@@ -0,0 +1,578 @@
+/*
+ * asnmap.c - Prefix to origin AS lookup from a routing table snapshot
+ * TCP SYN Flood Detector
+ */
+
+#include "asnmap.h"
+#include "../observe/logger.h"
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ASNMAP_BYTE_ORDER 0x01020304u
+
+/* Nested prefixes of distinct lengths: at most 33 open at once */
+#define ASNMAP_MAX_DEPTH 33
+
+typedef struct
+{
+    uint32_t start; /* Host byte order */
+    uint32_t end;   /* Last address, inclusive */
+    uint32_t asn;
+    uint32_t seq;   /* Input order, later duplicates win */
+} asnmap_prefix_t;
+
+typedef struct
+{
+    uint32_t *starts;
+    uint32_t *asns;
+    size_t count;
+    size_t capacity;
+    bool failed;
+} range_list_t;
+
+typedef struct asnmap_retired
+{
+    asnmap_t *map;
+    uint64_t retired_ns;
+    struct asnmap_retired *next;
+} asnmap_retired_t;
+
+static asnmap_retired_t *retired_head = NULL;
+static pthread_mutex_t asnmap_replace_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Parse "1.2.3.0/24" into a host-order range; false for IPv6 or garbage */
+static bool parse_prefix(const char *text, asnmap_prefix_t *out) {
+    char buf[INET_ADDRSTRLEN + 4];
+    size_t len = strlen(text);
+    if (len >= sizeof(buf)) {
+        return false;
+    }
+    memcpy(buf, text, len + 1);
+
+    char *slash = strchr(buf, '/');
+    if (!slash) {
+        return false;
+    }
+    *slash = '\0';
+
+    char *end;
+    unsigned long prefix_len = strtoul(slash + 1, &end, 10);
+    if (end == slash + 1 || *end != '\0' || prefix_len > 32) {
+        return false;
+    }
+
+    struct in_addr addr;
+    if (inet_pton(AF_INET, buf, &addr) != 1) {
+        return false;
+    }
+
+    uint32_t mask = prefix_len == 0 ? 0 : 0xFFFFFFFFu << (32 - prefix_len);
+    out->start = ntohl(addr.s_addr) & mask;
+    out->end = out->start | ~mask;
+    return true;
+}
+
+/* First AS number in "13335", "AS13335", "13335_209242" or "{64512,64513}" */
+static bool parse_asn(const char *text, uint32_t *asn) {
+    while (*text == '{' || *text == 'A' || *text == 'a' || *text == 'S' || *text == 's') {
+        text++;
+    }
+    if (!isdigit((unsigned char)*text)) {
+        return false;
+    }
+
+    char *end;
+    unsigned long value = strtoul(text, &end, 10);
+    if (value > UINT32_MAX) {
+        return false;
+    }
+    *asn = (uint32_t)value;
+    return true;
+}
+
+/* One snapshot line; false for comments, IPv6 and anything unparseable */
+static bool parse_line(char *line, asnmap_prefix_t *out) {
+    char *hash = strchr(line, '#');
+    if (hash) {
+        *hash = '\0';
+    }
+
+    if (strchr(line, '|')) {
+        /* bgpdump -m: TYPE|TIME|B|PEER_IP|PEER_AS|PREFIX|AS_PATH|ORIGIN|... */
+        char *fields[7];
+        size_t n = 0;
+        char *save = NULL;
+        for (char *f = strtok_r(line, "|", &save); f && n < ARRAY_SIZE(fields);
+             f = strtok_r(NULL, "|", &save)) {
+            fields[n++] = f;
+        }
+        if (n < 7 || !parse_prefix(fields[5], out)) {
+            return false;
+        }
+
+        /* The origin is the last AS of the path */
+        char *origin = NULL;
+        save = NULL;
+        for (char *t = strtok_r(fields[6], " \t\r\n", &save); t; t = strtok_r(NULL, " \t\r\n", &save)) {
+            origin = t;
+        }
+        return origin && parse_asn(origin, &out->asn);
+    }
+
+    char *save = NULL;
+    char *prefix = strtok_r(line, " \t\r\n", &save);
+    char *asn = strtok_r(NULL, " \t\r\n", &save);
+    return prefix && asn && parse_prefix(prefix, out) && parse_asn(asn, &out->asn);
+}
+
+static int compare_prefix(const void *a, const void *b) {
+    const asnmap_prefix_t *pa = a;
+    const asnmap_prefix_t *pb = b;
+
+    /* By start, then widest first, then input order */
+    if (pa->start != pb->start) {
+        return pa->start < pb->start ? -1 : 1;
+    }
+    if (pa->end != pb->end) {
+        return pa->end > pb->end ? -1 : 1;
+    }
+    return pa->seq < pb->seq ? -1 : (pa->seq > pb->seq);
+}
+
+/* Append a range; a range continuing the previous AS extends it instead */
+static void range_emit(range_list_t *list, uint64_t start, uint32_t asn) {
+    if (list->failed || (list->count > 0 && list->asns[list->count - 1] == asn)) {
+        return;
+    }
+
+    if (list->count == list->capacity) {
+        size_t grown = MAX(list->capacity * 2, (size_t)4096);
+        uint32_t *starts = realloc(list->starts, grown * sizeof(uint32_t));
+        if (starts) {
+            list->starts = starts;
+        }
+        uint32_t *asns = realloc(list->asns, grown * sizeof(uint32_t));
+        if (asns) {
+            list->asns = asns;
+        }
+        if (!starts || !asns) {
+            list->failed = true;
+            return;
+        }
+        list->capacity = grown;
+    }
+
+    list->starts[list->count] = (uint32_t)start;
+    list->asns[list->count] = asn;
+    list->count++;
+}
+
+/* Flatten sorted, possibly nested prefixes into disjoint ranges: every
+ * address takes the AS of the most specific prefix covering it */
+static void flatten(const asnmap_prefix_t *prefixes, size_t n, range_list_t *list) {
+    asnmap_prefix_t stack[ASNMAP_MAX_DEPTH];
+    size_t depth = 0;
+    uint64_t cur = 0; /* First address not yet emitted */
+
+    for (size_t i = 0; i < n; i++) {
+        const asnmap_prefix_t *p = &prefixes[i];
+
+        /* Close prefixes ending before this one */
+        while (depth > 0 && stack[depth - 1].end < p->start) {
+            const asnmap_prefix_t *top = &stack[--depth];
+            if (cur <= top->end) {
+                range_emit(list, cur, top->asn);
+                cur = (uint64_t)top->end + 1;
+            }
+        }
+
+        /* Same prefix again: the later line wins */
+        if (depth > 0 && stack[depth - 1].start == p->start && stack[depth - 1].end == p->end) {
+            stack[depth - 1].asn = p->asn;
+            continue;
+        }
+
+        if (cur < p->start) {
+            range_emit(list, cur, depth > 0 ? stack[depth - 1].asn : 0);
+            cur = p->start;
+        }
+        stack[depth++] = *p;
+    }
+
+    while (depth > 0) {
+        const asnmap_prefix_t *top = &stack[--depth];
+        if (cur <= top->end) {
+            range_emit(list, cur, top->asn);
+            cur = (uint64_t)top->end + 1;
+        }
+    }
+    if (cur <= UINT32_MAX) {
+        range_emit(list, cur, 0);
+    }
+}
+
+static synflood_ret_t write_map(const char *out_path, const range_list_t *list, size_t prefixes) {
+    uint32_t *index = malloc(ASNMAP_INDEX_SIZE * sizeof(uint32_t));
+    if (!index) {
+        return SYNFLOOD_ENOMEM;
+    }
+
+    /* index[h]: last range starting at or below h << 16 */
+    size_t r = 0;
+    for (uint32_t h = 0; h < ASNMAP_INDEX_SIZE - 1; h++) {
+        while (r + 1 < list->count && list->starts[r + 1] <= h << 16) {
+            r++;
+        }
+        index[h] = (uint32_t)r;
+    }
+    index[ASNMAP_INDEX_SIZE - 1] = (uint32_t)(list->count - 1);
+
+    asnmap_header_t header = {
+        .version = ASNMAP_VERSION,
+        .byte_order = ASNMAP_BYTE_ORDER,
+        .ranges = (uint32_t)list->count,
+        .prefixes = (uint32_t)MIN(prefixes, (size_t)UINT32_MAX),
+        .built_at = (uint64_t)time(NULL),
+    };
+    memcpy(header.magic, ASNMAP_MAGIC, sizeof(header.magic));
+
+    char tmp_path[PATH_MAX];
+    if ((size_t)snprintf(tmp_path, sizeof(tmp_path), "%s.XXXXXX", out_path) >= sizeof(tmp_path)) {
+        free(index);
+        return SYNFLOOD_EINVAL;
+    }
+
+    int fd = mkstemp(tmp_path);
+    if (fd < 0) {
+        LOG_ERROR("Failed to create %s: %s", tmp_path, strerror(errno));
+        free(index);
+        return SYNFLOOD_ERROR;
+    }
+    fchmod(fd, 0644);
+
+    FILE *fp = fdopen(fd, "wb");
+    bool ok = fp != NULL &&
+              fwrite(&header, sizeof(header), 1, fp) == 1 &&
+              fwrite(index, sizeof(uint32_t), ASNMAP_INDEX_SIZE, fp) == ASNMAP_INDEX_SIZE &&
+              fwrite(list->starts, sizeof(uint32_t), list->count, fp) == list->count &&
+              fwrite(list->asns, sizeof(uint32_t), list->count, fp) == list->count;
+    if (fp) {
+        ok = fclose(fp) == 0 && ok;
+    } else {
+        close(fd);
+    }
+    free(index);
+
+    if (!ok || rename(tmp_path, out_path) != 0) {
+        LOG_ERROR("Failed to write ASN map %s: %s", out_path, strerror(errno));
+        unlink(tmp_path);
+        return SYNFLOOD_ERROR;
+    }
+
+    return SYNFLOOD_OK;
+}
+
+synflood_ret_t asnmap_build(const char *in_path, const char *out_path, size_t *prefixes,
+                            size_t *ranges) {
+    if (!in_path || !out_path) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    FILE *fp = fopen(in_path, "r");
+    if (!fp) {
+        LOG_ERROR("Failed to open %s: %s", in_path, strerror(errno));
+        return SYNFLOOD_ERROR;
+    }
+
+    asnmap_prefix_t *list = NULL;
+    size_t count = 0, capacity = 0, skipped = 0;
+    char line[4096];
+    synflood_ret_t ret = SYNFLOOD_OK;
+
+    while (fgets(line, sizeof(line), fp)) {
+        asnmap_prefix_t p;
+        if (!parse_line(line, &p)) {
+            skipped++;
+            continue;
+        }
+
+        if (count == capacity) {
+            size_t grown = MAX(capacity * 2, (size_t)65536);
+            asnmap_prefix_t *bigger = realloc(list, grown * sizeof(*list));
+            if (!bigger) {
+                ret = SYNFLOOD_ENOMEM;
+                break;
+            }
+            list = bigger;
+            capacity = grown;
+        }
+        p.seq = (uint32_t)count;
+        list[count++] = p;
+    }
+    fclose(fp);
+
+    if (ret == SYNFLOOD_OK && count == 0) {
+        LOG_ERROR("No IPv4 prefixes in %s", in_path);
+        ret = SYNFLOOD_EINVAL;
+    }
+
+    range_list_t out = { 0 };
+    if (ret == SYNFLOOD_OK) {
+        qsort(list, count, sizeof(*list), compare_prefix);
+        flatten(list, count, &out);
+        if (out.failed) {
+            ret = SYNFLOOD_ENOMEM;
+        }
+    }
+
+    if (ret == SYNFLOOD_OK) {
+        ret = write_map(out_path, &out, count);
+    }
+
+    if (ret == SYNFLOOD_OK) {
+        LOG_INFO("ASN map %s built: %zu prefixes, %zu ranges (%zu lines skipped)",
+                 out_path, count, out.count, skipped);
+        if (prefixes) {
+            *prefixes = count;
+        }
+        if (ranges) {
+            *ranges = out.count;
+        }
+    }
+
+    free(list);
+    free(out.starts);
+    free(out.asns);
+    return ret;
+}
+
+/* Structural checks, so a damaged file can never send a lookup out of bounds */
+static bool asnmap_valid(const asnmap_t *map) {
+    const asnmap_header_t *h = map->header;
+    if (memcmp(h->magic, ASNMAP_MAGIC, sizeof(h->magic)) != 0 ||
+        h->version != ASNMAP_VERSION || h->byte_order != ASNMAP_BYTE_ORDER || h->ranges == 0) {
+        return false;
+    }
+    if (map->size != sizeof(asnmap_header_t) + ASNMAP_INDEX_SIZE * sizeof(uint32_t) +
+                     (size_t)h->ranges * 2 * sizeof(uint32_t)) {
+        return false;
+    }
+    if (map->starts[0] != 0) {
+        return false;
+    }
+    for (uint32_t i = 1; i < h->ranges; i++) {
+        if (map->starts[i] <= map->starts[i - 1]) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < ASNMAP_INDEX_SIZE; i++) {
+        if (map->index[i] >= h->ranges || (i > 0 && map->index[i] < map->index[i - 1])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+asnmap_t *asnmap_open(const char *path) {
+    if (!path || path[0] == '\0') {
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open ASN map %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(asnmap_header_t)) {
+        LOG_ERROR("ASN map %s is truncated", path);
+        close(fd);
+        return NULL;
+    }
+
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        LOG_ERROR("Failed to map ASN map %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    asnmap_t *map = calloc(1, sizeof(asnmap_t));
+    if (!map) {
+        munmap(base, (size_t)st.st_size);
+        return NULL;
+    }
+
+    const uint32_t *words = (const uint32_t *)((const char *)base + sizeof(asnmap_header_t));
+    map->base = base;
+    map->size = (size_t)st.st_size;
+    map->header = base;
+    map->index = words;
+    map->starts = words + ASNMAP_INDEX_SIZE;
+    map->asns = map->starts + map->header->ranges;
+
+    /* Lookups hop around the file; read-ahead would only waste cache */
+    madvise(base, map->size, MADV_RANDOM);
+
+    if (!asnmap_valid(map)) {
+        LOG_ERROR("ASN map %s is damaged or from another version (rebuild with synflood-asnmap)",
+                  path);
+        asnmap_close(map);
+        return NULL;
+    }
+
+    LOG_INFO("ASN map loaded: %s (%u prefixes, %u ranges, %zu KB)", path,
+             map->header->prefixes, map->header->ranges, map->size / 1024);
+    return map;
+}
+
+void asnmap_close(asnmap_t *map) {
+    if (!map) {
+        return;
+    }
+    munmap(map->base, map->size);
+    free(map);
+}
+
+uint32_t asnmap_lookup(const asnmap_t *map, uint32_t ip_addr) {
+    if (!map) {
+        return 0;
+    }
+
+    /* The answer lies between the ranges holding this /16 and the next */
+    uint32_t addr = ntohl(ip_addr);
+    uint32_t lo = map->index[addr >> 16];
+    uint32_t hi = map->index[(addr >> 16) + 1];
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        if (map->starts[mid] <= addr) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return map->asns[lo];
+}
+
+uint32_t asnmap_lookup_cached(const asnmap_t *map, uint32_t generation, ip_tracker_t *entry) {
+    if (!entry) {
+        return 0;
+    }
+
+    /* Result only changes when the map is replaced */
+    if (entry->asn_gen != generation) {
+        entry->asn = asnmap_lookup(map, entry->ip_addr);
+        entry->asn_gen = generation;
+    }
+
+    return entry->asn;
+}
+
+size_t asnmap_prefixes(const asnmap_t *map, uint32_t asn, uint32_t *nets, uint8_t *prefix_lens,
+                       size_t max) {
+    size_t count = 0;
+    uint32_t ranges = map->header->ranges;
+
+    for (uint32_t i = 0; i < ranges; i++) {
+        if (map->asns[i] != asn) {
+            continue;
+        }
+
+        /* Split the range into the fewest aligned CIDR blocks */
+        uint64_t start = map->starts[i];
+        uint64_t end = i + 1 < ranges ? (uint64_t)map->starts[i + 1] - 1 : UINT32_MAX;
+        while (start <= end) {
+            uint8_t len = 32;
+            while (len > 0) {
+                uint64_t size = 1ULL << (33 - len);
+                if ((start & (size - 1)) != 0 || start + size - 1 > end) {
+                    break;
+                }
+                len--;
+            }
+
+            if (count < max) {
+                nets[count] = htonl((uint32_t)start);
+                prefix_lens[count] = len;
+            }
+            count++;
+            start += 1ULL << (32 - len);
+        }
+    }
+
+    return count;
+}
+
+/* Unmap retired snapshots past the grace period (caller holds asnmap_replace_lock) */
+static void reclaim_locked(bool all) {
+    uint64_t now = get_monotonic_ns();
+    asnmap_retired_t **link = &retired_head;
+
+    /* Newest first: everything after the first expired snapshot is older */
+    while (*link && !all && now - (*link)->retired_ns < ms_to_ns(ASNMAP_GRACE_MS)) {
+        link = &(*link)->next;
+    }
+
+    asnmap_retired_t *r = *link;
+    *link = NULL;
+    while (r) {
+        asnmap_retired_t *next = r->next;
+        asnmap_close(r->map);
+        free(r);
+        r = next;
+    }
+}
+
+void asnmap_replace(asnmap_t **map, asnmap_t *new_map, volatile uint32_t *generation) {
+    if (!map) {
+        return;
+    }
+
+    pthread_mutex_lock(&asnmap_replace_lock);
+
+    asnmap_t *old_map = *map;
+
+    /* Map first, then generation: readers load them in the opposite order */
+    __atomic_store_n(map, new_map, __ATOMIC_RELEASE);
+    if (generation) {
+        /* A shared tracker's generation is bumped by several processes */
+        uint32_t cur = __atomic_load_n(generation, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(generation, &cur, cur + 1 ? cur + 1 : 1, false,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+
+    if (old_map) {
+        asnmap_retired_t *r = malloc(sizeof(*r));
+        if (r) {
+            r->map = old_map;
+            r->retired_ns = get_monotonic_ns();
+            r->next = retired_head;
+            retired_head = r;
+        } else {
+            /* Readers may still be on it: leaking beats unmapping under them */
+            LOG_WARN("Out of memory retiring the old ASN map; %zu KB leaked",
+                     old_map->size / 1024);
+        }
+    }
+    reclaim_locked(false);
+
+    pthread_mutex_unlock(&asnmap_replace_lock);
+}
+
+void asnmap_reclaim(bool all) {
+    pthread_mutex_lock(&asnmap_replace_lock);
+    reclaim_locked(all);
+    pthread_mutex_unlock(&asnmap_replace_lock);
+}
@@ -0,0 +1,132 @@
+/*
+ * asnmap.h - Prefix to origin AS lookup from a routing table snapshot
+ * TCP SYN Flood Detector
+ *
+ * A routing table (prefix -> origin AS) is flattened offline into sorted,
+ * disjoint address ranges, so longest-prefix match becomes "last range
+ * starting at or below the address". A 65536-entry index on the top 16
+ * address bits narrows the binary search to the ranges of one /16. The
+ * file is mapped read-only and shared through the page cache.
+ *
+ * File layout (host byte order, built by synflood-asnmap):
+ *   [asnmap_header_t][uint32 index x ASNMAP_INDEX_SIZE]
+ *   [uint32 range start x ranges][uint32 origin AS x ranges]
+ */
+
+#ifndef SYNFLOOD_ASNMAP_H
+#define SYNFLOOD_ASNMAP_H
+
+#include "common.h"
+
+#define ASNMAP_MAGIC "SFASNMAP"
+#define ASNMAP_VERSION 1
+
+/* One entry per /16, plus a sentinel */
+#define ASNMAP_INDEX_SIZE 65537
+
+/* A replaced map is unmapped this long after being unpublished, when no
+ * lock-free reader can still be searching it */
+#define ASNMAP_GRACE_MS 1000
+
+typedef struct
+{
+    char magic[8];       /* ASNMAP_MAGIC, not NUL-terminated */
+    uint32_t version;
+    uint32_t byte_order; /* 0x01020304 as written by the builder */
+    uint32_t ranges;     /* Disjoint ranges, the first starting at 0.0.0.0 */
+    uint32_t prefixes;   /* Prefixes read from the snapshot */
+    uint64_t built_at;   /* Unix time of the conversion */
+} asnmap_header_t;
+
+_Static_assert(sizeof(asnmap_header_t) == 32, "asnmap_header_t layout is part of the file format");
+
+/* A mapped snapshot */
+typedef struct asnmap
+{
+    void *base;
+    size_t size;
+    const asnmap_header_t *header;
+    const uint32_t *index;  /* index[h]: range holding address h << 16 */
+    const uint32_t *starts; /* Range starts, host byte order, ascending */
+    const uint32_t *asns;   /* Origin AS of each range, 0 = not routed */
+} asnmap_t;
+
+/**
+ * Convert a text routing table snapshot into the mapped format
+ * Accepts "PREFIX/LEN ASN" lines (as written by pyasn or "show ip bgp"
+ * post-processing; "AS" prefixes and multi-origin "A_B" or "{A,B}" take
+ * the first AS) and "bgpdump -m" lines, whose AS path ends in the origin.
+ * IPv6 prefixes and comments are skipped; a more specific prefix wins,
+ * and among duplicates the last line wins. The output is written to a
+ * temporary file and renamed, so a running daemon never sees it half done.
+ * @param in_path Text snapshot
+ * @param out_path Map file to create
+ * @param prefixes Output: prefixes read (may be NULL)
+ * @param ranges Output: ranges written (may be NULL)
+ * @return SYNFLOOD_OK, SYNFLOOD_EINVAL if nothing usable was read,
+ *         SYNFLOOD_ENOMEM or SYNFLOOD_ERROR
+ */
+synflood_ret_t asnmap_build(const char *in_path, const char *out_path, size_t *prefixes,
+                            size_t *ranges);
+
+/**
+ * Map a snapshot file and validate its structure
+ * @param path Map file written by asnmap_build
+ * @return Mapped snapshot or NULL on error
+ */
+asnmap_t *asnmap_open(const char *path);
+
+/**
+ * Unmap a snapshot (no reader may still be using it)
+ * @param map Snapshot (may be NULL)
+ */
+void asnmap_close(asnmap_t *map);
+
+/**
+ * Look up the origin AS of an address
+ * @param map Snapshot (may be NULL)
+ * @param ip_addr Address (network byte order)
+ * @return Origin AS, 0 if not routed or no map
+ */
+uint32_t asnmap_lookup(const asnmap_t *map, uint32_t ip_addr);
+
+/**
+ * Look up the origin AS of a tracked source, using the result cached in its
+ * tracker entry. The map is only searched when the cached result belongs to
+ * another map generation.
+ * @param map Published snapshot (may be NULL)
+ * @param generation Current map generation
+ * @param entry Tracker entry of the source
+ * @return Origin AS, 0 if not routed or no map
+ */
+uint32_t asnmap_lookup_cached(const asnmap_t *map, uint32_t generation, ip_tracker_t *entry);
+
+/**
+ * List the CIDR blocks originated by an AS (adjacent ranges are merged)
+ * @param map Snapshot
+ * @param asn Origin AS
+ * @param nets Output: network addresses (network byte order)
+ * @param prefix_lens Output: prefix lengths
+ * @param max Capacity of nets and prefix_lens
+ * @return Number of blocks; more than max if the output was truncated
+ */
+size_t asnmap_prefixes(const asnmap_t *map, uint32_t asn, uint32_t *nets, uint8_t *prefix_lens,
+                       size_t max);
+
+/**
+ * Publish a new snapshot (e.g. after a reload) and retire the old one
+ * @param map Pointer to the published snapshot pointer
+ * @param new_map New snapshot (may be NULL)
+ * @param generation Map generation to bump after publishing (may be NULL)
+ */
+void asnmap_replace(asnmap_t **map, asnmap_t *new_map, volatile uint32_t *generation);
+
+/**
+ * Unmap retired snapshots
+ * Replacements reclaim on their own; call with all=true at shutdown, once
+ * no reader is left.
+ * @param all Unmap everything, not only snapshots past the grace period
+ */
+void asnmap_reclaim(bool all);
+
+#endif /* SYNFLOOD_ASNMAP_H */
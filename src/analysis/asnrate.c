@@ -0,0 +1,244 @@
+/*
+ * asnrate.c - Per-origin-AS SYN rate table
+ * TCP SYN Flood Detector
+ *
+ * Fixed-size open-addressed table keyed by AS number, managed like the
+ * victim table: entries are never deleted, and when a probe sequence is
+ * full the least recently seen AS not over its threshold is recycled in
+ * place.
+ */
+
+#include "asnrate.h"
+#include "../observe/logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    uint32_t asn;
+    uint8_t in_use;
+    uint8_t flagged;          /* Episode logged, end not yet logged */
+    uint8_t block_pending;    /* asn_block due, not yet taken by asnrate_take_blocks */
+    uint32_t syn_count;       /* Current window */
+    uint32_t syn_rate;        /* SYN/s of the last completed window */
+    uint64_t window_start_ns;
+    uint64_t last_seen_ns;
+    uint64_t hold_until_ns;   /* Over threshold while now < this */
+} asnrate_entry_t;
+
+static asnrate_entry_t *asns = NULL;
+static size_t asn_mask = 0;
+static uint64_t asn_episodes_total = 0;
+static pthread_mutex_t asn_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline size_t asnrate_slot(uint32_t asn) {
+    return ip_hash(asn, asn_mask + 1);
+}
+
+synflood_ret_t asnrate_init(size_t max_entries) {
+    if (max_entries == 0 || (max_entries & (max_entries - 1)) != 0) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    asnrate_cleanup();
+
+    asnrate_entry_t *table = calloc(max_entries, sizeof(asnrate_entry_t));
+    if (!table) {
+        return SYNFLOOD_ENOMEM;
+    }
+
+    pthread_mutex_lock(&asn_lock);
+    asns = table;
+    asn_mask = max_entries - 1;
+    asn_episodes_total = 0;
+    pthread_mutex_unlock(&asn_lock);
+
+    LOG_INFO("AS rate table initialized: %zu origin ASes", max_entries);
+    return SYNFLOOD_OK;
+}
+
+void asnrate_cleanup(void) {
+    pthread_mutex_lock(&asn_lock);
+    free(asns);
+    asns = NULL;
+    asn_mask = 0;
+    pthread_mutex_unlock(&asn_lock);
+}
+
+bool asnrate_record(uint32_t asn, uint32_t weight, uint64_t now,
+                    const synflood_config_t *config, bool *started) {
+    pthread_mutex_lock(&asn_lock);
+
+    if (!asns) {
+        pthread_mutex_unlock(&asn_lock);
+        return false;
+    }
+
+    size_t idx = asnrate_slot(asn);
+    asnrate_entry_t *entry = NULL;
+    asnrate_entry_t *oldest = NULL;
+
+    for (size_t probe = 0; probe < ASNRATE_PROBE_LIMIT; probe++) {
+        asnrate_entry_t *e = &asns[(idx + probe) & asn_mask];
+
+        if (!e->in_use) {
+            /* No deletions, so the first hole ends the probe sequence */
+            memset(e, 0, sizeof(*e));
+            entry = e;
+            break;
+        }
+        if (e->asn == asn) {
+            entry = e;
+            break;
+        }
+        if (now >= e->hold_until_ns && (!oldest || e->last_seen_ns < oldest->last_seen_ns)) {
+            oldest = e;
+        }
+    }
+
+    if (!entry) {
+        if (!oldest) {
+            /* Every candidate slot is an AS over threshold: keep tracking those */
+            pthread_mutex_unlock(&asn_lock);
+            return false;
+        }
+        memset(oldest, 0, sizeof(*oldest));
+        entry = oldest;
+    }
+
+    if (!entry->in_use) {
+        entry->in_use = 1;
+        entry->asn = asn;
+        entry->window_start_ns = now;
+    }
+
+    /* Same fixed window as the per-source tracker */
+    if (now - entry->window_start_ns > ms_to_ns(config->window_ms)) {
+        entry->syn_rate = (uint32_t)((uint64_t)entry->syn_count * 1000 / config->window_ms);
+        entry->syn_count = weight;
+        entry->window_start_ns = now;
+    } else {
+        entry->syn_count += weight;
+    }
+    entry->last_seen_ns = now;
+
+    bool first = false;
+    if (config->asn_threshold != 0 && entry->syn_count > config->asn_threshold) {
+        if (!entry->flagged) {
+            entry->flagged = 1;
+            first = true;
+            asn_episodes_total++;
+            entry->block_pending = config->asn_block;
+            LOG_WARN("AS%u over asn_threshold (%u SYN in current window)", asn,
+                     entry->syn_count);
+        }
+        entry->hold_until_ns = now + sec_to_ns(config->asn_hold_s);
+    } else if (entry->flagged && now >= entry->hold_until_ns) {
+        entry->flagged = 0;
+        LOG_INFO("AS%u back under asn_threshold", asn);
+    }
+
+    bool over = now < entry->hold_until_ns;
+
+    pthread_mutex_unlock(&asn_lock);
+
+    if (started) {
+        *started = first;
+    }
+    return over;
+}
+
+size_t asnrate_take_blocks(uint32_t *out, size_t max) {
+    size_t count = 0;
+
+    pthread_mutex_lock(&asn_lock);
+
+    for (size_t i = 0; asns && i <= asn_mask && count < max; i++) {
+        asnrate_entry_t *e = &asns[i];
+        if (e->in_use && e->block_pending) {
+            e->block_pending = 0;
+            out[count++] = e->asn;
+        }
+    }
+
+    pthread_mutex_unlock(&asn_lock);
+    return count;
+}
+
+/* Ordering for asnrate_get_top: over threshold first, then by rate */
+static bool asnrate_ranks_higher(const asnrate_stats_t *a, const asnrate_stats_t *b) {
+    if (a->over_threshold != b->over_threshold) {
+        return a->over_threshold;
+    }
+    return a->syn_rate > b->syn_rate;
+}
+
+size_t asnrate_get_top(asnrate_stats_t *out, size_t max, uint64_t now) {
+    if (!out || max == 0) {
+        return 0;
+    }
+
+    size_t count = 0;
+
+    pthread_mutex_lock(&asn_lock);
+
+    for (size_t i = 0; asns && i <= asn_mask; i++) {
+        const asnrate_entry_t *e = &asns[i];
+        if (!e->in_use) {
+            continue;
+        }
+
+        asnrate_stats_t s = {
+            .asn = e->asn,
+            .over_threshold = now < e->hold_until_ns,
+            .syn_rate = e->syn_rate,
+        };
+
+        /* Insertion into the sorted top-N */
+        size_t pos = count < max ? count : max;
+        while (pos > 0 && asnrate_ranks_higher(&s, &out[pos - 1])) {
+            if (pos < max) {
+                out[pos] = out[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < max) {
+            out[pos] = s;
+            if (count < max) {
+                count++;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&asn_lock);
+    return count;
+}
+
+void asnrate_get_counts(size_t *tracked, size_t *over_threshold, uint64_t *episodes_total,
+                        uint64_t now) {
+    size_t n_tracked = 0, n_over = 0;
+
+    pthread_mutex_lock(&asn_lock);
+
+    for (size_t i = 0; asns && i <= asn_mask; i++) {
+        if (asns[i].in_use) {
+            n_tracked++;
+            if (now < asns[i].hold_until_ns) {
+                n_over++;
+            }
+        }
+    }
+
+    if (episodes_total) {
+        *episodes_total = asn_episodes_total;
+    }
+
+    pthread_mutex_unlock(&asn_lock);
+
+    if (tracked) {
+        *tracked = n_tracked;
+    }
+    if (over_threshold) {
+        *over_threshold = n_over;
+    }
+}
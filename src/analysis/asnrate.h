@@ -0,0 +1,81 @@
+/*
+ * asnrate.h - Per-origin-AS SYN rate table
+ * TCP SYN Flood Detector
+ *
+ * Aggregates the SYNs of every source by origin AS (see asnmap.h) in a
+ * small fixed-size table, to spot floods spread over many addresses of one
+ * network. While an AS is over asn_threshold the engine applies a tighter
+ * per-source threshold to its sources and may block its prefixes.
+ */
+
+#ifndef SYNFLOOD_ASNRATE_H
+#define SYNFLOOD_ASNRATE_H
+
+#include "common.h"
+
+/* Linear probe length before an idle slot is recycled */
+#define ASNRATE_PROBE_LIMIT 8
+
+/* Snapshot of one AS for metrics */
+typedef struct
+{
+    uint32_t asn;
+    bool over_threshold;
+    uint32_t syn_rate;   /* SYN/s over the last completed window */
+} asnrate_stats_t;
+
+/**
+ * Initialize the AS table
+ * @param max_entries Table size (power of 2)
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t asnrate_init(size_t max_entries);
+
+/**
+ * Free the AS table
+ */
+void asnrate_cleanup(void);
+
+/**
+ * Count SYNs from an AS and update its state
+ * @param asn Origin AS (not 0)
+ * @param weight Number of SYNs this packet stands for
+ * @param now Current monotonic time (ns)
+ * @param config Configuration (window_ms, asn_threshold, asn_hold_s, asn_block)
+ * @param started Output: this packet put the AS over the threshold (may be NULL)
+ * @return true if the AS is over the threshold
+ *
+ * With asn_block, an AS going over the threshold is also queued for
+ * asnrate_take_blocks(); the prefixes are added off the packet path.
+ */
+bool asnrate_record(uint32_t asn, uint32_t weight, uint64_t now,
+                    const synflood_config_t *config, bool *started);
+
+/**
+ * Take the ASes queued for blocking since the last call
+ * @param out Output array
+ * @param max Capacity of out (ASes beyond it stay queued)
+ * @return Number of ASes written
+ */
+size_t asnrate_take_blocks(uint32_t *out, size_t max);
+
+/**
+ * Get the busiest ASes, sorted by rate (over threshold first)
+ * @param out Output array
+ * @param max Capacity of out
+ * @param now Current monotonic time (ns)
+ * @return Number of entries written
+ */
+size_t asnrate_get_top(asnrate_stats_t *out, size_t max, uint64_t now);
+
+/**
+ * Get table counters
+ * @param tracked Output: ASes in the table (may be NULL)
+ * @param over_threshold Output: ASes currently over the threshold (may be NULL)
+ * @param episodes_total Output: times an AS went over the threshold (may be NULL)
+ * @param now Current monotonic time (ns)
+ */
+void asnrate_get_counts(size_t *tracked, size_t *over_threshold, uint64_t *episodes_total,
+                        uint64_t now);
+
+#endif /* SYNFLOOD_ASNRATE_H */
@@ -0,0 +1,459 @@
+/*
+ * engine.c - SYN detection engine with startup-specialized variants
+ * TCP SYN Flood Detector
+ */
+
+#include "engine.h"
+#include "tracker.h"
+#include "whitelist.h"
+#include "procparse.h"
+#include "victim.h"
+#include "scan.h"
+#include "asnmap.h"
+#include "asnrate.h"
+#include "../enforce/ipset_mgr.h"
+#include "../enforce/peersync.h"
+#include "../observe/logger.h"
+#include <linux/ip.h>
+#include <linux/tcp.h>
+#include <linux/udp.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+engine_process_fn engine_process_syn = engine_process_dynamic;
+
+/* Detection algorithm from SDD. Always inlined into the variants below with
+ * constant flags, so disabled features compile away. */
+static inline __attribute__((always_inline)) engine_verdict_t
+engine_process_common(app_context_t *ctx, const engine_packet_t *pkt, bool *fastpath,
+                      const bool use_whitelist, const bool validate,
+                      const bool inpath_drop, const bool use_fastpath, const bool use_victim,
+                      const bool use_scan, const bool use_asn) {
+    const synflood_config_t *config = ctx->config;
+    const uint32_t src_ip = pkt->src_ip;
+    const uint32_t weight = pkt->weight;
+    const flood_class_t flood_class = (flood_class_t)pkt->flood_class;
+    const bool is_syn = flood_class == FLOOD_CLASS_SYN;
+
+    /* Classes without a threshold are not tracked; a capture rule may still
+     * queue them */
+    if (flood_class >= FLOOD_CLASS_COUNT) {
+        return ENGINE_ACCEPT;
+    }
+    uint32_t threshold = engine_class_threshold(config, flood_class);
+    if (threshold == 0) {
+        return ENGINE_ACCEPT;
+    }
+
+    /* Step 1: Whitelisted sources only have a compact entry holding the
+     * whitelist generation of their verdict, probed before the tracker.
+     * Live edits publish the root before bumping the generation, so the
+     * generation is read first. */
+    uint32_t whitelist_gen = 0;
+    bool whitelisted = false;
+    if (use_whitelist) {
+        whitelist_gen = __atomic_load_n(ctx->tracker->whitelist_gen, __ATOMIC_ACQUIRE);
+        whitelisted = tracker_whitelisted(ctx->tracker, src_ip, whitelist_gen);
+    }
+
+    /* Step 2: Get or create tracker entry (single probe for known sources) */
+    ip_tracker_t *tracker = NULL;
+    if (!whitelisted) {
+        tracker = tracker_get_or_create(ctx->tracker, src_ip);
+        if (!tracker) {
+            /* A shared table has no idle slot left for it: normal under a
+             * burst of new sources, so not worth a log line per packet */
+            if (!ctx->tracker->shm) {
+                LOG_ERROR("Failed to get/create tracker entry");
+            }
+            return ENGINE_ACCEPT;
+        }
+    }
+
+    /* Read after the lookup: a new entry starts its window at creation time,
+     * which must not be later than the packet's */
+    uint64_t current_time = get_monotonic_ns();
+
+    /* Destination rate counts every SYN, whitelisted sources included */
+    if (use_victim && is_syn &&
+        victim_record(pkt->dst_ip, pkt->dst_port, weight, current_time, config) &&
+        config->victim_source_threshold < threshold) {
+        /* Victim under attack: tighter per-source limit for its traffic */
+        threshold = config->victim_source_threshold;
+    }
+
+    /* Step 3: Whitelist check for sources without a compact entry - the
+     * verdict is cached in the full entry until the whitelist changes. A
+     * whitelisted source trades its full entry for a compact one. */
+    if (use_whitelist && !whitelisted) {
+        whitelist_node_t *whitelist = __atomic_load_n(&ctx->whitelist_root, __ATOMIC_ACQUIRE);
+
+        if (whitelist_check_cached(whitelist, whitelist_gen, tracker)) {
+            tracker_mark_whitelisted(ctx->tracker, src_ip, whitelist_gen);
+            whitelisted = true;
+        }
+    }
+
+    if (whitelisted) {
+        LOG_DEBUG("Packet from whitelisted IP");
+        pthread_mutex_lock(&ctx->metrics_lock);
+        ctx->metrics.whitelist_hits_total++;
+        pthread_mutex_unlock(&ctx->metrics_lock);
+        if (use_fastpath && is_syn) {
+            *fastpath = true;
+        }
+        return ENGINE_ACCEPT;
+    }
+
+    /* Origin AS rates, without whitelisted sources. The lookup is cached in
+     * the entry until the map is replaced; the generation is read before the
+     * map. asn_block only queues the AS: the expiry thread adds its prefixes. */
+    if (use_asn && is_syn) {
+        uint32_t asnmap_gen = __atomic_load_n(ctx->tracker->asnmap_gen, __ATOMIC_ACQUIRE);
+        const asnmap_t *asnmap = __atomic_load_n(&ctx->asnmap, __ATOMIC_ACQUIRE);
+        uint32_t asn = asnmap_lookup_cached(asnmap, asnmap_gen, tracker);
+
+        /* AS over asn_threshold: tighter per-source limit for its sources */
+        if (asn != 0 && asnrate_record(asn, weight, current_time, config, NULL) &&
+            config->asn_source_threshold < threshold) {
+            threshold = config->asn_source_threshold;
+        }
+    }
+
+    /* Port scans are counted per source, so whitelisted sources are exempt.
+     * A scanner is blocked without SYN_RECV validation: probes to closed
+     * ports leave nothing in /proc/net/tcp. */
+    bool scan_block = false;
+    if (use_scan && is_syn && !tracker->blocked &&
+        scan_record(src_ip, pkt->dst_ip, pkt->dst_port, current_time, config)) {
+        scan_block = config->scan_block;
+    }
+
+    /* Step 4: Sliding window rate calculation */
+    uint64_t window_ns = ms_to_ns(config->window_ms);
+
+    /* All flag classes share the window */
+    uint32_t *counter = tracker_class_count(tracker, flood_class);
+    uint32_t count;
+
+    if (ctx->tracker->shm) {
+        /* Entry shared with other processes: one of them resets the window */
+        uint64_t window_start = __atomic_load_n(&tracker->window_start_ns, __ATOMIC_RELAXED);
+        if (current_time - window_start > window_ns &&
+            __atomic_compare_exchange_n(&tracker->window_start_ns, &window_start, current_time,
+                                        false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            uint32_t last = __atomic_exchange_n(&tracker->syn_count, 0, __ATOMIC_ACQ_REL);
+            for (size_t i = 0; i < ARRAY_SIZE(tracker->flood_count); i++) {
+                __atomic_store_n(&tracker->flood_count[i], 0, __ATOMIC_RELAXED);
+            }
+            if (use_fastpath && is_syn && !tracker->blocked && last <= config->fastpath_max_syn) {
+                *fastpath = true;
+            }
+        }
+        count = __atomic_add_fetch(counter, weight, __ATOMIC_RELAXED);
+    } else if (current_time - tracker->window_start_ns > window_ns) {
+        /* A completed window well below threshold marks a known-good source.
+         * The fast-path rules only bypass SYNs, so only a SYN is marked. */
+        if (use_fastpath && is_syn && !tracker->blocked &&
+            tracker->syn_count <= config->fastpath_max_syn) {
+            *fastpath = true;
+        }
+
+        /* Window expired, reset counters */
+        tracker->syn_count = 0;
+        memset(tracker->flood_count, 0, sizeof(tracker->flood_count));
+        count = *counter = weight;
+        tracker->window_start_ns = current_time;
+    } else {
+        count = *counter += weight;
+    }
+
+    tracker->last_seen_ns = current_time;
+
+    engine_verdict_t verdict = ENGINE_ACCEPT;
+
+    /* UDP and ICMP floods may be blocked in a set of their own, leaving the
+     * source's other traffic to the engine. The entry lapses with the set's
+     * timeout, so nothing has to expire it. */
+    uint64_t *set_expiry = flood_class >= FLOOD_CLASS_FIRST_PROTO
+        ? &tracker->set_block_expiry_ns[flood_class - FLOOD_CLASS_FIRST_PROTO]
+        : NULL;
+    const bool set_blocked = set_expiry && current_time < *set_expiry;
+
+    /* Step 5: Threshold check */
+    if (tracker->blocked || set_blocked) {
+        /* Packet was queued before (or is racing) the ipset rule - drop in-path */
+        uint64_t block_expiry = set_blocked ? *set_expiry : tracker->block_expiry_ns;
+        if (inpath_drop && current_time < block_expiry) {
+            verdict = ENGINE_DROP;
+        }
+    } else if (count > threshold || scan_block) {
+        /* Secondary validation: check /proc/net/tcp. Only a SYN flood leaves
+         * SYN_RECV sockets behind; scans and the other classes do not. */
+        const bool check_recv = validate && is_syn && !scan_block;
+        uint32_t syn_recv_count = 0;
+        if (check_recv) {
+            syn_recv_count = ctx->netns
+                ? procparse_count_syn_recv_from_ip_fd(ctx->netns->proc_tcp_fd, src_ip)
+                : procparse_count_syn_recv_from_ip(src_ip);
+        }
+
+        if (!check_recv || syn_recv_count > threshold / 2) {
+            /* Confirmed attack pattern - this packet is dropped even while
+             * the ipset add is still in flight */
+            if (inpath_drop) {
+                verdict = ENGINE_DROP;
+            }
+
+            const char *class_set = set_expiry ? engine_class_ipset(config, flood_class) : NULL;
+            synflood_ret_t added;
+            if (ctx->netns) {
+                added = ipset_mgr_add_in(ctx->netns->ns_fd, ctx->netns->ipset_name, src_ip,
+                                         config->block_duration_s);
+            } else if (class_set) {
+                added = ipset_mgr_add_to(class_set, src_ip, config->block_duration_s);
+            } else {
+                added = ipset_mgr_add(src_ip, config->block_duration_s, count);
+            }
+
+            if (added == SYNFLOOD_OK && class_set) {
+                *set_expiry = current_time + sec_to_ns(config->block_duration_s);
+            } else if (added == SYNFLOOD_OK) {
+                tracker->blocked = 1;
+                tracker->block_expiry_ns = current_time + sec_to_ns(config->block_duration_s);
+            }
+
+            if (added == SYNFLOOD_OK) {
+                logger_log_event(EVENT_BLOCKED, src_ip, count, syn_recv_count);
+
+                /* Let the other cluster nodes block it before it reaches them
+                 * (peers only keep a full blacklist) */
+                if (!ctx->netns && !class_set) {
+                    peersync_reason_t reason = PEERSYNC_REASON_RATE;
+                    if (!is_syn) {
+                        reason = PEERSYNC_REASON_FLOOD;
+                    } else if (count <= threshold) {
+                        reason = PEERSYNC_REASON_SCAN;
+                    } else if (threshold < config->syn_threshold) {
+                        reason = PEERSYNC_REASON_VICTIM;
+                    }
+                    peersync_announce(src_ip, config->block_duration_s, reason);
+                }
+
+                /* Update metrics */
+                pthread_mutex_lock(&ctx->metrics_lock);
+                ctx->metrics.detections_total++;
+                ctx->metrics.class_detections_total[flood_class]++;
+                ctx->metrics.blocked_ips_current = ctx->netns
+                    ? ctx->metrics.blocked_ips_current + 1
+                    : ipset_mgr_get_count();
+                pthread_mutex_unlock(&ctx->metrics_lock);
+            }
+        } else {
+            /* Possible false positive, log but don't block */
+            logger_log_event(EVENT_SUSPICIOUS, src_ip, count, syn_recv_count);
+
+            pthread_mutex_lock(&ctx->metrics_lock);
+            ctx->metrics.false_positives_total++;
+            pthread_mutex_unlock(&ctx->metrics_lock);
+        }
+    }
+
+    /* Update metrics */
+    pthread_mutex_lock(&ctx->metrics_lock);
+    if (is_syn) {
+        ctx->metrics.syn_packets_total++;
+    }
+    ctx->metrics.class_packets_total[flood_class]++;
+    if (inpath_drop && verdict == ENGINE_DROP) {
+        ctx->metrics.packets_dropped_total++;
+    }
+    pthread_mutex_unlock(&ctx->metrics_lock);
+
+    /* Without inpath_drop the packet is let through (ipset drops future packets) */
+    return verdict;
+}
+
+bool engine_parse_ipv4(const unsigned char *ip, size_t len, engine_packet_t *pkt) {
+    if (len < sizeof(struct iphdr)) {
+        return false;
+    }
+
+    const struct iphdr *iph = (const struct iphdr *)ip;
+    size_t ihl = (size_t)iph->ihl * 4;
+    if (iph->version != 4 || ihl < sizeof(struct iphdr) || len < ihl) {
+        return false;
+    }
+
+    /* Later fragments have no L4 header; the first one counts the datagram */
+    if (ntohs(iph->frag_off) & 0x1fff) {
+        return false;
+    }
+
+    pkt->src_ip = iph->saddr;
+    pkt->dst_ip = iph->daddr;
+    pkt->dst_port = 0;
+
+    const unsigned char *l4 = ip + ihl;
+    size_t l4_len = len - ihl;
+
+    switch (iph->protocol) {
+    case IPPROTO_TCP:
+        if (l4_len < sizeof(struct tcphdr)) {
+            return false;
+        }
+        pkt->dst_port = ntohs(((const struct tcphdr *)l4)->dest);
+        pkt->flood_class = (uint8_t)engine_tcp_class(l4[13]);
+        return true;
+    case IPPROTO_UDP:
+        if (l4_len < sizeof(struct udphdr)) {
+            return false;
+        }
+        pkt->dst_port = ntohs(((const struct udphdr *)l4)->dest);
+        pkt->flood_class = FLOOD_CLASS_UDP;
+        return true;
+    case IPPROTO_ICMP:
+        pkt->flood_class = FLOOD_CLASS_ICMP;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* One specialized variant per flag combination; the suffix spells the
+ * flags in binary, e.g. engine_process_v_0001010 */
+#define ENGINE_VARIANT(suffix, flags)                                                      \
+    static engine_verdict_t engine_process_v##suffix(app_context_t *ctx,                   \
+                                                     const engine_packet_t *pkt,            \
+                                                     bool *fastpath) {                      \
+        return engine_process_common(ctx, pkt, fastpath,                                   \
+                                     ((flags) & ENGINE_F_WHITELIST) != 0,                  \
+                                     ((flags) & ENGINE_F_VALIDATE) != 0,                   \
+                                     ((flags) & ENGINE_F_INPATH_DROP) != 0,                \
+                                     ((flags) & ENGINE_F_FASTPATH) != 0,                   \
+                                     ((flags) & ENGINE_F_VICTIM) != 0,                     \
+                                     ((flags) & ENGINE_F_SCAN) != 0,                       \
+                                     ((flags) & ENGINE_F_ASN) != 0);                       \
+    }
+
+#define ENGINE_VARIANT_ENTRY(suffix, flags) [flags] = engine_process_v##suffix,
+
+/* Apply X to every combination of the ENGINE_F_* bits, highest bit first */
+#define ENGINE_BITS_0(X, s, f) X(s##0, f) X(s##1, (f) | ENGINE_F_WHITELIST)
+#define ENGINE_BITS_1(X, s, f)                                                         \
+    ENGINE_BITS_0(X, s##0, f) ENGINE_BITS_0(X, s##1, (f) | ENGINE_F_VALIDATE)
+#define ENGINE_BITS_2(X, s, f)                                                         \
+    ENGINE_BITS_1(X, s##0, f) ENGINE_BITS_1(X, s##1, (f) | ENGINE_F_INPATH_DROP)
+#define ENGINE_BITS_3(X, s, f)                                                         \
+    ENGINE_BITS_2(X, s##0, f) ENGINE_BITS_2(X, s##1, (f) | ENGINE_F_FASTPATH)
+#define ENGINE_BITS_4(X, s, f)                                                         \
+    ENGINE_BITS_3(X, s##0, f) ENGINE_BITS_3(X, s##1, (f) | ENGINE_F_VICTIM)
+#define ENGINE_BITS_5(X, s, f)                                                         \
+    ENGINE_BITS_4(X, s##0, f) ENGINE_BITS_4(X, s##1, (f) | ENGINE_F_SCAN)
+#define ENGINE_BITS_6(X, s, f)                                                         \
+    ENGINE_BITS_5(X, s##0, f) ENGINE_BITS_5(X, s##1, (f) | ENGINE_F_ASN)
+#define ENGINE_FOR_EACH_VARIANT(X) ENGINE_BITS_6(X, _, 0)
+
+_Static_assert(ENGINE_VARIANT_COUNT == 2 * ENGINE_F_ASN,
+               "ENGINE_FOR_EACH_VARIANT must cover every ENGINE_F_* bit");
+
+ENGINE_FOR_EACH_VARIANT(ENGINE_VARIANT)
+
+static const engine_process_fn engine_variants[ENGINE_VARIANT_COUNT] = {
+    ENGINE_FOR_EACH_VARIANT(ENGINE_VARIANT_ENTRY)
+};
+
+/* Feature names in ENGINE_F_* bit order */
+static const char *engine_feature_names[] = {
+    "whitelist", "validate", "drop", "fastpath", "victim", "scan", "asn",
+};
+
+unsigned int engine_flags(const app_context_t *ctx) {
+    const synflood_config_t *config = ctx->config;
+    unsigned int flags = 0;
+
+    /* A configured whitelist file can gain entries at runtime */
+    if (ctx->whitelist_root || config->whitelist_file[0] != '\0') {
+        flags |= ENGINE_F_WHITELIST;
+    }
+    if (config->validate_syn_recv) {
+        flags |= ENGINE_F_VALIDATE;
+    }
+    if (config->victim_threshold != 0) {
+        flags |= ENGINE_F_VICTIM;
+    }
+    if (config->scan_port_threshold != 0 || config->scan_host_threshold != 0) {
+        flags |= ENGINE_F_SCAN;
+    }
+    if (ctx->asnmap) {
+        flags |= ENGINE_F_ASN;
+    }
+
+    /* Raw sockets see copies of packets: no verdicts, no marks */
+    if (!config->use_raw_socket) {
+        if (config->inpath_drop) {
+            flags |= ENGINE_F_INPATH_DROP;
+        }
+        if (config->fastpath_mark != 0) {
+            flags |= ENGINE_F_FASTPATH;
+        }
+    }
+
+    return flags;
+}
+
+unsigned int engine_select(const app_context_t *ctx) {
+    unsigned int flags = engine_flags(ctx);
+    engine_process_fn selected = engine_variants[flags];
+
+    if (selected != engine_process_syn) {
+        engine_process_syn = selected;
+        LOG_INFO("Detection engine variant: %s", engine_variant_name(flags));
+    }
+
+    return flags;
+}
+
+engine_process_fn engine_variant(unsigned int flags) {
+    return engine_variants[flags & (ENGINE_VARIANT_COUNT - 1)];
+}
+
+const char *engine_variant_name(unsigned int flags) {
+    static char names[ENGINE_VARIANT_COUNT][64];
+
+    flags &= ENGINE_VARIANT_COUNT - 1;
+    if (flags == 0) {
+        return "base";
+    }
+
+    /* Built once per variant, e.g. "whitelist+validate" */
+    char *name = names[flags];
+    if (name[0] == '\0') {
+        size_t len = 0;
+        for (size_t bit = 0; bit < ARRAY_SIZE(engine_feature_names); bit++) {
+            if (flags & (1u << bit)) {
+                len += (size_t)snprintf(name + len, sizeof(names[0]) - len, "%s%s",
+                                        len ? "+" : "", engine_feature_names[bit]);
+            }
+        }
+    }
+
+    return name;
+}
+
+engine_verdict_t engine_process_dynamic(app_context_t *ctx, const engine_packet_t *pkt,
+                                        bool *fastpath) {
+    unsigned int flags = engine_flags(ctx);
+
+    return engine_process_common(ctx, pkt, fastpath,
+                                 (flags & ENGINE_F_WHITELIST) != 0,
+                                 (flags & ENGINE_F_VALIDATE) != 0,
+                                 (flags & ENGINE_F_INPATH_DROP) != 0,
+                                 (flags & ENGINE_F_FASTPATH) != 0,
+                                 (flags & ENGINE_F_VICTIM) != 0,
+                                 (flags & ENGINE_F_SCAN) != 0,
+                                 (flags & ENGINE_F_ASN) != 0);
+}
@@ -0,0 +1,185 @@
+/*
+ * engine.h - SYN detection engine with startup-specialized variants
+ * TCP SYN Flood Detector
+ *
+ * The per-packet detection logic is compiled once per combination of
+ * settings that are fixed between reloads (whitelist present, SYN_RECV
+ * validation, in-path drop, fast-path marking, victim, scan and origin AS
+ * tracking).
+ * engine_select() picks the matching variant and stores it in
+ * engine_process_syn, so the capture loops call through a single pointer
+ * without re-testing configuration.
+ *
+ * Besides SYNs, the engine counts SYN-ACK, ACK and RST packets (reflection
+ * and ACK/RST floods), UDP datagrams and ICMP messages per source, each
+ * class against its own threshold. The class of a TCP packet is taken
+ * from its flags with a lookup table.
+ */
+
+#ifndef SYNFLOOD_ENGINE_H
+#define SYNFLOOD_ENGINE_H
+
+#include "common.h"
+#include <string.h>
+
+/* Variant selection bits */
+#define ENGINE_F_WHITELIST   0x1  /* A whitelist is loaded or configured */
+#define ENGINE_F_VALIDATE    0x2  /* Confirm detections against /proc/net/tcp */
+#define ENGINE_F_INPATH_DROP 0x4  /* Capture backend can drop (NFQUEUE + inpath_drop) */
+#define ENGINE_F_FASTPATH    0x8  /* Report known-good sources (NFQUEUE + fastpath_mark) */
+#define ENGINE_F_VICTIM      0x10 /* Per-destination tracking (victim_threshold) */
+#define ENGINE_F_SCAN        0x20 /* Port scan sketches (scan_port/host_threshold) */
+#define ENGINE_F_ASN         0x40 /* Per-origin-AS rates (an ASN map is loaded) */
+#define ENGINE_VARIANT_COUNT 128
+
+/* Fields of a captured packet the engine works on */
+typedef struct
+{
+    uint32_t src_ip;     /* Network byte order */
+    uint32_t dst_ip;     /* Network byte order */
+    uint16_t dst_port;   /* Host byte order, 0 for ICMP */
+    uint8_t flood_class; /* flood_class_t: TCP flag class or L4 protocol */
+    uint32_t weight;     /* Packets this one stands for (>1 while sampling) */
+} engine_packet_t;
+
+/* TCP header flag bits the classes are built from */
+#define ENGINE_TCP_SYN 0x02
+#define ENGINE_TCP_RST 0x04
+#define ENGINE_TCP_ACK 0x10
+
+/**
+ * Classify a packet by its TCP flags (FIN, PSH and URG are ignored)
+ * @param flags Flags byte of the TCP header
+ * @return flood_class_t, FLOOD_CLASS_NONE without SYN, ACK or RST
+ */
+static inline flood_class_t engine_tcp_class(uint8_t flags) {
+    /* Indexed by SYN | RST << 1 | ACK << 2 */
+    static const uint8_t classes[8] = {
+        FLOOD_CLASS_NONE, FLOOD_CLASS_SYN,    FLOOD_CLASS_RST, FLOOD_CLASS_RST,
+        FLOOD_CLASS_ACK,  FLOOD_CLASS_SYNACK, FLOOD_CLASS_RST, FLOOD_CLASS_RST,
+    };
+
+    return (flood_class_t)classes[((flags >> 1) & 0x3) | ((flags >> 2) & 0x4)];
+}
+
+/**
+ * Per-source threshold of a class
+ * @param config Configuration
+ * @param flood_class Class (not FLOOD_CLASS_NONE)
+ * @return Packets per window, 0 when the class is ignored
+ */
+static inline uint32_t engine_class_threshold(const synflood_config_t *config,
+                                              flood_class_t flood_class) {
+    const uint32_t thresholds[FLOOD_CLASS_COUNT] = {
+        [FLOOD_CLASS_SYN] = config->syn_threshold,
+        [FLOOD_CLASS_SYNACK] = config->synack_threshold,
+        [FLOOD_CLASS_ACK] = config->ack_threshold,
+        [FLOOD_CLASS_RST] = config->rst_threshold,
+        [FLOOD_CLASS_UDP] = config->udp_threshold,
+        [FLOOD_CLASS_ICMP] = config->icmp_threshold,
+    };
+
+    return thresholds[flood_class];
+}
+
+/**
+ * Blacklist of a class when it is not ipset_name
+ * @param config Configuration
+ * @param flood_class Class (not FLOOD_CLASS_NONE)
+ * @return Set name, NULL for classes blocked in ipset_name
+ */
+static inline const char *engine_class_ipset(const synflood_config_t *config,
+                                             flood_class_t flood_class) {
+    const char *set = NULL;
+
+    if (flood_class == FLOOD_CLASS_UDP) {
+        set = config->udp_ipset;
+    } else if (flood_class == FLOOD_CLASS_ICMP) {
+        set = config->icmp_ipset;
+    }
+    return set && set[0] != '\0' && strcmp(set, config->ipset_name) != 0 ? set : NULL;
+}
+
+/**
+ * Classes the capture filters have to let through
+ * @param config Configuration
+ * @return Bit mask of 1 << flood_class_t, always including FLOOD_CLASS_SYN
+ */
+static inline unsigned int engine_flood_classes(const synflood_config_t *config) {
+    unsigned int classes = 1u << FLOOD_CLASS_SYN;
+
+    for (unsigned int c = FLOOD_CLASS_SYNACK; c < FLOOD_CLASS_COUNT; c++) {
+        if (engine_class_threshold(config, (flood_class_t)c) != 0) {
+            classes |= 1u << c;
+        }
+    }
+    return classes;
+}
+
+/**
+ * Extract the engine fields from an IPv4 packet
+ * @param ip Packet, starting at the IP header
+ * @param len Bytes available
+ * @param pkt Output: packet fields (weight is not set)
+ * @return true for a TCP segment with a complete header, a UDP datagram or
+ *         an ICMP message, that is not a later fragment
+ */
+bool engine_parse_ipv4(const unsigned char *ip, size_t len, engine_packet_t *pkt);
+
+/* Per-packet verdicts, mapped to NF_ACCEPT/NF_DROP by the NFQUEUE backend */
+typedef enum
+{
+    ENGINE_ACCEPT = 0,
+    ENGINE_DROP = 1,
+} engine_verdict_t;
+
+/**
+ * Process one captured packet
+ * @param ctx Application context
+ * @param pkt Packet fields
+ * @param fastpath Output: set when the source may skip NFQUEUE for a while
+ * @return ENGINE_ACCEPT or ENGINE_DROP
+ */
+typedef engine_verdict_t (*engine_process_fn)(app_context_t *ctx, const engine_packet_t *pkt,
+                                              bool *fastpath);
+
+/* Active variant - written by engine_select() on the capture thread only */
+extern engine_process_fn engine_process_syn;
+
+/**
+ * Compute the variant bits for the current configuration and whitelist
+ * @param ctx Application context
+ * @return ENGINE_F_* bits
+ */
+unsigned int engine_flags(const app_context_t *ctx);
+
+/**
+ * Select the variant for the current configuration (call at init and
+ * after every reload, from the capture thread)
+ * @param ctx Application context
+ * @return Selected ENGINE_F_* bits
+ */
+unsigned int engine_select(const app_context_t *ctx);
+
+/**
+ * Get a specific variant (benchmarks and tests)
+ * @param flags ENGINE_F_* bits
+ * @return Variant function
+ */
+engine_process_fn engine_variant(unsigned int flags);
+
+/**
+ * Human-readable variant name, e.g. "whitelist+validate" ("base" when no bits)
+ * @param flags ENGINE_F_* bits
+ * @return Static string
+ */
+const char *engine_variant_name(unsigned int flags);
+
+/**
+ * Unspecialized reference implementation - tests every setting per packet
+ * @see engine_process_fn
+ */
+engine_verdict_t engine_process_dynamic(app_context_t *ctx, const engine_packet_t *pkt,
+                                        bool *fastpath);
+
+#endif /* SYNFLOOD_ENGINE_H */
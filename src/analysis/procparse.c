@@ -14,22 +14,64 @@
  */
 
 #include "procparse.h"
+#include "simd.h"
 #include "../observe/logger.h"
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
 
 #define PROC_NET_TCP "/proc/net/tcp"
 #define PROC_NET_TCP6 "/proc/net/tcp6"
 
+/* Decode 2 hex digits */
+static bool hex2(const char *src, uint8_t *out) {
+    uint32_t value = 0;
+
+    for (int i = 0; i < 2; i++) {
+        char c = src[i];
+        if (c >= '0' && c <= '9') {
+            value = (value << 4) | (uint32_t)(c - '0');
+        } else if (c >= 'A' && c <= 'F') {
+            value = (value << 4) | (uint32_t)(c - 'A' + 10);
+        } else if (c >= 'a' && c <= 'f') {
+            value = (value << 4) | (uint32_t)(c - 'a' + 10);
+        } else {
+            return false;
+        }
+    }
+
+    *out = (uint8_t)value;
+    return true;
+}
+
 /* Parse a /proc/net/tcp line and extract remote address and state */
 static bool parse_tcp_line(const char *line, uint32_t *rem_addr, uint8_t *state) {
+    /* Fast path: the kernel prints fixed-width fields after "sl:"
+     *   LLLLLLLL:PPPP RRRRRRRR:PPPP SS
+     *   0       8    13       22   27
+     */
+    const char *p = strchr(line, ':');
+    if (p) {
+        p++;
+        while (*p == ' ') {
+            p++;
+        }
+
+        uint32_t r_addr;
+        if (strnlen(p, 30) == 30 && p[8] == ':' && p[13] == ' ' && p[22] == ':' && p[27] == ' ' &&
+            simd_hex8(p + 14, &r_addr) && hex2(p + 28, state)) {
+            *rem_addr = r_addr;
+            return true;
+        }
+    }
+
     unsigned int sl;
     unsigned int loc_addr, loc_port;
     unsigned int r_addr, r_port;
     unsigned int st;
 
-    /* Parse the line
+    /* Fallback for unexpected layouts
      * Format: sl local_address rem_address st ...
      * Example: 0: 0100007F:0035 C0A80101:1234 03 ...
      */
@@ -84,19 +126,13 @@ uint32_t procparse_count_syn_recv_total(void) {
     return count;
 }
 
-uint32_t procparse_count_syn_recv_from_ip(uint32_t ip_addr) {
-    FILE *fp = fopen(PROC_NET_TCP, "r");
-    if (!fp) {
-        LOG_ERROR("Failed to open %s: %s", PROC_NET_TCP, strerror(errno));
-        return 0;
-    }
-
+/* Count SYN_RECV entries from ip_addr in an open /proc/net/tcp stream */
+static uint32_t count_syn_recv_from_ip(FILE *fp, uint32_t ip_addr) {
     char line[512];
     uint32_t count = 0;
 
     /* Skip header line */
     if (fgets(line, sizeof(line), fp) == NULL) {
-        fclose(fp);
         return 0;
     }
 
@@ -115,6 +151,41 @@ uint32_t procparse_count_syn_recv_from_ip(uint32_t ip_addr) {
         }
     }
 
+    return count;
+}
+
+uint32_t procparse_count_syn_recv_from_ip(uint32_t ip_addr) {
+    FILE *fp = fopen(PROC_NET_TCP, "r");
+    if (!fp) {
+        LOG_ERROR("Failed to open %s: %s", PROC_NET_TCP, strerror(errno));
+        return 0;
+    }
+
+    uint32_t count = count_syn_recv_from_ip(fp, ip_addr);
+
+    fclose(fp);
+    return count;
+}
+
+uint32_t procparse_count_syn_recv_from_ip_fd(int fd, uint32_t ip_addr) {
+    /* The caller keeps fd; read a rewound duplicate so fclose() leaves it open */
+    int dup_fd = dup(fd);
+    if (dup_fd < 0) {
+        LOG_ERROR("Failed to duplicate /proc/net/tcp fd %d: %s", fd, strerror(errno));
+        return 0;
+    }
+
+    FILE *fp = fdopen(dup_fd, "r");
+    if (!fp) {
+        close(dup_fd);
+        return 0;
+    }
+
+    uint32_t count = 0;
+    if (lseek(dup_fd, 0, SEEK_SET) == 0) {
+        count = count_syn_recv_from_ip(fp, ip_addr);
+    }
+
     fclose(fp);
     return count;
 }
@@ -150,15 +221,7 @@ size_t procparse_get_syn_recv_ips(uint32_t *ips, size_t max_ips) {
                 uint32_t network_addr = proc_addr_to_network(rem_addr);
 
                 /* Check if IP is already in the list (avoid duplicates) */
-                bool found = false;
-                for (size_t i = 0; i < count; i++) {
-                    if (ips[i] == network_addr) {
-                        found = true;
-                        break;
-                    }
-                }
-
-                if (!found) {
+                if (simd_find_u32(ips, count, network_addr) == count) {
                     ips[count++] = network_addr;
                 }
             }
@@ -21,6 +21,15 @@ uint32_t procparse_count_syn_recv_total(void);
  */
 uint32_t procparse_count_syn_recv_from_ip(uint32_t ip_addr);
 
+/**
+ * Count SYN_RECV connections from a specific source IP, reading an already
+ * open /proc/net/tcp (e.g. one opened inside another network namespace)
+ * @param fd File descriptor of /proc/net/tcp, rewound on every call
+ * @param ip_addr Source IP address (network byte order)
+ * @return Number of SYN_RECV connections from this IP
+ */
+uint32_t procparse_count_syn_recv_from_ip_fd(int fd, uint32_t ip_addr);
+
 /**
  * Get all source IPs currently in SYN_RECV state
  * @param ips Array to fill with IP addresses
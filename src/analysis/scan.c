@@ -0,0 +1,242 @@
+/*
+ * scan.c - Per-source port scan detection
+ * TCP SYN Flood Detector
+ *
+ * Fixed-size open-addressed table keyed by source IP, managed like the
+ * victim table: entries are never deleted, and when a probe sequence is
+ * full the least recently seen source not flagged in its current window
+ * is recycled in place.
+ */
+
+#include "scan.h"
+#include "../observe/logger.h"
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCAN_SKETCH_WORDS (SCAN_SKETCH_BITS / 64)
+
+/* Estimates saturate here (sketch nearly full) */
+#define SCAN_ESTIMATE_MAX (SCAN_SKETCH_BITS * 4)
+
+_Static_assert((SCAN_SKETCH_BITS & (SCAN_SKETCH_BITS - 1)) == 0 && SCAN_SKETCH_BITS >= 64,
+               "SCAN_SKETCH_BITS must be a power of 2, at least 64");
+
+typedef struct
+{
+    uint32_t src_ip;
+    uint8_t in_use;
+    uint8_t reported;         /* 1 << scan_kind_t already reported this window */
+    uint16_t port_bits;       /* Set bits in ports */
+    uint16_t host_bits;       /* Set bits in hosts */
+    uint64_t window_start_ns;
+    uint64_t last_seen_ns;
+    uint64_t ports[SCAN_SKETCH_WORDS];
+    uint64_t hosts[SCAN_SKETCH_WORDS];
+} scan_entry_t;
+
+static scan_entry_t *scanners = NULL;
+static size_t scan_mask = 0;
+static uint64_t scans_detected[SCAN_KIND_COUNT];
+static pthread_mutex_t scan_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Set-bit limits for the configured thresholds, recomputed when they change */
+static uint32_t cached_threshold[SCAN_KIND_COUNT];
+static uint32_t cached_bits[SCAN_KIND_COUNT];
+
+static const char *scan_kind_names[SCAN_KIND_COUNT] = {
+    [SCAN_VERTICAL] = "vertical",
+    [SCAN_HORIZONTAL] = "horizontal",
+};
+
+static inline size_t scan_slot(uint32_t src_ip) {
+    return ip_hash(src_ip, scan_mask + 1);
+}
+
+/* Linear counting assumes random bit positions: sequential ports must not
+ * land on sequential bits, so the value goes through the full mixer */
+static inline uint32_t sketch_bit(uint32_t value) {
+    return ip_hash(value, SCAN_SKETCH_BITS);
+}
+
+/* Set a sketch bit; true if it was clear */
+static inline bool sketch_add(uint64_t *sketch, uint32_t bit) {
+    uint64_t mask = 1ULL << (bit & 63);
+    uint64_t *word = &sketch[bit >> 6];
+    bool fresh = !(*word & mask);
+    *word |= mask;
+    return fresh;
+}
+
+/* Expected set bits after n distinct values: m(1 - (1 - 1/m)^n), without libm */
+static double expected_bits(uint32_t n) {
+    double bits = 0.0;
+    for (uint32_t i = 0; i < n; i++) {
+        bits += (SCAN_SKETCH_BITS - bits) / SCAN_SKETCH_BITS;
+    }
+    return bits;
+}
+
+uint32_t scan_estimate(uint32_t bits_set) {
+    double bits = 0.0;
+    uint32_t n = 0;
+
+    /* Smallest count whose expected bits round to bits_set */
+    while (n < SCAN_ESTIMATE_MAX && bits + 0.5 < bits_set) {
+        bits += (SCAN_SKETCH_BITS - bits) / SCAN_SKETCH_BITS;
+        n++;
+    }
+    return n;
+}
+
+/* Most set bits whose estimate does not exceed threshold */
+static uint32_t threshold_bits(scan_kind_t kind, uint32_t threshold) {
+    if (cached_threshold[kind] != threshold) {
+        cached_threshold[kind] = threshold;
+        cached_bits[kind] = (uint32_t)(expected_bits(threshold) + 0.5);
+    }
+    return cached_bits[kind];
+}
+
+static void scan_report(scan_kind_t kind, const scan_entry_t *entry,
+                        const synflood_config_t *config) {
+    uint32_t ports = scan_estimate(entry->port_bits);
+    uint32_t hosts = scan_estimate(entry->host_bits);
+
+    scans_detected[kind]++;
+
+    char ip_str[INET_ADDRSTRLEN];
+    struct in_addr addr = { .s_addr = entry->src_ip };
+    inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+    LOG_WARN("Source %s %s port scan (~%u ports, ~%u hosts in %us)", ip_str,
+             scan_kind_names[kind], ports, hosts, config->scan_window_s);
+
+    logger_log_event(EVENT_SCAN, entry->src_ip, ports, hosts);
+}
+
+synflood_ret_t scan_init(size_t max_entries) {
+    if (max_entries == 0 || (max_entries & (max_entries - 1)) != 0) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    scan_cleanup();
+
+    scan_entry_t *table = calloc(max_entries, sizeof(scan_entry_t));
+    if (!table) {
+        return SYNFLOOD_ENOMEM;
+    }
+
+    pthread_mutex_lock(&scan_lock);
+    scanners = table;
+    scan_mask = max_entries - 1;
+    memset(scans_detected, 0, sizeof(scans_detected));
+    pthread_mutex_unlock(&scan_lock);
+
+    LOG_INFO("Scan table initialized: %zu sources", max_entries);
+    return SYNFLOOD_OK;
+}
+
+void scan_cleanup(void) {
+    pthread_mutex_lock(&scan_lock);
+    free(scanners);
+    scanners = NULL;
+    scan_mask = 0;
+    pthread_mutex_unlock(&scan_lock);
+}
+
+bool scan_record(uint32_t src_ip, uint32_t dst_ip, uint16_t dst_port, uint64_t now,
+                 const synflood_config_t *config) {
+    uint64_t window_ns = sec_to_ns(config->scan_window_s);
+
+    pthread_mutex_lock(&scan_lock);
+
+    if (!scanners) {
+        pthread_mutex_unlock(&scan_lock);
+        return false;
+    }
+
+    size_t idx = scan_slot(src_ip);
+    scan_entry_t *entry = NULL;
+    scan_entry_t *oldest = NULL;
+
+    for (size_t probe = 0; probe < SCAN_PROBE_LIMIT; probe++) {
+        scan_entry_t *e = &scanners[(idx + probe) & scan_mask];
+
+        if (!e->in_use) {
+            /* No deletions, so the first hole ends the probe sequence */
+            entry = e;
+            break;
+        }
+        if (e->src_ip == src_ip) {
+            entry = e;
+            break;
+        }
+        bool flagged = e->reported && now - e->window_start_ns <= window_ns;
+        if (!flagged && (!oldest || e->last_seen_ns < oldest->last_seen_ns)) {
+            oldest = e;
+        }
+    }
+
+    if (!entry) {
+        if (!oldest) {
+            /* Every candidate slot is a flagged scanner: keep tracking those */
+            pthread_mutex_unlock(&scan_lock);
+            return false;
+        }
+        entry = oldest;
+        entry->in_use = 0;
+    }
+
+    if (!entry->in_use || now - entry->window_start_ns > window_ns) {
+        memset(entry, 0, sizeof(*entry));
+        entry->in_use = 1;
+        entry->src_ip = src_ip;
+        entry->window_start_ns = now;
+    }
+    entry->last_seen_ns = now;
+
+    /* Thresholds only need checking when a sketch gained a bit */
+    if (sketch_add(entry->ports, sketch_bit(dst_port))) {
+        entry->port_bits++;
+        if (config->scan_port_threshold != 0 && !(entry->reported & (1u << SCAN_VERTICAL)) &&
+            entry->port_bits > threshold_bits(SCAN_VERTICAL, config->scan_port_threshold)) {
+            entry->reported |= 1u << SCAN_VERTICAL;
+            scan_report(SCAN_VERTICAL, entry, config);
+        }
+    }
+    if (sketch_add(entry->hosts, sketch_bit(dst_ip))) {
+        entry->host_bits++;
+        if (config->scan_host_threshold != 0 && !(entry->reported & (1u << SCAN_HORIZONTAL)) &&
+            entry->host_bits > threshold_bits(SCAN_HORIZONTAL, config->scan_host_threshold)) {
+            entry->reported |= 1u << SCAN_HORIZONTAL;
+            scan_report(SCAN_HORIZONTAL, entry, config);
+        }
+    }
+
+    bool flagged = entry->reported != 0;
+
+    pthread_mutex_unlock(&scan_lock);
+    return flagged;
+}
+
+void scan_get_counts(size_t *tracked, uint64_t *detected) {
+    size_t n_tracked = 0;
+
+    pthread_mutex_lock(&scan_lock);
+
+    for (size_t i = 0; scanners && i <= scan_mask; i++) {
+        if (scanners[i].in_use) {
+            n_tracked++;
+        }
+    }
+
+    if (detected) {
+        memcpy(detected, scans_detected, sizeof(scans_detected));
+    }
+
+    pthread_mutex_unlock(&scan_lock);
+
+    if (tracked) {
+        *tracked = n_tracked;
+    }
+}
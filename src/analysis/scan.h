@@ -0,0 +1,75 @@
+/*
+ * scan.h - Per-source port scan detection
+ * TCP SYN Flood Detector
+ *
+ * A SYN scan stays far below the per-source rate threshold yet touches many
+ * destination ports (vertical scan) or many hosts (horizontal scan). Each
+ * source in a fixed-size side table keeps two 512-bit linear-counting
+ * sketches per scan window, one over destination ports and one over
+ * destination addresses. A SYN sets one bit in each; the number of set
+ * bits estimates the distinct count without storing the ports themselves.
+ */
+
+#ifndef SYNFLOOD_SCAN_H
+#define SYNFLOOD_SCAN_H
+
+#include "common.h"
+
+/* Linear probe length before an idle slot is recycled */
+#define SCAN_PROBE_LIMIT 8
+
+/* Sketch size in bits; estimates stay within a few percent up to ~2x this */
+#define SCAN_SKETCH_BITS 512
+
+/* Largest distinct count a threshold may ask for */
+#define SCAN_MAX_THRESHOLD 1024
+
+/* Kinds of scan, as reported in logs and metrics */
+typedef enum
+{
+    SCAN_VERTICAL = 0,   /* Many ports (scan_port_threshold) */
+    SCAN_HORIZONTAL = 1, /* Many hosts (scan_host_threshold) */
+    SCAN_KIND_COUNT = 2,
+} scan_kind_t;
+
+/**
+ * Initialize the scan table
+ * @param max_entries Table size (power of 2)
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t scan_init(size_t max_entries);
+
+/**
+ * Free the scan table
+ */
+void scan_cleanup(void);
+
+/**
+ * Add a SYN to its source's sketches and check the scan thresholds.
+ * Crossing a threshold is logged and published as EVENT_SCAN once per
+ * window.
+ * @param src_ip Source IP (network byte order)
+ * @param dst_ip Destination IP (network byte order)
+ * @param dst_port Destination port (host byte order)
+ * @param now Current monotonic time (ns)
+ * @param config Configuration (scan_port_threshold, scan_host_threshold, scan_window_s)
+ * @return true if the source has crossed a scan threshold in the current window
+ */
+bool scan_record(uint32_t src_ip, uint32_t dst_ip, uint16_t dst_port, uint64_t now,
+                 const synflood_config_t *config);
+
+/**
+ * Estimate distinct values from the number of set sketch bits
+ * @param bits_set Set bits (0 - SCAN_SKETCH_BITS)
+ * @return Estimated distinct count
+ */
+uint32_t scan_estimate(uint32_t bits_set);
+
+/**
+ * Get table counters
+ * @param tracked Output: sources in the table (may be NULL)
+ * @param detected Output: scans detected per scan_kind_t, SCAN_KIND_COUNT entries (may be NULL)
+ */
+void scan_get_counts(size_t *tracked, uint64_t *detected);
+
+#endif /* SYNFLOOD_SCAN_H */
@@ -0,0 +1,288 @@
+/*
+ * simd.c - Runtime CPU feature dispatch for hot kernels
+ * TCP SYN Flood Detector
+ *
+ * Vector versions are compiled with per-function target attributes, so the
+ * rest of the binary stays generic and runs on any x86-64 CPU.
+ */
+
+#include "simd.h"
+#include "../observe/logger.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+#define HASH_MULT 0x45d9f3b
+
+/* ---- Scalar ---- */
+
+static void hash_batch_scalar(const uint32_t *ips, uint32_t *out, size_t n, size_t bucket_count) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = ip_hash(ips[i], bucket_count);
+    }
+}
+
+static size_t find_u32_scalar(const uint32_t *keys, size_t n, uint32_t key) {
+    for (size_t i = 0; i < n; i++) {
+        if (keys[i] == key) {
+            return i;
+        }
+    }
+    return n;
+}
+
+static bool cidr_any_scalar(const uint32_t *prefixes, const uint32_t *masks, size_t n, uint32_t ip) {
+    for (size_t i = 0; i < n; i++) {
+        if ((ip & masks[i]) == prefixes[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool hex8_scalar(const char *src, uint32_t *out) {
+    uint32_t value = 0;
+
+    for (int i = 0; i < 8; i++) {
+        char c = src[i];
+        uint32_t nibble;
+
+        if (c >= '0' && c <= '9') {
+            nibble = (uint32_t)(c - '0');
+        } else if (c >= 'A' && c <= 'F') {
+            nibble = (uint32_t)(c - 'A' + 10);
+        } else if (c >= 'a' && c <= 'f') {
+            nibble = (uint32_t)(c - 'a' + 10);
+        } else {
+            return false;
+        }
+
+        value = (value << 4) | nibble;
+    }
+
+    *out = value;
+    return true;
+}
+
+#ifdef SIMD_X86
+
+/* ---- SSE4.2 (4 lanes) ---- */
+
+__attribute__((target("sse4.2")))
+static void hash_batch_sse42(const uint32_t *ips, uint32_t *out, size_t n, size_t bucket_count) {
+    const __m128i mult = _mm_set1_epi32(HASH_MULT);
+    const __m128i mask = _mm_set1_epi32((int)(bucket_count - 1));
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i h = _mm_loadu_si128((const __m128i *)(ips + i));
+        h = _mm_mullo_epi32(_mm_xor_si128(_mm_srli_epi32(h, 16), h), mult);
+        h = _mm_mullo_epi32(_mm_xor_si128(_mm_srli_epi32(h, 16), h), mult);
+        h = _mm_xor_si128(_mm_srli_epi32(h, 16), h);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_and_si128(h, mask));
+    }
+
+    hash_batch_scalar(ips + i, out + i, n - i, bucket_count);
+}
+
+__attribute__((target("sse4.2")))
+static size_t find_u32_sse42(const uint32_t *keys, size_t n, uint32_t key) {
+    const __m128i needle = _mm_set1_epi32((int)key);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(keys + i)), needle);
+        int bits = _mm_movemask_ps(_mm_castsi128_ps(eq));
+        if (bits) {
+            return i + (size_t)__builtin_ctz((unsigned int)bits);
+        }
+    }
+
+    return i + find_u32_scalar(keys + i, n - i, key);
+}
+
+__attribute__((target("sse4.2")))
+static bool cidr_any_sse42(const uint32_t *prefixes, const uint32_t *masks, size_t n, uint32_t ip) {
+    const __m128i addr = _mm_set1_epi32((int)ip);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i masked = _mm_and_si128(addr, _mm_loadu_si128((const __m128i *)(masks + i)));
+        __m128i eq = _mm_cmpeq_epi32(masked, _mm_loadu_si128((const __m128i *)(prefixes + i)));
+        if (_mm_movemask_epi8(eq)) {
+            return true;
+        }
+    }
+
+    return cidr_any_scalar(prefixes + i, masks + i, n - i, ip);
+}
+
+__attribute__((target("sse4.2")))
+static bool hex8_sse42(const char *src, uint32_t *out) {
+    __m128i c = _mm_loadl_epi64((const __m128i *)src);
+    __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+
+    /* Bytes >= 0x80 compare negative and fail both ranges */
+    __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                     _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+    __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                     _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+
+    if ((_mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha)) & 0xFF) != 0xFF) {
+        return false;
+    }
+
+    __m128i nibbles = _mm_blendv_epi8(_mm_sub_epi8(lower, _mm_set1_epi8('a' - 10)),
+                                      _mm_sub_epi8(c, _mm_set1_epi8('0')), is_digit);
+
+    /* Pairs of nibbles to bytes (high nibble first), then bytes to a word */
+    __m128i bytes = _mm_maddubs_epi16(nibbles, _mm_set1_epi16(0x0110));
+    bytes = _mm_packus_epi16(bytes, bytes);
+
+    *out = __builtin_bswap32((uint32_t)_mm_cvtsi128_si32(bytes));
+    return true;
+}
+
+/* ---- AVX2 (8 lanes) ----
+ * Tails fall back to scalar code, not SSE: mixing legacy-encoded SSE with
+ * dirty upper YMM state costs a transition penalty on some cores. */
+
+__attribute__((target("avx2")))
+static void hash_batch_avx2(const uint32_t *ips, uint32_t *out, size_t n, size_t bucket_count) {
+    const __m256i mult = _mm256_set1_epi32(HASH_MULT);
+    const __m256i mask = _mm256_set1_epi32((int)(bucket_count - 1));
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i h = _mm256_loadu_si256((const __m256i *)(ips + i));
+        h = _mm256_mullo_epi32(_mm256_xor_si256(_mm256_srli_epi32(h, 16), h), mult);
+        h = _mm256_mullo_epi32(_mm256_xor_si256(_mm256_srli_epi32(h, 16), h), mult);
+        h = _mm256_xor_si256(_mm256_srli_epi32(h, 16), h);
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_and_si256(h, mask));
+    }
+
+    hash_batch_scalar(ips + i, out + i, n - i, bucket_count);
+}
+
+__attribute__((target("avx2")))
+static size_t find_u32_avx2(const uint32_t *keys, size_t n, uint32_t key) {
+    const __m256i needle = _mm256_set1_epi32((int)key);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(keys + i)), needle);
+        int bits = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+        if (bits) {
+            return i + (size_t)__builtin_ctz((unsigned int)bits);
+        }
+    }
+
+    return i + find_u32_scalar(keys + i, n - i, key);
+}
+
+__attribute__((target("avx2")))
+static bool cidr_any_avx2(const uint32_t *prefixes, const uint32_t *masks, size_t n, uint32_t ip) {
+    const __m256i addr = _mm256_set1_epi32((int)ip);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i masked = _mm256_and_si256(addr, _mm256_loadu_si256((const __m256i *)(masks + i)));
+        __m256i eq = _mm256_cmpeq_epi32(masked, _mm256_loadu_si256((const __m256i *)(prefixes + i)));
+        if (_mm256_movemask_epi8(eq)) {
+            return true;
+        }
+    }
+
+    return cidr_any_scalar(prefixes + i, masks + i, n - i, ip);
+}
+
+#endif /* SIMD_X86 */
+
+/* Active implementations - scalar until simd_init() runs */
+void (*simd_hash_batch)(const uint32_t *, uint32_t *, size_t, size_t) = hash_batch_scalar;
+size_t (*simd_find_u32)(const uint32_t *, size_t, uint32_t) = find_u32_scalar;
+bool (*simd_cidr_any)(const uint32_t *, const uint32_t *, size_t, uint32_t) = cidr_any_scalar;
+bool (*simd_hex8)(const char *, uint32_t *) = hex8_scalar;
+
+static simd_level_t active_level = SIMD_LEVEL_SCALAR;
+
+bool simd_level_supported(simd_level_t level) {
+    switch (level) {
+        case SIMD_LEVEL_SCALAR:
+            return true;
+#ifdef SIMD_X86
+        case SIMD_LEVEL_SSE42:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse4.2");
+        case SIMD_LEVEL_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.2");
+#endif
+        default:
+            return false;
+    }
+}
+
+synflood_ret_t simd_set_level(simd_level_t level) {
+    if (!simd_level_supported(level)) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    switch (level) {
+#ifdef SIMD_X86
+        case SIMD_LEVEL_AVX2:
+            simd_hash_batch = hash_batch_avx2;
+            simd_find_u32 = find_u32_avx2;
+            simd_cidr_any = cidr_any_avx2;
+            simd_hex8 = hex8_sse42;  /* 8 bytes: no gain from wider registers */
+            break;
+        case SIMD_LEVEL_SSE42:
+            simd_hash_batch = hash_batch_sse42;
+            simd_find_u32 = find_u32_sse42;
+            simd_cidr_any = cidr_any_sse42;
+            simd_hex8 = hex8_sse42;
+            break;
+#endif
+        default:
+            simd_hash_batch = hash_batch_scalar;
+            simd_find_u32 = find_u32_scalar;
+            simd_cidr_any = cidr_any_scalar;
+            simd_hex8 = hex8_scalar;
+            break;
+    }
+
+    active_level = level;
+    return SYNFLOOD_OK;
+}
+
+simd_level_t simd_init(void) {
+    simd_level_t level = SIMD_LEVEL_SCALAR;
+
+    if (simd_level_supported(SIMD_LEVEL_AVX2)) {
+        level = SIMD_LEVEL_AVX2;
+    } else if (simd_level_supported(SIMD_LEVEL_SSE42)) {
+        level = SIMD_LEVEL_SSE42;
+    }
+
+    simd_set_level(level);
+    LOG_INFO("CPU dispatch: using %s kernels", simd_level_name(level));
+
+    return level;
+}
+
+simd_level_t simd_get_level(void) {
+    return active_level;
+}
+
+const char *simd_level_name(simd_level_t level) {
+    switch (level) {
+        case SIMD_LEVEL_SSE42:
+            return "sse4.2";
+        case SIMD_LEVEL_AVX2:
+            return "avx2";
+        default:
+            return "scalar";
+    }
+}
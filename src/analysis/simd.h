@@ -0,0 +1,91 @@
+/*
+ * simd.h - Runtime CPU feature dispatch for hot kernels
+ * TCP SYN Flood Detector
+ *
+ * Each kernel has a scalar, SSE4.2 and AVX2 implementation built into the
+ * same binary; simd_init() picks the best one the CPU supports. Until then
+ * (and on non-x86 builds) the scalar versions are used.
+ */
+
+#ifndef SYNFLOOD_SIMD_H
+#define SYNFLOOD_SIMD_H
+
+#include "common.h"
+
+typedef enum
+{
+    SIMD_LEVEL_SCALAR = 0,
+    SIMD_LEVEL_SSE42 = 1,
+    SIMD_LEVEL_AVX2 = 2,
+} simd_level_t;
+
+/**
+ * Hash a batch of source IPs to bucket indices (same result as ip_hash())
+ * @param ips Source IPs (network byte order)
+ * @param out Output: bucket index per IP
+ * @param n Number of IPs
+ * @param bucket_count Number of buckets (power of 2)
+ */
+extern void (*simd_hash_batch)(const uint32_t *ips, uint32_t *out, size_t n, size_t bucket_count);
+
+/**
+ * Find the first occurrence of a key in an array
+ * @param keys Key array
+ * @param n Number of keys
+ * @param key Key to find
+ * @return Index of the first match, or n if absent
+ */
+extern size_t (*simd_find_u32)(const uint32_t *keys, size_t n, uint32_t key);
+
+/**
+ * Check whether an IP matches any of a set of prefixes
+ * @param prefixes Network prefixes (already masked)
+ * @param masks Matching netmasks
+ * @param n Number of prefixes
+ * @param ip IP to test (network byte order)
+ * @return true if (ip & masks[i]) == prefixes[i] for some i
+ */
+extern bool (*simd_cidr_any)(const uint32_t *prefixes, const uint32_t *masks, size_t n, uint32_t ip);
+
+/**
+ * Decode exactly 8 hex digits (either case), most significant first
+ * @param src Input; 8 bytes must be readable
+ * @param out Output: decoded value
+ * @return true if all 8 characters were hex digits
+ */
+extern bool (*simd_hex8)(const char *src, uint32_t *out);
+
+/**
+ * Detect CPU features and select the best implementation of each kernel
+ * @return Selected level
+ */
+simd_level_t simd_init(void);
+
+/**
+ * Force a specific level (tests and benchmarks)
+ * @param level Level to use
+ * @return SYNFLOOD_OK, or SYNFLOOD_EINVAL if the CPU does not support it
+ */
+synflood_ret_t simd_set_level(simd_level_t level);
+
+/**
+ * Check whether the CPU supports a level
+ * @param level Level to check
+ * @return true if supported
+ */
+bool simd_level_supported(simd_level_t level);
+
+/**
+ * Get the active level
+ * @return Active level
+ */
+simd_level_t simd_get_level(void);
+
+/**
+ * Get level name for logs
+ * @param level Level
+ * @return "scalar", "sse4.2" or "avx2"
+ */
+const char *simd_level_name(simd_level_t level);
+
+#endif /* SYNFLOOD_SIMD_H */
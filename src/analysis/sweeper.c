@@ -0,0 +1,130 @@
+/*
+ * sweeper.c - Background reclamation of idle tracker entries
+ * TCP SYN Flood Detector
+ */
+
+#include "sweeper.h"
+#include "tracker.h"
+#include "../observe/logger.h"
+#include <pthread.h>
+#include <time.h>
+
+static pthread_t sweeper_thread;
+static volatile bool sweeper_running = false;
+
+static sweeper_stats_t stats;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Buckets per tick so the table is covered every idle_timeout_s / 2 */
+static size_t slice_buckets(size_t bucket_count, uint32_t idle_timeout_s) {
+    uint64_t pass_ns = sec_to_ns(idle_timeout_s) / 2;
+    uint64_t tick_ns = ms_to_ns(SWEEPER_TICK_MS);
+    if (pass_ns < tick_ns) {
+        return bucket_count;
+    }
+
+    uint64_t slice = ((uint64_t)bucket_count * tick_ns + pass_ns - 1) / pass_ns;
+    return (size_t)MIN(MAX(slice, (uint64_t)1), (uint64_t)bucket_count);
+}
+
+size_t sweeper_tick(tracker_table_t *tracker, uint32_t idle_timeout_s) {
+    if (!tracker) {
+        return 0;
+    }
+
+    size_t scan = idle_timeout_s ? slice_buckets(tracker->bucket_count, idle_timeout_s) : 0;
+    if (tracker_sweep_pending(tracker)) {
+        scan = MAX(scan, (size_t)TRACKER_SWEEP_SCAN);
+    }
+    if (scan == 0) {
+        return 0;
+    }
+
+    uint64_t now = get_monotonic_ns();
+    uint64_t idle_ns = sec_to_ns(idle_timeout_s);
+    uint64_t idle_before = (idle_timeout_s && now > idle_ns) ? now - idle_ns : 0;
+
+    /* Latency is wall time spent holding the table, whatever the clock */
+    uint64_t start = clock_system_ns();
+    size_t freed = 0;
+    for (size_t done = 0; done < scan; done += TRACKER_SWEEP_SCAN) {
+        size_t chunk = MIN(scan - done, (size_t)TRACKER_SWEEP_SCAN);
+        freed += idle_before ? tracker_age(tracker, idle_before, chunk)
+                             : tracker_sweep(tracker, chunk);
+    }
+    uint64_t elapsed = clock_system_ns() - start;
+
+    pthread_mutex_lock(&stats_lock);
+    stats.ticks_total++;
+    stats.buckets_total += scan;
+    stats.freed_total += freed;
+    stats.last_tick_ns = elapsed;
+    stats.max_tick_ns = MAX(stats.max_tick_ns, elapsed);
+    pthread_mutex_unlock(&stats_lock);
+
+    if (freed > 0) {
+        LOG_DEBUG("Sweeper freed %zu tracker entries in %lu us", freed,
+                  (unsigned long)(elapsed / 1000));
+    }
+    return freed;
+}
+
+static void *sweeper_thread_func(void *arg) {
+    app_context_t *ctx = (app_context_t *)arg;
+    struct timespec tick = {
+        .tv_sec = SWEEPER_TICK_MS / 1000,
+        .tv_nsec = (long)(SWEEPER_TICK_MS % 1000) * 1000000L,
+    };
+
+    LOG_INFO("Tracker sweeper started (idle_timeout_s=%u)", ctx->config->idle_timeout_s);
+
+    while (sweeper_running && ctx->running) {
+        nanosleep(&tick, NULL);
+        sweeper_tick(ctx->tracker, ctx->config->idle_timeout_s);
+    }
+
+    LOG_INFO("Tracker sweeper stopped");
+    return NULL;
+}
+
+synflood_ret_t sweeper_start(app_context_t *ctx) {
+    if (!ctx || !ctx->tracker || !ctx->config) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    if (sweeper_running) {
+        return SYNFLOOD_OK;
+    }
+
+    sweeper_running = true;
+    if (pthread_create(&sweeper_thread, NULL, sweeper_thread_func, ctx) != 0) {
+        LOG_ERROR("Failed to create tracker sweeper thread");
+        sweeper_running = false;
+        return SYNFLOOD_ERROR;
+    }
+
+    return SYNFLOOD_OK;
+}
+
+void sweeper_stop(void) {
+    if (!sweeper_running) {
+        return;
+    }
+
+    sweeper_running = false;
+    pthread_join(sweeper_thread, NULL);
+}
+
+bool sweeper_enabled(void) {
+    return sweeper_running;
+}
+
+void sweeper_get_stats(sweeper_stats_t *out) {
+    if (!out) {
+        return;
+    }
+
+    pthread_mutex_lock(&stats_lock);
+    *out = stats;
+    pthread_mutex_unlock(&stats_lock);
+}
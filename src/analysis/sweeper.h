@@ -0,0 +1,64 @@
+/*
+ * sweeper.h - Background reclamation of idle tracker entries
+ * TCP SYN Flood Detector
+ *
+ * Every SWEEPER_TICK_MS the sweeper frees entries from a slice of tracker
+ * buckets: entries dropped by tracker_clear(), and with idle_timeout_s set,
+ * unblocked entries not seen for that long. The slice is sized so the whole
+ * table is covered every idle_timeout_s / 2, so an idle entry is gone within
+ * one and a half timeouts and the table tracks active sources rather than
+ * filling up with what a past flood left behind.
+ */
+
+#ifndef SYNFLOOD_SWEEPER_H
+#define SYNFLOOD_SWEEPER_H
+
+#include "common.h"
+
+#define SWEEPER_TICK_MS 100
+
+typedef struct
+{
+    uint64_t ticks_total;   /* Ticks that examined at least one bucket */
+    uint64_t buckets_total; /* Buckets examined */
+    uint64_t freed_total;   /* Entries freed */
+    uint64_t last_tick_ns;  /* Time spent in the last such tick */
+    uint64_t max_tick_ns;   /* Longest tick since start */
+} sweeper_stats_t;
+
+/**
+ * Start the sweeper thread
+ * idle_timeout_s is read from ctx->config every tick, so reloads apply.
+ * @param ctx Application context
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t sweeper_start(app_context_t *ctx);
+
+/**
+ * Stop the sweeper thread
+ */
+void sweeper_stop(void);
+
+/**
+ * Check whether the sweeper thread is running
+ * @return true if running
+ */
+bool sweeper_enabled(void);
+
+/**
+ * Run one sweeper tick (what the thread does every SWEEPER_TICK_MS)
+ * Exposed so simulations on a virtual clock can drive the sweeper.
+ * @param tracker Tracker table
+ * @param idle_timeout_s Idle time after which unblocked entries go (0 = only
+ *                       reclaim cleared entries)
+ * @return Entries freed
+ */
+size_t sweeper_tick(tracker_table_t *tracker, uint32_t idle_timeout_s);
+
+/**
+ * Get sweeper counters
+ * @param stats Output statistics
+ */
+void sweeper_get_stats(sweeper_stats_t *stats);
+
+#endif /* SYNFLOOD_SWEEPER_H */
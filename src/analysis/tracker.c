@@ -4,9 +4,25 @@
  */
 
 #include "tracker.h"
+#include "tracker_shm.h"
+#include "simd.h"
 #include "../observe/logger.h"
+#include <arpa/inet.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <errno.h>
+
+synflood_ret_t tracker_wl_cache_init(tracker_table_t *table, size_t slots) {
+    slots = MAX(slots, (size_t)TRACKER_WL_CACHE_MIN);
+
+    table->wl_cache = calloc(slots, sizeof(uint64_t));
+    if (!table->wl_cache) {
+        return SYNFLOOD_ENOMEM;
+    }
+    table->wl_mask = slots - 1;
+    return SYNFLOOD_OK;
+}
 
 tracker_table_t *tracker_create(size_t bucket_count, size_t max_entries) {
     if (bucket_count == 0 || (bucket_count & (bucket_count - 1)) != 0) {
@@ -28,8 +44,19 @@ tracker_table_t *tracker_create(size_t bucket_count, size_t max_entries) {
     table->bucket_count = bucket_count;
     table->entry_count = 0;
     table->max_entries = max_entries;
+    table->local_gen[0] = 1;
+    table->local_gen[1] = 1;
+    table->whitelist_gen = &table->local_gen[0];
+    table->asnmap_gen = &table->local_gen[1];
+
+    if (tracker_wl_cache_init(table, bucket_count) != SYNFLOOD_OK) {
+        free(table->buckets);
+        free(table);
+        return NULL;
+    }
 
     if (pthread_rwlock_init(&table->lock, NULL) != 0) {
+        free(table->wl_cache);
         free(table->buckets);
         free(table);
         return NULL;
@@ -41,11 +68,32 @@ tracker_table_t *tracker_create(size_t bucket_count, size_t max_entries) {
     return table;
 }
 
+tracker_table_t *tracker_create_shared(const char *name, size_t max_entries) {
+    return tracker_shm_create(name, max_entries);
+}
+
+synflood_ret_t tracker_shared_unlink(const char *name) {
+    if (!name) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    if (shm_unlink(name) < 0) {
+        return errno == ENOENT ? SYNFLOOD_ENOTFOUND : SYNFLOOD_ERROR;
+    }
+
+    return SYNFLOOD_OK;
+}
+
 void tracker_destroy(tracker_table_t *table) {
     if (!table) {
         return;
     }
 
+    if (table->shm) {
+        tracker_shm_destroy(table);
+        return;
+    }
+
     pthread_rwlock_wrlock(&table->lock);
 
     for (size_t i = 0; i < table->bucket_count; i++) {
@@ -60,50 +108,62 @@ void tracker_destroy(tracker_table_t *table) {
     free(table->buckets);
     pthread_rwlock_unlock(&table->lock);
     pthread_rwlock_destroy(&table->lock);
+    free(table->wl_cache);
     free(table);
 
     LOG_DEBUG("Tracker table destroyed");
 }
 
-/* LRU eviction: remove the least recently seen entry */
+/* Cleared by tracker_clear() or tracker_clear_older(), not yet reclaimed */
+static inline bool node_stale(const tracker_table_t *table, const tracker_node_t *node) {
+    return node->generation != table->generation ||
+           node->data.last_seen_ns < table->stale_before_ns;
+}
+
+/* Unlink and free the node *link points to; caller holds the write lock */
+static void node_reclaim(tracker_table_t *table, tracker_node_t **link) {
+    tracker_node_t *node = *link;
+    *link = node->next;
+
+    if (node->generation != table->generation) {
+        table->stale_count--;
+    } else {
+        table->entry_count--;
+    }
+    free(node);
+}
+
+/* LRU eviction: remove the least recently seen entry. Cleared entries met
+ * on the way are reclaimed; if that made room, nothing live is evicted. */
 static void tracker_evict_lru(tracker_table_t *table) {
     if (table->entry_count == 0) {
         return;
     }
 
-    tracker_node_t *oldest_node = NULL;
-    tracker_node_t *oldest_prev = NULL;
-    size_t oldest_bucket = 0;
+    tracker_node_t **oldest_link = NULL;
     uint64_t oldest_time = UINT64_MAX;
 
     /* Find the oldest entry */
     for (size_t i = 0; i < table->bucket_count; i++) {
-        tracker_node_t *prev = NULL;
-        tracker_node_t *node = table->buckets[i];
+        tracker_node_t **link = &table->buckets[i];
 
-        while (node) {
+        while (*link) {
+            tracker_node_t *node = *link;
+            if (node_stale(table, node)) {
+                node_reclaim(table, link);
+                continue;
+            }
             if (node->data.last_seen_ns < oldest_time) {
                 oldest_time = node->data.last_seen_ns;
-                oldest_node = node;
-                oldest_prev = prev;
-                oldest_bucket = i;
+                oldest_link = link;
             }
-            prev = node;
-            node = node->next;
+            link = &node->next;
         }
     }
 
-    if (oldest_node) {
-        /* Remove from chain */
-        if (oldest_prev) {
-            oldest_prev->next = oldest_node->next;
-        } else {
-            table->buckets[oldest_bucket] = oldest_node->next;
-        }
-
-        LOG_DEBUG("Evicted LRU entry: IP=%u", oldest_node->data.ip_addr);
-        free(oldest_node);
-        table->entry_count--;
+    if (oldest_link && table->entry_count >= table->max_entries) {
+        LOG_DEBUG("Evicted LRU entry: IP=%u", (*oldest_link)->data.ip_addr);
+        node_reclaim(table, oldest_link);
     }
 }
 
@@ -112,22 +172,29 @@ ip_tracker_t *tracker_get_or_create(tracker_table_t *table, uint32_t ip_addr) {
         return NULL;
     }
 
+    if (table->shm) {
+        return tracker_shm_get_or_create(table, ip_addr);
+    }
+
     pthread_rwlock_wrlock(&table->lock);
 
     uint32_t bucket = ip_hash(ip_addr, table->bucket_count);
-    tracker_node_t *node = table->buckets[bucket];
-    tracker_node_t *prev = NULL;
+    tracker_node_t **link = &table->buckets[bucket];
 
     /* Search for existing entry */
-    while (node) {
+    while (*link) {
+        tracker_node_t *node = *link;
         if (node->data.ip_addr == ip_addr) {
+            if (node_stale(table, node)) {
+                node_reclaim(table, link); /* Cleared: start afresh */
+                break;
+            }
             uint64_t now = get_monotonic_ns();
             node->data.last_seen_ns = now;
             pthread_rwlock_unlock(&table->lock);
             return &node->data;
         }
-        prev = node;
-        node = node->next;
+        link = &node->next;
     }
 
     /* Entry not found, create new one */
@@ -148,14 +215,11 @@ ip_tracker_t *tracker_get_or_create(tracker_table_t *table, uint32_t ip_addr) {
     new_node->data.last_seen_ns = now;
     new_node->data.blocked = 0;
     new_node->data.block_expiry_ns = 0;
-    new_node->next = NULL;
+    new_node->generation = table->generation;
 
-    /* Insert at head of bucket */
-    if (prev) {
-        prev->next = new_node;
-    } else {
-        table->buckets[bucket] = new_node;
-    }
+    /* Insert at head of bucket (eviction may have changed the chain) */
+    new_node->next = table->buckets[bucket];
+    table->buckets[bucket] = new_node;
 
     table->entry_count++;
 
@@ -171,6 +235,10 @@ ip_tracker_t *tracker_get(tracker_table_t *table, uint32_t ip_addr) {
         return NULL;
     }
 
+    if (table->shm) {
+        return tracker_shm_get(table, ip_addr);
+    }
+
     pthread_rwlock_rdlock(&table->lock);
 
     uint32_t bucket = ip_hash(ip_addr, table->bucket_count);
@@ -178,8 +246,9 @@ ip_tracker_t *tracker_get(tracker_table_t *table, uint32_t ip_addr) {
 
     while (node) {
         if (node->data.ip_addr == ip_addr) {
+            ip_tracker_t *data = node_stale(table, node) ? NULL : &node->data;
             pthread_rwlock_unlock(&table->lock);
-            return &node->data;
+            return data;
         }
         node = node->next;
     }
@@ -188,32 +257,109 @@ ip_tracker_t *tracker_get(tracker_table_t *table, uint32_t ip_addr) {
     return NULL;
 }
 
+#define TRACKER_BATCH_CHUNK 64
+
+size_t tracker_get_batch(tracker_table_t *table, const uint32_t *ips, size_t n,
+                         ip_tracker_t **out) {
+    if (!table || !ips || !out) {
+        return 0;
+    }
+
+    if (table->shm) {
+        return tracker_shm_get_batch(table, ips, n, out);
+    }
+
+    uint32_t buckets[TRACKER_BATCH_CHUNK];
+    size_t found = 0;
+
+    pthread_rwlock_rdlock(&table->lock);
+
+    for (size_t base = 0; base < n; base += TRACKER_BATCH_CHUNK) {
+        size_t len = n - base < TRACKER_BATCH_CHUNK ? n - base : TRACKER_BATCH_CHUNK;
+
+        /* Hash the whole chunk at once, then touch every chain head before
+         * walking any of them so the cache misses overlap */
+        simd_hash_batch(ips + base, buckets, len, table->bucket_count);
+        for (size_t i = 0; i < len; i++) {
+            __builtin_prefetch(table->buckets[buckets[i]]);
+        }
+
+        for (size_t i = 0; i < len; i++) {
+            tracker_node_t *node = table->buckets[buckets[i]];
+            while (node && node->data.ip_addr != ips[base + i]) {
+                node = node->next;
+            }
+            if (node && node_stale(table, node)) {
+                node = NULL;
+            }
+
+            out[base + i] = node ? &node->data : NULL;
+            if (node) {
+                found++;
+            }
+        }
+    }
+
+    pthread_rwlock_unlock(&table->lock);
+    return found;
+}
+
+/* 0 never matches: generations start at 1 */
+static inline uint64_t wl_cache_key(uint32_t ip_addr, uint32_t generation) {
+    return ((uint64_t)generation << 32) | ip_addr;
+}
+
+bool tracker_whitelisted(tracker_table_t *table, uint32_t ip_addr, uint32_t generation) {
+    if (!table || !table->wl_cache) {
+        return false;
+    }
+
+    uint64_t *slot = &table->wl_cache[ip_hash(ip_addr, table->wl_mask + 1)];
+    return __atomic_load_n(slot, __ATOMIC_RELAXED) == wl_cache_key(ip_addr, generation);
+}
+
+void tracker_mark_whitelisted(tracker_table_t *table, uint32_t ip_addr, uint32_t generation) {
+    if (!table || !table->wl_cache) {
+        return;
+    }
+
+    /* One 64-bit store, so readers never see an address with another's generation */
+    uint64_t *slot = &table->wl_cache[ip_hash(ip_addr, table->wl_mask + 1)];
+    __atomic_store_n(slot, wl_cache_key(ip_addr, generation), __ATOMIC_RELAXED);
+
+    ip_tracker_t *entry = tracker_get(table, ip_addr);
+    if (entry && !entry->blocked) {
+        tracker_remove(table, ip_addr);
+    }
+}
+
 synflood_ret_t tracker_remove(tracker_table_t *table, uint32_t ip_addr) {
     if (!table) {
         return SYNFLOOD_EINVAL;
     }
 
+    if (table->shm) {
+        return tracker_shm_remove(table, ip_addr);
+    }
+
     pthread_rwlock_wrlock(&table->lock);
 
     uint32_t bucket = ip_hash(ip_addr, table->bucket_count);
-    tracker_node_t *node = table->buckets[bucket];
-    tracker_node_t *prev = NULL;
+    tracker_node_t **link = &table->buckets[bucket];
 
-    while (node) {
+    while (*link) {
+        tracker_node_t *node = *link;
         if (node->data.ip_addr == ip_addr) {
-            if (prev) {
-                prev->next = node->next;
-            } else {
-                table->buckets[bucket] = node->next;
-            }
-            free(node);
-            table->entry_count--;
+            bool stale = node_stale(table, node);
+            node_reclaim(table, link);
             pthread_rwlock_unlock(&table->lock);
+            if (stale) {
+                return SYNFLOOD_ENOTFOUND;
+            }
             LOG_DEBUG("Removed tracker entry: IP=%u", ip_addr);
             return SYNFLOOD_OK;
         }
-        prev = node;
-        node = node->next;
+        link = &node->next;
     }
 
     pthread_rwlock_unlock(&table->lock);
@@ -226,13 +372,18 @@ size_t tracker_get_expired_blocks(tracker_table_t *table, uint64_t current_time_
         return 0;
     }
 
+    if (table->shm) {
+        return tracker_shm_get_expired_blocks(table, current_time_ns, expired_ips, max_ips);
+    }
+
     pthread_rwlock_rdlock(&table->lock);
 
     size_t count = 0;
     for (size_t i = 0; i < table->bucket_count && count < max_ips; i++) {
         tracker_node_t *node = table->buckets[i];
         while (node && count < max_ips) {
-            if (node->data.blocked && node->data.block_expiry_ns <= current_time_ns) {
+            if (node->data.blocked && node->data.block_expiry_ns <= current_time_ns &&
+                !node_stale(table, node)) {
                 expired_ips[count++] = node->data.ip_addr;
             }
             node = node->next;
@@ -250,6 +401,11 @@ void tracker_get_stats(tracker_table_t *table, size_t *entry_count, size_t *bloc
         return;
     }
 
+    if (table->shm) {
+        tracker_shm_get_stats(table, entry_count, blocked_count);
+        return;
+    }
+
     pthread_rwlock_rdlock(&table->lock);
 
     if (entry_count) {
@@ -261,7 +417,7 @@ void tracker_get_stats(tracker_table_t *table, size_t *entry_count, size_t *bloc
         for (size_t i = 0; i < table->bucket_count; i++) {
             tracker_node_t *node = table->buckets[i];
             while (node) {
-                if (node->data.blocked) {
+                if (node->data.blocked && !node_stale(table, node)) {
                     count++;
                 }
                 node = node->next;
@@ -273,26 +429,190 @@ void tracker_get_stats(tracker_table_t *table, size_t *entry_count, size_t *bloc
     pthread_rwlock_unlock(&table->lock);
 }
 
+size_t tracker_dump_chunk(tracker_table_t *table, tracker_cursor_t *cursor,
+                          const tracker_filter_t *filter, ip_tracker_t *out, size_t max) {
+    if (!table || !cursor || !out) {
+        return 0;
+    }
+
+    if (table->shm) {
+        return tracker_shm_dump_chunk(table, cursor, filter, out, max);
+    }
+
+    pthread_rwlock_rdlock(&table->lock);
+
+    size_t count = 0;
+    size_t end = cursor->bucket + TRACKER_DUMP_SCAN;
+    if (end > table->bucket_count) {
+        end = table->bucket_count;
+    }
+
+    while (cursor->bucket < end && count < max) {
+        tracker_node_t *head = table->buckets[cursor->bucket];
+
+        if (!cursor->partial) {
+            size_t matches = 0;
+            for (tracker_node_t *node = head; node; node = node->next) {
+                if (!node_stale(table, node) && tracker_filter_match(filter, &node->data)) {
+                    matches++;
+                }
+            }
+
+            if (matches <= max - count) {
+                for (tracker_node_t *node = head; node; node = node->next) {
+                    if (!node_stale(table, node) && tracker_filter_match(filter, &node->data)) {
+                        out[count++] = node->data;
+                    }
+                }
+                cursor->bucket++;
+                continue;
+            }
+            if (count > 0) {
+                break; /* Start the bucket in the next call */
+            }
+        }
+
+        /* More matches than out holds: chain positions shift with head
+         * insertions, so walk the bucket in key order instead */
+        while (count < max) {
+            tracker_node_t *next = NULL;
+            for (tracker_node_t *node = head; node; node = node->next) {
+                uint32_t key = ntohl(node->data.ip_addr);
+                if ((cursor->partial && key <= cursor->last_key) || node_stale(table, node) ||
+                    !tracker_filter_match(filter, &node->data)) {
+                    continue;
+                }
+                if (!next || key < ntohl(next->data.ip_addr)) {
+                    next = node;
+                }
+            }
+            if (!next) {
+                break;
+            }
+            out[count++] = next->data;
+            cursor->last_key = ntohl(next->data.ip_addr);
+            cursor->partial = true;
+        }
+
+        if (count == max) {
+            break; /* Resume after last_key */
+        }
+        cursor->bucket++;
+        cursor->partial = false;
+    }
+
+    cursor->done = cursor->bucket >= table->bucket_count;
+
+    pthread_rwlock_unlock(&table->lock);
+    return count;
+}
+
 void tracker_clear(tracker_table_t *table) {
     if (!table) {
         return;
     }
 
+    if (table->shm) {
+        tracker_shm_clear(table);
+        return;
+    }
+
     pthread_rwlock_wrlock(&table->lock);
 
-    for (size_t i = 0; i < table->bucket_count; i++) {
-        tracker_node_t *node = table->buckets[i];
-        while (node) {
-            tracker_node_t *next = node->next;
-            free(node);
-            node = next;
+    /* Every node is now from an older generation; reclaimed lazily */
+    table->generation++;
+    table->stale_count += table->entry_count;
+    table->entry_count = 0;
+    table->stale_before_ns = 0;
+    __atomic_store_n(&table->sweep_pending, table->bucket_count, __ATOMIC_RELAXED);
+
+    pthread_rwlock_unlock(&table->lock);
+
+    LOG_INFO("Tracker table cleared");
+}
+
+void tracker_clear_older(tracker_table_t *table, uint64_t cutoff_ns) {
+    if (!table) {
+        return;
+    }
+
+    if (table->shm) {
+        tracker_shm_clear_older(table, cutoff_ns);
+        return;
+    }
+
+    /* A future cutoff would hide entries created from now on */
+    cutoff_ns = MIN(cutoff_ns, get_monotonic_ns());
+
+    pthread_rwlock_wrlock(&table->lock);
+
+    if (cutoff_ns > table->stale_before_ns) {
+        table->stale_before_ns = cutoff_ns;
+        __atomic_store_n(&table->sweep_pending, table->bucket_count, __ATOMIC_RELAXED);
+    }
+
+    pthread_rwlock_unlock(&table->lock);
+
+    LOG_INFO("Tracker entries idle for %llu ms cleared",
+             (unsigned long long)((get_monotonic_ns() - cutoff_ns) / NSEC_PER_MSEC));
+}
+
+/* Free cleared entries, and unblocked ones idle since before idle_before_ns,
+ * from the next scan buckets; caller holds the write lock */
+static size_t sweep_buckets(tracker_table_t *table, size_t scan, uint64_t idle_before_ns) {
+    size_t freed = 0;
+
+    for (size_t i = 0; i < scan; i++) {
+        tracker_node_t **link = &table->buckets[table->sweep_bucket];
+        while (*link) {
+            tracker_node_t *node = *link;
+            if (node_stale(table, node) ||
+                (!node->data.blocked && node->data.last_seen_ns < idle_before_ns)) {
+                node_reclaim(table, link);
+                freed++;
+            } else {
+                link = &node->next;
+            }
         }
-        table->buckets[i] = NULL;
+        table->sweep_bucket = (table->sweep_bucket + 1) & (table->bucket_count - 1);
     }
 
-    table->entry_count = 0;
+    size_t pending = table->sweep_pending;
+    __atomic_store_n(&table->sweep_pending, pending > scan ? pending - scan : 0, __ATOMIC_RELAXED);
+    return freed;
+}
+
+size_t tracker_sweep(tracker_table_t *table, size_t max_buckets) {
+    if (!table || table->shm) {
+        return 0;
+    }
 
+    pthread_rwlock_wrlock(&table->lock);
+    size_t freed = sweep_buckets(table, MIN(max_buckets, table->sweep_pending), 0);
     pthread_rwlock_unlock(&table->lock);
 
-    LOG_INFO("Tracker table cleared");
+    if (freed > 0) {
+        LOG_DEBUG("Tracker sweep reclaimed %zu entries", freed);
+    }
+    return freed;
+}
+
+size_t tracker_age(tracker_table_t *table, uint64_t idle_before_ns, size_t max_buckets) {
+    if (!table) {
+        return 0;
+    }
+
+    if (table->shm) {
+        return tracker_shm_age(table, idle_before_ns, max_buckets);
+    }
+
+    pthread_rwlock_wrlock(&table->lock);
+    size_t freed = sweep_buckets(table, MIN(max_buckets, table->bucket_count), idle_before_ns);
+    pthread_rwlock_unlock(&table->lock);
+
+    return freed;
+}
+
+bool tracker_sweep_pending(tracker_table_t *table) {
+    return table && !table->shm && __atomic_load_n(&table->sweep_pending, __ATOMIC_RELAXED) != 0;
 }
@@ -8,6 +8,40 @@
 
 #include "common.h"
 
+/* Buckets (slots for shared tables) examined per tracker_dump_chunk call */
+#define TRACKER_DUMP_SCAN 1024
+
+/* Buckets examined per lock hold by the background sweeper */
+#define TRACKER_SWEEP_SCAN 1024
+
+/* Minimum slots in the whitelisted-source cache */
+#define TRACKER_WL_CACHE_MIN 1024
+
+/* Which entries tracker_dump_chunk returns (zero-initialized matches all) */
+typedef enum
+{
+    TRACKER_MATCH_ANY = 0,
+    TRACKER_MATCH_BLOCKED,
+    TRACKER_MATCH_UNBLOCKED,
+} tracker_match_t;
+
+typedef struct
+{
+    uint32_t prefix;        /* Network byte order */
+    uint32_t prefix_mask;   /* Network byte order, 0 = any source */
+    uint32_t min_syn_count; /* SYNs in the current window */
+    tracker_match_t blocked;
+} tracker_filter_t;
+
+/* Position of an incremental walk over the table (zero-initialize to start) */
+typedef struct
+{
+    size_t bucket;     /* Next bucket (slot for shared tables) */
+    uint32_t last_key; /* Last source returned from that bucket (host byte order) */
+    bool partial;      /* That bucket is being returned in key order from last_key on */
+    bool done;
+} tracker_cursor_t;
+
 /**
  * Create a new tracker table
  * @param bucket_count Number of hash buckets (must be power of 2)
@@ -16,6 +50,25 @@
  */
 tracker_table_t *tracker_create(size_t bucket_count, size_t max_entries);
 
+/**
+ * Create or attach to a tracker table in a named shared-memory segment
+ * Processes passing the same name and max_entries count into one table.
+ * The segment has a fixed number of slots; when an IP's probe window is
+ * full the least recently seen entry there is replaced. The generations
+ * validating cached whitelist and ASN verdicts live in the segment too.
+ * @param name POSIX shared-memory name, e.g. "/synflood_tracker"
+ * @param max_entries Maximum number of entries (must match across processes)
+ * @return Pointer to tracker_table_t or NULL on error
+ */
+tracker_table_t *tracker_create_shared(const char *name, size_t max_entries);
+
+/**
+ * Remove a shared tracker segment name (mappings stay valid until destroyed)
+ * @param name POSIX shared-memory name
+ * @return SYNFLOOD_OK on success, SYNFLOOD_ENOTFOUND if it does not exist
+ */
+synflood_ret_t tracker_shared_unlink(const char *name);
+
 /**
  * Destroy tracker table and free all resources
  * @param table Tracker table to destroy
@@ -38,6 +91,39 @@ ip_tracker_t *tracker_get_or_create(tracker_table_t *table, uint32_t ip_addr);
  */
 ip_tracker_t *tracker_get(tracker_table_t *table, uint32_t ip_addr);
 
+/**
+ * Look up a batch of IPs (no creation) under a single read lock
+ * Bucket indices are computed with the CPU-dispatched hash kernel.
+ * @param table Tracker table
+ * @param ips IP addresses (network byte order)
+ * @param n Number of IPs
+ * @param out Output: entry per IP, NULL if not tracked
+ * @return Number of IPs found
+ */
+size_t tracker_get_batch(tracker_table_t *table, const uint32_t *ips, size_t n,
+                         ip_tracker_t **out);
+
+/**
+ * Check the compact cache of whitelisted sources (lock-free)
+ * Whitelisted sources keep only their address and the whitelist generation
+ * here instead of a full entry, so their SYNs skip the tracker and the trie.
+ * @param table Tracker table
+ * @param ip_addr IP address (network byte order)
+ * @param generation Current whitelist generation (must not be 0)
+ * @return true if the source was found whitelisted in this generation
+ */
+bool tracker_whitelisted(tracker_table_t *table, uint32_t ip_addr, uint32_t generation);
+
+/**
+ * Record a source as whitelisted in the compact cache
+ * Its full entry is removed unless it is blocked (the block still has to
+ * be lifted by the expiry thread).
+ * @param table Tracker table
+ * @param ip_addr IP address (network byte order)
+ * @param generation Whitelist generation of the verdict (must not be 0)
+ */
+void tracker_mark_whitelisted(tracker_table_t *table, uint32_t ip_addr, uint32_t generation);
+
 /**
  * Remove a tracker entry
  * @param table Tracker table
@@ -65,10 +151,106 @@ size_t tracker_get_expired_blocks(tracker_table_t *table, uint64_t current_time_
  */
 void tracker_get_stats(tracker_table_t *table, size_t *entry_count, size_t *blocked_count);
 
+/**
+ * Copy the next matching entries out of the table
+ * Each call holds the read lock only while examining at most
+ * TRACKER_DUMP_SCAN buckets, so a full walk of a large table never stalls
+ * the detection path. A bucket is returned whole, or, if its matches do
+ * not fit in out, in source address order resumed after the last one
+ * returned, so entries inserted or removed between calls may be missed
+ * but are never returned twice (in a shared table an entry evicted and
+ * re-created in a later slot can be).
+ * @param table Tracker table
+ * @param cursor Walk position, advanced; cursor->done is set at the end
+ * @param filter Entries to return (NULL = all)
+ * @param out Output entries (copies)
+ * @param max Capacity of out
+ * @return Entries copied (may be 0 before the walk is done)
+ */
+size_t tracker_dump_chunk(tracker_table_t *table, tracker_cursor_t *cursor,
+                          const tracker_filter_t *filter, ip_tracker_t *out, size_t max);
+
+/**
+ * Counter of a flag class in the current window
+ * @param entry Entry
+ * @param flood_class Flag class (not FLOOD_CLASS_NONE)
+ * @return syn_count or the class's flood_count slot
+ */
+static inline uint32_t *tracker_class_count(ip_tracker_t *entry, flood_class_t flood_class) {
+    return flood_class == FLOOD_CLASS_SYN ? &entry->syn_count : &entry->flood_count[flood_class - 1];
+}
+
+/**
+ * Check an entry against a dump filter
+ * @param filter Filter (NULL = all)
+ * @param entry Entry
+ * @return true if the entry matches
+ */
+static inline bool tracker_filter_match(const tracker_filter_t *filter, const ip_tracker_t *entry) {
+    if (!filter) {
+        return true;
+    }
+    if ((entry->ip_addr & filter->prefix_mask) != (filter->prefix & filter->prefix_mask)) {
+        return false;
+    }
+    if (entry->syn_count < filter->min_syn_count) {
+        return false;
+    }
+    if (filter->blocked == TRACKER_MATCH_BLOCKED && !entry->blocked) {
+        return false;
+    }
+    if (filter->blocked == TRACKER_MATCH_UNBLOCKED && entry->blocked) {
+        return false;
+    }
+    return true;
+}
+
 /**
  * Clear all entries from the tracker table
+ * O(1) for private tables: the table generation is bumped and older nodes
+ * become invisible at once. Their memory is reclaimed lazily, when a lookup
+ * or LRU scan runs into them, or by tracker_sweep().
  * @param table Tracker table
  */
 void tracker_clear(tracker_table_t *table);
 
+/**
+ * Clear every entry last seen before a point in time
+ * O(1) for private tables, reclaimed like tracker_clear(). Until the sweep
+ * reaches them, aged-out entries still count in the entry_count reported by
+ * tracker_get_stats().
+ * @param table Tracker table
+ * @param cutoff_ns Entries with last_seen_ns before this are removed
+ */
+void tracker_clear_older(tracker_table_t *table, uint64_t cutoff_ns);
+
+/**
+ * Reclaim cleared entries from the next buckets
+ * Holds the write lock only while examining at most max_buckets buckets.
+ * @param table Tracker table
+ * @param max_buckets Buckets to examine
+ * @return Entries freed
+ */
+size_t tracker_sweep(tracker_table_t *table, size_t max_buckets);
+
+/**
+ * Free idle entries from the next buckets
+ * Unblocked entries last seen before idle_before_ns are removed, along with
+ * any cleared ones; blocked entries stay until their block is lifted. Holds
+ * the write lock only while examining at most max_buckets buckets (slots for
+ * shared tables), continuing where the previous call stopped.
+ * @param table Tracker table
+ * @param idle_before_ns Entries last seen before this are idle
+ * @param max_buckets Buckets to examine
+ * @return Entries freed
+ */
+size_t tracker_age(tracker_table_t *table, uint64_t idle_before_ns, size_t max_buckets);
+
+/**
+ * Check whether cleared entries may still be waiting for tracker_sweep()
+ * @param table Tracker table
+ * @return true until a sweep has covered the table since the last clear
+ */
+bool tracker_sweep_pending(tracker_table_t *table);
+
 #endif /* SYNFLOOD_TRACKER_H */
@@ -0,0 +1,699 @@
+/*
+ * tracker_shm.c - Shared-memory backend for the tracker table
+ * TCP SYN Flood Detector
+ *
+ * Segment layout (all offsets fixed at creation):
+ *   [shm_header_t][shm_stripe_t x stripe_count][ip_tracker_t x slot_count]
+ */
+
+#include "tracker_shm.h"
+#include "../observe/logger.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define TRACKER_SHM_MAGIC 0x53594E54u /* "SYNT" */
+
+typedef struct
+{
+    uint32_t magic;        /* Written last by the creator */
+    uint32_t version;
+    uint64_t slot_count;   /* Power of 2 */
+    uint64_t max_entries;
+    uint64_t stripe_count; /* Power of 2 */
+    uint64_t entry_count;  /* Live entries (atomic) */
+    uint64_t recoveries;   /* Locks taken over from dead processes (atomic) */
+    uint64_t evict_hand;   /* Next slot examined by shm_evict_any (atomic) */
+    uint32_t whitelist_gen; /* Generation of cached whitelist verdicts, shared by all processes */
+    uint32_t asnmap_gen;    /* Generation of cached origin ASes, likewise */
+} shm_header_t;
+
+_Static_assert(sizeof(shm_header_t) == 64, "shm_header_t must be one cache line");
+
+typedef struct
+{
+    uint32_t owner;   /* PID holding the stripe, 0 = free (atomic) */
+    uint32_t pending; /* Slot index + 1 being rewritten by the owner, 0 = none */
+} shm_stripe_t;
+
+struct tracker_shm
+{
+    void *map;
+    size_t map_size;
+    shm_header_t *header;
+    shm_stripe_t *stripes;
+    ip_tracker_t *slots;
+    uint32_t pid;
+    uint64_t age_hand; /* Next slot examined by tracker_shm_age (this process) */
+};
+
+static size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+static size_t shm_layout_size(size_t stripe_count, size_t slot_count) {
+    size_t slots_offset = sizeof(shm_header_t) + stripe_count * sizeof(shm_stripe_t);
+    slots_offset = (slots_offset + 63) & ~(size_t)63;
+    return slots_offset + slot_count * sizeof(ip_tracker_t);
+}
+
+static void shm_attach_layout(struct tracker_shm *shm) {
+    shm->header = shm->map;
+    shm->stripes = (shm_stripe_t *)(shm->header + 1);
+
+    size_t slots_offset = sizeof(shm_header_t) + shm->header->stripe_count * sizeof(shm_stripe_t);
+    slots_offset = (slots_offset + 63) & ~(size_t)63;
+    shm->slots = (ip_tracker_t *)((char *)shm->map + slots_offset);
+}
+
+static inline uint32_t slot_key(const ip_tracker_t *slot) {
+    return __atomic_load_n(&slot->ip_addr, __ATOMIC_ACQUIRE);
+}
+
+static inline bool key_live(uint32_t key) {
+    return key != 0 && key != TRACKER_SHM_TOMBSTONE;
+}
+
+/* Reset everything but the key */
+static void shm_init_entry(ip_tracker_t *slot, uint64_t now) {
+    slot->syn_count = 0;
+    slot->window_start_ns = now;
+    slot->last_seen_ns = now;
+    slot->blocked = 0;
+    slot->whitelisted = 0;
+    slot->whitelist_gen = 0;
+    slot->block_expiry_ns = 0;
+    memset(slot->flood_count, 0, sizeof(slot->flood_count));
+    memset(slot->set_block_expiry_ns, 0, sizeof(slot->set_block_expiry_ns));
+    slot->asn = 0;
+    slot->asn_gen = 0;
+}
+
+/* Start of the grace period: entries seen since then are not evicted */
+static inline uint64_t shm_idle_before(uint64_t now) {
+    uint64_t grace = ms_to_ns(TRACKER_SHM_EVICT_GRACE_MS);
+    return now > grace ? now - grace : 0;
+}
+
+/* Refresh an entry the caller is about to use. Fails if an evictor has
+ * already claimed it, in which case the caller must not use the slot. */
+static bool shm_touch(ip_tracker_t *slot, uint64_t now) {
+    uint64_t seen = __atomic_load_n(&slot->last_seen_ns, __ATOMIC_ACQUIRE);
+
+    while (seen < now) {
+        if (__atomic_compare_exchange_n(&slot->last_seen_ns, &seen, now, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return true;
+        }
+    }
+    return seen != TRACKER_SHM_RETIRING;
+}
+
+/* Claim an entry idle since before idle_before for eviction. Claiming and
+ * shm_touch() race on last_seen_ns, so an entry refreshed by a lookup is
+ * never claimed, and a claimed one is never handed out. */
+static bool shm_claim_idle(ip_tracker_t *slot, uint64_t idle_before, uint64_t *seen) {
+    *seen = __atomic_load_n(&slot->last_seen_ns, __ATOMIC_ACQUIRE);
+
+    return *seen < idle_before &&
+           __atomic_compare_exchange_n(&slot->last_seen_ns, seen, TRACKER_SHM_RETIRING, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+/* Give up a claim whose key changed under it (removed by its owner stripe) */
+static void shm_unclaim(ip_tracker_t *slot, uint64_t seen) {
+    uint64_t retiring = TRACKER_SHM_RETIRING;
+    __atomic_compare_exchange_n(&slot->last_seen_ns, &retiring, seen, false,
+                                __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
+
+/* Retire an idle entry to a tombstone */
+static bool shm_retire_idle(struct tracker_shm *shm, ip_tracker_t *slot, uint32_t key,
+                            uint64_t idle_before) {
+    uint64_t seen;
+
+    if (!shm_claim_idle(slot, idle_before, &seen)) {
+        return false;
+    }
+    if (!__atomic_compare_exchange_n(&slot->ip_addr, &key, TRACKER_SHM_TOMBSTONE, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        shm_unclaim(slot, seen);
+        return false;
+    }
+
+    __atomic_sub_fetch(&shm->header->entry_count, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+static bool pid_alive(uint32_t pid) {
+    return kill((pid_t)pid, 0) == 0 || errno != ESRCH;
+}
+
+/* Lock owner died mid-update: redo its in-progress slot and recount */
+static void stripe_recover(struct tracker_shm *shm, shm_stripe_t *stripe, uint32_t dead_pid) {
+    uint64_t now = get_monotonic_ns();
+
+    uint32_t pending = stripe->pending;
+    if (pending != 0 && pending <= shm->header->slot_count) {
+        ip_tracker_t *slot = &shm->slots[pending - 1];
+        if (key_live(slot_key(slot))) {
+            shm_init_entry(slot, now);
+        }
+    }
+    stripe->pending = 0;
+
+    /* entry_count may or may not include the interrupted insert */
+    uint64_t live = 0;
+    for (uint64_t i = 0; i < shm->header->slot_count; i++) {
+        if (key_live(slot_key(&shm->slots[i]))) {
+            live++;
+        }
+    }
+    __atomic_store_n(&shm->header->entry_count, live, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&shm->header->recoveries, 1, __ATOMIC_RELAXED);
+
+    LOG_WARN("Shared tracker: recovered lock held by dead process %u (slot %u repaired)",
+             dead_pid, pending);
+}
+
+static void stripe_lock(struct tracker_shm *shm, shm_stripe_t *stripe) {
+    uint32_t spins = 0;
+
+    for (;;) {
+        uint32_t owner = 0;
+        if (__atomic_compare_exchange_n(&stripe->owner, &owner, shm->pid, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return;
+        }
+
+        if (++spins >= TRACKER_SHM_SPINS_CHECK) {
+            spins = 0;
+
+            /* Another thread of this process counts as alive */
+            if (owner != shm->pid && !pid_alive(owner) &&
+                __atomic_compare_exchange_n(&stripe->owner, &owner, shm->pid, false,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                stripe_recover(shm, stripe, owner);
+                return;
+            }
+            sched_yield();
+        }
+    }
+}
+
+static void stripe_unlock(shm_stripe_t *stripe) {
+    __atomic_store_n(&stripe->owner, 0, __ATOMIC_RELEASE);
+}
+
+static inline shm_stripe_t *stripe_for(struct tracker_shm *shm, uint32_t home) {
+    return &shm->stripes[home & (shm->header->stripe_count - 1)];
+}
+
+/* Lock-free probe for an existing key */
+static ip_tracker_t *shm_find(struct tracker_shm *shm, uint32_t ip_addr, uint32_t home) {
+    uint64_t mask = shm->header->slot_count - 1;
+
+    for (uint32_t i = 0; i < TRACKER_SHM_PROBE; i++) {
+        ip_tracker_t *slot = &shm->slots[(home + i) & mask];
+        uint32_t key = slot_key(slot);
+        if (key == ip_addr) {
+            return slot;
+        }
+        if (key == 0) {
+            break; /* Never-used slot ends the probe sequence */
+        }
+    }
+
+    return NULL;
+}
+
+tracker_table_t *tracker_shm_create(const char *name, size_t max_entries) {
+    if (!name || name[0] != '/' || max_entries == 0) {
+        LOG_ERROR("Shared tracker needs a name starting with '/' and max_entries > 0");
+        return NULL;
+    }
+
+    /* Keep load at or below 50% so probe sequences stay short */
+    size_t slot_count = round_up_pow2(max_entries * 2);
+    if (slot_count < 64) {
+        slot_count = 64;
+    }
+    size_t stripe_count = MIN(slot_count / 16, (size_t)1024);
+    size_t map_size = shm_layout_size(stripe_count, slot_count);
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        LOG_ERROR("shm_open(%s) failed: %s", name, strerror(errno));
+        return NULL;
+    }
+
+    /* Initialization runs under an exclusive lock on the segment. The kernel
+     * drops the lock when its holder dies, so a segment whose magic is still
+     * unset once we hold it was abandoned mid-initialization (or is new). */
+    if (flock(fd, LOCK_EX) < 0) {
+        LOG_ERROR("Failed to lock shared tracker %s: %s", name, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        LOG_ERROR("Failed to stat shared tracker %s: %s", name, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    /* The magic is only ever written under the lock, so it is stable here */
+    bool creator = true;
+    if (st.st_size != 0) {
+        uint32_t magic = 0;
+        if (pread(fd, &magic, sizeof(magic), 0) == (ssize_t)sizeof(magic) &&
+            magic == TRACKER_SHM_MAGIC) {
+            creator = false;
+        } else {
+            LOG_WARN("Shared tracker %s was left half-initialized; reinitializing", name);
+        }
+    }
+
+    if (creator) {
+        /* Truncating to zero first discards whatever a dead creator left */
+        if (ftruncate(fd, 0) < 0 || ftruncate(fd, (off_t)map_size) < 0) {
+            LOG_ERROR("Failed to size shared tracker %s: %s", name, strerror(errno));
+            close(fd);
+            return NULL;
+        }
+    } else if ((size_t)st.st_size != map_size) {
+        LOG_ERROR("Shared tracker %s has a different size (%ld bytes, expected %zu): "
+                  "max_tracked_ips must match across processes", name, (long)st.st_size, map_size);
+        close(fd);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        LOG_ERROR("Failed to map shared tracker %s: %s", name, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    shm_header_t *header = map;
+    if (creator) {
+        header->version = TRACKER_SHM_VERSION;
+        header->slot_count = slot_count;
+        header->max_entries = max_entries;
+        header->stripe_count = stripe_count;
+        header->whitelist_gen = 1;
+        header->asnmap_gen = 1;
+        __atomic_store_n(&header->magic, TRACKER_SHM_MAGIC, __ATOMIC_RELEASE);
+    }
+    /* The mapping keeps the open file alive, so close() alone would not unlock */
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    if (!creator && (header->version != TRACKER_SHM_VERSION ||
+                     header->slot_count != slot_count || header->max_entries != max_entries)) {
+        LOG_ERROR("Shared tracker %s is incompatible (version or max_tracked_ips differ)", name);
+        munmap(map, map_size);
+        return NULL;
+    }
+
+    tracker_table_t *table = calloc(1, sizeof(tracker_table_t));
+    struct tracker_shm *shm = calloc(1, sizeof(struct tracker_shm));
+
+    /* The whitelisted-source cache stays private to each process */
+    size_t wl_slots = MIN(slot_count / 2, (size_t)TRACKER_SHM_WL_CACHE_MAX);
+    if (!table || !shm || tracker_wl_cache_init(table, wl_slots) != SYNFLOOD_OK) {
+        free(table);
+        free(shm);
+        munmap(map, map_size);
+        return NULL;
+    }
+
+    shm->map = map;
+    shm->map_size = map_size;
+    shm->pid = (uint32_t)getpid();
+    shm_attach_layout(shm);
+
+    table->shm = shm;
+    table->bucket_count = slot_count;
+    table->max_entries = max_entries;
+    table->whitelist_gen = &header->whitelist_gen;
+    table->asnmap_gen = &header->asnmap_gen;
+
+    LOG_INFO("Shared tracker %s %s: slots=%zu, max_entries=%zu, %zu KB", name,
+             creator ? "created" : "attached", slot_count, max_entries, map_size / 1024);
+
+    return table;
+}
+
+void tracker_shm_destroy(tracker_table_t *table) {
+    /* The segment outlives this process; see tracker_shared_unlink() */
+    munmap(table->shm->map, table->shm->map_size);
+    free(table->shm);
+    free(table->wl_cache);
+    free(table);
+}
+
+/*
+ * Remove one idle entry anywhere in the table, for when an insert had to
+ * use a free slot while the table was already at capacity. A clock hand
+ * shared by all processes walks the slots; unblocked entries go first.
+ * Entries seen within the grace period may still be in use by the process
+ * that looked them up and are skipped, so the table can stay over capacity
+ * until they go idle. The caller holds no stripe lock: the entry is claimed
+ * and retired with CAS, so a concurrent lookup, insert or remove of it
+ * simply wins or loses.
+ */
+static void shm_evict_any(struct tracker_shm *shm, const ip_tracker_t *keep, uint64_t now) {
+    uint64_t mask = shm->header->slot_count - 1;
+    uint64_t idle_before = shm_idle_before(now);
+    ip_tracker_t *blocked = NULL;
+    uint32_t blocked_key = 0;
+
+    for (uint64_t n = 0; n < TRACKER_SHM_EVICT_SCAN && n <= mask; n++) {
+        uint64_t i = __atomic_fetch_add(&shm->header->evict_hand, 1, __ATOMIC_RELAXED) & mask;
+        ip_tracker_t *slot = &shm->slots[i];
+        uint32_t key = slot_key(slot);
+
+        if (slot == keep || !key_live(key)) {
+            continue;
+        }
+        if (slot->blocked) {
+            if (!blocked) {
+                blocked = slot;
+                blocked_key = key;
+            }
+            continue;
+        }
+        if (shm_retire_idle(shm, slot, key, idle_before)) {
+            return;
+        }
+    }
+
+    if (blocked) {
+        shm_retire_idle(shm, blocked, blocked_key, idle_before);
+    }
+}
+
+ip_tracker_t *tracker_shm_get_or_create(tracker_table_t *table, uint32_t ip_addr) {
+    struct tracker_shm *shm = table->shm;
+    uint32_t home = ip_hash(ip_addr, shm->header->slot_count);
+    uint64_t now = get_monotonic_ns();
+    uint64_t idle_before = shm_idle_before(now);
+
+    if (!key_live(ip_addr)) {
+        return NULL;
+    }
+
+    /* Refreshing a found slot keeps evictors off it for the grace period.
+     * It may have been evicted and reused between the probe and the
+     * refresh, so the key is checked again afterwards. */
+    ip_tracker_t *slot = shm_find(shm, ip_addr, home);
+    if (slot && shm_touch(slot, now) && slot_key(slot) == ip_addr) {
+        return slot;
+    }
+
+    /* Inserts of the same IP share a stripe, so they cannot duplicate */
+    shm_stripe_t *stripe = stripe_for(shm, home);
+    stripe_lock(shm, stripe);
+
+    uint64_t mask = shm->header->slot_count - 1;
+    for (;;) {
+        ip_tracker_t *free_slot = NULL;
+        ip_tracker_t *oldest = NULL;
+        uint32_t free_key = 0;
+
+        slot = NULL;
+        for (uint32_t i = 0; i < TRACKER_SHM_PROBE; i++) {
+            ip_tracker_t *candidate = &shm->slots[(home + i) & mask];
+            uint32_t key = slot_key(candidate);
+
+            if (key == ip_addr) {
+                slot = candidate;
+                break;
+            }
+            if (!key_live(key)) {
+                if (!free_slot) {
+                    free_slot = candidate;
+                    free_key = key;
+                }
+                if (key == 0) {
+                    break;
+                }
+                continue;
+            }
+            /* Eviction prefers unblocked entries, then the least recently
+             * seen, and never takes one still within the grace period */
+            if (__atomic_load_n(&candidate->last_seen_ns, __ATOMIC_RELAXED) >= idle_before) {
+                continue;
+            }
+            if (!oldest || (oldest->blocked && !candidate->blocked) ||
+                (oldest->blocked == candidate->blocked &&
+                 candidate->last_seen_ns < oldest->last_seen_ns)) {
+                oldest = candidate;
+            }
+        }
+
+        if (slot) {
+            /* Inserted by another process between the lookup and the lock */
+            if (shm_touch(slot, now)) {
+                if (slot_key(slot) == ip_addr) {
+                    break;
+                }
+                continue;
+            }
+
+            /* Claimed by an evictor, which may have died: finish its job */
+            uint32_t key = ip_addr;
+            if (__atomic_compare_exchange_n(&slot->ip_addr, &key, TRACKER_SHM_TOMBSTONE, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                __atomic_sub_fetch(&shm->header->entry_count, 1, __ATOMIC_RELAXED);
+            }
+            continue;
+        }
+
+        bool full = __atomic_load_n(&shm->header->entry_count, __ATOMIC_RELAXED) >=
+                    shm->header->max_entries;
+        if (free_slot && !(full && oldest)) {
+            stripe->pending = (uint32_t)(free_slot - shm->slots) + 1;
+
+            /* Other stripes may race for the same free slot */
+            if (!__atomic_compare_exchange_n(&free_slot->ip_addr, &free_key, ip_addr, false,
+                                             __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                stripe->pending = 0;
+                continue;
+            }
+            shm_init_entry(free_slot, now);
+            __atomic_add_fetch(&shm->header->entry_count, 1, __ATOMIC_RELAXED);
+            slot = free_slot;
+        } else if (oldest) {
+            uint32_t old_key = slot_key(oldest);
+            uint64_t seen;
+
+            /* Looked up since the probe: pick again */
+            if (!key_live(old_key) || !shm_claim_idle(oldest, idle_before, &seen)) {
+                continue;
+            }
+            stripe->pending = (uint32_t)(oldest - shm->slots) + 1;
+
+            if (!__atomic_compare_exchange_n(&oldest->ip_addr, &old_key, ip_addr, false,
+                                             __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                shm_unclaim(oldest, seen);
+                stripe->pending = 0;
+                continue;
+            }
+            shm_init_entry(oldest, now);
+            LOG_DEBUG("Shared tracker evicted IP=%u for IP=%u", old_key, ip_addr);
+            slot = oldest;
+        }
+
+        stripe->pending = 0;
+        break;
+    }
+
+    stripe_unlock(stripe);
+
+    if (slot && __atomic_load_n(&shm->header->entry_count, __ATOMIC_RELAXED) >
+                    shm->header->max_entries) {
+        shm_evict_any(shm, slot, now);
+    }
+
+    return slot;
+}
+
+ip_tracker_t *tracker_shm_get(tracker_table_t *table, uint32_t ip_addr) {
+    struct tracker_shm *shm = table->shm;
+
+    if (!key_live(ip_addr)) {
+        return NULL;
+    }
+
+    return shm_find(shm, ip_addr, ip_hash(ip_addr, shm->header->slot_count));
+}
+
+size_t tracker_shm_get_batch(tracker_table_t *table, const uint32_t *ips, size_t n,
+                             ip_tracker_t **out) {
+    struct tracker_shm *shm = table->shm;
+    size_t found = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        out[i] = key_live(ips[i]) ? shm_find(shm, ips[i], ip_hash(ips[i], shm->header->slot_count))
+                                  : NULL;
+        if (out[i]) {
+            found++;
+        }
+    }
+
+    return found;
+}
+
+synflood_ret_t tracker_shm_remove(tracker_table_t *table, uint32_t ip_addr) {
+    struct tracker_shm *shm = table->shm;
+
+    if (!key_live(ip_addr)) {
+        return SYNFLOOD_ENOTFOUND;
+    }
+
+    uint32_t home = ip_hash(ip_addr, shm->header->slot_count);
+    shm_stripe_t *stripe = stripe_for(shm, home);
+    stripe_lock(shm, stripe);
+
+    synflood_ret_t ret = SYNFLOOD_ENOTFOUND;
+    ip_tracker_t *slot = shm_find(shm, ip_addr, home);
+    uint32_t key = ip_addr;
+    if (slot && __atomic_compare_exchange_n(&slot->ip_addr, &key, TRACKER_SHM_TOMBSTONE, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        __atomic_sub_fetch(&shm->header->entry_count, 1, __ATOMIC_RELAXED);
+        ret = SYNFLOOD_OK;
+    }
+
+    stripe_unlock(stripe);
+    return ret;
+}
+
+size_t tracker_shm_get_expired_blocks(tracker_table_t *table, uint64_t current_time_ns,
+                                      uint32_t *expired_ips, size_t max_ips) {
+    struct tracker_shm *shm = table->shm;
+    size_t count = 0;
+
+    for (uint64_t i = 0; i < shm->header->slot_count && count < max_ips; i++) {
+        ip_tracker_t *slot = &shm->slots[i];
+        uint32_t key = slot_key(slot);
+        if (key_live(key) && slot->blocked && slot->block_expiry_ns <= current_time_ns) {
+            expired_ips[count++] = key;
+        }
+    }
+
+    return count;
+}
+
+void tracker_shm_get_stats(tracker_table_t *table, size_t *entry_count, size_t *blocked_count) {
+    struct tracker_shm *shm = table->shm;
+
+    if (entry_count) {
+        *entry_count = (size_t)__atomic_load_n(&shm->header->entry_count, __ATOMIC_RELAXED);
+    }
+
+    if (blocked_count) {
+        size_t count = 0;
+        for (uint64_t i = 0; i < shm->header->slot_count; i++) {
+            if (key_live(slot_key(&shm->slots[i])) && shm->slots[i].blocked) {
+                count++;
+            }
+        }
+        *blocked_count = count;
+    }
+}
+
+size_t tracker_shm_dump_chunk(tracker_table_t *table, tracker_cursor_t *cursor,
+                              const tracker_filter_t *filter, ip_tracker_t *out, size_t max) {
+    struct tracker_shm *shm = table->shm;
+    uint64_t slot_count = shm->header->slot_count;
+    uint64_t end = cursor->bucket + TRACKER_DUMP_SCAN;
+    size_t count = 0;
+
+    if (end > slot_count) {
+        end = slot_count;
+    }
+
+    while (cursor->bucket < end && count < max) {
+        const ip_tracker_t *slot = &shm->slots[cursor->bucket];
+        uint32_t key = slot_key(slot);
+
+        if (key_live(key)) {
+            /* Lock-free copy; discard it if the slot was reused meanwhile */
+            ip_tracker_t copy = *slot;
+            if (slot_key(slot) == key && copy.ip_addr == key &&
+                tracker_filter_match(filter, &copy)) {
+                out[count++] = copy;
+            }
+        }
+
+        cursor->bucket++;
+    }
+
+    cursor->done = cursor->bucket >= slot_count;
+    return count;
+}
+
+void tracker_shm_clear(tracker_table_t *table) {
+    struct tracker_shm *shm = table->shm;
+
+    for (uint64_t i = 0; i < shm->header->stripe_count; i++) {
+        stripe_lock(shm, &shm->stripes[i]);
+    }
+
+    memset(shm->slots, 0, shm->header->slot_count * sizeof(ip_tracker_t));
+    __atomic_store_n(&shm->header->entry_count, 0, __ATOMIC_RELEASE);
+
+    for (uint64_t i = 0; i < shm->header->stripe_count; i++) {
+        stripe_unlock(&shm->stripes[i]);
+    }
+
+    LOG_INFO("Shared tracker table cleared");
+}
+
+/* Slots are retired with the eviction CAS, so no stripe lock is needed */
+void tracker_shm_clear_older(tracker_table_t *table, uint64_t cutoff_ns) {
+    struct tracker_shm *shm = table->shm;
+    size_t cleared = 0;
+
+    for (uint64_t i = 0; i < shm->header->slot_count; i++) {
+        ip_tracker_t *slot = &shm->slots[i];
+        uint32_t key = slot_key(slot);
+
+        if (key_live(key) && shm_retire_idle(shm, slot, key, cutoff_ns)) {
+            cleared++;
+        }
+    }
+
+    LOG_INFO("Shared tracker table: %zu idle entries cleared", cleared);
+}
+
+size_t tracker_shm_age(tracker_table_t *table, uint64_t idle_before_ns, size_t max_slots) {
+    struct tracker_shm *shm = table->shm;
+    uint64_t mask = shm->header->slot_count - 1;
+    size_t freed = 0;
+
+    for (size_t n = 0; n < max_slots && n <= mask; n++) {
+        ip_tracker_t *slot = &shm->slots[shm->age_hand++ & mask];
+        uint32_t key = slot_key(slot);
+
+        if (key_live(key) && !slot->blocked && shm_retire_idle(shm, slot, key, idle_before_ns)) {
+            freed++;
+        }
+    }
+
+    return freed;
+}
@@ -0,0 +1,69 @@
+/*
+ * tracker_shm.h - Shared-memory backend for the tracker table
+ * TCP SYN Flood Detector
+ *
+ * Several daemon processes (e.g. one per NFQUEUE number) can map the same
+ * named segment and count into one table. The segment holds no pointers:
+ * entries live in a fixed open-addressed slot array located by index, so
+ * every process may map it at a different address.
+ *
+ * Structural changes (insert, evict, remove) take a per-stripe lock word
+ * holding the owner's PID. A waiter that finds the owner dead takes the
+ * lock over and repairs the slot the owner had recorded as in progress.
+ * Lookups never lock. An entry handed out by a lookup stays its IP's for
+ * at least TRACKER_SHM_EVICT_GRACE_MS: only idle entries are evicted, and
+ * an evictor claims one with a CAS on last_seen_ns that the lookup's
+ * refresh races against. The public tracker_* functions dispatch here when
+ * table->shm is set; these functions are internal to tracker.c.
+ */
+
+#ifndef SYNFLOOD_TRACKER_SHM_H
+#define SYNFLOOD_TRACKER_SHM_H
+
+#include "tracker.h"
+
+/* Segment layout version, bumped on incompatible changes */
+#define TRACKER_SHM_VERSION 6
+
+/* Slots probed from an IP's home slot before evicting */
+#define TRACKER_SHM_PROBE 16
+
+/* A slot seen this recently is never evicted: callers use the entry pointer
+ * they got from tracker_get_or_create() for at most one packet */
+#define TRACKER_SHM_EVICT_GRACE_MS 1000
+
+/* Slots examined per over-capacity insert when looking for an idle entry */
+#define TRACKER_SHM_EVICT_SCAN 64
+
+/* Slot key marking a removed entry (255.255.255.255 never sends SYNs) */
+#define TRACKER_SHM_TOMBSTONE 0xFFFFFFFFu
+
+/* last_seen_ns of an entry claimed for eviction */
+#define TRACKER_SHM_RETIRING UINT64_MAX
+
+/* Spins before checking whether a lock owner is still alive */
+#define TRACKER_SHM_SPINS_CHECK 4096
+
+/* Whitelisted-source cache slots per process for shared tables (power of 2) */
+#define TRACKER_SHM_WL_CACHE_MAX 65536
+
+/* Allocate a table's whitelisted-source cache (slots: power of 2), in tracker.c */
+synflood_ret_t tracker_wl_cache_init(tracker_table_t *table, size_t slots);
+
+tracker_table_t *tracker_shm_create(const char *name, size_t max_entries);
+void tracker_shm_destroy(tracker_table_t *table);
+ip_tracker_t *tracker_shm_get_or_create(tracker_table_t *table, uint32_t ip_addr);
+ip_tracker_t *tracker_shm_get(tracker_table_t *table, uint32_t ip_addr);
+size_t tracker_shm_get_batch(tracker_table_t *table, const uint32_t *ips, size_t n,
+                             ip_tracker_t **out);
+synflood_ret_t tracker_shm_remove(tracker_table_t *table, uint32_t ip_addr);
+size_t tracker_shm_get_expired_blocks(tracker_table_t *table, uint64_t current_time_ns,
+                                      uint32_t *expired_ips, size_t max_ips);
+void tracker_shm_get_stats(tracker_table_t *table, size_t *entry_count, size_t *blocked_count);
+void tracker_shm_clear(tracker_table_t *table);
+void tracker_shm_clear_older(tracker_table_t *table, uint64_t cutoff_ns);
+size_t tracker_shm_age(tracker_table_t *table, uint64_t idle_before_ns, size_t max_slots);
+size_t tracker_shm_dump_chunk(tracker_table_t *table, tracker_cursor_t *cursor,
+                              const tracker_filter_t *filter, ip_tracker_t *out, size_t max);
+
+#endif /* SYNFLOOD_TRACKER_SHM_H */
@@ -0,0 +1,234 @@
+/*
+ * victim.c - Per-destination (victim) SYN rate table
+ * TCP SYN Flood Detector
+ *
+ * Fixed-size open-addressed table keyed by destination IP/port. Entries
+ * are never deleted: when a probe sequence is full the least recently
+ * seen destination that is not under attack is recycled in place, so
+ * memory stays bounded however many destinations are probed.
+ */
+
+#include "victim.h"
+#include "../observe/logger.h"
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    uint32_t dst_ip;
+    uint16_t dst_port;
+    uint8_t in_use;
+    uint8_t attacked;         /* Attack logged, end not yet logged */
+    uint32_t syn_count;       /* Current window */
+    uint32_t syn_rate;        /* SYN/s of the last completed window */
+    uint64_t window_start_ns;
+    uint64_t last_seen_ns;
+    uint64_t attack_until_ns; /* Under attack while now < this */
+} victim_entry_t;
+
+static victim_entry_t *victims = NULL;
+static size_t victim_mask = 0;
+static uint64_t victim_attacks_total = 0;
+static pthread_mutex_t victim_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline size_t victim_slot(uint32_t dst_ip, uint16_t dst_port) {
+    return ip_hash(dst_ip ^ ((uint32_t)dst_port * 0x9E3779B1u), victim_mask + 1);
+}
+
+static void victim_log(const char *what, const victim_entry_t *entry) {
+    char ip_str[INET_ADDRSTRLEN];
+    struct in_addr addr = { .s_addr = entry->dst_ip };
+    inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+
+    if (entry->attacked) {
+        LOG_WARN("Destination %s:%u %s (%u SYN in current window)", ip_str,
+                 entry->dst_port, what, entry->syn_count);
+    } else {
+        LOG_INFO("Destination %s:%u %s", ip_str, entry->dst_port, what);
+    }
+}
+
+synflood_ret_t victim_init(size_t max_entries) {
+    if (max_entries == 0 || (max_entries & (max_entries - 1)) != 0) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    victim_cleanup();
+
+    victim_entry_t *table = calloc(max_entries, sizeof(victim_entry_t));
+    if (!table) {
+        return SYNFLOOD_ENOMEM;
+    }
+
+    pthread_mutex_lock(&victim_lock);
+    victims = table;
+    victim_mask = max_entries - 1;
+    victim_attacks_total = 0;
+    pthread_mutex_unlock(&victim_lock);
+
+    LOG_INFO("Victim table initialized: %zu destinations", max_entries);
+    return SYNFLOOD_OK;
+}
+
+void victim_cleanup(void) {
+    pthread_mutex_lock(&victim_lock);
+    free(victims);
+    victims = NULL;
+    victim_mask = 0;
+    pthread_mutex_unlock(&victim_lock);
+}
+
+bool victim_record(uint32_t dst_ip, uint16_t dst_port, uint32_t weight, uint64_t now,
+                   const synflood_config_t *config) {
+    pthread_mutex_lock(&victim_lock);
+
+    if (!victims) {
+        pthread_mutex_unlock(&victim_lock);
+        return false;
+    }
+
+    size_t idx = victim_slot(dst_ip, dst_port);
+    victim_entry_t *entry = NULL;
+    victim_entry_t *oldest = NULL;
+
+    for (size_t probe = 0; probe < VICTIM_PROBE_LIMIT; probe++) {
+        victim_entry_t *e = &victims[(idx + probe) & victim_mask];
+
+        if (!e->in_use) {
+            /* No deletions, so the first hole ends the probe sequence */
+            memset(e, 0, sizeof(*e));
+            entry = e;
+            break;
+        }
+        if (e->dst_ip == dst_ip && e->dst_port == dst_port) {
+            entry = e;
+            break;
+        }
+        if (now >= e->attack_until_ns && (!oldest || e->last_seen_ns < oldest->last_seen_ns)) {
+            oldest = e;
+        }
+    }
+
+    if (!entry) {
+        if (!oldest) {
+            /* Every candidate slot is an active victim: keep tracking those */
+            pthread_mutex_unlock(&victim_lock);
+            return false;
+        }
+        memset(oldest, 0, sizeof(*oldest));
+        entry = oldest;
+    }
+
+    if (!entry->in_use) {
+        entry->in_use = 1;
+        entry->dst_ip = dst_ip;
+        entry->dst_port = dst_port;
+        entry->window_start_ns = now;
+    }
+
+    /* Same fixed window as the per-source tracker */
+    if (now - entry->window_start_ns > ms_to_ns(config->window_ms)) {
+        entry->syn_rate = (uint32_t)((uint64_t)entry->syn_count * 1000 / config->window_ms);
+        entry->syn_count = weight;
+        entry->window_start_ns = now;
+    } else {
+        entry->syn_count += weight;
+    }
+    entry->last_seen_ns = now;
+
+    if (entry->syn_count > config->victim_threshold) {
+        if (!entry->attacked) {
+            entry->attacked = 1;
+            victim_attacks_total++;
+            victim_log("under SYN flood", entry);
+        }
+        entry->attack_until_ns = now + sec_to_ns(config->victim_hold_s);
+    } else if (entry->attacked && now >= entry->attack_until_ns) {
+        entry->attacked = 0;
+        victim_log("no longer under attack", entry);
+    }
+
+    bool under_attack = now < entry->attack_until_ns;
+
+    pthread_mutex_unlock(&victim_lock);
+    return under_attack;
+}
+
+/* Ordering for victim_get_top: attacked first, then by rate */
+static bool victim_ranks_higher(const victim_stats_t *a, const victim_stats_t *b) {
+    if (a->under_attack != b->under_attack) {
+        return a->under_attack;
+    }
+    return a->syn_rate > b->syn_rate;
+}
+
+size_t victim_get_top(victim_stats_t *out, size_t max, uint64_t now) {
+    if (!out || max == 0) {
+        return 0;
+    }
+
+    size_t count = 0;
+
+    pthread_mutex_lock(&victim_lock);
+
+    for (size_t i = 0; victims && i <= victim_mask; i++) {
+        const victim_entry_t *e = &victims[i];
+        if (!e->in_use) {
+            continue;
+        }
+
+        victim_stats_t s = {
+            .dst_ip = e->dst_ip,
+            .dst_port = e->dst_port,
+            .under_attack = now < e->attack_until_ns,
+            .syn_rate = e->syn_rate,
+        };
+
+        /* Insertion into the sorted top-N */
+        size_t pos = count < max ? count : max;
+        while (pos > 0 && victim_ranks_higher(&s, &out[pos - 1])) {
+            if (pos < max) {
+                out[pos] = out[pos - 1];
+            }
+            pos--;
+        }
+        if (pos < max) {
+            out[pos] = s;
+            if (count < max) {
+                count++;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&victim_lock);
+    return count;
+}
+
+void victim_get_counts(size_t *tracked, size_t *under_attack, uint64_t *attacks_total, uint64_t now) {
+    size_t n_tracked = 0, n_attacked = 0;
+
+    pthread_mutex_lock(&victim_lock);
+
+    for (size_t i = 0; victims && i <= victim_mask; i++) {
+        if (victims[i].in_use) {
+            n_tracked++;
+            if (now < victims[i].attack_until_ns) {
+                n_attacked++;
+            }
+        }
+    }
+
+    if (attacks_total) {
+        *attacks_total = victim_attacks_total;
+    }
+
+    pthread_mutex_unlock(&victim_lock);
+
+    if (tracked) {
+        *tracked = n_tracked;
+    }
+    if (under_attack) {
+        *under_attack = n_attacked;
+    }
+}
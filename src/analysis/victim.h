@@ -0,0 +1,69 @@
+/*
+ * victim.h - Per-destination (victim) SYN rate table
+ * TCP SYN Flood Detector
+ *
+ * Counts SYNs per local destination IP/port in a small fixed-size table to
+ * spot floods spread over many sources. While a destination is under
+ * attack the engine applies a tighter per-source threshold to its traffic.
+ */
+
+#ifndef SYNFLOOD_VICTIM_H
+#define SYNFLOOD_VICTIM_H
+
+#include "common.h"
+
+/* Linear probe length before an idle slot is recycled */
+#define VICTIM_PROBE_LIMIT 8
+
+/* Snapshot of one destination for metrics */
+typedef struct
+{
+    uint32_t dst_ip;      /* Network byte order */
+    uint16_t dst_port;    /* Host byte order */
+    bool under_attack;
+    uint32_t syn_rate;    /* SYN/s over the last completed window */
+} victim_stats_t;
+
+/**
+ * Initialize the victim table
+ * @param max_entries Table size (power of 2)
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t victim_init(size_t max_entries);
+
+/**
+ * Free the victim table
+ */
+void victim_cleanup(void);
+
+/**
+ * Count SYNs towards a destination and update its attack state
+ * @param dst_ip Destination IP (network byte order)
+ * @param dst_port Destination port (host byte order)
+ * @param weight Number of SYNs this packet stands for
+ * @param now Current monotonic time (ns)
+ * @param config Configuration (window_ms, victim_threshold, victim_hold_s)
+ * @return true if the destination is under attack
+ */
+bool victim_record(uint32_t dst_ip, uint16_t dst_port, uint32_t weight, uint64_t now,
+                   const synflood_config_t *config);
+
+/**
+ * Get the busiest destinations, sorted by rate (attacked first)
+ * @param out Output array
+ * @param max Capacity of out
+ * @param now Current monotonic time (ns)
+ * @return Number of entries written
+ */
+size_t victim_get_top(victim_stats_t *out, size_t max, uint64_t now);
+
+/**
+ * Get table counters
+ * @param tracked Output: destinations in the table (may be NULL)
+ * @param under_attack Output: destinations currently under attack (may be NULL)
+ * @param attacks_total Output: attack episodes started (may be NULL)
+ * @param now Current monotonic time (ns)
+ */
+void victim_get_counts(size_t *tracked, size_t *under_attack, uint64_t *attacks_total, uint64_t now);
+
+#endif /* SYNFLOOD_VICTIM_H */
@@ -0,0 +1,351 @@
+/*
+ * whatif.c - Offline threshold sweep over recorded traffic
+ * TCP SYN Flood Detector
+ */
+
+#include "whatif.h"
+#include "whitelist.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NIL UINT32_MAX
+#define WHATIF_MAX_THREADS 64
+
+typedef struct
+{
+    uint32_t ip_addr;
+    uint32_t next;          /* Hash chain */
+    uint32_t first_syn_ms;
+    uint32_t handshakes;    /* Saturating */
+    uint64_t blocked_mask;  /* Configurations that ever blocked this source */
+    bool whitelisted;
+    bool seen_syn;
+} whatif_source_t;
+
+typedef struct
+{
+    /* Shared inputs */
+    size_t config_count;
+    const whatif_packet_t *packets;
+    size_t packet_count;
+    whitelist_node_t *whitelist;
+    const uint32_t *threshold;
+    const uint32_t *window_ms;
+    const uint32_t *block_ms;
+    unsigned shard;
+    unsigned shard_count;
+
+    /* Sources of this shard; per source the state holds count[C],
+     * window_start[C] and block_end[C] (capture milliseconds) */
+    whatif_source_t *sources;
+    uint32_t *state;
+    size_t source_count;
+    size_t source_cap;
+    uint32_t *buckets;
+    size_t bucket_count;
+
+    whatif_result_t results[WHATIF_MAX_CONFIGS];
+    whatif_summary_t summary;
+    synflood_ret_t status;
+} whatif_shard_t;
+
+/* Full 32-bit mix: low bits pick the bucket, high bits the shard */
+static inline uint32_t source_hash(uint32_t ip_addr) {
+    return ip_hash(ip_addr, (size_t)UINT32_MAX + 1);
+}
+
+static bool shard_grow(whatif_shard_t *sh) {
+    size_t cap = sh->source_cap ? sh->source_cap * 2 : 1024;
+    size_t stride = 3 * sh->config_count;
+    if (cap >= NIL) {
+        return false;
+    }
+
+    whatif_source_t *sources = realloc(sh->sources, cap * sizeof(*sources));
+    if (!sources) {
+        return false;
+    }
+    sh->sources = sources;
+
+    uint32_t *state = realloc(sh->state, cap * stride * sizeof(*state));
+    if (!state) {
+        return false;
+    }
+    sh->state = state;
+
+    /* Rehash so chains stay around one source long */
+    uint32_t *buckets = malloc(cap * sizeof(*buckets));
+    if (!buckets) {
+        return false;
+    }
+    memset(buckets, 0xFF, cap * sizeof(*buckets));
+    for (size_t i = 0; i < sh->source_count; i++) {
+        size_t b = source_hash(sources[i].ip_addr) & (cap - 1);
+        sources[i].next = buckets[b];
+        buckets[b] = (uint32_t)i;
+    }
+
+    free(sh->buckets);
+    sh->buckets = buckets;
+    sh->bucket_count = cap;
+    sh->source_cap = cap;
+    return true;
+}
+
+static whatif_source_t *source_get(whatif_shard_t *sh, uint32_t ip_addr, uint32_t hash,
+                                   uint32_t now) {
+    if (sh->bucket_count) {
+        uint32_t i = sh->buckets[hash & (sh->bucket_count - 1)];
+        while (i != NIL && sh->sources[i].ip_addr != ip_addr) {
+            i = sh->sources[i].next;
+        }
+        if (i != NIL) {
+            return &sh->sources[i];
+        }
+    }
+
+    if (sh->source_count == sh->source_cap && !shard_grow(sh)) {
+        return NULL;
+    }
+
+    uint32_t i = (uint32_t)sh->source_count++;
+    whatif_source_t *src = &sh->sources[i];
+    memset(src, 0, sizeof(*src));
+    src->ip_addr = ip_addr;
+    src->whitelisted = sh->whitelist && whitelist_check(sh->whitelist, ip_addr);
+
+    /* New tracker entry: empty window starting now, not blocked */
+    size_t c_count = sh->config_count;
+    uint32_t *st = &sh->state[(size_t)i * 3 * c_count];
+    for (size_t c = 0; c < c_count; c++) {
+        st[c] = 0;
+        st[c_count + c] = now;
+        st[2 * c_count + c] = 0;
+    }
+
+    size_t b = hash & (sh->bucket_count - 1);
+    src->next = sh->buckets[b];
+    sh->buckets[b] = i;
+    return src;
+}
+
+static void count_syn(whatif_shard_t *sh, whatif_source_t *src, uint32_t now) {
+    const size_t c_count = sh->config_count;
+    uint32_t *restrict count = &sh->state[(size_t)(src - sh->sources) * 3 * c_count];
+    uint32_t *restrict start = count + c_count;
+    uint32_t *restrict until = start + c_count;
+    const uint32_t *restrict window_ms = sh->window_ms;
+
+    /* Window update for every configuration at once; no branches so the
+     * compiler can vectorize it. Blocked sources do not reach the daemon. */
+    for (size_t c = 0; c < c_count; c++) {
+        uint32_t live = now >= until[c];
+        uint32_t reset = now - start[c] > window_ms[c];
+        uint32_t next = reset ? 1 : count[c] + 1;
+        count[c] = live ? next : count[c];
+        start[c] = (live & reset) ? now : start[c];
+    }
+
+    for (size_t c = 0; c < c_count; c++) {
+        whatif_result_t *r = &sh->results[c];
+
+        if (now < until[c]) {
+            r->syns_dropped++;
+            continue;
+        }
+        if (count[c] <= sh->threshold[c]) {
+            continue;
+        }
+
+        until[c] = now + MIN(sh->block_ms[c], UINT32_MAX - now);
+        r->blocks_total++;
+        r->first_block_ms = MIN(r->first_block_ms, (uint64_t)now);
+
+        uint64_t bit = 1ULL << c;
+        if (!(src->blocked_mask & bit)) {
+            src->blocked_mask |= bit;
+            r->blocked_sources++;
+
+            uint64_t delay = now - src->first_syn_ms;
+            r->detect_ms_total += delay;
+            r->detect_ms_max = MAX(r->detect_ms_max, delay);
+        }
+    }
+}
+
+static void *shard_run(void *arg) {
+    whatif_shard_t *sh = arg;
+    uint64_t t0 = sh->packets[0].ts_ns;
+    uint64_t last_ns = t0;
+
+    for (size_t c = 0; c < sh->config_count; c++) {
+        sh->results[c].first_block_ms = UINT64_MAX;
+    }
+
+    for (size_t p = 0; p < sh->packet_count; p++) {
+        const whatif_packet_t *pkt = &sh->packets[p];
+        uint32_t hash = source_hash(pkt->src_ip);
+        if ((hash >> 20) % sh->shard_count != sh->shard) {
+            continue;
+        }
+
+        last_ns = MAX(last_ns, pkt->ts_ns);
+        uint64_t ms = (last_ns - t0) / NSEC_PER_MSEC;
+        uint32_t now = ms > UINT32_MAX ? UINT32_MAX : (uint32_t)ms;
+
+        whatif_source_t *src = source_get(sh, pkt->src_ip, hash, now);
+        if (!src) {
+            sh->status = SYNFLOOD_ENOMEM;
+            return NULL;
+        }
+
+        if (pkt->kind == WHATIF_HANDSHAKE) {
+            if (src->handshakes < UINT32_MAX) {
+                src->handshakes++;
+            }
+            continue;
+        }
+
+        if (src->whitelisted) {
+            sh->summary.whitelisted_syns++;
+            continue;
+        }
+
+        if (!src->seen_syn) {
+            src->seen_syn = true;
+            src->first_syn_ms = now;
+            sh->summary.sources_total++;
+        }
+        sh->summary.syns_total++;
+
+        count_syn(sh, src, now);
+    }
+
+    /* A blocked source that also finished handshakes was likely a real client */
+    for (size_t i = 0; i < sh->source_count; i++) {
+        const whatif_source_t *src = &sh->sources[i];
+        if (!src->seen_syn || src->handshakes == 0) {
+            continue;
+        }
+        sh->summary.handshake_sources++;
+        for (size_t c = 0; c < sh->config_count; c++) {
+            if (src->blocked_mask & (1ULL << c)) {
+                sh->results[c].est_false_positives++;
+            }
+        }
+    }
+
+    sh->status = SYNFLOOD_OK;
+    return NULL;
+}
+
+synflood_ret_t whatif_replay(const whatif_config_t *configs, size_t config_count,
+                             const whatif_packet_t *packets, size_t packet_count,
+                             whitelist_node_t *whitelist, unsigned threads,
+                             whatif_result_t *results, whatif_summary_t *summary) {
+    if (!configs || config_count == 0 || config_count > WHATIF_MAX_CONFIGS || !results ||
+        (!packets && packet_count > 0)) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    uint32_t threshold[WHATIF_MAX_CONFIGS];
+    uint32_t window_ms[WHATIF_MAX_CONFIGS];
+    uint32_t block_ms[WHATIF_MAX_CONFIGS];
+    for (size_t c = 0; c < config_count; c++) {
+        threshold[c] = configs[c].syn_threshold;
+        window_ms[c] = configs[c].window_ms;
+        uint64_t ms = (uint64_t)configs[c].block_duration_s * MSEC_PER_SEC;
+        block_ms[c] = ms > UINT32_MAX ? UINT32_MAX : (uint32_t)ms;
+    }
+
+    memset(results, 0, config_count * sizeof(*results));
+    for (size_t c = 0; c < config_count; c++) {
+        results[c].first_block_ms = UINT64_MAX;
+    }
+    if (summary) {
+        memset(summary, 0, sizeof(*summary));
+    }
+    if (packet_count == 0) {
+        return SYNFLOOD_OK;
+    }
+
+    threads = MIN(MAX(threads, 1u), (unsigned)WHATIF_MAX_THREADS);
+    whatif_shard_t *shards = calloc(threads, sizeof(*shards));
+    pthread_t *tids = calloc(threads, sizeof(*tids));
+    bool *started = calloc(threads, sizeof(*started));
+    if (!shards || !tids || !started) {
+        free(shards);
+        free(tids);
+        free(started);
+        return SYNFLOOD_ENOMEM;
+    }
+
+    for (unsigned t = 0; t < threads; t++) {
+        whatif_shard_t *sh = &shards[t];
+        sh->config_count = config_count;
+        sh->packets = packets;
+        sh->packet_count = packet_count;
+        sh->whitelist = whitelist;
+        sh->threshold = threshold;
+        sh->window_ms = window_ms;
+        sh->block_ms = block_ms;
+        sh->shard = t;
+        sh->shard_count = threads;
+        sh->status = SYNFLOOD_ERROR;
+    }
+
+    for (unsigned t = 1; t < threads; t++) {
+        started[t] = pthread_create(&tids[t], NULL, shard_run, &shards[t]) == 0;
+    }
+    shard_run(&shards[0]);
+
+    synflood_ret_t ret = SYNFLOOD_OK;
+    for (unsigned t = 0; t < threads; t++) {
+        whatif_shard_t *sh = &shards[t];
+        if (t > 0) {
+            if (started[t]) {
+                pthread_join(tids[t], NULL);
+            } else {
+                shard_run(sh); /* No thread: do its share here */
+            }
+        }
+        if (sh->status != SYNFLOOD_OK) {
+            ret = sh->status;
+        }
+
+        for (size_t c = 0; c < config_count; c++) {
+            const whatif_result_t *r = &sh->results[c];
+            results[c].blocks_total += r->blocks_total;
+            results[c].blocked_sources += r->blocked_sources;
+            results[c].syns_dropped += r->syns_dropped;
+            results[c].est_false_positives += r->est_false_positives;
+            results[c].first_block_ms = MIN(results[c].first_block_ms, r->first_block_ms);
+            results[c].detect_ms_total += r->detect_ms_total;
+            results[c].detect_ms_max = MAX(results[c].detect_ms_max, r->detect_ms_max);
+        }
+        if (summary) {
+            summary->syns_total += sh->summary.syns_total;
+            summary->sources_total += sh->summary.sources_total;
+            summary->handshake_sources += sh->summary.handshake_sources;
+            summary->whitelisted_syns += sh->summary.whitelisted_syns;
+        }
+
+        free(sh->sources);
+        free(sh->state);
+        free(sh->buckets);
+    }
+
+    if (summary) {
+        uint64_t last = packets[0].ts_ns;
+        for (size_t p = 1; p < packet_count; p++) {
+            last = MAX(last, packets[p].ts_ns);
+        }
+        summary->duration_ms = (last - packets[0].ts_ns) / NSEC_PER_MSEC;
+    }
+
+    free(shards);
+    free(tids);
+    free(started);
+    return ret;
+}
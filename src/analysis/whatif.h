@@ -0,0 +1,90 @@
+/*
+ * whatif.h - Offline threshold sweep over recorded traffic
+ * TCP SYN Flood Detector
+ *
+ * Replays a packet capture through the detection rule of the engine (per
+ * source SYN counter over window_ms, block above syn_threshold for
+ * block_duration_s) for many configurations in a single pass. Each source
+ * keeps one counter, window start and block end per configuration, laid
+ * out as arrays so a SYN updates every configuration in one vectorizable
+ * loop. Sources are independent, so threads each take a hash shard of the
+ * sources and scan the whole capture.
+ *
+ * Not modelled: the /proc SYN_RECV validation (there is no live socket
+ * table to read) and victim thresholds. A blocked source's SYNs are
+ * dropped by the kernel before they reach the daemon, so its counters
+ * stand still until the block ends.
+ */
+
+#ifndef SYNFLOOD_WHATIF_H
+#define SYNFLOOD_WHATIF_H
+
+#include "common.h"
+
+/* Configurations per pass (one bit each in a per-source mask) */
+#define WHATIF_MAX_CONFIGS 64
+
+typedef enum
+{
+    WHATIF_SYN = 0,       /* SYN without ACK: a connection attempt */
+    WHATIF_HANDSHAKE = 1, /* ACK without SYN/RST: the source completed a handshake */
+} whatif_kind_t;
+
+/* One replayed packet */
+typedef struct
+{
+    uint64_t ts_ns;   /* Capture time; only differences matter */
+    uint32_t src_ip;  /* Network byte order */
+    uint8_t kind;     /* whatif_kind_t */
+} whatif_packet_t;
+
+typedef struct
+{
+    char name[64];
+    uint32_t syn_threshold;
+    uint32_t window_ms;
+    uint32_t block_duration_s;
+} whatif_config_t;
+
+/* Outcome of one configuration */
+typedef struct
+{
+    uint64_t blocks_total;        /* Blocks, counting sources blocked again after expiry */
+    uint64_t blocked_sources;     /* Distinct sources blocked at least once */
+    uint64_t syns_dropped;        /* SYNs that arrived while their source was blocked */
+    uint64_t est_false_positives; /* Blocked sources that also completed handshakes */
+    uint64_t first_block_ms;      /* Capture time of the first block, UINT64_MAX if none */
+    uint64_t detect_ms_total;     /* Sum over blocked sources of first SYN to first block */
+    uint64_t detect_ms_max;
+} whatif_result_t;
+
+/* Figures that do not depend on the configuration */
+typedef struct
+{
+    uint64_t syns_total;         /* SYNs from sources that are not whitelisted */
+    uint64_t sources_total;      /* Distinct sources that sent a SYN */
+    uint64_t handshake_sources;  /* ... of which completed a handshake */
+    uint64_t whitelisted_syns;   /* SYNs skipped by the whitelist */
+    uint64_t duration_ms;        /* First to last packet */
+} whatif_summary_t;
+
+/**
+ * Replay a capture under every configuration
+ * Packets should be in capture order; a timestamp earlier than the one
+ * before it is treated as equal to it.
+ * @param configs Configurations (1 - WHATIF_MAX_CONFIGS)
+ * @param config_count Number of configurations
+ * @param packets Capture
+ * @param packet_count Number of packets
+ * @param whitelist Sources never blocked (NULL = none)
+ * @param threads Worker threads (0 = 1)
+ * @param results Output, one per configuration
+ * @param summary Output capture figures (may be NULL)
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t whatif_replay(const whatif_config_t *configs, size_t config_count,
+                             const whatif_packet_t *packets, size_t packet_count,
+                             whitelist_node_t *whitelist, unsigned threads,
+                             whatif_result_t *results, whatif_summary_t *summary);
+
+#endif /* SYNFLOOD_WHATIF_H */
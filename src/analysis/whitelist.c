@@ -4,6 +4,7 @@
  */
 
 #include "whitelist.h"
+#include "simd.h"
 #include "../observe/logger.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -164,6 +165,20 @@ bool whitelist_check(whitelist_node_t *root, uint32_t ip_addr) {
     return false;
 }
 
+bool whitelist_check_cached(whitelist_node_t *root, uint32_t generation, ip_tracker_t *entry) {
+    if (!entry) {
+        return false;
+    }
+
+    /* Verdict only changes when the whitelist is reloaded */
+    if (entry->whitelist_gen != generation) {
+        entry->whitelisted = whitelist_check(root, entry->ip_addr) ? 1 : 0;
+        entry->whitelist_gen = generation;
+    }
+
+    return entry->whitelisted != 0;
+}
+
 whitelist_node_t *whitelist_load(const char *path) {
     if (!path) {
         return NULL;
@@ -234,3 +249,507 @@ size_t whitelist_count(whitelist_node_t *root) {
 
     return 1 + whitelist_count(root->left) + whitelist_count(root->right);
 }
+
+/*
+ * Live edits (control socket) copy the path from the root to the edited
+ * node and publish the new root with a single pointer store, so packet
+ * threads walk either the old or the new tree and never wait. Unlinked
+ * nodes are freed once every online reader has passed a quiescent point:
+ * each reader slot records the reclamation epoch seen at its last one, and
+ * a batch retired at epoch E is freed when no online slot is below E.
+ */
+
+/* Nodes unlinked by one edit, freed together */
+typedef struct whitelist_garbage
+{
+    struct whitelist_garbage *next;
+    uint64_t epoch; /* Reclamation epoch started by the retirement */
+    bool subtree; /* Nodes are whole trees (replaced whitelists) */
+    size_t count;
+    whitelist_node_t *nodes[];
+} whitelist_garbage_t;
+
+/* Nodes from the root down to, not including, an entry's position */
+typedef struct
+{
+    whitelist_node_t **nodes;
+    size_t count;
+    size_t capacity;
+} whitelist_path_t;
+
+/* Serializes writers; readers never take it */
+static pthread_mutex_t whitelist_edit_lock = PTHREAD_MUTEX_INITIALIZER;
+static whitelist_garbage_t *garbage_head = NULL; /* Newest first */
+static size_t garbage_count = 0;
+
+/* One cache line per reader */
+typedef struct
+{
+    uint64_t epoch; /* Epoch at the last quiescent point, 0 = free slot */
+    uint8_t pad[56];
+} whitelist_reader_slot_t;
+
+static whitelist_reader_slot_t reader_slots[WHITELIST_MAX_READERS];
+static uint64_t reclaim_epoch = 1;
+static uint32_t reader_overflow = 0; /* Online readers that found no free slot */
+
+static _Thread_local int reader_slot = -1;
+static _Thread_local uint32_t reader_depth = 0;
+
+static uint32_t cidr_mask(uint8_t prefix_len) {
+    return prefix_len == 0 ? 0 : htonl(~((1U << (32 - prefix_len)) - 1));
+}
+
+static bool path_push(whitelist_path_t *path, whitelist_node_t *node) {
+    if (path->count == path->capacity) {
+        size_t capacity = path->capacity ? path->capacity * 2 : 32;
+        whitelist_node_t **nodes = realloc(path->nodes, capacity * sizeof(*nodes));
+        if (!nodes) {
+            return false;
+        }
+        path->nodes = nodes;
+        path->capacity = capacity;
+    }
+    path->nodes[path->count++] = node;
+    return true;
+}
+
+/* Find the node holding prefix, recording the path to it */
+static bool whitelist_descend(whitelist_node_t *root, uint32_t prefix, whitelist_path_t *path,
+                              whitelist_node_t **found) {
+    whitelist_node_t *node = root;
+    while (node && node->prefix != prefix) {
+        if (!path_push(path, node)) {
+            return false;
+        }
+        node = prefix < node->prefix ? node->left : node->right;
+    }
+    *found = node;
+    return true;
+}
+
+/* Allocate all node copies an edit needs up front, so it fails before
+ * anything is published */
+static whitelist_node_t **copies_alloc(size_t count) {
+    whitelist_node_t **copies = calloc(count ? count : 1, sizeof(*copies));
+    if (!copies) {
+        return NULL;
+    }
+    for (size_t i = 0; i < count; i++) {
+        copies[i] = malloc(sizeof(whitelist_node_t));
+        if (!copies[i]) {
+            for (size_t j = 0; j < i; j++) {
+                free(copies[j]);
+            }
+            free(copies);
+            return NULL;
+        }
+    }
+    return copies;
+}
+
+/* Copy the recorded path bottom-up around a new subtree; returns the new root */
+static whitelist_node_t *path_rebuild(const whitelist_path_t *path, whitelist_node_t **copies,
+                                      uint32_t prefix, whitelist_node_t *subtree) {
+    whitelist_node_t *child = subtree;
+    for (size_t i = path->count; i-- > 0;) {
+        whitelist_node_t *copy = copies[i];
+        *copy = *path->nodes[i];
+        if (prefix < copy->prefix) {
+            copy->left = child;
+        } else {
+            copy->right = child;
+        }
+        child = copy;
+    }
+    return child;
+}
+
+/* Make a new root visible, then invalidate cached verdicts (0 is reserved).
+ * Readers load the generation before the root. */
+static void whitelist_publish(whitelist_node_t **root, whitelist_node_t *new_root,
+                              volatile uint32_t *generation) {
+    __atomic_store_n(root, new_root, __ATOMIC_RELEASE);
+    if (generation) {
+        /* A shared tracker's generation is bumped by several processes */
+        uint32_t cur = __atomic_load_n(generation, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(generation, &cur, cur + 1 ? cur + 1 : 1, false,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        }
+    }
+}
+
+static void garbage_free(whitelist_garbage_t *g) {
+    for (size_t i = 0; i < g->count; i++) {
+        if (g->subtree) {
+            whitelist_free(g->nodes[i]);
+        } else {
+            free(g->nodes[i]);
+        }
+    }
+    free(g);
+}
+
+/* Queue unlinked nodes, after publishing (caller holds whitelist_edit_lock) */
+static void garbage_retire(whitelist_garbage_t *g) {
+    if (g->count == 0) {
+        free(g);
+        return;
+    }
+    g->epoch = __atomic_add_fetch(&reclaim_epoch, 1, __ATOMIC_SEQ_CST);
+    g->next = garbage_head;
+    garbage_head = g;
+    garbage_count++;
+}
+
+/* Free garbage no online reader can hold (caller holds whitelist_edit_lock) */
+static void reclaim_locked(bool all) {
+    /* Pairs with the fence in whitelist_reader_online() */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    uint64_t safe = UINT64_MAX;
+    if (__atomic_load_n(&reader_overflow, __ATOMIC_SEQ_CST) > 0) {
+        safe = 0;
+    }
+    for (size_t i = 0; i < WHITELIST_MAX_READERS; i++) {
+        uint64_t epoch = __atomic_load_n(&reader_slots[i].epoch, __ATOMIC_ACQUIRE);
+        if (epoch != 0 && epoch < safe) {
+            safe = epoch;
+        }
+    }
+
+    /* Newest first: everything after the first free batch is older */
+    whitelist_garbage_t **link = &garbage_head;
+    while (*link && !all && (*link)->epoch > safe) {
+        link = &(*link)->next;
+    }
+
+    whitelist_garbage_t *g = *link;
+    *link = NULL;
+    while (g) {
+        whitelist_garbage_t *next = g->next;
+        garbage_free(g);
+        garbage_count--;
+        g = next;
+    }
+}
+
+void whitelist_reader_online(void) {
+    if (reader_depth++ > 0) {
+        return;
+    }
+
+    uint64_t epoch = __atomic_load_n(&reclaim_epoch, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < WHITELIST_MAX_READERS; i++) {
+        uint64_t expected = 0;
+        if (__atomic_compare_exchange_n(&reader_slots[i].epoch, &expected, epoch, false,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            reader_slot = i;
+            break;
+        }
+    }
+    if (reader_slot < 0) {
+        /* Without a slot this reader holds off all reclamation */
+        __atomic_add_fetch(&reader_overflow, 1, __ATOMIC_SEQ_CST);
+    }
+
+    /* Either the reclaimer sees this slot, or the roots this thread loads
+     * next are newer than anything it frees */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void whitelist_quiescent(void) {
+    if (reader_slot >= 0) {
+        __atomic_store_n(&reader_slots[reader_slot].epoch,
+                         __atomic_load_n(&reclaim_epoch, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+    }
+}
+
+void whitelist_reader_offline(void) {
+    if (reader_depth == 0 || --reader_depth > 0) {
+        return;
+    }
+
+    if (reader_slot >= 0) {
+        __atomic_store_n(&reader_slots[reader_slot].epoch, 0, __ATOMIC_RELEASE);
+        reader_slot = -1;
+    } else {
+        __atomic_sub_fetch(&reader_overflow, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+bool whitelist_contains(whitelist_node_t *root, uint32_t prefix, uint8_t prefix_len) {
+    if (prefix_len > 32) {
+        return false;
+    }
+    prefix &= cidr_mask(prefix_len);
+
+    whitelist_node_t *node = root;
+    while (node && node->prefix != prefix) {
+        node = prefix < node->prefix ? node->left : node->right;
+    }
+    return node && node->prefix_len == prefix_len;
+}
+
+synflood_ret_t whitelist_insert(whitelist_node_t **root, uint32_t prefix, uint8_t prefix_len,
+                                volatile uint32_t *generation) {
+    if (!root || prefix_len > 32) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    uint32_t mask = cidr_mask(prefix_len);
+    prefix &= mask;
+
+    synflood_ret_t ret = SYNFLOOD_ENOMEM;
+    whitelist_path_t path = {0};
+    whitelist_node_t *found;
+
+    pthread_mutex_lock(&whitelist_edit_lock);
+
+    if (!whitelist_descend(*root, prefix, &path, &found)) {
+        goto out;
+    }
+
+    if (found && found->prefix_len == prefix_len) {
+        ret = SYNFLOOD_OK; /* Already present */
+        goto out;
+    }
+
+    /* One copy per path node, plus the new (or re-sized) entry */
+    whitelist_garbage_t *g = malloc(sizeof(*g) + (path.count + 1) * sizeof(whitelist_node_t *));
+    whitelist_node_t **copies = copies_alloc(path.count + 1);
+    if (!g || !copies) {
+        free(g);
+        free(copies);
+        goto out;
+    }
+
+    whitelist_node_t *node = copies[path.count];
+    *node = found ? *found : (whitelist_node_t){0};
+    node->prefix = prefix;
+    node->mask = mask;
+    node->prefix_len = prefix_len;
+
+    whitelist_publish(root, path_rebuild(&path, copies, prefix, node), generation);
+    free(copies);
+
+    memcpy(g->nodes, path.nodes, path.count * sizeof(whitelist_node_t *));
+    g->count = path.count;
+    g->subtree = false;
+    if (found) {
+        g->nodes[g->count++] = found;
+    }
+    garbage_retire(g);
+    reclaim_locked(false);
+    ret = SYNFLOOD_OK;
+
+out:
+    pthread_mutex_unlock(&whitelist_edit_lock);
+    free(path.nodes);
+    return ret;
+}
+
+synflood_ret_t whitelist_remove(whitelist_node_t **root, uint32_t prefix, uint8_t prefix_len,
+                                volatile uint32_t *generation) {
+    if (!root || prefix_len > 32) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    prefix &= cidr_mask(prefix_len);
+
+    synflood_ret_t ret = SYNFLOOD_ENOMEM;
+    whitelist_path_t path = {0};
+    whitelist_path_t succ_path = {0}; /* Right child down to the successor's parent */
+    whitelist_node_t *found;
+    whitelist_node_t *successor = NULL;
+
+    pthread_mutex_lock(&whitelist_edit_lock);
+
+    if (!whitelist_descend(*root, prefix, &path, &found)) {
+        goto out;
+    }
+
+    if (!found || found->prefix_len != prefix_len) {
+        ret = SYNFLOOD_ENOTFOUND;
+        goto out;
+    }
+
+    /* Two children: the in-order successor takes the entry's place */
+    if (found->left && found->right) {
+        successor = found->right;
+        while (successor->left) {
+            if (!path_push(&succ_path, successor)) {
+                goto out;
+            }
+            successor = successor->left;
+        }
+    }
+
+    size_t copy_count = path.count + (successor ? succ_path.count + 1 : 0);
+    size_t garbage_count = copy_count + 1;
+    whitelist_garbage_t *g = malloc(sizeof(*g) + garbage_count * sizeof(whitelist_node_t *));
+    whitelist_node_t **copies = copies_alloc(copy_count);
+    if (!g || !copies) {
+        free(g);
+        free(copies);
+        goto out;
+    }
+
+    whitelist_node_t *subtree;
+    if (!successor) {
+        subtree = found->left ? found->left : found->right;
+    } else {
+        /* Right subtree without the successor */
+        whitelist_node_t *child = successor->right;
+        for (size_t i = succ_path.count; i-- > 0;) {
+            whitelist_node_t *copy = copies[path.count + 1 + i];
+            *copy = *succ_path.nodes[i];
+            copy->left = child;
+            child = copy;
+        }
+
+        subtree = copies[path.count];
+        *subtree = *successor;
+        subtree->left = found->left;
+        subtree->right = child;
+    }
+
+    whitelist_publish(root, path_rebuild(&path, copies, prefix, subtree), generation);
+    free(copies);
+
+    memcpy(g->nodes, path.nodes, path.count * sizeof(whitelist_node_t *));
+    g->count = path.count;
+    g->subtree = false;
+    g->nodes[g->count++] = found;
+    if (successor) {
+        memcpy(g->nodes + g->count, succ_path.nodes, succ_path.count * sizeof(whitelist_node_t *));
+        g->count += succ_path.count;
+        g->nodes[g->count++] = successor;
+    }
+    garbage_retire(g);
+    reclaim_locked(false);
+    ret = SYNFLOOD_OK;
+
+out:
+    pthread_mutex_unlock(&whitelist_edit_lock);
+    free(path.nodes);
+    free(succ_path.nodes);
+    return ret;
+}
+
+void whitelist_replace(whitelist_node_t **root, whitelist_node_t *new_root,
+                       volatile uint32_t *generation) {
+    if (!root) {
+        return;
+    }
+
+    pthread_mutex_lock(&whitelist_edit_lock);
+
+    whitelist_node_t *old_root = *root;
+    whitelist_garbage_t *g = malloc(sizeof(*g) + sizeof(whitelist_node_t *));
+
+    whitelist_publish(root, new_root, generation);
+
+    if (g) {
+        g->nodes[0] = old_root;
+        g->count = old_root ? 1 : 0;
+        g->subtree = true;
+        garbage_retire(g);
+    } else if (old_root) {
+        /* Readers may still be on it: leaking beats freeing under them */
+        LOG_WARN("Out of memory retiring the old whitelist; %zu entries leaked",
+                 whitelist_count(old_root));
+    }
+    reclaim_locked(false);
+
+    pthread_mutex_unlock(&whitelist_edit_lock);
+}
+
+void whitelist_reclaim(bool all) {
+    pthread_mutex_lock(&whitelist_edit_lock);
+    reclaim_locked(all);
+    pthread_mutex_unlock(&whitelist_edit_lock);
+}
+
+size_t whitelist_retired_count(void) {
+    pthread_mutex_lock(&whitelist_edit_lock);
+    size_t count = garbage_count;
+    pthread_mutex_unlock(&whitelist_edit_lock);
+    return count;
+}
+
+/* Copy nodes into the flat arrays (pre-order) */
+static void whitelist_flatten_node(whitelist_node_t *node, whitelist_flat_t *flat) {
+    if (!node) {
+        return;
+    }
+
+    flat->prefixes[flat->count] = node->prefix;
+    flat->masks[flat->count] = node->mask;
+    flat->count++;
+
+    whitelist_flatten_node(node->left, flat);
+    whitelist_flatten_node(node->right, flat);
+}
+
+whitelist_flat_t *whitelist_flatten(whitelist_node_t *root) {
+    whitelist_flat_t *flat = calloc(1, sizeof(whitelist_flat_t));
+    if (!flat) {
+        return NULL;
+    }
+
+    size_t count = whitelist_count(root);
+    if (count > 0) {
+        flat->prefixes = malloc(count * sizeof(uint32_t));
+        flat->masks = malloc(count * sizeof(uint32_t));
+        if (!flat->prefixes || !flat->masks) {
+            whitelist_flat_free(flat);
+            return NULL;
+        }
+    }
+
+    whitelist_flatten_node(root, flat);
+    return flat;
+}
+
+size_t whitelist_check_batch(const whitelist_flat_t *flat, const uint32_t *ips, size_t n, bool *out) {
+    if (!flat || !ips || !out) {
+        return 0;
+    }
+
+    size_t hits = 0;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = simd_cidr_any(flat->prefixes, flat->masks, flat->count, ips[i]);
+        if (out[i]) {
+            hits++;
+        }
+    }
+
+    return hits;
+}
+
+bool whitelist_flat_overlaps(const whitelist_flat_t *flat, uint32_t prefix, uint8_t prefix_len) {
+    if (!flat || prefix_len > 32) {
+        return false;
+    }
+
+    uint32_t mask = cidr_mask(prefix_len);
+    for (size_t i = 0; i < flat->count; i++) {
+        /* Two CIDRs overlap iff they agree on the shorter prefix */
+        if (((flat->prefixes[i] ^ prefix) & flat->masks[i] & mask) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void whitelist_flat_free(whitelist_flat_t *flat) {
+    if (!flat) {
+        return;
+    }
+
+    free(flat->prefixes);
+    free(flat->masks);
+    free(flat);
+}
@@ -8,6 +8,9 @@
 
 #include "common.h"
 
+/* Threads that can be online readers at the same time (see whitelist_reader_online) */
+#define WHITELIST_MAX_READERS 128
+
 /**
  * Load whitelist from configuration file
  * @param path Path to whitelist configuration file
@@ -31,6 +34,100 @@ synflood_ret_t whitelist_add(whitelist_node_t **root, const char *cidr);
  */
 bool whitelist_check(whitelist_node_t *root, uint32_t ip_addr);
 
+/**
+ * Check if a tracked source is whitelisted, using the verdict cached in its
+ * tracker entry. The trie is only walked when the cached verdict belongs to
+ * an older whitelist generation.
+ * @param root Root node of Patricia trie
+ * @param generation Current whitelist generation (must not be 0)
+ * @param entry Tracker entry of the source IP
+ * @return true if whitelisted, false otherwise
+ */
+bool whitelist_check_cached(whitelist_node_t *root, uint32_t generation, ip_tracker_t *entry);
+
+/**
+ * Check whether an exact entry is in the whitelist
+ * @param root Root node of Patricia trie
+ * @param prefix Network address (network byte order, host bits ignored)
+ * @param prefix_len Prefix length (0-32)
+ * @return true if the entry is present with this prefix length
+ */
+bool whitelist_contains(whitelist_node_t *root, uint32_t prefix, uint8_t prefix_len);
+
+/**
+ * Insert an entry into a live whitelist without blocking readers
+ * The path to the entry is copied and the new root published atomically;
+ * replaced nodes are retired (see whitelist_reclaim). Writers serialize on
+ * an internal lock. An entry with the same network address and another
+ * length is replaced.
+ * @param root Pointer to the published root pointer
+ * @param prefix Network address (network byte order, host bits ignored)
+ * @param prefix_len Prefix length (0-32)
+ * @param generation Whitelist generation to bump after publishing (may be NULL)
+ * @return SYNFLOOD_OK on success, SYNFLOOD_EINVAL or SYNFLOOD_ENOMEM
+ */
+synflood_ret_t whitelist_insert(whitelist_node_t **root, uint32_t prefix, uint8_t prefix_len,
+                                volatile uint32_t *generation);
+
+/**
+ * Remove an entry from a live whitelist without blocking readers
+ * Copy-on-write like whitelist_insert().
+ * @param root Pointer to the published root pointer
+ * @param prefix Network address (network byte order, host bits ignored)
+ * @param prefix_len Prefix length (0-32)
+ * @param generation Whitelist generation to bump after publishing (may be NULL)
+ * @return SYNFLOOD_OK, SYNFLOOD_ENOTFOUND if the entry is not present,
+ *         SYNFLOOD_EINVAL or SYNFLOOD_ENOMEM
+ */
+synflood_ret_t whitelist_remove(whitelist_node_t **root, uint32_t prefix, uint8_t prefix_len,
+                                volatile uint32_t *generation);
+
+/**
+ * Publish a whole new whitelist (e.g. after reloading the file) and retire
+ * the old one, serialized with live edits
+ * @param root Pointer to the published root pointer
+ * @param new_root New whitelist (may be NULL)
+ * @param generation Whitelist generation to bump after publishing (may be NULL)
+ */
+void whitelist_replace(whitelist_node_t **root, whitelist_node_t *new_root,
+                       volatile uint32_t *generation);
+
+/**
+ * Free retired nodes
+ * Nodes are freed once every online reader has passed a quiescent point
+ * after they were unlinked. Edits reclaim on their own; call periodically
+ * to free what readers released since, and with all=true at shutdown, once
+ * no reader is left.
+ * @param all Free everything, not only nodes no reader can hold
+ */
+void whitelist_reclaim(bool all);
+
+/**
+ * Get the number of edits whose retired nodes are not freed yet
+ * @return Retired batches waiting for readers
+ */
+size_t whitelist_retired_count(void);
+
+/**
+ * Mark the calling thread as an online reader of live whitelists
+ * Threads that walk a published root without the edit lock must be online
+ * while doing so, and must call whitelist_quiescent() regularly when they
+ * stay online for long. Calls nest.
+ */
+void whitelist_reader_online(void);
+
+/**
+ * Report a quiescent point: the calling thread holds no whitelist node
+ * it loaded before this call
+ */
+void whitelist_quiescent(void);
+
+/**
+ * Mark the calling thread as offline (e.g. before exiting); it no longer
+ * holds up reclamation
+ */
+void whitelist_reader_offline(void);
+
 /**
  * Free whitelist and all nodes
  * @param root Root node of Patricia trie
@@ -44,4 +141,37 @@ void whitelist_free(whitelist_node_t *root);
  */
 size_t whitelist_count(whitelist_node_t *root);
 
+/**
+ * Flatten a whitelist into prefix/mask arrays for batch lookups
+ * @param root Root node of Patricia trie (may be NULL)
+ * @return Flat whitelist (free with whitelist_flat_free) or NULL on error
+ */
+whitelist_flat_t *whitelist_flatten(whitelist_node_t *root);
+
+/**
+ * Check a batch of IPs against a flattened whitelist
+ * Uses the CPU-dispatched CIDR kernel; same verdicts as whitelist_check().
+ * @param flat Flattened whitelist
+ * @param ips IP addresses (network byte order)
+ * @param n Number of IPs
+ * @param out Output: verdict per IP
+ * @return Number of whitelisted IPs
+ */
+size_t whitelist_check_batch(const whitelist_flat_t *flat, const uint32_t *ips, size_t n, bool *out);
+
+/**
+ * Check whether any address of a CIDR range is whitelisted
+ * @param flat Flattened whitelist (may be NULL)
+ * @param prefix Network address (network byte order)
+ * @param prefix_len Prefix length (0-32)
+ * @return true if a whitelist entry overlaps the range
+ */
+bool whitelist_flat_overlaps(const whitelist_flat_t *flat, uint32_t prefix, uint8_t prefix_len);
+
+/**
+ * Free a flattened whitelist
+ * @param flat Flat whitelist (may be NULL)
+ */
+void whitelist_flat_free(whitelist_flat_t *flat);
+
 #endif /* SYNFLOOD_WHITELIST_H */
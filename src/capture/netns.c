@@ -0,0 +1,472 @@
+/*
+ * netns.c - Monitoring of additional network namespaces
+ * TCP SYN Flood Detector
+ */
+
+#include "netns.h"
+#include "rawsock.h"
+#include "../analysis/engine.h"
+#include "../analysis/tracker.h"
+#include "../analysis/whitelist.h"
+#include "../enforce/ipset_mgr.h"
+#include "../observe/logger.h"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/* One monitored namespace */
+typedef struct
+{
+    char name[64];
+    char ipset_name[256];
+    netns_config_t settings;  /* Overrides, kept if the entry disappears on reload */
+    int sock_fd;
+    netns_binding_t binding;
+    synflood_config_t config; /* Host configuration with namespace overrides */
+    app_context_t ctx;
+    engine_process_fn process;
+    uint64_t next_expiry_ns;
+} netns_target_t;
+
+static netns_target_t *targets = NULL;
+static size_t target_count = 0;
+static const app_context_t *netns_host_ctx = NULL;
+static int epoll_fd = -1;
+
+static pthread_t *workers = NULL;
+static uint32_t worker_count = 0;
+static volatile bool netns_running = false;
+
+/* Workers hold it for reading while processing a batch */
+static pthread_rwlock_t pause_lock;
+static bool pause_lock_ready = false;
+
+/* Copy the host configuration and apply the namespace's overrides */
+static void netns_apply(netns_target_t *t, const app_context_t *host_ctx) {
+    t->config = *host_ctx->config;
+    t->config.netns_count = 0;
+
+    if (t->settings.syn_threshold != 0) {
+        t->config.syn_threshold = t->settings.syn_threshold;
+    }
+    if (t->settings.block_duration_s != 0) {
+        t->config.block_duration_s = t->settings.block_duration_s;
+    }
+
+    /* Capture is a raw socket copy: no verdicts, no marks, no sampling */
+    t->config.use_raw_socket = true;
+    t->config.fastpath_mark = 0;
+    t->config.overload_max_sample = 1;
+
+    /* The victim and scan tables are keyed by address only and shared by
+     * the daemon; namespaces commonly reuse the same private addresses.
+     * Origin AS tracking stays off too: t->ctx never gets the ASN map. */
+    t->config.victim_threshold = 0;
+    t->config.scan_port_threshold = 0;
+    t->config.scan_host_threshold = 0;
+
+    /* Every block goes to the namespace's own set */
+    t->config.udp_ipset[0] = '\0';
+    t->config.icmp_ipset[0] = '\0';
+
+    /* Cached verdicts in the namespace's table follow the host's generation */
+    uint32_t whitelist_gen = __atomic_load_n(host_ctx->tracker->whitelist_gen, __ATOMIC_ACQUIRE);
+    t->ctx.whitelist_root = __atomic_load_n(&host_ctx->whitelist_root, __ATOMIC_ACQUIRE);
+    __atomic_store_n(t->ctx.tracker->whitelist_gen, whitelist_gen, __ATOMIC_RELEASE);
+    t->process = engine_variant(engine_flags(&t->ctx));
+
+    /* Flag class thresholds may have changed */
+    if (t->sock_fd >= 0) {
+        rawsock_set_filter(t->sock_fd, engine_flood_classes(&t->config));
+    }
+}
+
+/* Find a namespace's settings in a configuration by name */
+static const netns_config_t *netns_find_config(const synflood_config_t *config, const char *name) {
+    for (uint32_t i = 0; i < config->netns_count; i++) {
+        if (strcmp(config->namespaces[i].name, name) == 0) {
+            return &config->namespaces[i];
+        }
+    }
+    return NULL;
+}
+
+/* Open the capture socket and /proc/net/tcp inside the target namespace */
+static synflood_ret_t netns_attach(netns_target_t *t, const netns_config_t *ns_config) {
+    t->binding.ns_fd = open(ns_config->path, O_RDONLY | O_CLOEXEC);
+    if (t->binding.ns_fd < 0) {
+        LOG_ERROR("Failed to open namespace %s (%s): %s", ns_config->name, ns_config->path,
+                  strerror(errno));
+        return SYNFLOOD_ERROR;
+    }
+
+    int self_fd = open("/proc/thread-self/ns/net", O_RDONLY | O_CLOEXEC);
+    if (self_fd < 0) {
+        LOG_ERROR("Failed to open own network namespace: %s", strerror(errno));
+        return SYNFLOOD_ERROR;
+    }
+
+    /* Only this thread switches; sockets and /proc files stay bound to the
+     * namespace they were opened in */
+    if (setns(t->binding.ns_fd, CLONE_NEWNET) < 0) {
+        LOG_ERROR("setns() into %s failed (need CAP_SYS_ADMIN): %s", ns_config->name,
+                  strerror(errno));
+        close(self_fd);
+        return SYNFLOOD_ERROR;
+    }
+
+    /* SYNs only until netns_apply() sets the configured classes */
+    t->sock_fd = rawsock_open(1u << FLOOD_CLASS_SYN);
+    t->binding.proc_tcp_fd = open("/proc/thread-self/net/tcp", O_RDONLY | O_CLOEXEC);
+    int proc_errno = errno;
+
+    int back = setns(self_fd, CLONE_NEWNET);
+    close(self_fd);
+    if (back < 0) {
+        LOG_ERROR("Failed to return to own network namespace: %s", strerror(errno));
+        return SYNFLOOD_ERROR;
+    }
+
+    if (t->sock_fd < 0) {
+        return SYNFLOOD_ERROR;
+    }
+    if (t->binding.proc_tcp_fd < 0) {
+        LOG_ERROR("Failed to open /proc/net/tcp in %s: %s", ns_config->name, strerror(proc_errno));
+        return SYNFLOOD_ERROR;
+    }
+
+    return SYNFLOOD_OK;
+}
+
+/* Unblock sources whose block expired (runs on the worker owning the namespace) */
+static void netns_expire(netns_target_t *t, uint64_t now) {
+    uint32_t expired_ips[256];
+    size_t count = tracker_get_expired_blocks(t->ctx.tracker, now, expired_ips,
+                                              ARRAY_SIZE(expired_ips));
+
+    for (size_t i = 0; i < count; i++) {
+        if (ipset_mgr_remove_in(t->binding.ns_fd, t->ipset_name, expired_ips[i]) != SYNFLOOD_OK) {
+            continue;
+        }
+
+        ip_tracker_t *tracker = tracker_get(t->ctx.tracker, expired_ips[i]);
+        if (tracker) {
+            tracker->blocked = 0;
+            tracker->block_expiry_ns = 0;
+        }
+
+        logger_log_event(EVENT_UNBLOCKED, expired_ips[i], 0, 0);
+
+        pthread_mutex_lock(&t->ctx.metrics_lock);
+        if (t->ctx.metrics.blocked_ips_current > 0) {
+            t->ctx.metrics.blocked_ips_current--;
+        }
+        pthread_mutex_unlock(&t->ctx.metrics_lock);
+    }
+}
+
+/* Process up to NETNS_BATCH packets from one namespace */
+static void netns_drain(netns_target_t *t, unsigned char *buffer, size_t size) {
+    uint64_t now = get_monotonic_ns();
+
+    /* Follow live whitelist edits; the generation is read before the root */
+    uint32_t whitelist_gen = __atomic_load_n(netns_host_ctx->tracker->whitelist_gen, __ATOMIC_ACQUIRE);
+    if (*t->ctx.tracker->whitelist_gen != whitelist_gen) {
+        t->ctx.whitelist_root = __atomic_load_n(&netns_host_ctx->whitelist_root, __ATOMIC_ACQUIRE);
+        __atomic_store_n(t->ctx.tracker->whitelist_gen, whitelist_gen, __ATOMIC_RELEASE);
+    }
+
+    /* Expiry runs here so the namespace is never touched by two threads.
+     * Kernel set entries time out on their own; an idle namespace only
+     * delays the unblock event until its next packet. */
+    if (now >= t->next_expiry_ns) {
+        netns_expire(t, now);
+        t->next_expiry_ns = now + sec_to_ns(t->config.proc_check_interval_s);
+    }
+
+    for (int i = 0; i < NETNS_BATCH; i++) {
+        ssize_t packet_len = recv(t->sock_fd, buffer, size, MSG_DONTWAIT);
+        if (packet_len < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                LOG_ERROR("recv() failed on namespace %s: %s", t->name, strerror(errno));
+            }
+            break;
+        }
+
+        pthread_mutex_lock(&t->ctx.metrics_lock);
+        t->ctx.metrics.packets_total++;
+        pthread_mutex_unlock(&t->ctx.metrics_lock);
+
+        engine_packet_t pkt;
+        if (!rawsock_parse(buffer, (size_t)packet_len, &pkt)) {
+            continue;
+        }
+
+        pkt.weight = 1;
+        bool fastpath = false;
+        t->process(&t->ctx, &pkt, &fastpath);
+    }
+}
+
+static void *netns_worker(void *arg) {
+    (void)arg;
+    unsigned char buffer[65536];
+
+    /* Targets keep host whitelist roots only until the next generation check
+     * in netns_drain(), so every iteration is a quiescent point */
+    whitelist_reader_online();
+
+    while (netns_running) {
+        whitelist_quiescent();
+
+        struct epoll_event ev;
+        int n = epoll_wait(epoll_fd, &ev, 1, NETNS_POLL_MS);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("epoll_wait() failed in namespace worker: %s", strerror(errno));
+            break;
+        }
+        if (n == 0) {
+            continue;
+        }
+
+        netns_target_t *t = ev.data.ptr;
+
+        pthread_rwlock_rdlock(&pause_lock);
+        netns_drain(t, buffer, sizeof(buffer));
+        pthread_rwlock_unlock(&pause_lock);
+
+        /* One-shot: re-arm so another worker can pick the namespace up */
+        ev.events = EPOLLIN | EPOLLONESHOT;
+        ev.data.ptr = t;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, t->sock_fd, &ev) < 0) {
+            LOG_ERROR("Failed to re-arm namespace %s: %s", t->name, strerror(errno));
+        }
+    }
+
+    whitelist_reader_offline();
+    return NULL;
+}
+
+synflood_ret_t netns_init(app_context_t *host_ctx) {
+    if (!host_ctx || !host_ctx->config) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    const synflood_config_t *config = host_ctx->config;
+    if (config->netns_count == 0) {
+        return SYNFLOOD_OK;
+    }
+
+    netns_host_ctx = host_ctx;
+
+    /* Prefer the writer so a reload is not starved by busy workers */
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&pause_lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+    pause_lock_ready = true;
+
+    targets = calloc(config->netns_count, sizeof(netns_target_t));
+    if (!targets) {
+        return SYNFLOOD_ENOMEM;
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        LOG_ERROR("Failed to create epoll instance: %s", strerror(errno));
+        return SYNFLOOD_ERROR;
+    }
+
+    for (uint32_t i = 0; i < config->netns_count; i++) {
+        const netns_config_t *ns_config = &config->namespaces[i];
+        netns_target_t *t = &targets[i];
+
+        t->settings = *ns_config;
+        strncpy(t->name, ns_config->name, sizeof(t->name) - 1);
+        strncpy(t->ipset_name, ns_config->ipset_name[0] ? ns_config->ipset_name : config->ipset_name,
+                sizeof(t->ipset_name) - 1);
+        t->sock_fd = -1;
+        t->binding.ns_fd = -1;
+        t->binding.proc_tcp_fd = -1;
+        t->binding.ipset_name = t->ipset_name;
+        target_count++;
+
+        if (netns_attach(t, ns_config) != SYNFLOOD_OK) {
+            return SYNFLOOD_ERROR;
+        }
+
+        t->ctx.config = &t->config;
+        t->ctx.netns = &t->binding;
+        t->ctx.running = true;
+        pthread_mutex_init(&t->ctx.metrics_lock, NULL);
+
+        t->ctx.tracker = tracker_create(config->hash_buckets, config->max_tracked_ips);
+        if (!t->ctx.tracker) {
+            LOG_ERROR("Failed to create tracker table for namespace %s", t->name);
+            return SYNFLOOD_ERROR;
+        }
+        netns_apply(t, host_ctx);
+
+        if (ipset_mgr_create_in(t->binding.ns_fd, t->ipset_name, t->config.block_duration_s,
+                                config->max_tracked_ips) != SYNFLOOD_OK) {
+            return SYNFLOOD_ERROR;
+        }
+
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLONESHOT, .data.ptr = t };
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, t->sock_fd, &ev) < 0) {
+            LOG_ERROR("Failed to watch namespace %s: %s", t->name, strerror(errno));
+            return SYNFLOOD_ERROR;
+        }
+
+        LOG_INFO("Monitoring namespace %s (%s): syn_threshold=%u, ipset=%s, variant=%s",
+                 t->name, ns_config->path, t->config.syn_threshold, t->ipset_name,
+                 engine_variant_name(engine_flags(&t->ctx)));
+    }
+
+    return SYNFLOOD_OK;
+}
+
+synflood_ret_t netns_start(uint32_t workers_requested) {
+    if (target_count == 0) {
+        return SYNFLOOD_OK;
+    }
+    if (workers_requested == 0) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    workers = calloc(workers_requested, sizeof(pthread_t));
+    if (!workers) {
+        return SYNFLOOD_ENOMEM;
+    }
+
+    netns_running = true;
+    for (uint32_t i = 0; i < workers_requested; i++) {
+        if (pthread_create(&workers[i], NULL, netns_worker, NULL) != 0) {
+            LOG_ERROR("Failed to create namespace worker %u", i);
+            netns_stop();
+            return SYNFLOOD_ERROR;
+        }
+        worker_count++;
+    }
+
+    LOG_INFO("Namespace worker pool started: %zu namespaces, %u workers", target_count,
+             worker_count);
+
+    return SYNFLOOD_OK;
+}
+
+void netns_stop(void) {
+    if (!netns_running) {
+        return;
+    }
+
+    netns_running = false;
+    for (uint32_t i = 0; i < worker_count; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    free(workers);
+    workers = NULL;
+    worker_count = 0;
+}
+
+void netns_cleanup(void) {
+    netns_stop();
+
+    for (size_t i = 0; i < target_count; i++) {
+        netns_target_t *t = &targets[i];
+
+        if (t->sock_fd >= 0) {
+            close(t->sock_fd);
+        }
+        if (t->binding.proc_tcp_fd >= 0) {
+            close(t->binding.proc_tcp_fd);
+        }
+        if (t->binding.ns_fd >= 0) {
+            close(t->binding.ns_fd);
+        }
+        if (t->ctx.tracker) {
+            tracker_destroy(t->ctx.tracker);
+            pthread_mutex_destroy(&t->ctx.metrics_lock);
+        }
+    }
+
+    free(targets);
+    targets = NULL;
+    target_count = 0;
+    netns_host_ctx = NULL;
+
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+
+    if (pause_lock_ready) {
+        pthread_rwlock_destroy(&pause_lock);
+        pause_lock_ready = false;
+    }
+}
+
+void netns_pause(void) {
+    if (target_count > 0) {
+        pthread_rwlock_wrlock(&pause_lock);
+    }
+}
+
+void netns_resume(const app_context_t *host_ctx) {
+    if (target_count == 0) {
+        return;
+    }
+
+    const synflood_config_t *config = host_ctx->config;
+    bool changed = config->netns_count != target_count;
+
+    for (size_t i = 0; i < target_count; i++) {
+        netns_target_t *t = &targets[i];
+        const netns_config_t *ns_config = netns_find_config(config, t->name);
+
+        /* Thresholds and whitelist follow the reload; attachments do not */
+        if (ns_config && strcmp(ns_config->path, t->settings.path) == 0) {
+            t->settings = *ns_config;
+        } else {
+            changed = true;
+        }
+        netns_apply(t, host_ctx);
+    }
+
+    pthread_rwlock_unlock(&pause_lock);
+
+    if (changed) {
+        LOG_WARN("Namespace list changed: restart the daemon to attach or detach namespaces");
+    }
+}
+
+size_t netns_count(void) {
+    return target_count;
+}
+
+bool netns_get_stats(size_t index, netns_stats_t *out) {
+    if (index >= target_count || !out) {
+        return false;
+    }
+
+    netns_target_t *t = &targets[index];
+    out->name = t->name;
+
+    pthread_mutex_lock(&t->ctx.metrics_lock);
+    out->metrics = t->ctx.metrics;
+    pthread_mutex_unlock(&t->ctx.metrics_lock);
+
+    tracker_get_stats(t->ctx.tracker, &out->tracked_ips, &out->blocked_ips);
+
+    return true;
+}
@@ -0,0 +1,86 @@
+/*
+ * netns.h - Monitoring of additional network namespaces
+ * TCP SYN Flood Detector
+ *
+ * Each namespace listed in the configuration gets its own raw capture
+ * socket and /proc/net/tcp handle (opened inside the namespace via
+ * setns()), its own tracker, thresholds and ipset. The sockets of all
+ * namespaces are serviced by one shared pool of worker threads; a
+ * namespace is only ever processed by one worker at a time, so its
+ * tracker and metrics see the same single-writer access as the main
+ * capture loop.
+ */
+
+#ifndef SYNFLOOD_NETNS_H
+#define SYNFLOOD_NETNS_H
+
+#include "common.h"
+
+/* Packets drained from one namespace socket before yielding to others */
+#define NETNS_BATCH 64
+
+/* Worker wake-up interval to notice shutdown */
+#define NETNS_POLL_MS 500
+
+/* Per-namespace statistics */
+typedef struct
+{
+    const char *name;
+    metrics_t metrics;
+    size_t tracked_ips;
+    size_t blocked_ips;
+} netns_stats_t;
+
+/**
+ * Attach to every namespace in the configuration (call from the main
+ * thread before other threads are started; needs CAP_SYS_ADMIN)
+ * @param host_ctx Daemon context - configuration and whitelist are inherited
+ * @return SYNFLOOD_OK on success (also when no namespaces are configured)
+ */
+synflood_ret_t netns_init(app_context_t *host_ctx);
+
+/**
+ * Start the shared worker pool
+ * @param workers Number of worker threads
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t netns_start(uint32_t workers);
+
+/**
+ * Stop the worker pool and wait for the workers to exit
+ */
+void netns_stop(void);
+
+/**
+ * Close namespace handles and free per-namespace state
+ */
+void netns_cleanup(void);
+
+/**
+ * Hold the workers between packet batches while the host context is
+ * being reloaded (whitelist freed, configuration replaced)
+ */
+void netns_pause(void);
+
+/**
+ * Re-apply configuration and whitelist from the host context to every
+ * namespace and let the workers continue
+ * @param host_ctx Daemon context after reload
+ */
+void netns_resume(const app_context_t *host_ctx);
+
+/**
+ * Number of attached namespaces
+ * @return Namespace count
+ */
+size_t netns_count(void);
+
+/**
+ * Get statistics for one namespace
+ * @param index Namespace index (0 .. netns_count() - 1)
+ * @param out Output statistics
+ * @return true if index is valid
+ */
+bool netns_get_stats(size_t index, netns_stats_t *out);
+
+#endif /* SYNFLOOD_NETNS_H */
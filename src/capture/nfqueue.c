@@ -4,17 +4,16 @@
  */
 
 #include "nfqueue.h"
-#include "../analysis/tracker.h"
+#include "overload.h"
+#include "../analysis/engine.h"
 #include "../analysis/whitelist.h"
-#include "../analysis/procparse.h"
-#include "../enforce/ipset_mgr.h"
 #include "../observe/logger.h"
 #include <libnetfilter_queue/libnetfilter_queue.h>
 #include <linux/netfilter.h>
-#include <linux/ip.h>
-#include <linux/tcp.h>
 #include <netinet/in.h>
+#include <stdio.h>
 #include <string.h>
+#include <errno.h>
 
 /* External signal handler from main.c */
 extern void handle_signals(void);
@@ -23,87 +22,20 @@ static struct nfq_handle *nfq_h = NULL;
 static struct nfq_q_handle *nfq_qh = NULL;
 static int nfqueue_sock_fd = -1;
 static app_context_t *global_ctx = NULL;
+static bool fastpath_warned = false;
+static uint16_t nfqueue_num = 0;
+static uint64_t enobufs_drops = 0;
 
-/* Extract source IP from packet payload */
-static uint32_t extract_src_ip(unsigned char *payload, int payload_len) {
-    if (payload_len < sizeof(struct iphdr)) {
-        return 0;
-    }
-
-    struct iphdr *iph = (struct iphdr *)payload;
-    return iph->saddr;
-}
-
-/* Process a SYN packet according to the detection algorithm from SDD */
-static int process_syn_packet(app_context_t *ctx, uint32_t src_ip) {
-    /* Step 1: Whitelist check */
-    if (whitelist_check(ctx->whitelist_root, src_ip)) {
-        LOG_DEBUG("Packet from whitelisted IP");
-        pthread_mutex_lock(&ctx->metrics_lock);
-        ctx->metrics.whitelist_hits_total++;
-        pthread_mutex_unlock(&ctx->metrics_lock);
-        return NF_ACCEPT;
-    }
+#define PROC_NFNETLINK_QUEUE "/proc/net/netfilter/nfnetlink_queue"
 
-    /* Step 2: Get or create tracker entry */
-    ip_tracker_t *tracker = tracker_get_or_create(ctx->tracker, src_ip);
-    if (!tracker) {
-        LOG_ERROR("Failed to get/create tracker entry");
-        return NF_ACCEPT;
+/* Extract addresses, destination port and class from packet payload
+ * Returns false when there is no usable source address or L4 header */
+static bool extract_packet(unsigned char *payload, int payload_len, engine_packet_t *pkt) {
+    if (payload_len < 0 || !engine_parse_ipv4(payload, (size_t)payload_len, pkt)) {
+        return false;
     }
 
-    /* Step 3: Sliding window rate calculation */
-    uint64_t current_time = get_monotonic_ns();
-    uint64_t window_ns = ms_to_ns(ctx->config->window_ms);
-
-    if (current_time - tracker->window_start_ns > window_ns) {
-        /* Window expired, reset counter */
-        tracker->syn_count = 1;
-        tracker->window_start_ns = current_time;
-    } else {
-        tracker->syn_count++;
-    }
-
-    tracker->last_seen_ns = current_time;
-
-    /* Step 4: Threshold check */
-    if (tracker->syn_count > ctx->config->syn_threshold) {
-        if (!tracker->blocked) {
-            /* Secondary validation: check /proc/net/tcp */
-            uint32_t syn_recv_count = procparse_count_syn_recv_from_ip(src_ip);
-
-            if (syn_recv_count > ctx->config->syn_threshold / 2) {
-                /* Confirmed attack pattern */
-                if (ipset_mgr_add(src_ip, ctx->config->block_duration_s) == SYNFLOOD_OK) {
-                    tracker->blocked = 1;
-                    tracker->block_expiry_ns = current_time +
-                                               sec_to_ns(ctx->config->block_duration_s);
-
-                    logger_log_event(EVENT_BLOCKED, src_ip, tracker->syn_count, syn_recv_count);
-
-                    /* Update metrics */
-                    pthread_mutex_lock(&ctx->metrics_lock);
-                    ctx->metrics.detections_total++;
-                    ctx->metrics.blocked_ips_current = ipset_mgr_get_count();
-                    pthread_mutex_unlock(&ctx->metrics_lock);
-                }
-            } else {
-                /* Possible false positive, log but don't block */
-                logger_log_event(EVENT_SUSPICIOUS, src_ip, tracker->syn_count, syn_recv_count);
-
-                pthread_mutex_lock(&ctx->metrics_lock);
-                ctx->metrics.false_positives_total++;
-                pthread_mutex_unlock(&ctx->metrics_lock);
-            }
-        }
-    }
-
-    /* Update metrics */
-    pthread_mutex_lock(&ctx->metrics_lock);
-    ctx->metrics.syn_packets_total++;
-    pthread_mutex_unlock(&ctx->metrics_lock);
-
-    return NF_ACCEPT; /* Let packet through (ipset will drop future packets) */
+    return pkt->src_ip != 0;
 }
 
 /* NFQUEUE callback function */
@@ -133,25 +65,101 @@ static int nfqueue_callback(struct nfq_q_handle *qh, struct nfgenmsg *nfmsg,
     ctx->metrics.packets_total++;
     pthread_mutex_unlock(&ctx->metrics_lock);
 
-    /* Extract source IP */
-    uint32_t src_ip = extract_src_ip(payload, payload_len);
-    if (src_ip == 0) {
+    /* Extract source/destination */
+    engine_packet_t pkt;
+    if (!extract_packet(payload, payload_len, &pkt)) {
+        return nfq_set_verdict(qh, id, NF_ACCEPT, 0, NULL);
+    }
+
+    /* Load shedding: under overload only 1-in-N packets are analysed */
+    pkt.weight = overload_sample(pkt.src_ip);
+    if (pkt.weight == 0) {
         return nfq_set_verdict(qh, id, NF_ACCEPT, 0, NULL);
     }
 
-    /* Process SYN packet */
-    int verdict = process_syn_packet(ctx, src_ip);
+    /* Process packet (variant selected at init/reload) */
+    bool fastpath = false;
+    int verdict = engine_process_syn(ctx, &pkt, &fastpath) == ENGINE_DROP ?
+                  NF_DROP : NF_ACCEPT;
+
+    /* Known-good source: mark the packet and let it re-run the hook, where
+     * the fast-path rules add the source to the bypass ipset and accept it */
+    uint32_t fastpath_mark = ctx->config->fastpath_mark;
+    if (fastpath && verdict == NF_ACCEPT) {
+        uint32_t mark = nfq_get_nfmark(nfa);
+
+        if ((mark & fastpath_mark) == fastpath_mark) {
+            /* Came back despite the mark - rules are missing, avoid a loop */
+            if (!fastpath_warned) {
+                LOG_WARN("Fast-path mark 0x%x not matched by firewall rules, "
+                         "see fastpath rule templates", fastpath_mark);
+                fastpath_warned = true;
+            }
+            return nfq_set_verdict(qh, id, NF_ACCEPT, 0, NULL);
+        }
+
+        pthread_mutex_lock(&ctx->metrics_lock);
+        ctx->metrics.fastpath_marked_total++;
+        pthread_mutex_unlock(&ctx->metrics_lock);
+
+        return nfq_set_verdict2(qh, id, NF_REPEAT, mark | fastpath_mark, 0, NULL);
+    }
 
     /* Set verdict */
     return nfq_set_verdict(qh, id, verdict, 0, NULL);
 }
 
+/* Read backlog and drop counters of our queue from procfs
+ * Columns: queue_num portid queue_total copy_mode copy_range queue_dropped user_dropped ... */
+static void read_queue_stats(uint64_t *backlog, uint64_t *drops) {
+    *backlog = 0;
+    *drops = 0;
+
+    FILE *fp = fopen(PROC_NFNETLINK_QUEUE, "r");
+    if (!fp) {
+        return;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned int qnum, portid, total, mode, range, qdropped, udropped;
+        if (sscanf(line, "%u %u %u %u %u %u %u", &qnum, &portid, &total, &mode,
+                   &range, &qdropped, &udropped) == 7 && qnum == nfqueue_num) {
+            *backlog = total;
+            *drops = (uint64_t)qdropped + udropped;
+            break;
+        }
+    }
+
+    fclose(fp);
+}
+
+/* Feed the overload controller and publish its state */
+static void overload_tick(app_context_t *ctx, uint64_t now) {
+    uint64_t backlog, drops;
+    read_queue_stats(&backlog, &drops);
+    overload_update(drops + enobufs_drops, backlog, now);
+
+    uint32_t rate;
+    uint64_t shed, drops_total;
+    overload_get_stats(&rate, &shed, &drops_total);
+
+    pthread_mutex_lock(&ctx->metrics_lock);
+    ctx->metrics.sample_rate = rate;
+    ctx->metrics.shed_packets_total = shed;
+    ctx->metrics.capture_drops_total = drops_total;
+    pthread_mutex_unlock(&ctx->metrics_lock);
+}
+
 synflood_ret_t nfqueue_init(app_context_t *ctx, uint16_t queue_num) {
     if (!ctx) {
         return SYNFLOOD_EINVAL;
     }
 
     global_ctx = ctx;
+    nfqueue_num = queue_num;
+    enobufs_drops = 0;
+    overload_init(ctx->config->overload_max_sample);
 
     /* Open library handle */
     nfq_h = nfq_open();
@@ -198,6 +206,7 @@ synflood_ret_t nfqueue_init(app_context_t *ctx, uint16_t queue_num) {
     }
 
     ctx->nfqueue_fd = nfqueue_sock_fd;
+    overload_set_recv_timeout(nfqueue_sock_fd);
 
     LOG_INFO("NFQUEUE initialized: queue_num=%u, fd=%d", queue_num, nfqueue_sock_fd);
 
@@ -215,11 +224,31 @@ synflood_ret_t nfqueue_start(app_context_t *ctx) {
     int rv;
     uint32_t packet_count = 0;
 
+    /* The engine walks the live whitelist; each iteration is a quiescent point */
+    whitelist_reader_online();
+
     while (ctx->running) {
+        whitelist_quiescent();
         rv = recv(nfqueue_sock_fd, buf, sizeof(buf), 0);
+        if (rv < 0 && errno == ENOBUFS) {
+            /* Netlink socket overran: the kernel dropped queued packets */
+            enobufs_drops++;
+            continue;
+        }
+        if (rv < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            /* Receive timeout: idle, but signals and the controller still run */
+            handle_signals();
+            packet_count = 0;
+            uint64_t now = get_monotonic_ns();
+            if (overload_tick_due(now)) {
+                overload_tick(ctx, now);
+            }
+            continue;
+        }
         if (rv < 0) {
             if (ctx->running) {
                 LOG_ERROR("recv() failed on nfqueue");
+                whitelist_reader_offline();
                 return SYNFLOOD_ERROR;
             }
             break;
@@ -232,8 +261,15 @@ synflood_ret_t nfqueue_start(app_context_t *ctx) {
             handle_signals();
             packet_count = 0;
         }
+
+        /* The controller ticks on time, so light traffic still relaxes it */
+        uint64_t now = get_monotonic_ns();
+        if (overload_tick_due(now)) {
+            overload_tick(ctx, now);
+        }
     }
 
+    whitelist_reader_offline();
     LOG_INFO("NFQUEUE packet capture loop stopped");
 
     return SYNFLOOD_OK;
@@ -263,6 +299,7 @@ void nfqueue_cleanup(void) {
 
     nfqueue_sock_fd = -1;
     global_ctx = NULL;
+    fastpath_warned = false;
 
     LOG_INFO("NFQUEUE cleanup completed");
 }
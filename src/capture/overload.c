@@ -0,0 +1,162 @@
+/*
+ * overload.c - Capture overload controller implementation
+ * TCP SYN Flood Detector
+ *
+ * When the kernel starts dropping queued packets (or the queue backlog keeps
+ * growing) the controller doubles N and the capture path only processes
+ * 1-in-N packets, counting each admitted packet with weight N so per-source
+ * rates stay comparable with the configured thresholds. Heavy hitters keep
+ * crossing the threshold; CPU per second stays bounded. N halves again after
+ * a few calm ticks.
+ *
+ * Sampling is per packet, not per source: the decision hashes the source
+ * together with a packet sequence number. Every packet of every source is
+ * admitted with probability 1/N and then counted N times, so a source's
+ * expected count equals what it sent, with a relative error of about
+ * sqrt(N / sent) that is small for the heavy hitters the thresholds are
+ * about. Sampling whole sources instead would count an admitted source N
+ * times over (blocking well-behaved ones at 1/N of the threshold) and not
+ * see a shed flooder at all.
+ *
+ * Only used from the capture thread, so no locking is needed.
+ */
+
+#include "overload.h"
+#include "../observe/logger.h"
+#include <inttypes.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+static uint32_t max_sample_rate = 1;
+static uint32_t sample_rate = 1;
+static uint32_t sample_mask = 0;
+static uint32_t packet_seq = 0;
+static uint64_t shed_packets = 0;
+
+static uint64_t last_drops = 0;
+static uint64_t last_backlog = 0;
+static uint64_t next_tick_ns = 0;
+static uint32_t calm_ticks = 0;
+static bool have_reading = false;
+
+/* 32-bit finalizer (murmur3) - cheap, well distributed */
+static inline uint32_t mix32(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+void overload_init(uint32_t max_sample) {
+    if (max_sample == 0 || (max_sample & (max_sample - 1)) != 0) {
+        max_sample = 1;
+    }
+
+    max_sample_rate = max_sample;
+    sample_rate = 1;
+    sample_mask = 0;
+    packet_seq = 0;
+    shed_packets = 0;
+    last_drops = 0;
+    last_backlog = 0;
+    next_tick_ns = 0;
+    calm_ticks = 0;
+    have_reading = false;
+}
+
+uint32_t overload_sample(uint32_t src_ip) {
+    if (sample_mask == 0) {
+        return 1;
+    }
+
+    /* Per-packet decision (see above); mixing in the source keeps a source
+     * sending every N-th packet from always landing on the same outcome */
+    if ((mix32(src_ip ^ packet_seq++) & sample_mask) != 0) {
+        shed_packets++;
+        return 0;
+    }
+
+    return sample_rate;
+}
+
+static void set_sample_rate(uint32_t rate) {
+    sample_rate = rate;
+    sample_mask = rate - 1;
+}
+
+bool overload_update(uint64_t drops_total, uint64_t backlog, uint64_t now_ns) {
+    next_tick_ns = now_ns + OVERLOAD_TICK_NS;
+
+    if (!have_reading) {
+        /* First reading only establishes the baseline */
+        last_drops = drops_total;
+        last_backlog = backlog;
+        have_reading = true;
+        return false;
+    }
+
+    bool dropping = drops_total > last_drops;
+    bool backlog_growing = backlog >= OVERLOAD_BACKLOG_MIN && backlog > last_backlog;
+
+    last_drops = drops_total;
+    last_backlog = backlog;
+
+    if (max_sample_rate <= 1) {
+        return false;
+    }
+
+    if (dropping || backlog_growing) {
+        calm_ticks = 0;
+        if (sample_rate < max_sample_rate) {
+            set_sample_rate(sample_rate * 2);
+            LOG_WARN("Capture overloaded (drops=%" PRIu64 " backlog=%" PRIu64
+                     "), sampling 1-in-%u", drops_total, backlog, sample_rate);
+            return true;
+        }
+        return false;
+    }
+
+    if (sample_rate > 1 && ++calm_ticks >= OVERLOAD_CALM_TICKS) {
+        calm_ticks = 0;
+        set_sample_rate(sample_rate / 2);
+        if (sample_rate == 1) {
+            LOG_INFO("Capture load recovered, sampling disabled");
+        } else {
+            LOG_INFO("Capture load easing, sampling 1-in-%u", sample_rate);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+bool overload_tick_due(uint64_t now_ns) {
+    return now_ns >= next_tick_ns;
+}
+
+synflood_ret_t overload_set_recv_timeout(int fd) {
+    struct timeval tv = {
+        .tv_sec = (time_t)(OVERLOAD_TICK_NS / NSEC_PER_SEC),
+        .tv_usec = (suseconds_t)((OVERLOAD_TICK_NS % NSEC_PER_SEC) / 1000),
+    };
+
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) {
+        LOG_WARN("Failed to set capture receive timeout: overload ticks need traffic");
+        return SYNFLOOD_ERROR;
+    }
+    return SYNFLOOD_OK;
+}
+
+void overload_get_stats(uint32_t *rate, uint64_t *shed_total, uint64_t *drops_total) {
+    if (rate) {
+        *rate = sample_rate;
+    }
+    if (shed_total) {
+        *shed_total = shed_packets;
+    }
+    if (drops_total) {
+        *drops_total = last_drops;
+    }
+}
@@ -0,0 +1,69 @@
+/*
+ * overload.h - Capture overload controller and load-shedding sampler
+ * TCP SYN Flood Detector
+ */
+
+#ifndef SYNFLOOD_OVERLOAD_H
+#define SYNFLOOD_OVERLOAD_H
+
+#include "common.h"
+
+/* How often the capture loops feed backlog/drop readings to the controller */
+#define OVERLOAD_TICK_NS (250ULL * NSEC_PER_MSEC)
+
+/* Queue backlog (packets) that counts as pressure when it keeps growing */
+#define OVERLOAD_BACKLOG_MIN 256
+
+/* Consecutive calm ticks before the sample rate is relaxed by one step */
+#define OVERLOAD_CALM_TICKS 4
+
+/**
+ * Initialize the overload controller
+ * @param max_sample Largest 1-in-N sample rate (power of 2, 0 or 1 disables shedding)
+ */
+void overload_init(uint32_t max_sample);
+
+/**
+ * Decide whether a packet is processed while shedding load
+ * Sampling is per packet, deterministic on a hash of the source and the
+ * packet sequence: every packet is admitted with probability 1/N, so
+ * weighting it by N keeps each source's expected count unbiased.
+ * @param src_ip Source IP address (network byte order)
+ * @return 0 if the packet is shed, otherwise the weight (N) to count it with
+ */
+uint32_t overload_sample(uint32_t src_ip);
+
+/**
+ * Feed the controller a backlog/drop reading
+ * @param drops_total Cumulative kernel drop counter for the capture path
+ * @param backlog Packets currently waiting in the kernel queue (0 if unknown)
+ * @param now_ns Current time in nanoseconds
+ * @return true if the sample rate changed
+ */
+bool overload_update(uint64_t drops_total, uint64_t backlog, uint64_t now_ns);
+
+/**
+ * Check whether a controller tick is due
+ * @param now_ns Current time in nanoseconds
+ * @return true if overload_update() should be called
+ */
+bool overload_tick_due(uint64_t now_ns);
+
+/**
+ * Make blocking receives on a capture socket return at least once per tick
+ * Without traffic the capture loop would otherwise never get to relax the
+ * sample rate or handle signals.
+ * @param fd Capture socket
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t overload_set_recv_timeout(int fd);
+
+/**
+ * Get controller statistics
+ * @param sample_rate Output: current 1-in-N sample rate
+ * @param shed_total Output: packets shed since init
+ * @param drops_total Output: last cumulative kernel drop counter seen
+ */
+void overload_get_stats(uint32_t *sample_rate, uint64_t *shed_total, uint64_t *drops_total);
+
+#endif /* SYNFLOOD_OVERLOAD_H */
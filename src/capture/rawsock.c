@@ -4,117 +4,182 @@
  */
 
 #include "rawsock.h"
-#include "../analysis/tracker.h"
+#include "overload.h"
+#include "../analysis/engine.h"
 #include "../analysis/whitelist.h"
-#include "../analysis/procparse.h"
-#include "../enforce/ipset_mgr.h"
 #include "../observe/logger.h"
 #include <sys/socket.h>
 #include <linux/if_packet.h>
 #include <linux/filter.h>
-#include <linux/ip.h>
-#include <linux/tcp.h>
 #include <net/ethernet.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
 
 /* External signal handler from main.c */
 extern void handle_signals(void);
 
 static int raw_sock_fd = -1;
 static app_context_t *global_ctx = NULL;
+static uint64_t ring_drops = 0;
+static unsigned int filter_classes = 0;
+
+/* Frame offsets seen by the filter (Ethernet header, then IPv4) */
+#define BPF_OFF_IP        14
+#define BPF_OFF_FRAG      (BPF_OFF_IP + 6)
+#define BPF_OFF_PROTO     (BPF_OFF_IP + 9)
+#define BPF_OFF_TCP_FLAGS (BPF_OFF_IP + 13) /* Relative to the IP header length in X */
+
+/* Packet type and header checks, one test per class, reject, accept */
+#define BPF_MAX_INSNS (9 + FLOOD_CLASS_COUNT + 2)
+
+/* Build the kernel-side filter for the given classes, equivalent to
+ * engine_parse_ipv4(): not sent by this host, not a later fragment, and udp or icmp when those
+ * classes are on, or tcp whose tcp[tcpflags] & (tcp-syn|tcp-rst|tcp-ack)
+ * is an enabled flag class (see engine_tcp_class()) */
+static unsigned short build_filter(unsigned int classes, struct sock_filter *code) {
+    /* TCP classes: flags masked to SYN|RST|ACK, jeq per class, RST matches any.
+     * Protocol classes: jeq on the IP protocol. */
+    static const uint8_t class_match[FLOOD_CLASS_COUNT] = {
+        [FLOOD_CLASS_SYN] = ENGINE_TCP_SYN,
+        [FLOOD_CLASS_SYNACK] = ENGINE_TCP_SYN | ENGINE_TCP_ACK,
+        [FLOOD_CLASS_ACK] = ENGINE_TCP_ACK,
+        [FLOOD_CLASS_RST] = ENGINE_TCP_RST,
+        [FLOOD_CLASS_UDP] = IPPROTO_UDP,
+        [FLOOD_CLASS_ICMP] = IPPROTO_ICMP,
+    };
+
+    unsigned short tests = 0;
+    for (unsigned int c = 0; c < FLOOD_CLASS_COUNT; c++) {
+        if (classes & (1u << c)) {
+            tests++;
+        }
+    }
 
-/* BPF filter for TCP SYN packets only
- * This filters at kernel level before copying to userspace
- * Filter: tcp and tcp[tcpflags] & tcp-syn != 0 and tcp[tcpflags] & tcp-ack == 0
- */
-static struct sock_filter bpf_code[] = {
-    /* Load protocol (IP header offset 9) */
-    { 0x30, 0, 0, 0x00000017 },  /* ldh [23] - load protocol */
-    { 0x15, 0, 8, 0x00000006 },  /* jeq #6 (TCP), else skip */
+    /* Jump offsets count from the next instruction */
+    const unsigned short reject = 9 + tests;
+    unsigned short n = 0;
+
+    /* A packet socket also sees the host's own transmissions: its replies
+     * must not count against its own address */
+    code[n] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF + SKF_AD_PKTTYPE);
+    n++;
+    code[n] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, PACKET_OUTGOING,
+                                           reject - n - 1, 0);
+    n++;
+    code[n] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_H | BPF_ABS, BPF_OFF_FRAG);
+    n++;
+    code[n] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1fff, reject - n - 1, 0);
+    n++;
+    code[n] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_B | BPF_ABS, BPF_OFF_PROTO);
+    n++;
+
+    /* Taken branches land on the accept after the reject */
+    for (unsigned int c = FLOOD_CLASS_FIRST_PROTO; c < FLOOD_CLASS_COUNT; c++) {
+        if (classes & (1u << c)) {
+            code[n] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, class_match[c],
+                                                   reject - n, 0);
+            n++;
+        }
+    }
 
-    /* Load TCP flags (offset 13 in TCP header) */
-    { 0x30, 0, 0, 0x00000021 },  /* ldb [33] - load TCP flags */
+    code[n] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_TCP, 0,
+                                           reject - n - 1);
+    n++;
+    code[n] = (struct sock_filter)BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, BPF_OFF_IP);
+    n++;
+    code[n] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_B | BPF_IND, BPF_OFF_TCP_FLAGS);
+    n++;
+    code[n] = (struct sock_filter)BPF_STMT(BPF_ALU | BPF_AND | BPF_K,
+                                           ENGINE_TCP_SYN | ENGINE_TCP_RST | ENGINE_TCP_ACK);
+    n++;
+
+    for (unsigned int c = 0; c < FLOOD_CLASS_FIRST_PROTO; c++) {
+        if (classes & (1u << c)) {
+            uint16_t op = BPF_JMP | (c == FLOOD_CLASS_RST ? BPF_JSET : BPF_JEQ) | BPF_K;
+            code[n] = (struct sock_filter)BPF_JUMP(op, class_match[c], reject - n, 0);
+            n++;
+        }
+    }
 
-    /* Check for SYN flag (0x02) */
-    { 0x45, 6, 0, 0x00000002 },  /* jset #0x02, else skip */
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0);
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0xffffffff);
 
-    /* Check that ACK flag (0x10) is NOT set */
-    { 0x45, 0, 5, 0x00000010 },  /* jset #0x10, skip if set */
+    return n;
+}
 
-    /* Accept packet */
-    { 0x06, 0, 0, 0xffffffff },  /* ret #-1 (accept) */
+/* Feed the overload controller with socket drop counters and publish its state */
+static void overload_tick(app_context_t *ctx, uint64_t now) {
+    struct tpacket_stats stats;
+    socklen_t len = sizeof(stats);
 
-    /* Reject packet */
-    { 0x06, 0, 0, 0x00000000 },  /* ret #0 (reject) */
-};
+    /* Counters reset on every read, so accumulate them */
+    if (getsockopt(raw_sock_fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) == 0) {
+        ring_drops += stats.tp_drops;
+    }
 
-static struct sock_fprog bpf_prog = {
-    .len = sizeof(bpf_code) / sizeof(bpf_code[0]),
-    .filter = bpf_code,
-};
+    overload_update(ring_drops, 0, now);
 
-/* Process a SYN packet - same logic as NFQUEUE */
-static void process_syn_packet_raw(app_context_t *ctx, uint32_t src_ip) {
-    /* Step 1: Whitelist check */
-    if (whitelist_check(ctx->whitelist_root, src_ip)) {
-        pthread_mutex_lock(&ctx->metrics_lock);
-        ctx->metrics.whitelist_hits_total++;
-        pthread_mutex_unlock(&ctx->metrics_lock);
-        return;
-    }
+    uint32_t rate;
+    uint64_t shed, drops_total;
+    overload_get_stats(&rate, &shed, &drops_total);
 
-    /* Step 2: Get or create tracker entry */
-    ip_tracker_t *tracker = tracker_get_or_create(ctx->tracker, src_ip);
-    if (!tracker) {
-        return;
-    }
+    pthread_mutex_lock(&ctx->metrics_lock);
+    ctx->metrics.sample_rate = rate;
+    ctx->metrics.shed_packets_total = shed;
+    ctx->metrics.capture_drops_total = drops_total;
+    pthread_mutex_unlock(&ctx->metrics_lock);
+}
 
-    /* Step 3: Sliding window rate calculation */
-    uint64_t current_time = get_monotonic_ns();
-    uint64_t window_ns = ms_to_ns(ctx->config->window_ms);
+synflood_ret_t rawsock_set_filter(int fd, unsigned int classes) {
+    struct sock_filter code[BPF_MAX_INSNS];
+    struct sock_fprog prog = {
+        .len = build_filter(classes, code),
+        .filter = code,
+    };
 
-    if (current_time - tracker->window_start_ns > window_ns) {
-        tracker->syn_count = 1;
-        tracker->window_start_ns = current_time;
-    } else {
-        tracker->syn_count++;
+    /* Replaces the previous filter atomically */
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0) {
+        LOG_ERROR("Failed to attach BPF filter to raw socket");
+        return SYNFLOOD_ERROR;
     }
 
-    tracker->last_seen_ns = current_time;
+    return SYNFLOOD_OK;
+}
 
-    /* Step 4: Threshold check */
-    if (tracker->syn_count > ctx->config->syn_threshold) {
-        if (!tracker->blocked) {
-            uint32_t syn_recv_count = procparse_count_syn_recv_from_ip(src_ip);
+int rawsock_open(unsigned int classes) {
+    /* Create raw socket (bound to the calling thread's network namespace) */
+    int fd = socket(AF_PACKET, SOCK_RAW | SOCK_CLOEXEC, htons(ETH_P_IP));
+    if (fd < 0) {
+        LOG_ERROR("Failed to create raw socket (need CAP_NET_RAW)");
+        return -1;
+    }
 
-            if (syn_recv_count > ctx->config->syn_threshold / 2) {
-                if (ipset_mgr_add(src_ip, ctx->config->block_duration_s) == SYNFLOOD_OK) {
-                    tracker->blocked = 1;
-                    tracker->block_expiry_ns = current_time +
-                                               sec_to_ns(ctx->config->block_duration_s);
+#ifdef PACKET_IGNORE_OUTGOING
+    /* The host's own DNS, NTP and ICMP traffic is not even queued (Linux
+     * 4.20+); on older kernels the filter's packet-type check rejects it */
+    int one = 1;
+    if (setsockopt(fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &one, sizeof(one)) < 0) {
+        LOG_DEBUG("PACKET_IGNORE_OUTGOING unavailable, relying on the BPF filter");
+    }
+#endif
 
-                    logger_log_event(EVENT_BLOCKED, src_ip, tracker->syn_count, syn_recv_count);
+    if (rawsock_set_filter(fd, classes) != SYNFLOOD_OK) {
+        close(fd);
+        return -1;
+    }
 
-                    pthread_mutex_lock(&ctx->metrics_lock);
-                    ctx->metrics.detections_total++;
-                    ctx->metrics.blocked_ips_current = ipset_mgr_get_count();
-                    pthread_mutex_unlock(&ctx->metrics_lock);
-                }
-            } else {
-                logger_log_event(EVENT_SUSPICIOUS, src_ip, tracker->syn_count, syn_recv_count);
+    return fd;
+}
 
-                pthread_mutex_lock(&ctx->metrics_lock);
-                ctx->metrics.false_positives_total++;
-                pthread_mutex_unlock(&ctx->metrics_lock);
-            }
-        }
+bool rawsock_parse(const unsigned char *frame, size_t len, engine_packet_t *pkt) {
+    /* Skip Ethernet header */
+    if (len < sizeof(struct ethhdr)) {
+        return false;
     }
 
-    pthread_mutex_lock(&ctx->metrics_lock);
-    ctx->metrics.syn_packets_total++;
-    pthread_mutex_unlock(&ctx->metrics_lock);
+    return engine_parse_ipv4(frame + sizeof(struct ethhdr), len - sizeof(struct ethhdr), pkt);
 }
 
 synflood_ret_t rawsock_init(app_context_t *ctx) {
@@ -123,27 +188,35 @@ synflood_ret_t rawsock_init(app_context_t *ctx) {
     }
 
     global_ctx = ctx;
+    ring_drops = 0;
+    overload_init(ctx->config->overload_max_sample);
 
-    /* Create raw socket */
-    raw_sock_fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_IP));
+    filter_classes = engine_flood_classes(ctx->config);
+    raw_sock_fd = rawsock_open(filter_classes);
     if (raw_sock_fd < 0) {
-        LOG_ERROR("Failed to create raw socket (need CAP_NET_RAW)");
         return SYNFLOOD_ERROR;
     }
 
-    /* Attach BPF filter */
-    if (setsockopt(raw_sock_fd, SOL_SOCKET, SO_ATTACH_FILTER, &bpf_prog, sizeof(bpf_prog)) < 0) {
-        LOG_ERROR("Failed to attach BPF filter to raw socket");
-        close(raw_sock_fd);
-        raw_sock_fd = -1;
-        return SYNFLOOD_ERROR;
-    }
+    overload_set_recv_timeout(raw_sock_fd);
 
     LOG_INFO("Raw socket initialized: fd=%d (BPF filter attached)", raw_sock_fd);
 
     return SYNFLOOD_OK;
 }
 
+void rawsock_reload(const synflood_config_t *config) {
+    unsigned int classes = engine_flood_classes(config);
+
+    if (raw_sock_fd < 0 || classes == filter_classes) {
+        return;
+    }
+
+    if (rawsock_set_filter(raw_sock_fd, classes) == SYNFLOOD_OK) {
+        filter_classes = classes;
+        LOG_INFO("Raw socket BPF filter updated for the configured flag classes");
+    }
+}
+
 synflood_ret_t rawsock_start(app_context_t *ctx) {
     if (!ctx || raw_sock_fd < 0) {
         return SYNFLOOD_ERROR;
@@ -155,11 +228,26 @@ synflood_ret_t rawsock_start(app_context_t *ctx) {
     ssize_t packet_len;
     uint32_t packet_count = 0;
 
+    /* The engine walks the live whitelist; each iteration is a quiescent point */
+    whitelist_reader_online();
+
     while (ctx->running) {
+        whitelist_quiescent();
         packet_len = recvfrom(raw_sock_fd, buffer, sizeof(buffer), 0, NULL, NULL);
+        if (packet_len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            /* Receive timeout: idle, but signals and the controller still run */
+            handle_signals();
+            packet_count = 0;
+            uint64_t now = get_monotonic_ns();
+            if (overload_tick_due(now)) {
+                overload_tick(ctx, now);
+            }
+            continue;
+        }
         if (packet_len < 0) {
             if (ctx->running) {
                 LOG_ERROR("recvfrom() failed on raw socket");
+                whitelist_reader_offline();
                 return SYNFLOOD_ERROR;
             }
             break;
@@ -170,32 +258,32 @@ synflood_ret_t rawsock_start(app_context_t *ctx) {
         ctx->metrics.packets_total++;
         pthread_mutex_unlock(&ctx->metrics_lock);
 
-        /* Skip Ethernet header */
-        if (packet_len < sizeof(struct ethhdr) + sizeof(struct iphdr)) {
+        engine_packet_t pkt;
+        if (!rawsock_parse(buffer, (size_t)packet_len, &pkt)) {
             continue;
         }
 
-        unsigned char *ip_packet = buffer + sizeof(struct ethhdr);
-        struct iphdr *iph = (struct iphdr *)ip_packet;
-
-        /* Verify it's IPv4 and TCP */
-        if (iph->version != 4 || iph->protocol != IPPROTO_TCP) {
-            continue;
+        /* Load shedding: under overload only 1-in-N packets are analysed */
+        pkt.weight = overload_sample(pkt.src_ip);
+        if (pkt.weight != 0) {
+            bool fastpath = false;
+            engine_process_syn(ctx, &pkt, &fastpath);
         }
 
-        /* Extract source IP */
-        uint32_t src_ip = iph->saddr;
-
-        /* Process SYN packet */
-        process_syn_packet_raw(ctx, src_ip);
-
         /* Check for signals periodically (every 1000 packets) */
         if (++packet_count >= 1000) {
             handle_signals();
             packet_count = 0;
         }
+
+        /* The controller ticks on time, so light traffic still relaxes it */
+        uint64_t now = get_monotonic_ns();
+        if (overload_tick_due(now)) {
+            overload_tick(ctx, now);
+        }
     }
 
+    whitelist_reader_offline();
     LOG_INFO("Raw socket packet capture loop stopped");
 
     return SYNFLOOD_OK;
@@ -7,6 +7,33 @@
 #define SYNFLOOD_RAWSOCK_H
 
 #include "common.h"
+#include "../analysis/engine.h"
+
+/**
+ * Open an AF_PACKET socket with a BPF filter for the given TCP flag
+ * classes attached. The socket captures in the network namespace of the
+ * calling thread.
+ * @param classes Bit mask of 1 << flood_class_t, see engine_flood_classes()
+ * @return Socket file descriptor, or -1 on error
+ */
+int rawsock_open(unsigned int classes);
+
+/**
+ * Replace the BPF filter of a rawsock_open() socket
+ * @param fd Socket
+ * @param classes Bit mask of 1 << flood_class_t
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t rawsock_set_filter(int fd, unsigned int classes);
+
+/**
+ * Extract the engine fields from a captured Ethernet frame
+ * @param frame Frame as received from a rawsock_open() socket
+ * @param len Frame length
+ * @param pkt Output: packet fields (weight is not set)
+ * @return true if the frame is an IPv4 TCP packet with a complete TCP header
+ */
+bool rawsock_parse(const unsigned char *frame, size_t len, engine_packet_t *pkt);
 
 /**
  * Initialize raw socket capture
@@ -15,6 +42,12 @@
  */
 synflood_ret_t rawsock_init(app_context_t *ctx);
 
+/**
+ * Apply the flag classes of a reloaded configuration to the capture filter
+ * @param config New configuration
+ */
+void rawsock_reload(const synflood_config_t *config);
+
 /**
  * Start raw socket packet capture loop
  * @param ctx Application context
@@ -0,0 +1,99 @@
+/*
+ * clock.c - Time sources for get_monotonic_ns()
+ * TCP SYN Flood Detector
+ */
+
+#include "clock.h"
+
+synflood_clock_t *synflood_clock = NULL;
+
+/* Cached clock: refreshed by its own thread */
+typedef struct
+{
+    synflood_clock_t base;
+    uint64_t now;
+} clock_cached_t;
+
+static clock_cached_t cached_clock;
+static pthread_t cached_thread;
+static volatile bool cached_running = false;
+static uint32_t cached_resolution_us = 0;
+
+void clock_install(synflood_clock_t *clock) {
+    __atomic_store_n(&synflood_clock, clock, __ATOMIC_RELEASE);
+}
+
+static uint64_t virtual_now(synflood_clock_t *clock) {
+    return __atomic_load_n(&((clock_virtual_t *)clock)->now, __ATOMIC_ACQUIRE);
+}
+
+void clock_virtual_start(clock_virtual_t *clock, uint64_t start_ns) {
+    clock->base.now_ns = virtual_now;
+    __atomic_store_n(&clock->now, start_ns, __ATOMIC_RELEASE);
+    clock_install(&clock->base);
+}
+
+uint64_t clock_virtual_advance(clock_virtual_t *clock, uint64_t delta_ns) {
+    return __atomic_add_fetch(&clock->now, delta_ns, __ATOMIC_ACQ_REL);
+}
+
+void clock_virtual_set(clock_virtual_t *clock, uint64_t now_ns) {
+    uint64_t current = __atomic_load_n(&clock->now, __ATOMIC_ACQUIRE);
+    while (now_ns > current &&
+           !__atomic_compare_exchange_n(&clock->now, &current, now_ns, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    }
+}
+
+static uint64_t cached_now(synflood_clock_t *clock) {
+    return __atomic_load_n(&((clock_cached_t *)clock)->now, __ATOMIC_RELAXED);
+}
+
+static void *cached_thread_func(void *arg) {
+    (void)arg;
+
+    struct timespec tick = {
+        .tv_sec = cached_resolution_us / 1000000,
+        .tv_nsec = (long)(cached_resolution_us % 1000000) * 1000,
+    };
+
+    while (cached_running) {
+        __atomic_store_n(&cached_clock.now, clock_system_ns(), __ATOMIC_RELAXED);
+        nanosleep(&tick, NULL);
+    }
+
+    return NULL;
+}
+
+synflood_ret_t clock_cached_start(uint32_t resolution_us) {
+    if (resolution_us == 0) {
+        return SYNFLOOD_EINVAL;
+    }
+    if (cached_running) {
+        return SYNFLOOD_OK;
+    }
+
+    cached_resolution_us = resolution_us;
+    cached_clock.base.now_ns = cached_now;
+    __atomic_store_n(&cached_clock.now, clock_system_ns(), __ATOMIC_RELAXED);
+    cached_running = true;
+
+    if (pthread_create(&cached_thread, NULL, cached_thread_func, NULL) != 0) {
+        cached_running = false;
+        return SYNFLOOD_ERROR;
+    }
+
+    clock_install(&cached_clock.base);
+
+    return SYNFLOOD_OK;
+}
+
+void clock_cached_stop(void) {
+    if (!cached_running) {
+        return;
+    }
+
+    clock_install(NULL);
+    cached_running = false;
+    pthread_join(cached_thread, NULL);
+}
@@ -0,0 +1,71 @@
+/*
+ * clock.h - Time sources for get_monotonic_ns()
+ * TCP SYN Flood Detector
+ *
+ * Every timestamp in the pipeline (tracker windows and LRU, block expiry,
+ * victim hold, peer sync pacing, control uptime) comes from
+ * get_monotonic_ns(), which reads the installed time source:
+ *
+ *   - none (default): CLOCK_MONOTONIC on every call
+ *   - cached: a background thread refreshes the time every
+ *     clock_resolution_us, so a reading is a single load
+ *   - virtual: time moves only when the caller advances it, so tests,
+ *     simulations and benchmarks replay hours of traffic in milliseconds
+ *
+ * Sleeps (expiry and peer sync intervals) stay on the system clock;
+ * simulations call the periodic functions directly instead.
+ */
+
+#ifndef SYNFLOOD_CLOCK_H
+#define SYNFLOOD_CLOCK_H
+
+#include "common.h"
+
+/* Clock that only moves when told to */
+typedef struct
+{
+    synflood_clock_t base;
+    uint64_t now;
+} clock_virtual_t;
+
+/**
+ * Install a time source for get_monotonic_ns()
+ * @param clock Time source, or NULL for CLOCK_MONOTONIC
+ */
+void clock_install(synflood_clock_t *clock);
+
+/**
+ * Initialize a virtual clock and install it
+ * @param clock Virtual clock (must outlive its installation)
+ * @param start_ns Initial time (ns)
+ */
+void clock_virtual_start(clock_virtual_t *clock, uint64_t start_ns);
+
+/**
+ * Move a virtual clock forward
+ * @param clock Virtual clock
+ * @param delta_ns Time to add (ns)
+ * @return New time (ns)
+ */
+uint64_t clock_virtual_advance(clock_virtual_t *clock, uint64_t delta_ns);
+
+/**
+ * Set a virtual clock (never backwards)
+ * @param clock Virtual clock
+ * @param now_ns New time (ns); ignored if before the current time
+ */
+void clock_virtual_set(clock_virtual_t *clock, uint64_t now_ns);
+
+/**
+ * Start the cached clock and install it
+ * @param resolution_us Refresh interval (microseconds, > 0)
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t clock_cached_start(uint32_t resolution_us);
+
+/**
+ * Stop the cached clock and go back to CLOCK_MONOTONIC
+ */
+void clock_cached_stop(void);
+
+#endif /* SYNFLOOD_CLOCK_H */
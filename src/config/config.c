@@ -4,11 +4,44 @@
  */
 
 #include "config.h"
+#include "../analysis/scan.h"
 #include <libconfig.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <arpa/inet.h>
+
+/* Parse "a.b.c.d" or "a.b.c.d:port" (default_port when omitted) */
+static synflood_ret_t config_parse_peer(const char *str, uint16_t default_port, peer_addr_t *peer) {
+    char host[INET_ADDRSTRLEN];
+    const char *colon = strchr(str, ':');
+    size_t host_len = colon ? (size_t)(colon - str) : strlen(str);
+    struct in_addr addr;
+
+    if (host_len == 0 || host_len >= sizeof(host)) {
+        return SYNFLOOD_EINVAL;
+    }
+    memcpy(host, str, host_len);
+    host[host_len] = '\0';
+
+    if (inet_pton(AF_INET, host, &addr) != 1) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    peer->ip = addr.s_addr;
+    peer->port = default_port;
+    if (colon) {
+        char *end;
+        long port = strtol(colon + 1, &end, 10);
+        if (*end != '\0' || port <= 0 || port > 65535) {
+            return SYNFLOOD_EINVAL;
+        }
+        peer->port = (uint16_t)port;
+    }
+
+    return SYNFLOOD_OK;
+}
 
 log_level_t config_parse_log_level(const char *level_str) {
     if (strcmp(level_str, "debug") == 0) {
@@ -37,13 +70,52 @@ synflood_ret_t config_load(const char *path, synflood_config_t *config) {
     config->window_ms = DEFAULT_WINDOW_MS;
     config->block_duration_s = DEFAULT_BLOCK_DURATION_S;
     config->proc_check_interval_s = DEFAULT_PROC_CHECK_INTERVAL_S;
+    config->validate_syn_recv = true;
+    config->synack_threshold = 0;
+    config->ack_threshold = 0;
+    config->rst_threshold = 0;
+    config->udp_threshold = 0;
+    config->icmp_threshold = 0;
+    config->victim_threshold = 0;
+    config->victim_source_threshold = DEFAULT_VICTIM_SOURCE_THRESHOLD;
+    config->victim_hold_s = DEFAULT_VICTIM_HOLD_S;
+    config->scan_port_threshold = 0;
+    config->scan_host_threshold = 0;
+    config->scan_window_s = DEFAULT_SCAN_WINDOW_S;
+    config->scan_block = false;
+    config->asn_threshold = 0;
+    config->asn_source_threshold = DEFAULT_ASN_SOURCE_THRESHOLD;
+    config->asn_hold_s = DEFAULT_ASN_HOLD_S;
+    config->asn_block = false;
+    config->clock_resolution_us = 0;
     config->max_tracked_ips = DEFAULT_MAX_TRACKED_IPS;
     config->hash_buckets = DEFAULT_HASH_BUCKETS;
+    config->max_tracked_victims = DEFAULT_MAX_TRACKED_VICTIMS;
+    config->max_tracked_scanners = DEFAULT_MAX_TRACKED_SCANNERS;
+    config->max_tracked_asns = DEFAULT_MAX_TRACKED_ASNS;
+    config->idle_timeout_s = 0;
     config->nfqueue_num = DEFAULT_NFQUEUE_NUM;
     config->use_raw_socket = false;
+    config->inpath_drop = false;
+    config->compact_min_prefix = 0;
+    config->compact_min_density = DEFAULT_COMPACT_MIN_DENSITY;
+    config->compact_min_entries = DEFAULT_COMPACT_MIN_ENTRIES;
+    config->fastpath_mark = 0;
+    config->fastpath_max_syn = DEFAULT_FASTPATH_MAX_SYN;
+    config->fastpath_timeout_s = DEFAULT_FASTPATH_TIMEOUT_S;
+    config->overload_max_sample = DEFAULT_OVERLOAD_MAX_SAMPLE;
+    config->netns_count = 0;
+    config->netns_workers = DEFAULT_NETNS_WORKERS;
+    config->peersync_port = 0;
+    config->peersync_batch_ms = DEFAULT_PEERSYNC_BATCH_MS;
+    config->peersync_max_age_s = DEFAULT_PEERSYNC_MAX_AGE_S;
+    config->peersync_ttl = DEFAULT_PEERSYNC_TTL;
     config->log_level = LOG_LEVEL_INFO;
     config->use_syslog = true;
     strncpy(config->ipset_name, DEFAULT_IPSET_NAME, sizeof(config->ipset_name) - 1);
+    strncpy(config->compact_ipset, DEFAULT_COMPACT_IPSET_NAME, sizeof(config->compact_ipset) - 1);
+    strncpy(config->asn_ipset, DEFAULT_ASN_IPSET_NAME, sizeof(config->asn_ipset) - 1);
+    strncpy(config->fastpath_ipset, DEFAULT_FASTPATH_IPSET_NAME, sizeof(config->fastpath_ipset) - 1);
     strncpy(config->whitelist_file, DEFAULT_WHITELIST_PATH, sizeof(config->whitelist_file) - 1);
     strncpy(config->metrics_socket, DEFAULT_METRICS_SOCKET, sizeof(config->metrics_socket) - 1);
 
@@ -70,6 +142,64 @@ synflood_ret_t config_load(const char *path, synflood_config_t *config) {
         if (config_setting_lookup_int(detection, "proc_check_interval_s", &val) == CONFIG_TRUE) {
             config->proc_check_interval_s = (uint32_t)val;
         }
+        if (config_setting_lookup_bool(detection, "validate_syn_recv", &val) == CONFIG_TRUE) {
+            config->validate_syn_recv = (bool)val;
+        }
+        if (config_setting_lookup_int(detection, "synack_threshold", &val) == CONFIG_TRUE) {
+            config->synack_threshold = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(detection, "ack_threshold", &val) == CONFIG_TRUE) {
+            config->ack_threshold = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(detection, "rst_threshold", &val) == CONFIG_TRUE) {
+            config->rst_threshold = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(detection, "udp_threshold", &val) == CONFIG_TRUE) {
+            config->udp_threshold = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(detection, "icmp_threshold", &val) == CONFIG_TRUE) {
+            config->icmp_threshold = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(detection, "victim_threshold", &val) == CONFIG_TRUE) {
+            config->victim_threshold = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(detection, "victim_source_threshold", &val) == CONFIG_TRUE) {
+            config->victim_source_threshold = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(detection, "victim_hold_s", &val) == CONFIG_TRUE) {
+            config->victim_hold_s = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(detection, "scan_port_threshold", &val) == CONFIG_TRUE) {
+            config->scan_port_threshold = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(detection, "scan_host_threshold", &val) == CONFIG_TRUE) {
+            config->scan_host_threshold = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(detection, "scan_window_s", &val) == CONFIG_TRUE) {
+            config->scan_window_s = (uint32_t)val;
+        }
+        if (config_setting_lookup_bool(detection, "scan_block", &val) == CONFIG_TRUE) {
+            config->scan_block = (bool)val;
+        }
+        const char *asn_map_file;
+        if (config_setting_lookup_string(detection, "asn_map_file", &asn_map_file) == CONFIG_TRUE) {
+            strncpy(config->asn_map_file, asn_map_file, sizeof(config->asn_map_file) - 1);
+        }
+        if (config_setting_lookup_int(detection, "asn_threshold", &val) == CONFIG_TRUE) {
+            config->asn_threshold = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(detection, "asn_source_threshold", &val) == CONFIG_TRUE) {
+            config->asn_source_threshold = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(detection, "asn_hold_s", &val) == CONFIG_TRUE) {
+            config->asn_hold_s = (uint32_t)val;
+        }
+        if (config_setting_lookup_bool(detection, "asn_block", &val) == CONFIG_TRUE) {
+            config->asn_block = (bool)val;
+        }
+        if (config_setting_lookup_int(detection, "clock_resolution_us", &val) == CONFIG_TRUE) {
+            config->clock_resolution_us = (uint32_t)val;
+        }
     }
 
     /* Parse enforcement section */
@@ -83,6 +213,30 @@ synflood_ret_t config_load(const char *path, synflood_config_t *config) {
         if (config_setting_lookup_string(enforcement, "ipset_name", &str) == CONFIG_TRUE) {
             strncpy(config->ipset_name, str, sizeof(config->ipset_name) - 1);
         }
+        if (config_setting_lookup_bool(enforcement, "inpath_drop", &val) == CONFIG_TRUE) {
+            config->inpath_drop = (bool)val;
+        }
+        if (config_setting_lookup_string(enforcement, "udp_ipset", &str) == CONFIG_TRUE) {
+            strncpy(config->udp_ipset, str, sizeof(config->udp_ipset) - 1);
+        }
+        if (config_setting_lookup_string(enforcement, "icmp_ipset", &str) == CONFIG_TRUE) {
+            strncpy(config->icmp_ipset, str, sizeof(config->icmp_ipset) - 1);
+        }
+        if (config_setting_lookup_string(enforcement, "asn_ipset", &str) == CONFIG_TRUE) {
+            strncpy(config->asn_ipset, str, sizeof(config->asn_ipset) - 1);
+        }
+        if (config_setting_lookup_int(enforcement, "compact_min_prefix", &val) == CONFIG_TRUE) {
+            config->compact_min_prefix = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(enforcement, "compact_min_density", &val) == CONFIG_TRUE) {
+            config->compact_min_density = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(enforcement, "compact_min_entries", &val) == CONFIG_TRUE) {
+            config->compact_min_entries = (uint32_t)val;
+        }
+        if (config_setting_lookup_string(enforcement, "compact_ipset", &str) == CONFIG_TRUE) {
+            strncpy(config->compact_ipset, str, sizeof(config->compact_ipset) - 1);
+        }
     }
 
     /* Parse limits section */
@@ -95,18 +249,142 @@ synflood_ret_t config_load(const char *path, synflood_config_t *config) {
         if (config_setting_lookup_int(limits, "hash_buckets", &val) == CONFIG_TRUE) {
             config->hash_buckets = (uint32_t)val;
         }
+        if (config_setting_lookup_int(limits, "max_tracked_victims", &val) == CONFIG_TRUE) {
+            config->max_tracked_victims = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(limits, "max_tracked_scanners", &val) == CONFIG_TRUE) {
+            config->max_tracked_scanners = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(limits, "max_tracked_asns", &val) == CONFIG_TRUE) {
+            config->max_tracked_asns = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(limits, "idle_timeout_s", &val) == CONFIG_TRUE) {
+            config->idle_timeout_s = (uint32_t)val;
+        }
+        const char *str;
+        if (config_setting_lookup_string(limits, "tracker_shm", &str) == CONFIG_TRUE) {
+            strncpy(config->tracker_shm, str, sizeof(config->tracker_shm) - 1);
+        }
     }
 
     /* Parse capture section */
     config_setting_t *capture = config_lookup(&cfg_reader, "capture");
     if (capture) {
         int val;
+        const char *str;
         if (config_setting_lookup_int(capture, "nfqueue_num", &val) == CONFIG_TRUE) {
             config->nfqueue_num = (uint16_t)val;
         }
         if (config_setting_lookup_bool(capture, "use_raw_socket", &val) == CONFIG_TRUE) {
             config->use_raw_socket = (bool)val;
         }
+        if (config_setting_lookup_int(capture, "fastpath_mark", &val) == CONFIG_TRUE) {
+            config->fastpath_mark = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(capture, "fastpath_max_syn", &val) == CONFIG_TRUE) {
+            config->fastpath_max_syn = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(capture, "fastpath_timeout_s", &val) == CONFIG_TRUE) {
+            config->fastpath_timeout_s = (uint32_t)val;
+        }
+        if (config_setting_lookup_string(capture, "fastpath_ipset", &str) == CONFIG_TRUE) {
+            strncpy(config->fastpath_ipset, str, sizeof(config->fastpath_ipset) - 1);
+        }
+        if (config_setting_lookup_int(capture, "overload_max_sample", &val) == CONFIG_TRUE) {
+            config->overload_max_sample = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(capture, "netns_workers", &val) == CONFIG_TRUE) {
+            config->netns_workers = (uint32_t)val;
+        }
+    }
+
+    /* Parse namespaces list */
+    config_setting_t *namespaces = config_lookup(&cfg_reader, "namespaces");
+    if (namespaces) {
+        int count = config_setting_length(namespaces);
+        if (count > SYNFLOOD_MAX_NETNS) {
+            fprintf(stderr, "Too many namespaces: %d (max %d)\n", count, SYNFLOOD_MAX_NETNS);
+            config_destroy(&cfg_reader);
+            return SYNFLOOD_EINVAL;
+        }
+
+        for (int i = 0; i < count; i++) {
+            config_setting_t *entry = config_setting_get_elem(namespaces, (unsigned int)i);
+            netns_config_t *ns = &config->namespaces[config->netns_count++];
+            const char *str;
+            int val;
+
+            if (config_setting_lookup_string(entry, "name", &str) == CONFIG_TRUE) {
+                strncpy(ns->name, str, sizeof(ns->name) - 1);
+            }
+            if (config_setting_lookup_string(entry, "path", &str) == CONFIG_TRUE) {
+                strncpy(ns->path, str, sizeof(ns->path) - 1);
+            }
+            if (config_setting_lookup_int(entry, "syn_threshold", &val) == CONFIG_TRUE) {
+                ns->syn_threshold = (uint32_t)val;
+            }
+            if (config_setting_lookup_int(entry, "block_duration_s", &val) == CONFIG_TRUE) {
+                ns->block_duration_s = (uint32_t)val;
+            }
+            if (config_setting_lookup_string(entry, "ipset_name", &str) == CONFIG_TRUE) {
+                strncpy(ns->ipset_name, str, sizeof(ns->ipset_name) - 1);
+            }
+        }
+    }
+
+    /* Parse peer sync section */
+    config_setting_t *peersync = config_lookup(&cfg_reader, "peersync");
+    if (peersync) {
+        const char *str;
+        int val;
+        if (config_setting_lookup_int(peersync, "port", &val) == CONFIG_TRUE) {
+            if (val < 0 || val > 65535) {
+                fprintf(stderr, "Invalid peersync port: %d (must be 0-65535)\n", val);
+                config_destroy(&cfg_reader);
+                return SYNFLOOD_EINVAL;
+            }
+            config->peersync_port = (uint16_t)val;
+        }
+        if (config_setting_lookup_string(peersync, "group", &str) == CONFIG_TRUE) {
+            strncpy(config->peersync_group, str, sizeof(config->peersync_group) - 1);
+        }
+        if (config_setting_lookup_string(peersync, "bind", &str) == CONFIG_TRUE) {
+            strncpy(config->peersync_bind, str, sizeof(config->peersync_bind) - 1);
+        }
+        if (config_setting_lookup_string(peersync, "key_file", &str) == CONFIG_TRUE) {
+            strncpy(config->peersync_key_file, str, sizeof(config->peersync_key_file) - 1);
+        }
+        if (config_setting_lookup_int(peersync, "batch_ms", &val) == CONFIG_TRUE) {
+            config->peersync_batch_ms = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(peersync, "max_age_s", &val) == CONFIG_TRUE) {
+            config->peersync_max_age_s = (uint32_t)val;
+        }
+        if (config_setting_lookup_int(peersync, "ttl", &val) == CONFIG_TRUE) {
+            config->peersync_ttl = (uint32_t)val;
+        }
+
+        config_setting_t *peers = config_setting_get_member(peersync, "peers");
+        if (peers) {
+            int count = config_setting_length(peers);
+            if (count > SYNFLOOD_MAX_PEERS) {
+                fprintf(stderr, "Too many peersync peers: %d (max %d)\n", count, SYNFLOOD_MAX_PEERS);
+                config_destroy(&cfg_reader);
+                return SYNFLOOD_EINVAL;
+            }
+
+            for (int i = 0; i < count; i++) {
+                str = config_setting_get_string_elem(peers, (unsigned int)i);
+                peer_addr_t *peer = &config->peersync_peers[config->peersync_peer_count];
+                if (!str || config_parse_peer(str, config->peersync_port, peer) != SYNFLOOD_OK) {
+                    fprintf(stderr, "Invalid peersync peer: %s (expected address[:port])\n",
+                            str ? str : "(not a string)");
+                    config_destroy(&cfg_reader);
+                    return SYNFLOOD_EINVAL;
+                }
+                config->peersync_peer_count++;
+            }
+        }
     }
 
     /* Parse whitelist section */
@@ -151,6 +429,36 @@ synflood_ret_t config_validate(const synflood_config_t *config) {
         return SYNFLOOD_EINVAL;
     }
 
+    if (config->synack_threshold > 1000000) {
+        fprintf(stderr, "Invalid synack_threshold: %u (must be 0-1000000, 0 = disabled)\n",
+                config->synack_threshold);
+        return SYNFLOOD_EINVAL;
+    }
+
+    if (config->ack_threshold > 1000000) {
+        fprintf(stderr, "Invalid ack_threshold: %u (must be 0-1000000, 0 = disabled)\n",
+                config->ack_threshold);
+        return SYNFLOOD_EINVAL;
+    }
+
+    if (config->rst_threshold > 1000000) {
+        fprintf(stderr, "Invalid rst_threshold: %u (must be 0-1000000, 0 = disabled)\n",
+                config->rst_threshold);
+        return SYNFLOOD_EINVAL;
+    }
+
+    if (config->udp_threshold > 1000000) {
+        fprintf(stderr, "Invalid udp_threshold: %u (must be 0-1000000, 0 = disabled)\n",
+                config->udp_threshold);
+        return SYNFLOOD_EINVAL;
+    }
+
+    if (config->icmp_threshold > 1000000) {
+        fprintf(stderr, "Invalid icmp_threshold: %u (must be 0-1000000, 0 = disabled)\n",
+                config->icmp_threshold);
+        return SYNFLOOD_EINVAL;
+    }
+
     if (config->window_ms == 0 || config->window_ms > 60000) {
         fprintf(stderr, "Invalid window_ms: %u (must be 1-60000)\n", config->window_ms);
         return SYNFLOOD_EINVAL;
@@ -178,6 +486,217 @@ synflood_ret_t config_validate(const synflood_config_t *config) {
         return SYNFLOOD_EINVAL;
     }
 
+    /* Idle entries must outlive a detection window */
+    if (config->idle_timeout_s != 0 &&
+        (uint64_t)config->idle_timeout_s * MSEC_PER_SEC <= config->window_ms) {
+        fprintf(stderr, "Invalid idle_timeout_s: %u (must be longer than window_ms, or 0)\n",
+                config->idle_timeout_s);
+        return SYNFLOOD_EINVAL;
+    }
+
+    /* Shared tracker name: a single POSIX shm name component */
+    if (config->tracker_shm[0] != '\0' &&
+        (config->tracker_shm[0] != '/' || strchr(config->tracker_shm + 1, '/') != NULL ||
+         config->tracker_shm[1] == '\0')) {
+        fprintf(stderr, "Invalid tracker_shm: %s (must be \"/name\" without further slashes)\n",
+                config->tracker_shm);
+        return SYNFLOOD_EINVAL;
+    }
+
+    if (config->clock_resolution_us != 0 &&
+        (config->clock_resolution_us < 10 || config->clock_resolution_us > 100000)) {
+        fprintf(stderr, "Invalid clock_resolution_us: %u (must be 10-100000, or 0)\n",
+                config->clock_resolution_us);
+        return SYNFLOOD_EINVAL;
+    }
+
+    /* Validate victim detection (only when enabled) */
+    if (config->victim_threshold != 0) {
+        if (config->victim_source_threshold == 0) {
+            fprintf(stderr, "Invalid victim_source_threshold: must be at least 1\n");
+            return SYNFLOOD_EINVAL;
+        }
+        if (config->victim_hold_s == 0 || config->victim_hold_s > 3600) {
+            fprintf(stderr, "Invalid victim_hold_s: %u (must be 1-3600)\n", config->victim_hold_s);
+            return SYNFLOOD_EINVAL;
+        }
+        if (config->max_tracked_victims == 0 || config->max_tracked_victims > 65536 ||
+            (config->max_tracked_victims & (config->max_tracked_victims - 1)) != 0) {
+            fprintf(stderr, "Invalid max_tracked_victims: %u (must be power of 2, max 65536)\n",
+                    config->max_tracked_victims);
+            return SYNFLOOD_EINVAL;
+        }
+    }
+
+    /* Validate port scan detection (only when enabled) */
+    if (config->scan_port_threshold != 0 || config->scan_host_threshold != 0) {
+        if (config->scan_port_threshold > SCAN_MAX_THRESHOLD ||
+            config->scan_host_threshold > SCAN_MAX_THRESHOLD) {
+            fprintf(stderr, "Invalid scan threshold: must be at most %d distinct ports/hosts\n",
+                    SCAN_MAX_THRESHOLD);
+            return SYNFLOOD_EINVAL;
+        }
+        if (config->scan_window_s == 0 || config->scan_window_s > 3600) {
+            fprintf(stderr, "Invalid scan_window_s: %u (must be 1-3600)\n", config->scan_window_s);
+            return SYNFLOOD_EINVAL;
+        }
+        if (config->max_tracked_scanners == 0 || config->max_tracked_scanners > 65536 ||
+            (config->max_tracked_scanners & (config->max_tracked_scanners - 1)) != 0) {
+            fprintf(stderr, "Invalid max_tracked_scanners: %u (must be power of 2, max 65536)\n",
+                    config->max_tracked_scanners);
+            return SYNFLOOD_EINVAL;
+        }
+    }
+
+    /* Validate origin AS tracking (only when enabled) */
+    if (config->asn_map_file[0] != '\0') {
+        if (config->asn_threshold > 10000000) {
+            fprintf(stderr, "Invalid asn_threshold: %u (must be 0-10000000, 0 = rates only)\n",
+                    config->asn_threshold);
+            return SYNFLOOD_EINVAL;
+        }
+        if (config->asn_source_threshold == 0) {
+            fprintf(stderr, "Invalid asn_source_threshold: must be at least 1\n");
+            return SYNFLOOD_EINVAL;
+        }
+        if (config->asn_hold_s == 0 || config->asn_hold_s > 3600) {
+            fprintf(stderr, "Invalid asn_hold_s: %u (must be 1-3600)\n", config->asn_hold_s);
+            return SYNFLOOD_EINVAL;
+        }
+        if (config->max_tracked_asns == 0 || config->max_tracked_asns > 65536 ||
+            (config->max_tracked_asns & (config->max_tracked_asns - 1)) != 0) {
+            fprintf(stderr, "Invalid max_tracked_asns: %u (must be power of 2, max 65536)\n",
+                    config->max_tracked_asns);
+            return SYNFLOOD_EINVAL;
+        }
+        if (config->asn_block && (strlen(config->asn_ipset) == 0 ||
+                                  strcmp(config->asn_ipset, config->ipset_name) == 0)) {
+            fprintf(stderr, "Invalid asn_ipset: must be set and differ from ipset_name\n");
+            return SYNFLOOD_EINVAL;
+        }
+    }
+
+    /* Validate blocklist compaction (only when enabled) */
+    if (config->compact_min_prefix != 0) {
+        if (config->compact_min_prefix < 8 || config->compact_min_prefix > 31) {
+            fprintf(stderr, "Invalid compact_min_prefix: %u (must be 8-31, or 0 to disable)\n",
+                    config->compact_min_prefix);
+            return SYNFLOOD_EINVAL;
+        }
+        if (config->compact_min_density == 0 || config->compact_min_density > 100) {
+            fprintf(stderr, "Invalid compact_min_density: %u (must be 1-100)\n",
+                    config->compact_min_density);
+            return SYNFLOOD_EINVAL;
+        }
+        if (strlen(config->compact_ipset) == 0 ||
+            strcmp(config->compact_ipset, config->ipset_name) == 0) {
+            fprintf(stderr, "Invalid compact_ipset: must be set and differ from ipset_name\n");
+            return SYNFLOOD_EINVAL;
+        }
+    }
+
+    /* Validate fast path (only when enabled) */
+    if (config->fastpath_mark != 0) {
+        if (config->fastpath_timeout_s == 0 || config->fastpath_timeout_s > 86400) {
+            fprintf(stderr, "Invalid fastpath_timeout_s: %u (must be 1-86400)\n", config->fastpath_timeout_s);
+            return SYNFLOOD_EINVAL;
+        }
+        if (strlen(config->fastpath_ipset) == 0) {
+            fprintf(stderr, "Invalid fastpath_ipset: cannot be empty\n");
+            return SYNFLOOD_EINVAL;
+        }
+    }
+
+    /* Validate load shedding (0 and 1 both disable it) */
+    if (config->overload_max_sample > 4096 ||
+        (config->overload_max_sample & (config->overload_max_sample - 1)) != 0) {
+        fprintf(stderr, "Invalid overload_max_sample: %u (must be power of 2, max 4096)\n",
+                config->overload_max_sample);
+        return SYNFLOOD_EINVAL;
+    }
+
+    /* Validate namespaces (only when configured) */
+    if (config->netns_count > 0) {
+        if (config->netns_count > SYNFLOOD_MAX_NETNS) {
+            fprintf(stderr, "Too many namespaces: %u (max %d)\n", config->netns_count, SYNFLOOD_MAX_NETNS);
+            return SYNFLOOD_EINVAL;
+        }
+        if (config->netns_workers == 0 || config->netns_workers > 64) {
+            fprintf(stderr, "Invalid netns_workers: %u (must be 1-64)\n", config->netns_workers);
+            return SYNFLOOD_EINVAL;
+        }
+
+        for (uint32_t i = 0; i < config->netns_count; i++) {
+            const netns_config_t *ns = &config->namespaces[i];
+
+            if (ns->name[0] == '\0' || ns->path[0] == '\0') {
+                fprintf(stderr, "Invalid namespace %u: name and path are required\n", i);
+                return SYNFLOOD_EINVAL;
+            }
+            if (ns->syn_threshold > 1000000) {
+                fprintf(stderr, "Invalid syn_threshold for namespace %s: %u (must be 1-1000000)\n",
+                        ns->name, ns->syn_threshold);
+                return SYNFLOOD_EINVAL;
+            }
+            if (ns->block_duration_s > 86400) {
+                fprintf(stderr, "Invalid block_duration_s for namespace %s: %u (must be 1-86400)\n",
+                        ns->name, ns->block_duration_s);
+                return SYNFLOOD_EINVAL;
+            }
+            for (uint32_t j = 0; j < i; j++) {
+                if (strcmp(config->namespaces[j].name, ns->name) == 0) {
+                    fprintf(stderr, "Duplicate namespace name: %s\n", ns->name);
+                    return SYNFLOOD_EINVAL;
+                }
+            }
+        }
+    }
+
+    /* Validate peer sync (only when enabled) */
+    if (config->peersync_port != 0) {
+        struct in_addr addr;
+
+        if (config->peersync_group[0] == '\0' && config->peersync_peer_count == 0) {
+            fprintf(stderr, "Invalid peersync: a multicast group or at least one peer is required\n");
+            return SYNFLOOD_EINVAL;
+        }
+        if (config->peersync_group[0] != '\0' &&
+            (inet_pton(AF_INET, config->peersync_group, &addr) != 1 ||
+             !IN_MULTICAST(ntohl(addr.s_addr)))) {
+            fprintf(stderr, "Invalid peersync group: %s (must be an IPv4 multicast address)\n",
+                    config->peersync_group);
+            return SYNFLOOD_EINVAL;
+        }
+        if (config->peersync_bind[0] != '\0' &&
+            inet_pton(AF_INET, config->peersync_bind, &addr) != 1) {
+            fprintf(stderr, "Invalid peersync bind: %s\n", config->peersync_bind);
+            return SYNFLOOD_EINVAL;
+        }
+        if (config->peersync_peer_count > SYNFLOOD_MAX_PEERS) {
+            fprintf(stderr, "Too many peersync peers: %u (max %d)\n",
+                    config->peersync_peer_count, SYNFLOOD_MAX_PEERS);
+            return SYNFLOOD_EINVAL;
+        }
+        if (config->peersync_key_file[0] == '\0') {
+            fprintf(stderr, "Invalid peersync: key_file is required\n");
+            return SYNFLOOD_EINVAL;
+        }
+        if (config->peersync_batch_ms == 0 || config->peersync_batch_ms > 10000) {
+            fprintf(stderr, "Invalid peersync batch_ms: %u (must be 1-10000)\n",
+                    config->peersync_batch_ms);
+            return SYNFLOOD_EINVAL;
+        }
+        if (config->peersync_max_age_s == 0 || config->peersync_max_age_s > 3600) {
+            fprintf(stderr, "Invalid peersync max_age_s: %u (must be 1-3600)\n",
+                    config->peersync_max_age_s);
+            return SYNFLOOD_EINVAL;
+        }
+        if (config->peersync_ttl == 0 || config->peersync_ttl > 255) {
+            fprintf(stderr, "Invalid peersync ttl: %u (must be 1-255)\n", config->peersync_ttl);
+            return SYNFLOOD_EINVAL;
+        }
+    }
+
     /* Validate ipset name */
     if (strlen(config->ipset_name) == 0) {
         fprintf(stderr, "Invalid ipset_name: cannot be empty\n");
@@ -202,15 +721,89 @@ void config_print(const synflood_config_t *config) {
     printf("    syn_threshold: %u\n", config->syn_threshold);
     printf("    window_ms: %u\n", config->window_ms);
     printf("    proc_check_interval_s: %u\n", config->proc_check_interval_s);
+    printf("    validate_syn_recv: %s\n", config->validate_syn_recv ? "true" : "false");
+    printf("    synack_threshold: %u%s\n", config->synack_threshold,
+           config->synack_threshold ? "" : " (disabled)");
+    printf("    ack_threshold: %u%s\n", config->ack_threshold,
+           config->ack_threshold ? "" : " (disabled)");
+    printf("    rst_threshold: %u%s\n", config->rst_threshold,
+           config->rst_threshold ? "" : " (disabled)");
+    printf("    udp_threshold: %u%s\n", config->udp_threshold,
+           config->udp_threshold ? "" : " (disabled)");
+    printf("    icmp_threshold: %u%s\n", config->icmp_threshold,
+           config->icmp_threshold ? "" : " (disabled)");
+    printf("    victim_threshold: %u%s\n", config->victim_threshold,
+           config->victim_threshold ? "" : " (disabled)");
+    printf("    victim_source_threshold: %u\n", config->victim_source_threshold);
+    printf("    victim_hold_s: %u\n", config->victim_hold_s);
+    printf("    scan_port_threshold: %u%s\n", config->scan_port_threshold,
+           config->scan_port_threshold ? "" : " (disabled)");
+    printf("    scan_host_threshold: %u%s\n", config->scan_host_threshold,
+           config->scan_host_threshold ? "" : " (disabled)");
+    printf("    scan_window_s: %u\n", config->scan_window_s);
+    printf("    scan_block: %s\n", config->scan_block ? "true" : "false");
+    printf("    asn_map_file: %s\n", config->asn_map_file[0] ? config->asn_map_file : "(disabled)");
+    printf("    asn_threshold: %u%s\n", config->asn_threshold,
+           config->asn_threshold ? "" : " (rates only)");
+    printf("    asn_source_threshold: %u\n", config->asn_source_threshold);
+    printf("    asn_hold_s: %u\n", config->asn_hold_s);
+    printf("    asn_block: %s\n", config->asn_block ? "true" : "false");
+    printf("    clock_resolution_us: %u%s\n", config->clock_resolution_us,
+           config->clock_resolution_us ? "" : " (system clock)");
     printf("  Enforcement:\n");
     printf("    block_duration_s: %u\n", config->block_duration_s);
     printf("    ipset_name: %s\n", config->ipset_name);
+    printf("    inpath_drop: %s\n", config->inpath_drop ? "true" : "false");
+    printf("    udp_ipset: %s\n", config->udp_ipset[0] ? config->udp_ipset : config->ipset_name);
+    printf("    icmp_ipset: %s\n", config->icmp_ipset[0] ? config->icmp_ipset : config->ipset_name);
+    printf("    compact_min_prefix: %u%s\n", config->compact_min_prefix,
+           config->compact_min_prefix ? "" : " (disabled)");
+    printf("    compact_min_density: %u%%\n", config->compact_min_density);
+    printf("    compact_min_entries: %u\n", config->compact_min_entries);
+    printf("    compact_ipset: %s\n", config->compact_ipset);
+    printf("    asn_ipset: %s\n", config->asn_ipset);
     printf("  Limits:\n");
     printf("    max_tracked_ips: %u\n", config->max_tracked_ips);
     printf("    hash_buckets: %u\n", config->hash_buckets);
+    printf("    max_tracked_victims: %u\n", config->max_tracked_victims);
+    printf("    max_tracked_scanners: %u\n", config->max_tracked_scanners);
+    printf("    max_tracked_asns: %u\n", config->max_tracked_asns);
+    printf("    idle_timeout_s: %u%s\n", config->idle_timeout_s,
+           config->idle_timeout_s ? "" : " (disabled)");
+    printf("    tracker_shm: %s\n", config->tracker_shm[0] ? config->tracker_shm : "(private)");
     printf("  Capture:\n");
     printf("    nfqueue_num: %u\n", config->nfqueue_num);
     printf("    use_raw_socket: %s\n", config->use_raw_socket ? "true" : "false");
+    printf("    fastpath_mark: 0x%x%s\n", config->fastpath_mark,
+           config->fastpath_mark ? "" : " (disabled)");
+    printf("    fastpath_max_syn: %u\n", config->fastpath_max_syn);
+    printf("    fastpath_timeout_s: %u\n", config->fastpath_timeout_s);
+    printf("    fastpath_ipset: %s\n", config->fastpath_ipset);
+    printf("    overload_max_sample: %u\n", config->overload_max_sample);
+    printf("    netns_workers: %u\n", config->netns_workers);
+    printf("  Namespaces: %u\n", config->netns_count);
+    for (uint32_t i = 0; i < config->netns_count; i++) {
+        const netns_config_t *ns = &config->namespaces[i];
+        printf("    %s: path=%s syn_threshold=%u block_duration_s=%u ipset_name=%s\n",
+               ns->name, ns->path,
+               ns->syn_threshold ? ns->syn_threshold : config->syn_threshold,
+               ns->block_duration_s ? ns->block_duration_s : config->block_duration_s,
+               ns->ipset_name[0] ? ns->ipset_name : config->ipset_name);
+    }
+    printf("  Peer sync: %s\n", config->peersync_port ? "enabled" : "disabled");
+    if (config->peersync_port != 0) {
+        printf("    port: %u\n", config->peersync_port);
+        printf("    group: %s\n", config->peersync_group[0] ? config->peersync_group : "(none)");
+        printf("    bind: %s\n", config->peersync_bind[0] ? config->peersync_bind : "(any)");
+        for (uint32_t i = 0; i < config->peersync_peer_count; i++) {
+            struct in_addr addr = { .s_addr = config->peersync_peers[i].ip };
+            printf("    peer: %s:%u\n", inet_ntoa(addr), config->peersync_peers[i].port);
+        }
+        printf("    key_file: %s\n", config->peersync_key_file);
+        printf("    batch_ms: %u\n", config->peersync_batch_ms);
+        printf("    max_age_s: %u\n", config->peersync_max_age_s);
+        printf("    ttl: %u\n", config->peersync_ttl);
+    }
     printf("  Whitelist:\n");
     printf("    file: %s\n", config->whitelist_file);
     printf("  Logging:\n");
@@ -0,0 +1,321 @@
+/*
+ * blockcap.c - Blacklist capacity management
+ * TCP SYN Flood Detector
+ *
+ * Records live in a fixed pool (capacity plus a quarter for history) with
+ * chained hashing through pool indices; live records are also in a binary
+ * min-heap of pool indices, least valuable at the root.
+ */
+
+#include "blockcap.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NIL UINT32_MAX
+
+typedef struct
+{
+    uint32_t ip_addr;   /* Network byte order */
+    uint32_t rate;      /* Highest triggering rate seen */
+    uint32_t next;      /* Hash chain, or free list */
+    uint32_t heap_pos;  /* NIL while not in the set */
+    uint64_t expiry_ns;
+    uint16_t repeats;   /* Times blocked again after an unblock */
+} block_rec_t;
+
+static block_rec_t *recs = NULL;
+static uint32_t free_head = NIL;
+static uint32_t *buckets = NULL;
+static size_t bucket_count = 0;
+static uint32_t *heap = NULL;
+static size_t heap_len = 0;
+static size_t capacity = 0;
+
+/* No live entry expires before this (exact after a sweep) */
+static uint64_t min_expiry_ns = 0;
+
+static blockcap_stats_t stats;
+static pthread_mutex_t blockcap_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t block_value(uint32_t rate, uint16_t repeats) {
+    return (uint64_t)rate * ((uint64_t)repeats + 1);
+}
+
+/* Lower value first; among equals the block ending sooner */
+static bool worth_less(uint64_t value_a, uint64_t expiry_a, uint64_t value_b, uint64_t expiry_b) {
+    return value_a < value_b || (value_a == value_b && expiry_a < expiry_b);
+}
+
+static bool rec_less(uint32_t a, uint32_t b) {
+    return worth_less(block_value(recs[a].rate, recs[a].repeats), recs[a].expiry_ns,
+                      block_value(recs[b].rate, recs[b].repeats), recs[b].expiry_ns);
+}
+
+static void heap_set(size_t pos, uint32_t r) {
+    heap[pos] = r;
+    recs[r].heap_pos = (uint32_t)pos;
+}
+
+static void sift_up(size_t pos) {
+    uint32_t r = heap[pos];
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (!rec_less(r, heap[parent])) {
+            break;
+        }
+        heap_set(pos, heap[parent]);
+        pos = parent;
+    }
+    heap_set(pos, r);
+}
+
+static void sift_down(size_t pos) {
+    uint32_t r = heap[pos];
+    for (;;) {
+        size_t child = 2 * pos + 1;
+        if (child >= heap_len) {
+            break;
+        }
+        if (child + 1 < heap_len && rec_less(heap[child + 1], heap[child])) {
+            child++;
+        }
+        if (!rec_less(heap[child], r)) {
+            break;
+        }
+        heap_set(pos, heap[child]);
+        pos = child;
+    }
+    heap_set(pos, r);
+}
+
+static void heap_remove(size_t pos) {
+    recs[heap[pos]].heap_pos = NIL;
+    heap_len--;
+    if (pos == heap_len) {
+        return;
+    }
+
+    uint32_t moved = heap[heap_len];
+    heap_set(pos, moved);
+    sift_up(pos);
+    sift_down(recs[moved].heap_pos);
+}
+
+static uint32_t rec_find(uint32_t ip_addr) {
+    uint32_t r = buckets[ip_hash(ip_addr, bucket_count)];
+    while (r != NIL && recs[r].ip_addr != ip_addr) {
+        r = recs[r].next;
+    }
+    return r;
+}
+
+/* Free the records of sources no longer in the set */
+static void purge_history(void) {
+    for (size_t b = 0; b < bucket_count; b++) {
+        uint32_t *link = &buckets[b];
+        while (*link != NIL) {
+            uint32_t r = *link;
+            if (recs[r].heap_pos == NIL) {
+                *link = recs[r].next;
+                recs[r].next = free_head;
+                free_head = r;
+            } else {
+                link = &recs[r].next;
+            }
+        }
+    }
+}
+
+static uint32_t rec_alloc(uint32_t ip_addr) {
+    if (free_head == NIL) {
+        purge_history();
+    }
+
+    uint32_t r = free_head;
+    free_head = recs[r].next;
+
+    size_t b = ip_hash(ip_addr, bucket_count);
+    memset(&recs[r], 0, sizeof(recs[r]));
+    recs[r].ip_addr = ip_addr;
+    recs[r].heap_pos = NIL;
+    recs[r].next = buckets[b];
+    buckets[b] = r;
+    return r;
+}
+
+/* Drop live entries whose block has ended (the kernel timed them out) */
+static void sweep_expired(uint64_t now_ns) {
+    size_t kept = 0;
+    uint64_t earliest = UINT64_MAX;
+
+    for (size_t i = 0; i < heap_len; i++) {
+        uint32_t r = heap[i];
+        if (recs[r].expiry_ns <= now_ns) {
+            recs[r].heap_pos = NIL;
+            stats.expired_total++;
+        } else {
+            heap_set(kept++, r);
+            earliest = MIN(earliest, recs[r].expiry_ns);
+        }
+    }
+
+    heap_len = kept;
+    for (size_t i = heap_len / 2; i-- > 0;) {
+        sift_down(i);
+    }
+    min_expiry_ns = earliest;
+}
+
+synflood_ret_t blockcap_init(size_t max_entries) {
+    if (max_entries == 0 || max_entries > NIL / 2) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    blockcap_cleanup();
+
+    size_t pool = max_entries + max_entries / 4 + 1;
+    size_t nbuckets = 1;
+    while (nbuckets < pool) {
+        nbuckets <<= 1;
+    }
+
+    block_rec_t *new_recs = calloc(pool, sizeof(*new_recs));
+    uint32_t *new_buckets = malloc(nbuckets * sizeof(*new_buckets));
+    uint32_t *new_heap = malloc(max_entries * sizeof(*new_heap));
+    if (!new_recs || !new_buckets || !new_heap) {
+        free(new_recs);
+        free(new_buckets);
+        free(new_heap);
+        return SYNFLOOD_ENOMEM;
+    }
+
+    for (size_t i = 0; i < pool; i++) {
+        new_recs[i].next = i + 1 < pool ? (uint32_t)(i + 1) : NIL;
+    }
+    memset(new_buckets, 0xFF, nbuckets * sizeof(*new_buckets));
+
+    pthread_mutex_lock(&blockcap_lock);
+    recs = new_recs;
+    free_head = 0;
+    buckets = new_buckets;
+    bucket_count = nbuckets;
+    heap = new_heap;
+    heap_len = 0;
+    capacity = max_entries;
+    min_expiry_ns = UINT64_MAX;
+    memset(&stats, 0, sizeof(stats));
+    stats.capacity = max_entries;
+    pthread_mutex_unlock(&blockcap_lock);
+
+    return SYNFLOOD_OK;
+}
+
+void blockcap_cleanup(void) {
+    pthread_mutex_lock(&blockcap_lock);
+    free(recs);
+    free(buckets);
+    free(heap);
+    recs = NULL;
+    buckets = NULL;
+    heap = NULL;
+    free_head = NIL;
+    bucket_count = 0;
+    heap_len = 0;
+    capacity = 0;
+    pthread_mutex_unlock(&blockcap_lock);
+}
+
+bool blockcap_enabled(void) {
+    return capacity != 0;
+}
+
+ssize_t blockcap_admit(uint32_t ip_addr, uint32_t rate, uint64_t expiry_ns, uint64_t now_ns,
+                       uint32_t *evicted, size_t max_evict) {
+    pthread_mutex_lock(&blockcap_lock);
+    if (!recs) {
+        pthread_mutex_unlock(&blockcap_lock);
+        return 0;
+    }
+
+    uint32_t r = rec_find(ip_addr);
+
+    /* Already in the set: the block is refreshed, not added */
+    if (r != NIL && recs[r].heap_pos != NIL) {
+        recs[r].rate = MAX(recs[r].rate, rate);
+        recs[r].expiry_ns = MAX(recs[r].expiry_ns, expiry_ns);
+        sift_down(recs[r].heap_pos);
+        pthread_mutex_unlock(&blockcap_lock);
+        return 0;
+    }
+
+    uint16_t repeats = 0;
+    if (r != NIL) {
+        repeats = recs[r].repeats < UINT16_MAX ? recs[r].repeats + 1 : UINT16_MAX;
+        rate = MAX(rate, recs[r].rate);
+    }
+    uint64_t value = block_value(rate, repeats);
+
+    size_t count = 0;
+    if (heap_len >= capacity && now_ns >= min_expiry_ns) {
+        sweep_expired(now_ns);
+    }
+    if (heap_len >= capacity) {
+        size_t batch = MIN(MAX(capacity / 64, (size_t)1), (size_t)BLOCKCAP_EVICT_MAX);
+        batch = MIN(batch, max_evict);
+
+        /* Evict only what is worth less than the new block */
+        while (count < batch && heap_len > 0) {
+            block_rec_t *least = &recs[heap[0]];
+            if (!worth_less(block_value(least->rate, least->repeats), least->expiry_ns,
+                            value, expiry_ns)) {
+                break;
+            }
+            evicted[count++] = least->ip_addr;
+            heap_remove(0);
+        }
+
+        if (count == 0) {
+            stats.rejected_total++;
+            pthread_mutex_unlock(&blockcap_lock);
+            return -1;
+        }
+        stats.evicted_total += count;
+    }
+
+    if (r == NIL) {
+        r = rec_alloc(ip_addr);
+    }
+    recs[r].rate = rate;
+    recs[r].repeats = repeats;
+    recs[r].expiry_ns = expiry_ns;
+
+    heap_set(heap_len++, r);
+    sift_up(heap_len - 1);
+    min_expiry_ns = MIN(min_expiry_ns, expiry_ns);
+    stats.admitted_total++;
+
+    pthread_mutex_unlock(&blockcap_lock);
+    return (ssize_t)count;
+}
+
+void blockcap_remove(uint32_t ip_addr) {
+    pthread_mutex_lock(&blockcap_lock);
+    if (recs) {
+        uint32_t r = rec_find(ip_addr);
+        if (r != NIL && recs[r].heap_pos != NIL) {
+            heap_remove(recs[r].heap_pos);
+        }
+    }
+    pthread_mutex_unlock(&blockcap_lock);
+}
+
+void blockcap_get_stats(blockcap_stats_t *out) {
+    if (!out) {
+        return;
+    }
+
+    pthread_mutex_lock(&blockcap_lock);
+    *out = stats;
+    out->live = heap_len;
+    pthread_mutex_unlock(&blockcap_lock);
+}
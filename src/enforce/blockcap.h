@@ -0,0 +1,87 @@
+/*
+ * blockcap.h - Blacklist capacity management
+ * TCP SYN Flood Detector
+ *
+ * The blacklist ipset holds at most max_tracked_ips entries. This module
+ * mirrors its live entries in a min-heap ordered by how much each block is
+ * worth: the SYN rate that triggered it, scaled by how often the source was
+ * blocked before, with the earliest expiry breaking ties. When the set is
+ * full a new block either evicts a batch of less valuable blocks or, if it
+ * is worth less than all of them, is rejected.
+ *
+ * Records of unblocked sources are kept while there is room, so a source
+ * blocked again keeps its repeat count.
+ */
+
+#ifndef SYNFLOOD_BLOCKCAP_H
+#define SYNFLOOD_BLOCKCAP_H
+
+#include "common.h"
+#include <sys/types.h>
+
+/* Rate given to operator blocks: never evicted by detections */
+#define BLOCKCAP_RATE_MANUAL UINT32_MAX
+
+/* Upper bound on one eviction batch */
+#define BLOCKCAP_EVICT_MAX 256
+
+/* Counters */
+typedef struct
+{
+    size_t capacity;           /* Entries the set can hold */
+    size_t live;               /* Entries currently tracked in the set */
+    uint64_t admitted_total;   /* Blocks admitted */
+    uint64_t rejected_total;   /* Blocks refused: set full of more valuable blocks */
+    uint64_t evicted_total;    /* Blocks evicted to make room */
+    uint64_t expired_total;    /* Entries found expired while making room */
+} blockcap_stats_t;
+
+/**
+ * Initialize capacity management
+ * @param capacity Maximum entries in the blacklist set (maxelem)
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t blockcap_init(size_t capacity);
+
+/**
+ * Free all records
+ */
+void blockcap_cleanup(void);
+
+/**
+ * Whether capacity management is active
+ * @return true after a successful blockcap_init()
+ */
+bool blockcap_enabled(void);
+
+/**
+ * Admit a block, making room in a full set
+ * A source that is already blocked is updated in place. Otherwise, when
+ * the set is full, expired entries are dropped first, then up to a batch
+ * of blocks worth less than the new one are evicted. The admitted source
+ * counts as live at once; call blockcap_remove() if adding it fails.
+ * @param ip_addr Source to block (network byte order)
+ * @param rate SYNs in the window that triggered the block (BLOCKCAP_RATE_MANUAL for
+ *             operator blocks, 0 if unknown)
+ * @param expiry_ns When the block ends (monotonic ns)
+ * @param now_ns Current monotonic time (ns)
+ * @param evicted Output: sources to delete from the set (may be NULL if max_evict is 0)
+ * @param max_evict Capacity of evicted
+ * @return Number of sources evicted, or -1 if the block is rejected
+ */
+ssize_t blockcap_admit(uint32_t ip_addr, uint32_t rate, uint64_t expiry_ns, uint64_t now_ns,
+                       uint32_t *evicted, size_t max_evict);
+
+/**
+ * Mark a source as no longer in the set (its repeat count is kept)
+ * @param ip_addr Source (network byte order)
+ */
+void blockcap_remove(uint32_t ip_addr);
+
+/**
+ * Get a snapshot of the counters
+ * @param out Output statistics
+ */
+void blockcap_get_stats(blockcap_stats_t *out);
+
+#endif /* SYNFLOOD_BLOCKCAP_H */
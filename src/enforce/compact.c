@@ -0,0 +1,453 @@
+/*
+ * compact.c - Blocklist compaction into CIDR entries
+ * TCP SYN Flood Detector
+ */
+
+#include "compact.h"
+#include "blockcap.h"
+#include "../analysis/whitelist.h"
+#include "../observe/logger.h"
+#include <arpa/inet.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Growing buffer for an ipset restore script */
+typedef struct
+{
+    char *buf;
+    size_t len;
+    size_t capacity;
+    bool failed; /* Out of memory */
+} script_t;
+
+/* State of one cover computation */
+typedef struct
+{
+    const ipset_entry_t *entries;
+    uint64_t need[33]; /* Blocked addresses a prefix of each length needs */
+    const whitelist_flat_t *whitelist;
+    compact_net_t *out;
+    size_t max;
+    size_t count;
+} cover_state_t;
+
+/* Existing aggregates of one prefix length: nets[start .. end) */
+typedef struct
+{
+    uint8_t prefix_len;
+    size_t start;
+    size_t end;
+} net_group_t;
+
+static bool compact_active = false;
+static char ip_ipset[256];
+static char net_ipset[256];
+static size_t capacity = 0;
+
+/* Pass buffers, sized for a full blacklist */
+static ipset_entry_t *ips = NULL;
+static ipset_entry_t *nets = NULL;
+static compact_net_t *cover = NULL;
+static uint32_t *retired_ips = NULL;
+
+/* Serializes passes and releases; protects stats */
+static pthread_mutex_t compact_lock = PTHREAD_MUTEX_INITIALIZER;
+static compact_stats_t stats;
+
+static uint32_t host_mask(uint8_t prefix_len) {
+    return prefix_len == 0 ? 0 : ~0U << (32 - prefix_len);
+}
+
+static int compare_addr(const void *a, const void *b) {
+    uint32_t x = ntohl(((const ipset_entry_t *)a)->addr);
+    uint32_t y = ntohl(((const ipset_entry_t *)b)->addr);
+    return (x > y) - (x < y);
+}
+
+static int compare_len_addr(const void *a, const void *b) {
+    const ipset_entry_t *x = a;
+    const ipset_entry_t *y = b;
+    if (x->prefix_len != y->prefix_len) {
+        return (int)x->prefix_len - (int)y->prefix_len;
+    }
+    return compare_addr(a, b);
+}
+
+/* First entry in [lo, hi) at or above a host-order address */
+static size_t lower_bound(const ipset_entry_t *entries, size_t lo, size_t hi, uint32_t addr) {
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ntohl(entries[mid].addr) < addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* Cover entries [lo, hi), all inside base/len: the whole prefix if it is
+ * dense enough, otherwise each half on its own */
+static void cover_range(cover_state_t *st, size_t lo, size_t hi, uint32_t base, uint8_t len) {
+    if (lo == hi || st->count == st->max) {
+        return;
+    }
+
+    size_t n = hi - lo;
+    if (n >= st->need[len] &&
+        !whitelist_flat_overlaps(st->whitelist, htonl(base), len)) {
+        compact_net_t *net = &st->out[st->count++];
+        net->net = htonl(base);
+        net->prefix_len = len;
+        net->first = lo;
+        net->count = n;
+        net->timeout_s = 0;
+        for (size_t i = lo; i < hi; i++) {
+            net->timeout_s = MAX(net->timeout_s, st->entries[i].timeout_s);
+        }
+        return;
+    }
+
+    if (len >= 31) {
+        return; /* Halves are single addresses */
+    }
+
+    uint32_t half = base | (1U << (31 - len));
+    size_t mid = lower_bound(st->entries, lo, hi, half);
+    cover_range(st, lo, mid, base, (uint8_t)(len + 1));
+    cover_range(st, mid, hi, half, (uint8_t)(len + 1));
+}
+
+size_t compact_cover(const ipset_entry_t *entries, size_t n, uint8_t min_prefix,
+                     uint32_t min_density, const whitelist_flat_t *whitelist,
+                     compact_net_t *out, size_t max) {
+    if (!entries || !out || min_prefix == 0 || min_prefix > 31 ||
+        min_density == 0 || min_density > 100) {
+        return 0;
+    }
+
+    cover_state_t st = {
+        .entries = entries,
+        .whitelist = whitelist,
+        .out = out,
+        .max = max,
+    };
+    for (uint8_t len = min_prefix; len <= 32; len++) {
+        uint64_t size = 1ULL << (32 - len);
+        st.need[len] = MAX((size * min_density + 99) / 100, 2);
+    }
+
+    /* One independent cover per widest allowed prefix */
+    size_t i = 0;
+    while (i < n && st.count < max) {
+        uint32_t base = ntohl(entries[i].addr) & host_mask(min_prefix);
+        uint64_t next = (uint64_t)base + (1ULL << (32 - min_prefix));
+        size_t j = next > UINT32_MAX ? n : lower_bound(entries, i, n, (uint32_t)next);
+
+        cover_range(&st, i, j, base, min_prefix);
+        i = j;
+    }
+
+    return st.count;
+}
+
+static void script_printf(script_t *s, const char *fmt, ...) {
+    if (s->failed) {
+        return;
+    }
+
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(s->buf ? s->buf + s->len : NULL, s->capacity - s->len, fmt, ap);
+        va_end(ap);
+
+        if (n < 0) {
+            s->failed = true;
+            return;
+        }
+        if (s->len + (size_t)n < s->capacity) {
+            s->len += (size_t)n;
+            return;
+        }
+
+        size_t grown = MAX(s->capacity * 2, s->len + (size_t)n + 4096);
+        char *buf = realloc(s->buf, grown);
+        if (!buf) {
+            s->failed = true;
+            return;
+        }
+        s->buf = buf;
+        s->capacity = grown;
+    }
+}
+
+static void script_add_net(script_t *s, uint32_t net, uint8_t prefix_len, uint32_t timeout_s) {
+    char ip_str[INET_ADDRSTRLEN];
+    struct in_addr addr = { .s_addr = net };
+    inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+
+    /* -exist also raises the timeout of an aggregate already in the set */
+    script_printf(s, "add %s %s/%u timeout %u\n", net_ipset, ip_str, prefix_len, timeout_s);
+}
+
+static void script_del(script_t *s, const char *set, uint32_t ip_addr, int prefix_len) {
+    char ip_str[INET_ADDRSTRLEN];
+    struct in_addr addr = { .s_addr = ip_addr };
+    inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+
+    if (prefix_len < 0) {
+        script_printf(s, "del %s %s\n", set, ip_str);
+    } else {
+        script_printf(s, "del %s %s/%d\n", set, ip_str, prefix_len);
+    }
+}
+
+/* Find the existing aggregate containing an address (groups by length) */
+static ipset_entry_t *find_net(const net_group_t *groups, size_t group_count, uint32_t ip_addr) {
+    uint32_t host = ntohl(ip_addr);
+
+    for (size_t g = 0; g < group_count; g++) {
+        uint32_t key = host & host_mask(groups[g].prefix_len);
+        size_t i = lower_bound(nets, groups[g].start, groups[g].end, key);
+        if (i < groups[g].end && ntohl(nets[i].addr) == key) {
+            return &nets[i];
+        }
+    }
+    return NULL;
+}
+
+synflood_ret_t compact_init(const synflood_config_t *config) {
+    if (!config) {
+        return SYNFLOOD_EINVAL;
+    }
+    if (config->compact_min_prefix == 0) {
+        return SYNFLOOD_OK;
+    }
+
+    if (__atomic_load_n(&compact_active, __ATOMIC_ACQUIRE)) {
+        return SYNFLOOD_OK; /* Already set up (reload) */
+    }
+
+    /* A reload may enable compaction while the expiry thread is running */
+    pthread_mutex_lock(&compact_lock);
+
+    capacity = config->max_tracked_ips;
+    ips = calloc(capacity, sizeof(*ips));
+    nets = calloc(capacity, sizeof(*nets));
+    cover = calloc(capacity, sizeof(*cover));
+    retired_ips = calloc(capacity, sizeof(*retired_ips));
+    if (!ips || !nets || !cover || !retired_ips) {
+        pthread_mutex_unlock(&compact_lock);
+        compact_cleanup();
+        return SYNFLOOD_ENOMEM;
+    }
+
+    /* Created with -exist, so a set left from a previous run is kept */
+    if (ipset_mgr_init_net(config->compact_ipset, config->block_duration_s,
+                           config->max_tracked_ips) != SYNFLOOD_OK) {
+        pthread_mutex_unlock(&compact_lock);
+        compact_cleanup();
+        return SYNFLOOD_ERROR;
+    }
+
+    snprintf(ip_ipset, sizeof(ip_ipset), "%s", config->ipset_name);
+    snprintf(net_ipset, sizeof(net_ipset), "%s", config->compact_ipset);
+    memset(&stats, 0, sizeof(stats));
+    __atomic_store_n(&compact_active, true, __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&compact_lock);
+
+    LOG_INFO("Blocklist compaction enabled: up to /%u at %u%% density into %s",
+             config->compact_min_prefix, config->compact_min_density, net_ipset);
+
+    return SYNFLOOD_OK;
+}
+
+bool compact_enabled(void) {
+    return __atomic_load_n(&compact_active, __ATOMIC_ACQUIRE);
+}
+
+size_t compact_run(app_context_t *ctx) {
+    if (!compact_enabled() || !ctx || !ctx->config) {
+        return 0;
+    }
+
+    const synflood_config_t *config = ctx->config;
+    if (config->compact_min_prefix == 0) {
+        return 0; /* Switched off by a reload */
+    }
+
+    pthread_mutex_lock(&compact_lock);
+
+    ssize_t n = ipset_mgr_list(ip_ipset, ips, capacity);
+    ssize_t m = n < 0 ? -1 : ipset_mgr_list(net_ipset, nets, capacity);
+    if (n < 0 || m < 0) {
+        stats.errors_total++;
+        pthread_mutex_unlock(&compact_lock);
+        LOG_WARN("Blocklist compaction skipped: could not list %s or %s", ip_ipset, net_ipset);
+        return 0;
+    }
+
+    stats.nets_current = (uint64_t)m;
+    if ((size_t)n < config->compact_min_entries) {
+        pthread_mutex_unlock(&compact_lock);
+        return 0;
+    }
+
+    qsort(ips, (size_t)n, sizeof(*ips), compare_addr);
+    qsort(nets, (size_t)m, sizeof(*nets), compare_len_addr);
+
+    net_group_t groups[33];
+    size_t group_count = 0;
+    for (size_t i = 0; i < (size_t)m; i++) {
+        if (group_count == 0 || groups[group_count - 1].prefix_len != nets[i].prefix_len) {
+            groups[group_count++] = (net_group_t){ nets[i].prefix_len, i, i };
+        }
+        groups[group_count - 1].end = i + 1;
+    }
+
+    /* Adds first, so no covered source is ever unblocked in between */
+    script_t adds = {0};
+    script_t dels = {0};
+    size_t retired = 0;
+
+    /* Addresses blocked inside an existing aggregate fold into it */
+    size_t kept = 0;
+    for (size_t i = 0; i < (size_t)n; i++) {
+        ipset_entry_t *net = find_net(groups, group_count, ips[i].addr);
+        if (!net) {
+            ips[kept++] = ips[i];
+            continue;
+        }
+        if (ips[i].timeout_s > net->timeout_s) {
+            net->timeout_s = ips[i].timeout_s;
+            script_add_net(&adds, net->addr, net->prefix_len, net->timeout_s);
+        }
+        script_del(&dels, ip_ipset, ips[i].addr, -1);
+        retired_ips[retired++] = ips[i].addr;
+    }
+
+    /* The whitelist is copied so edits are not held up for a whole pass */
+    whitelist_reader_online();
+    whitelist_flat_t *whitelist = whitelist_flatten(__atomic_load_n(&ctx->whitelist_root,
+                                                                    __ATOMIC_ACQUIRE));
+    whitelist_reader_offline();
+    size_t added = compact_cover(ips, kept, (uint8_t)config->compact_min_prefix,
+                                 config->compact_min_density, whitelist, cover, capacity);
+    whitelist_flat_free(whitelist);
+
+    for (size_t c = 0; c < added; c++) {
+        script_add_net(&adds, cover[c].net, cover[c].prefix_len, cover[c].timeout_s);
+        for (size_t i = cover[c].first; i < cover[c].first + cover[c].count; i++) {
+            script_del(&dels, ip_ipset, ips[i].addr, -1);
+            retired_ips[retired++] = ips[i].addr;
+        }
+    }
+
+    synflood_ret_t ret = SYNFLOOD_OK;
+    if (retired > 0) {
+        script_printf(&adds, "%.*s", (int)dels.len, dels.buf ? dels.buf : "");
+        ret = adds.failed || dels.failed ? SYNFLOOD_ENOMEM : ipset_mgr_restore(adds.buf, adds.len);
+    }
+    free(adds.buf);
+    free(dels.buf);
+
+    if (ret != SYNFLOOD_OK) {
+        stats.errors_total++;
+        pthread_mutex_unlock(&compact_lock);
+        LOG_ERROR("Blocklist compaction failed to update %s/%s", ip_ipset, net_ipset);
+        return 0;
+    }
+
+    /* Retired entries no longer take up blacklist capacity */
+    for (size_t i = 0; i < retired; i++) {
+        blockcap_remove(retired_ips[i]);
+    }
+
+    if (retired > 0) {
+        stats.runs_total++;
+        stats.nets_added_total += added;
+        stats.retired_total += retired;
+        stats.nets_current += added;
+    }
+    pthread_mutex_unlock(&compact_lock);
+
+    if (retired > 0) {
+        LOG_INFO("Blocklist compaction: %zu addresses retired, %zu new aggregates", retired, added);
+
+        pthread_mutex_lock(&ctx->metrics_lock);
+        ctx->metrics.blocked_ips_current = ipset_mgr_get_count();
+        pthread_mutex_unlock(&ctx->metrics_lock);
+    }
+
+    return retired;
+}
+
+size_t compact_release(uint32_t prefix, uint8_t prefix_len) {
+    if (!compact_enabled() || prefix_len > 32) {
+        return 0;
+    }
+
+    uint32_t mask = htonl(host_mask(prefix_len));
+
+    pthread_mutex_lock(&compact_lock);
+
+    ssize_t m = ipset_mgr_list(net_ipset, nets, capacity);
+    if (m < 0) {
+        stats.errors_total++;
+        pthread_mutex_unlock(&compact_lock);
+        return 0;
+    }
+
+    script_t dels = {0};
+    size_t released = 0;
+    for (size_t i = 0; i < (size_t)m; i++) {
+        uint32_t net_mask = htonl(host_mask(nets[i].prefix_len));
+        if (((nets[i].addr ^ prefix) & net_mask & mask) == 0) {
+            script_del(&dels, net_ipset, nets[i].addr, nets[i].prefix_len);
+            released++;
+        }
+    }
+
+    if (released > 0 &&
+        (dels.failed || ipset_mgr_restore(dels.buf, dels.len) != SYNFLOOD_OK)) {
+        stats.errors_total++;
+        released = 0;
+    }
+    stats.nets_current = (uint64_t)m - released;
+    free(dels.buf);
+
+    pthread_mutex_unlock(&compact_lock);
+
+    if (released > 0) {
+        LOG_INFO("Released %zu blocklist aggregates overlapping a whitelisted range", released);
+    }
+
+    return released;
+}
+
+void compact_get_stats(compact_stats_t *out) {
+    if (!out) {
+        return;
+    }
+
+    pthread_mutex_lock(&compact_lock);
+    *out = stats;
+    pthread_mutex_unlock(&compact_lock);
+}
+
+void compact_cleanup(void) {
+    __atomic_store_n(&compact_active, false, __ATOMIC_RELEASE);
+    free(ips);
+    free(nets);
+    free(cover);
+    free(retired_ips);
+    ips = NULL;
+    nets = NULL;
+    cover = NULL;
+    retired_ips = NULL;
+    capacity = 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * compact.h - Blocklist compaction into CIDR entries
+ * TCP SYN Flood Detector
+ *
+ * During a botnet flood the hash:ip blacklist fills with /32 entries, many
+ * of them neighbours. A compaction pass lists the blacklist, finds the
+ * widest prefixes (no wider than compact_min_prefix) in which at least
+ * compact_min_density percent of the addresses are blocked, adds them to a
+ * hash:net set and deletes the /32 entries they cover, all in one ipset
+ * restore batch. A prefix overlapping the whitelist is never used.
+ *
+ * An aggregate keeps the longest remaining block time of the addresses it
+ * replaced, so no source is released early. Addresses blocked later inside
+ * an existing aggregate are retired into it on the next pass.
+ */
+
+#ifndef SYNFLOOD_COMPACT_H
+#define SYNFLOOD_COMPACT_H
+
+#include "common.h"
+#include "ipset_mgr.h"
+#include <stddef.h>
+
+/* One CIDR entry of a computed cover */
+typedef struct
+{
+    uint32_t net;        /* Network byte order */
+    uint8_t prefix_len;
+    uint32_t timeout_s;  /* Longest remaining block time of the covered addresses */
+    size_t first;        /* Covered addresses: input[first .. first + count) */
+    size_t count;
+} compact_net_t;
+
+/* Counters */
+typedef struct
+{
+    uint64_t runs_total;        /* Passes that changed the sets */
+    uint64_t nets_added_total;  /* Aggregates created */
+    uint64_t retired_total;     /* /32 entries replaced by an aggregate */
+    uint64_t errors_total;      /* Passes that failed to list or update a set */
+    uint64_t nets_current;      /* Aggregates in the set after the last pass */
+} compact_stats_t;
+
+/**
+ * Compute the aggregates for a sorted list of blocked addresses
+ * Each aggregate is the widest prefix of at least min_prefix bits in which
+ * at least min_density percent of the addresses (and at least two) are
+ * blocked and no address is whitelisted. Addresses left out stay /32.
+ * @param entries Blocked addresses, sorted by ascending address in host order
+ * @param n Number of entries
+ * @param min_prefix Widest prefix length allowed (8-31)
+ * @param min_density Percent of a prefix that must be blocked (1-100)
+ * @param whitelist Flattened whitelist (may be NULL)
+ * @param out Output aggregates, ascending
+ * @param max Capacity of out
+ * @return Number of aggregates written
+ */
+size_t compact_cover(const ipset_entry_t *entries, size_t n, uint8_t min_prefix,
+                     uint32_t min_density, const whitelist_flat_t *whitelist,
+                     compact_net_t *out, size_t max);
+
+/**
+ * Create the hash:net set and the pass buffers
+ * A no-op when compaction is disabled or already set up, so a reload can
+ * call it to enable compaction.
+ * @param config Configuration
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t compact_init(const synflood_config_t *config);
+
+/**
+ * Whether compaction is active
+ * @return true after a successful compact_init() with compact_min_prefix set
+ */
+bool compact_enabled(void);
+
+/**
+ * Run one compaction pass
+ * @param ctx Application context (configuration and whitelist)
+ * @return Number of /32 entries retired
+ */
+size_t compact_run(app_context_t *ctx);
+
+/**
+ * Delete the aggregates overlapping a range (e.g. a new whitelist entry)
+ * The addresses they covered are unblocked with them.
+ * @param prefix Network address (network byte order)
+ * @param prefix_len Prefix length (0-32)
+ * @return Number of aggregates deleted
+ */
+size_t compact_release(uint32_t prefix, uint8_t prefix_len);
+
+/**
+ * Get a snapshot of the counters
+ * @param out Output statistics
+ */
+void compact_get_stats(compact_stats_t *out);
+
+/**
+ * Free the pass buffers
+ */
+void compact_cleanup(void);
+
+#endif /* SYNFLOOD_COMPACT_H */
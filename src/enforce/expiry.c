@@ -5,11 +5,18 @@
 
 #include "expiry.h"
 #include "ipset_mgr.h"
+#include "compact.h"
 #include "../analysis/tracker.h"
+#include "../analysis/whitelist.h"
+#include "../analysis/asnmap.h"
+#include "../analysis/asnrate.h"
 #include "../observe/logger.h"
+#include <arpa/inet.h>
 #include <pthread.h>
 #include <unistd.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 static pthread_t expiry_thread;
 static volatile bool expiry_running = false;
@@ -62,15 +69,82 @@ size_t expiry_check_now(app_context_t *ctx) {
     return removed;
 }
 
+/* Most prefixes one AS block may add; larger networks are only rate-limited */
+#define EXPIRY_ASN_BLOCK_MAX_NETS 1024
+
+/* Block every prefix an AS originates in asn_ipset, in one ipset batch */
+static void expiry_block_asn(const asnmap_t *asnmap, uint32_t asn,
+                             const synflood_config_t *config) {
+    uint32_t nets[EXPIRY_ASN_BLOCK_MAX_NETS];
+    uint8_t prefix_lens[EXPIRY_ASN_BLOCK_MAX_NETS];
+
+    size_t count = asnmap_prefixes(asnmap, asn, nets, prefix_lens, ARRAY_SIZE(nets));
+    if (count == 0) {
+        return;
+    }
+    if (count > ARRAY_SIZE(nets)) {
+        LOG_WARN("AS%u originates %zu prefixes (more than %d): not blocked", asn, count,
+                 EXPIRY_ASN_BLOCK_MAX_NETS);
+        return;
+    }
+
+    /* "add SET 255.255.255.255/32 timeout 4294967295\n" */
+    size_t line_max = 48 + strlen(config->asn_ipset);
+    char *script = malloc(count * line_max);
+    if (!script) {
+        return;
+    }
+
+    size_t len = 0;
+    for (size_t i = 0; i < count; i++) {
+        char ip_str[INET_ADDRSTRLEN];
+        struct in_addr addr = { .s_addr = nets[i] };
+        inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+        len += (size_t)snprintf(script + len, count * line_max - len, "add %s %s/%u timeout %u\n",
+                                config->asn_ipset, ip_str, prefix_lens[i],
+                                config->block_duration_s);
+    }
+
+    if (ipset_mgr_restore(script, len) == SYNFLOOD_OK) {
+        LOG_WARN("Blocked AS%u: %zu prefixes in %s for %us", asn, count, config->asn_ipset,
+                 config->block_duration_s);
+    }
+    free(script);
+}
+
+size_t expiry_block_asns_now(app_context_t *ctx) {
+    if (!ctx || !ctx->config) {
+        return 0;
+    }
+
+    uint32_t asns[64];
+    size_t count = asnrate_take_blocks(asns, ARRAY_SIZE(asns));
+    if (count == 0) {
+        return 0;
+    }
+
+    const asnmap_t *asnmap = __atomic_load_n(&ctx->asnmap, __ATOMIC_ACQUIRE);
+    if (!asnmap) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        expiry_block_asn(asnmap, asns[i], ctx->config);
+    }
+
+    return count;
+}
+
 static void *expiry_thread_func(void *arg) {
     app_context_t *ctx = (app_context_t *)arg;
 
     LOG_INFO("Expiration check thread started (interval=%us)", check_interval);
 
     while (expiry_running && ctx->running) {
-        /* Sleep for check interval */
+        /* Sleep for check interval; queued AS blocks are added every second */
         for (uint32_t i = 0; i < check_interval && expiry_running && ctx->running; i++) {
             sleep(1);
+            expiry_block_asns_now(ctx);
         }
 
         if (!expiry_running || !ctx->running) {
@@ -79,6 +153,14 @@ static void *expiry_thread_func(void *arg) {
 
         /* Check for expired blocks */
         expiry_check_now(ctx);
+
+        /* Fold neighbouring blocks into CIDR entries */
+        if (compact_enabled()) {
+            compact_run(ctx);
+        }
+
+        /* Free whitelist nodes the readers have moved past since the last edit */
+        whitelist_reclaim(false);
     }
 
     LOG_INFO("Expiration check thread stopped");
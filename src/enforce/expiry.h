@@ -28,4 +28,12 @@ void expiry_stop(void);
  */
 size_t expiry_check_now(app_context_t *ctx);
 
+/**
+ * Add the prefixes of the ASes queued by asn_block to asn_ipset
+ * (runs every second on the expiration thread)
+ * @param ctx Application context
+ * @return Number of ASes taken from the queue
+ */
+size_t expiry_block_asns_now(app_context_t *ctx);
+
 #endif /* SYNFLOOD_EXPIRY_H */
@@ -8,6 +8,7 @@
  */
 
 #include "ipset_mgr.h"
+#include "blockcap.h"
 #include "../observe/logger.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -17,12 +18,18 @@
 #include <sys/wait.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <sched.h>
 
 static char current_ipset_name[256] = {0};
 static uint32_t current_timeout = 0;
+static ipset_mgr_evict_fn evict_callback = NULL;
+static void *evict_callback_arg = NULL;
 
-/* Helper function to execute ipset commands safely using fork+execl */
-static int execute_ipset_cmd(const char *arg1, const char *arg2, const char *arg3,
+static void evict_entries(const uint32_t *ips, size_t n);
+
+/* Helper function to execute ipset commands safely using fork+execl.
+ * With netns_fd >= 0 the command runs inside that network namespace. */
+static int execute_ipset_cmd(int netns_fd, const char *arg1, const char *arg2, const char *arg3,
                              const char *arg4, const char *arg5, const char *arg6,
                              const char *arg7, const char *arg8) {
     pid_t pid = fork();
@@ -41,6 +48,11 @@ static int execute_ipset_cmd(const char *arg1, const char *arg2, const char *arg
             close(devnull);
         }
 
+        /* ipsets are per namespace: switch before exec */
+        if (netns_fd >= 0 && setns(netns_fd, CLONE_NEWNET) < 0) {
+            _exit(126);
+        }
+
         /* Execute ipset command */
         execl("/usr/sbin/ipset", "ipset", arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8, (char *)NULL);
 
@@ -76,7 +88,7 @@ synflood_ret_t ipset_mgr_init(const char *ipset_name, uint32_t timeout, uint32_t
     snprintf(timeout_str, sizeof(timeout_str), "%u", timeout);
     snprintf(maxelem_str, sizeof(maxelem_str), "%u", max_entries);
 
-    int ret = execute_ipset_cmd("create", "-exist", ipset_name, "hash:ip",
+    int ret = execute_ipset_cmd(-1, "create", "-exist", ipset_name, "hash:ip",
                                  "timeout", timeout_str, "maxelem", maxelem_str);
     if (ret != 0) {
         LOG_ERROR("Failed to create ipset %s", ipset_name);
@@ -86,15 +98,75 @@ synflood_ret_t ipset_mgr_init(const char *ipset_name, uint32_t timeout, uint32_t
     LOG_INFO("ipset manager initialized: name=%s, timeout=%u, maxelem=%u",
              ipset_name, timeout, max_entries);
 
+    /* Track entries so a full set makes room for the worst attackers */
+    if (blockcap_init(max_entries) != SYNFLOOD_OK) {
+        LOG_WARN("Blacklist capacity management disabled: could not allocate %u records",
+                 max_entries);
+        return SYNFLOOD_OK;
+    }
+
+    /* Blocks left from a previous run count against the capacity */
+    ipset_entry_t *existing = calloc(max_entries, sizeof(*existing));
+    ssize_t n = existing ? ipset_mgr_list(ipset_name, existing, max_entries) : -1;
+    uint64_t now = get_monotonic_ns();
+    for (ssize_t i = 0; i < n; i++) {
+        uint64_t expiry = existing[i].timeout_s ? now + sec_to_ns(existing[i].timeout_s)
+                                                : UINT64_MAX;
+        blockcap_admit(existing[i].addr, 0, expiry, now, NULL, 0);
+    }
+    free(existing);
+
+    if (n > 0) {
+        LOG_INFO("Blacklist already holds %zd entries", n);
+    }
+
     return SYNFLOOD_OK;
 }
 
+/* Create an auxiliary set of the given type; kind names it in log messages */
+static synflood_ret_t create_aux_set(const char *ipset_name, const char *type, const char *kind,
+                                     uint32_t timeout, uint32_t max_entries) {
+    if (!ipset_name) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    char timeout_str[32];
+    char maxelem_str[32];
+    snprintf(timeout_str, sizeof(timeout_str), "%u", timeout);
+    snprintf(maxelem_str, sizeof(maxelem_str), "%u", max_entries);
+
+    int ret = execute_ipset_cmd(-1, "create", "-exist", ipset_name, type,
+                                 "timeout", timeout_str, "maxelem", maxelem_str);
+    if (ret != 0) {
+        LOG_ERROR("Failed to create %s ipset %s", kind, ipset_name);
+        return SYNFLOOD_ERROR;
+    }
+
+    LOG_INFO("Using %s ipset: name=%s, timeout=%u, maxelem=%u",
+             kind, ipset_name, timeout, max_entries);
+
+    return SYNFLOOD_OK;
+}
+
+synflood_ret_t ipset_mgr_init_fastpath(const char *ipset_name, uint32_t timeout, uint32_t max_entries) {
+    return create_aux_set(ipset_name, "hash:ip", "fast-path", timeout, max_entries);
+}
+
+synflood_ret_t ipset_mgr_init_net(const char *ipset_name, uint32_t timeout, uint32_t max_entries) {
+    return create_aux_set(ipset_name, "hash:net", "CIDR", timeout, max_entries);
+}
+
+synflood_ret_t ipset_mgr_init_proto(const char *ipset_name, uint32_t timeout, uint32_t max_entries) {
+    return create_aux_set(ipset_name, "hash:ip", "protocol", timeout, max_entries);
+}
+
 void ipset_mgr_shutdown(void) {
     LOG_INFO("ipset manager shutting down");
+    blockcap_cleanup();
     /* Note: We don't destroy the ipset on shutdown to preserve blocks */
 }
 
-synflood_ret_t ipset_mgr_add(uint32_t ip_addr, uint32_t timeout) {
+synflood_ret_t ipset_mgr_add(uint32_t ip_addr, uint32_t timeout, uint32_t rate) {
     char ip_str[INET_ADDRSTRLEN];
     struct in_addr addr = { .s_addr = ip_addr };
     inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
@@ -108,12 +180,26 @@ synflood_ret_t ipset_mgr_add(uint32_t ip_addr, uint32_t timeout) {
         timeout = current_timeout;
     }
 
+    /* A full set makes room by evicting less valuable blocks, or refuses */
+    uint64_t now = get_monotonic_ns();
+    uint32_t evicted[BLOCKCAP_EVICT_MAX];
+    ssize_t n = blockcap_admit(ip_addr, rate, now + sec_to_ns(timeout), now, evicted,
+                               ARRAY_SIZE(evicted));
+    if (n < 0) {
+        LOG_DEBUG("Blacklist full: not blocking %s (rate %u below every entry)", ip_str, rate);
+        return SYNFLOOD_ENOMEM;
+    }
+    if (n > 0) {
+        evict_entries(evicted, (size_t)n);
+    }
+
     char timeout_str[32];
     snprintf(timeout_str, sizeof(timeout_str), "%u", timeout);
 
-    int ret = execute_ipset_cmd("add", "-exist", current_ipset_name, ip_str,
+    int ret = execute_ipset_cmd(-1, "add", "-exist", current_ipset_name, ip_str,
                                  "timeout", timeout_str, NULL, NULL);
     if (ret != 0) {
+        blockcap_remove(ip_addr);
         LOG_ERROR("Failed to add IP %s to ipset %s", ip_str, current_ipset_name);
         return SYNFLOOD_ERROR;
     }
@@ -123,6 +209,30 @@ synflood_ret_t ipset_mgr_add(uint32_t ip_addr, uint32_t timeout) {
     return SYNFLOOD_OK;
 }
 
+synflood_ret_t ipset_mgr_add_to(const char *ipset_name, uint32_t ip_addr, uint32_t timeout) {
+    if (!ipset_name) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    char ip_str[INET_ADDRSTRLEN];
+    struct in_addr addr = { .s_addr = ip_addr };
+    inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+
+    char timeout_str[32];
+    snprintf(timeout_str, sizeof(timeout_str), "%u", timeout);
+
+    int ret = execute_ipset_cmd(-1, "add", "-exist", ipset_name, ip_str,
+                                 "timeout", timeout_str, NULL, NULL);
+    if (ret != 0) {
+        LOG_ERROR("Failed to add IP %s to ipset %s", ip_str, ipset_name);
+        return SYNFLOOD_ERROR;
+    }
+
+    LOG_INFO("Added IP to blacklist: %s (set=%s, timeout=%u)", ip_str, ipset_name, timeout);
+
+    return SYNFLOOD_OK;
+}
+
 synflood_ret_t ipset_mgr_remove(uint32_t ip_addr) {
     char ip_str[INET_ADDRSTRLEN];
     struct in_addr addr = { .s_addr = ip_addr };
@@ -133,13 +243,15 @@ synflood_ret_t ipset_mgr_remove(uint32_t ip_addr) {
         return SYNFLOOD_ERROR;
     }
 
-    int ret = execute_ipset_cmd("del", "-exist", current_ipset_name, ip_str,
+    int ret = execute_ipset_cmd(-1, "del", "-exist", current_ipset_name, ip_str,
                                  NULL, NULL, NULL, NULL);
     if (ret != 0) {
         LOG_ERROR("Failed to remove IP %s from ipset %s", ip_str, current_ipset_name);
         return SYNFLOOD_ERROR;
     }
 
+    blockcap_remove(ip_addr);
+
     LOG_INFO("Removed IP from blacklist: %s", ip_str);
 
     return SYNFLOOD_OK;
@@ -188,13 +300,19 @@ synflood_ret_t ipset_mgr_flush(void) {
         return SYNFLOOD_ERROR;
     }
 
-    int ret = execute_ipset_cmd("flush", current_ipset_name, NULL, NULL,
+    int ret = execute_ipset_cmd(-1, "flush", current_ipset_name, NULL, NULL,
                                  NULL, NULL, NULL, NULL);
     if (ret != 0) {
         LOG_ERROR("Failed to flush ipset %s", current_ipset_name);
         return SYNFLOOD_ERROR;
     }
 
+    if (blockcap_enabled()) {
+        blockcap_stats_t stats;
+        blockcap_get_stats(&stats);
+        blockcap_init(stats.capacity);
+    }
+
     LOG_INFO("Flushed ipset %s", current_ipset_name);
 
     return SYNFLOOD_OK;
@@ -260,3 +378,270 @@ size_t ipset_mgr_get_count(void) {
 
     return count;
 }
+
+/* Parse an `ipset save` member line: "add SET ADDR[/LEN] [timeout N] ..." */
+static bool parse_save_line(char *line, ipset_entry_t *entry) {
+    char *save = NULL;
+    char *word = strtok_r(line, " \t\n", &save);
+    if (!word || strcmp(word, "add") != 0) {
+        return false;
+    }
+
+    strtok_r(NULL, " \t\n", &save); /* Set name */
+    char *member = strtok_r(NULL, " \t\n", &save);
+    if (!member) {
+        return false;
+    }
+
+    unsigned long prefix_len = 32;
+    char *slash = strchr(member, '/');
+    if (slash) {
+        char *end;
+        *slash = '\0';
+        prefix_len = strtoul(slash + 1, &end, 10);
+        if (*end != '\0' || prefix_len > 32) {
+            return false;
+        }
+    }
+
+    struct in_addr addr;
+    if (inet_pton(AF_INET, member, &addr) != 1) {
+        return false;
+    }
+
+    entry->addr = addr.s_addr;
+    entry->prefix_len = (uint8_t)prefix_len;
+    entry->timeout_s = 0;
+
+    while ((word = strtok_r(NULL, " \t\n", &save)) != NULL) {
+        if (strcmp(word, "timeout") == 0 && (word = strtok_r(NULL, " \t\n", &save)) != NULL) {
+            entry->timeout_s = (uint32_t)strtoul(word, NULL, 10);
+        }
+    }
+
+    return true;
+}
+
+ssize_t ipset_mgr_list(const char *ipset_name, ipset_entry_t *out, size_t max) {
+    if (!ipset_name || !out) {
+        return -1;
+    }
+
+    int pipefd[2];
+    if (pipe(pipefd) < 0) {
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        close(pipefd[0]);
+        dup2(pipefd[1], STDOUT_FILENO);
+        close(pipefd[1]);
+
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDERR_FILENO);
+            close(devnull);
+        }
+
+        /* save prints one parseable line per member, unlike list */
+        execl("/usr/sbin/ipset", "ipset", "save", ipset_name, (char *)NULL);
+        _exit(127);
+    }
+
+    close(pipefd[1]);
+
+    FILE *fp = fdopen(pipefd[0], "r");
+    if (!fp) {
+        close(pipefd[0]);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+
+    char line[256];
+    size_t count = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (count < max && parse_save_line(line, &out[count])) {
+            count++;
+        }
+    }
+
+    fclose(fp);
+
+    int status;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return -1;
+    }
+
+    return (ssize_t)count;
+}
+
+synflood_ret_t ipset_mgr_restore(const char *script, size_t len) {
+    if (!script) {
+        return SYNFLOOD_EINVAL;
+    }
+    if (len == 0) {
+        return SYNFLOOD_OK;
+    }
+
+    int pipefd[2];
+    if (pipe(pipefd) < 0) {
+        return SYNFLOOD_ERROR;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        LOG_ERROR("fork() failed: %s", strerror(errno));
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return SYNFLOOD_ERROR;
+    }
+
+    if (pid == 0) {
+        close(pipefd[1]);
+        dup2(pipefd[0], STDIN_FILENO);
+        close(pipefd[0]);
+
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+            close(devnull);
+        }
+
+        execl("/usr/sbin/ipset", "ipset", "restore", "-exist", (char *)NULL);
+        _exit(127);
+    }
+
+    close(pipefd[0]);
+
+    /* SIGPIPE is ignored: a dead child shows up as a write error */
+    size_t written = 0;
+    while (written < len) {
+        ssize_t n = write(pipefd[1], script + written, len - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        written += (size_t)n;
+    }
+    close(pipefd[1]);
+
+    int status;
+    if (waitpid(pid, &status, 0) < 0) {
+        LOG_ERROR("waitpid() failed: %s", strerror(errno));
+        return SYNFLOOD_ERROR;
+    }
+
+    if (written < len || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        LOG_ERROR("ipset restore failed (%zu of %zu bytes sent)", written, len);
+        return SYNFLOOD_ERROR;
+    }
+
+    return SYNFLOOD_OK;
+}
+
+/* Delete evicted blocks from the blacklist in one batch */
+static void evict_entries(const uint32_t *ips, size_t n) {
+    size_t size = n * (sizeof(current_ipset_name) + INET_ADDRSTRLEN + 8);
+    char *script = malloc(size);
+    if (!script) {
+        return;
+    }
+
+    size_t len = 0;
+    for (size_t i = 0; i < n; i++) {
+        char ip_str[INET_ADDRSTRLEN];
+        struct in_addr addr = { .s_addr = ips[i] };
+        inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+        len += (size_t)snprintf(script + len, size - len, "del %s %s\n", current_ipset_name, ip_str);
+    }
+
+    if (ipset_mgr_restore(script, len) == SYNFLOOD_OK) {
+        LOG_WARN("Blacklist full: evicted %zu lower-priority blocks", n);
+        for (size_t i = 0; evict_callback && i < n; i++) {
+            evict_callback(ips[i], evict_callback_arg);
+        }
+    }
+    free(script);
+}
+
+void ipset_mgr_set_evict_callback(ipset_mgr_evict_fn fn, void *arg) {
+    evict_callback = fn;
+    evict_callback_arg = arg;
+}
+
+synflood_ret_t ipset_mgr_create_in(int netns_fd, const char *ipset_name, uint32_t timeout,
+                                   uint32_t max_entries) {
+    if (netns_fd < 0 || !ipset_name) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    char timeout_str[32];
+    char maxelem_str[32];
+    snprintf(timeout_str, sizeof(timeout_str), "%u", timeout);
+    snprintf(maxelem_str, sizeof(maxelem_str), "%u", max_entries);
+
+    int ret = execute_ipset_cmd(netns_fd, "create", "-exist", ipset_name, "hash:ip",
+                                "timeout", timeout_str, "maxelem", maxelem_str);
+    if (ret != 0) {
+        LOG_ERROR("Failed to create ipset %s in namespace (fd=%d)", ipset_name, netns_fd);
+        return SYNFLOOD_ERROR;
+    }
+
+    return SYNFLOOD_OK;
+}
+
+synflood_ret_t ipset_mgr_add_in(int netns_fd, const char *ipset_name, uint32_t ip_addr,
+                                uint32_t timeout) {
+    if (netns_fd < 0 || !ipset_name) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    char ip_str[INET_ADDRSTRLEN];
+    struct in_addr addr = { .s_addr = ip_addr };
+    inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+
+    char timeout_str[32];
+    snprintf(timeout_str, sizeof(timeout_str), "%u", timeout);
+
+    int ret = execute_ipset_cmd(netns_fd, "add", "-exist", ipset_name, ip_str,
+                                "timeout", timeout_str, NULL, NULL);
+    if (ret != 0) {
+        LOG_ERROR("Failed to add IP %s to ipset %s in namespace", ip_str, ipset_name);
+        return SYNFLOOD_ERROR;
+    }
+
+    LOG_INFO("Added IP to blacklist: %s (set=%s, timeout=%u)", ip_str, ipset_name, timeout);
+
+    return SYNFLOOD_OK;
+}
+
+synflood_ret_t ipset_mgr_remove_in(int netns_fd, const char *ipset_name, uint32_t ip_addr) {
+    if (netns_fd < 0 || !ipset_name) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    char ip_str[INET_ADDRSTRLEN];
+    struct in_addr addr = { .s_addr = ip_addr };
+    inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+
+    int ret = execute_ipset_cmd(netns_fd, "del", "-exist", ipset_name, ip_str,
+                                NULL, NULL, NULL, NULL);
+    if (ret != 0) {
+        LOG_ERROR("Failed to remove IP %s from ipset %s in namespace", ip_str, ipset_name);
+        return SYNFLOOD_ERROR;
+    }
+
+    LOG_INFO("Removed IP from blacklist: %s (set=%s)", ip_str, ipset_name);
+
+    return SYNFLOOD_OK;
+}
@@ -7,6 +7,15 @@
 #define SYNFLOOD_IPSET_MGR_H
 
 #include "common.h"
+#include <sys/types.h>
+
+/* One member of an ipset as listed by ipset_mgr_list() */
+typedef struct
+{
+    uint32_t addr;       /* Network byte order */
+    uint8_t prefix_len;  /* 32 for single addresses */
+    uint32_t timeout_s;  /* Remaining time, 0 if the set has no timeouts */
+} ipset_entry_t;
 
 /**
  * Initialize ipset manager and create ipset if needed
@@ -17,18 +26,71 @@
  */
 synflood_ret_t ipset_mgr_init(const char *ipset_name, uint32_t timeout, uint32_t max_entries);
 
+/**
+ * Create the fast-path ipset used by the kernel rules to let known-good
+ * sources bypass NFQUEUE (entries are added by the kernel, not the daemon)
+ * @param ipset_name Name of the fast-path ipset
+ * @param timeout Default timeout for entries (seconds)
+ * @param max_entries Maximum number of entries in ipset
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t ipset_mgr_init_fastpath(const char *ipset_name, uint32_t timeout, uint32_t max_entries);
+
+/**
+ * Create a hash:net ipset (CIDR entries, e.g. for blocklist compaction)
+ * @param ipset_name Name of the ipset
+ * @param timeout Default timeout for entries (seconds)
+ * @param max_entries Maximum number of entries in ipset
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t ipset_mgr_init_net(const char *ipset_name, uint32_t timeout, uint32_t max_entries);
+
+/**
+ * Create a per-protocol blacklist (hash:ip, e.g. udp_ipset). Entries are
+ * not subject to blacklist capacity management.
+ * @param ipset_name Name of the ipset
+ * @param timeout Default timeout for entries (seconds)
+ * @param max_entries Maximum number of entries in ipset
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t ipset_mgr_init_proto(const char *ipset_name, uint32_t timeout, uint32_t max_entries);
+
 /**
  * Shutdown ipset manager
  */
 void ipset_mgr_shutdown(void);
 
+/* Told about each block deleted from a full blacklist to make room */
+typedef void (*ipset_mgr_evict_fn)(uint32_t ip_addr, void *arg);
+
+/**
+ * Set the function told about evicted blocks, so the caller can clear
+ * its own record of them
+ * @param fn Callback, run on the thread adding the new block (NULL = none)
+ * @param arg Passed to fn
+ */
+void ipset_mgr_set_evict_callback(ipset_mgr_evict_fn fn, void *arg);
+
 /**
  * Add an IP address to the blacklist
+ * When the set is full, blocks worth less than this one are evicted in a
+ * batch to make room (see blockcap.h).
  * @param ip_addr IP address to block (network byte order)
  * @param timeout Timeout in seconds (0 for default)
+ * @param rate SYNs in the window that triggered the block (BLOCKCAP_RATE_MANUAL for
+ *             operator blocks, 0 if unknown)
+ * @return SYNFLOOD_OK on success, SYNFLOOD_ENOMEM if the set is full of more valuable blocks
+ */
+synflood_ret_t ipset_mgr_add(uint32_t ip_addr, uint32_t timeout, uint32_t rate);
+
+/**
+ * Add an IP address to a per-protocol blacklist
+ * @param ipset_name Set created with ipset_mgr_init_proto()
+ * @param ip_addr IP address to block (network byte order)
+ * @param timeout Timeout in seconds
  * @return SYNFLOOD_OK on success
  */
-synflood_ret_t ipset_mgr_add(uint32_t ip_addr, uint32_t timeout);
+synflood_ret_t ipset_mgr_add_to(const char *ipset_name, uint32_t ip_addr, uint32_t timeout);
 
 /**
  * Remove an IP address from the blacklist
@@ -56,4 +118,52 @@ synflood_ret_t ipset_mgr_flush(void);
  */
 size_t ipset_mgr_get_count(void);
 
+/**
+ * List the members of an ipset with their remaining timeouts
+ * @param ipset_name Name of the ipset
+ * @param out Output entries
+ * @param max Capacity of out (further members are not returned)
+ * @return Number of entries written, or -1 if the set could not be listed
+ */
+ssize_t ipset_mgr_list(const char *ipset_name, ipset_entry_t *out, size_t max);
+
+/**
+ * Apply a batch of ipset commands with a single `ipset restore -exist`
+ * @param script Commands in `ipset save` syntax, one per line
+ * @param len Script length
+ * @return SYNFLOOD_OK if every command succeeded
+ */
+synflood_ret_t ipset_mgr_restore(const char *script, size_t len);
+
+/**
+ * Create a blacklist ipset inside another network namespace
+ * @param netns_fd Namespace file descriptor (from open() on /proc/PID/ns/net)
+ * @param ipset_name Name of the ipset
+ * @param timeout Default timeout for entries (seconds)
+ * @param max_entries Maximum number of entries in ipset
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t ipset_mgr_create_in(int netns_fd, const char *ipset_name, uint32_t timeout,
+                                   uint32_t max_entries);
+
+/**
+ * Add an IP address to a blacklist inside another network namespace
+ * @param netns_fd Namespace file descriptor
+ * @param ipset_name Name of the ipset
+ * @param ip_addr IP address to block (network byte order)
+ * @param timeout Timeout in seconds
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t ipset_mgr_add_in(int netns_fd, const char *ipset_name, uint32_t ip_addr,
+                                uint32_t timeout);
+
+/**
+ * Remove an IP address from a blacklist inside another network namespace
+ * @param netns_fd Namespace file descriptor
+ * @param ipset_name Name of the ipset
+ * @param ip_addr IP address to unblock (network byte order)
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t ipset_mgr_remove_in(int netns_fd, const char *ipset_name, uint32_t ip_addr);
+
 #endif /* SYNFLOOD_IPSET_MGR_H */
@@ -0,0 +1,695 @@
+/*
+ * peersync.c - Blocklist sharing between cluster nodes
+ * TCP SYN Flood Detector
+ */
+
+#include "peersync.h"
+#include "ipset_mgr.h"
+#include "../analysis/tracker.h"
+#include "../analysis/whitelist.h"
+#include "../observe/logger.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <pthread.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Longest wait before the thread notices shutdown */
+#define PEERSYNC_POLL_MS 500
+
+static app_context_t *peer_ctx = NULL;
+static int sock_fd = -1;
+static volatile bool peersync_active = false;
+static uint8_t peer_key[PEERSYNC_KEY_LEN];
+static uint32_t node_id = 0;
+static uint64_t next_seq = 0;
+static uint32_t batch_ms = DEFAULT_PEERSYNC_BATCH_MS;
+static uint32_t max_age_s = DEFAULT_PEERSYNC_MAX_AGE_S;
+
+/* Every datagram goes to the multicast group (if any) and each peer */
+static struct sockaddr_in destinations[SYNFLOOD_MAX_PEERS + 1];
+static size_t destination_count = 0;
+
+/* Pending announcements and counters */
+static pthread_mutex_t peersync_lock = PTHREAD_MUTEX_INITIALIZER;
+static peersync_block_t pending[PEERSYNC_MAX_PENDING];
+static size_t pending_count = 0;
+static peersync_stats_t stats;
+
+/* Replay window per sender (receive thread only): highest sequence number
+ * seen and a bitmap of the 64 below it, so reordered datagrams still count */
+typedef struct
+{
+    uint32_t node_id;
+    uint64_t seq;
+    uint64_t seen;
+    uint64_t last_seen_s;
+} peersync_sender_t;
+
+static peersync_sender_t senders[PEERSYNC_MAX_SENDERS];
+
+static pthread_t peersync_thread;
+static volatile bool peersync_running = false;
+
+/* Held shared while applying received blocks, exclusively during reload */
+static pthread_rwlock_t pause_lock;
+static bool pause_lock_ready = false;
+
+/* SipHash-2-4 (Aumasson & Bernstein), used as a 64-bit MAC */
+#define ROTL64(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+#define SIPROUND                                                   \
+    do {                                                           \
+        v0 += v1; v1 = ROTL64(v1, 13); v1 ^= v0; v0 = ROTL64(v0, 32); \
+        v2 += v3; v3 = ROTL64(v3, 16); v3 ^= v2;                   \
+        v0 += v3; v3 = ROTL64(v3, 21); v3 ^= v0;                   \
+        v2 += v1; v1 = ROTL64(v1, 17); v1 ^= v2; v2 = ROTL64(v2, 32); \
+    } while (0)
+
+static uint64_t load_le64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+static uint64_t siphash24(const uint8_t key[PEERSYNC_KEY_LEN], const uint8_t *in, size_t len) {
+    uint64_t k0 = load_le64(key);
+    uint64_t k1 = load_le64(key + 8);
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+    const uint8_t *end = in + (len & ~(size_t)7);
+
+    for (; in != end; in += 8) {
+        uint64_t m = load_le64(in);
+        v3 ^= m;
+        SIPROUND;
+        SIPROUND;
+        v0 ^= m;
+    }
+
+    uint64_t b = (uint64_t)len << 56;
+    for (size_t i = 0; i < (len & 7); i++) {
+        b |= (uint64_t)in[i] << (8 * i);
+    }
+
+    v3 ^= b;
+    SIPROUND;
+    SIPROUND;
+    v0 ^= b;
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+static void put_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static void put_be64(uint8_t *p, uint64_t v) {
+    put_be32(p, (uint32_t)(v >> 32));
+    put_be32(p + 4, (uint32_t)v);
+}
+
+static uint32_t get_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t get_be64(const uint8_t *p) {
+    return ((uint64_t)get_be32(p) << 32) | get_be32(p + 4);
+}
+
+synflood_ret_t peersync_parse_key(const char *text, uint8_t key[PEERSYNC_KEY_LEN]) {
+    if (!text || !key) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    while (isspace((unsigned char)*text)) {
+        text++;
+    }
+
+    for (size_t i = 0; i < PEERSYNC_KEY_LEN; i++) {
+        unsigned int byte;
+        if (!isxdigit((unsigned char)text[0]) || !isxdigit((unsigned char)text[1]) ||
+            sscanf(text, "%2x", &byte) != 1) {
+            return SYNFLOOD_EINVAL;
+        }
+        key[i] = (uint8_t)byte;
+        text += 2;
+    }
+
+    while (isspace((unsigned char)*text)) {
+        text++;
+    }
+
+    return (*text == '\0') ? SYNFLOOD_OK : SYNFLOOD_EINVAL;
+}
+
+size_t peersync_encode(const uint8_t key[PEERSYNC_KEY_LEN], const peersync_batch_t *batch,
+                       uint8_t *buf, size_t size) {
+    if (!key || !batch || !buf || batch->count > PEERSYNC_MAX_RECORDS) {
+        return 0;
+    }
+
+    size_t len = PEERSYNC_HEADER_LEN + batch->count * PEERSYNC_RECORD_LEN + PEERSYNC_TAG_LEN;
+    if (size < len) {
+        return 0;
+    }
+
+    put_be32(buf, PEERSYNC_MAGIC);
+    buf[4] = PEERSYNC_VERSION;
+    buf[5] = (uint8_t)batch->count;
+    buf[6] = 0;
+    buf[7] = 0;
+    put_be32(buf + 8, batch->node_id);
+    put_be64(buf + 12, batch->seq);
+    put_be64(buf + 20, batch->timestamp_s);
+
+    uint8_t *rec = buf + PEERSYNC_HEADER_LEN;
+    for (size_t i = 0; i < batch->count; i++, rec += PEERSYNC_RECORD_LEN) {
+        memcpy(rec, &batch->blocks[i].ip, 4); /* Already network byte order */
+        put_be32(rec + 4, batch->blocks[i].remaining_s);
+        rec[8] = batch->blocks[i].reason;
+        rec[9] = rec[10] = rec[11] = 0;
+    }
+
+    put_be64(rec, siphash24(key, buf, (size_t)(rec - buf)));
+
+    return len;
+}
+
+synflood_ret_t peersync_decode(const uint8_t key[PEERSYNC_KEY_LEN], const uint8_t *buf,
+                               size_t len, peersync_batch_t *batch) {
+    if (!key || !buf || !batch || len < PEERSYNC_HEADER_LEN + PEERSYNC_TAG_LEN) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    size_t count = buf[5];
+    if (get_be32(buf) != PEERSYNC_MAGIC || buf[4] != PEERSYNC_VERSION ||
+        count > PEERSYNC_MAX_RECORDS ||
+        len != PEERSYNC_HEADER_LEN + count * PEERSYNC_RECORD_LEN + PEERSYNC_TAG_LEN) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    /* Compare the whole tag so timing does not reveal a matching prefix */
+    size_t body = len - PEERSYNC_TAG_LEN;
+    uint64_t diff = siphash24(key, buf, body) ^ get_be64(buf + body);
+    if (diff != 0) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    batch->node_id = get_be32(buf + 8);
+    batch->seq = get_be64(buf + 12);
+    batch->timestamp_s = get_be64(buf + 20);
+    batch->count = count;
+
+    const uint8_t *rec = buf + PEERSYNC_HEADER_LEN;
+    for (size_t i = 0; i < count; i++, rec += PEERSYNC_RECORD_LEN) {
+        memcpy(&batch->blocks[i].ip, rec, 4);
+        batch->blocks[i].remaining_s = get_be32(rec + 4);
+        batch->blocks[i].reason = rec[8];
+    }
+
+    return SYNFLOOD_OK;
+}
+
+static uint64_t wall_clock_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec;
+}
+
+static synflood_ret_t peersync_load_key(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        LOG_ERROR("Cannot open peer sync key file %s: %s", path, strerror(errno));
+        return SYNFLOOD_ERROR;
+    }
+
+    char text[128] = {0};
+    size_t n = fread(text, 1, sizeof(text) - 1, fp);
+    fclose(fp);
+    text[n] = '\0';
+
+    synflood_ret_t ret = peersync_parse_key(text, peer_key);
+    memset(text, 0, sizeof(text));
+    if (ret != SYNFLOOD_OK) {
+        LOG_ERROR("Invalid peer sync key in %s (expected 32 hex digits)", path);
+    }
+
+    return ret;
+}
+
+static uint32_t peersync_random_id(void) {
+    uint32_t id = 0;
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        if (read(fd, &id, sizeof(id)) != (ssize_t)sizeof(id)) {
+            id = 0;
+        }
+        close(fd);
+    }
+
+    if (id == 0) {
+        id = (uint32_t)getpid() ^ (uint32_t)get_monotonic_ns() ^ (uint32_t)wall_clock_s();
+    }
+
+    return id ? id : 1;
+}
+
+synflood_ret_t peersync_init(app_context_t *ctx) {
+    if (!ctx || !ctx->config) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    const synflood_config_t *config = ctx->config;
+    if (config->peersync_port == 0) {
+        return SYNFLOOD_OK;
+    }
+
+    if (peersync_load_key(config->peersync_key_file) != SYNFLOOD_OK) {
+        return SYNFLOOD_ERROR;
+    }
+
+    struct in_addr bind_addr = { .s_addr = htonl(INADDR_ANY) };
+    if (config->peersync_bind[0] != '\0' &&
+        inet_pton(AF_INET, config->peersync_bind, &bind_addr) != 1) {
+        LOG_ERROR("Invalid peer sync bind address: %s", config->peersync_bind);
+        return SYNFLOOD_EINVAL;
+    }
+
+    struct in_addr group = { .s_addr = htonl(INADDR_ANY) };
+    if (config->peersync_group[0] != '\0' &&
+        inet_pton(AF_INET, config->peersync_group, &group) != 1) {
+        LOG_ERROR("Invalid peer sync group: %s", config->peersync_group);
+        return SYNFLOOD_EINVAL;
+    }
+
+    sock_fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (sock_fd < 0) {
+        LOG_ERROR("Failed to create peer sync socket: %s", strerror(errno));
+        return SYNFLOOD_ERROR;
+    }
+
+    /* Several instances on one host may join the same group */
+    int one = 1;
+    setsockopt(sock_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    /* Multicast datagrams only arrive on a wildcard (or group) bind */
+    struct sockaddr_in local = {
+        .sin_family = AF_INET,
+        .sin_port = htons(config->peersync_port),
+        .sin_addr = config->peersync_group[0] ? (struct in_addr){ htonl(INADDR_ANY) } : bind_addr,
+    };
+    if (bind(sock_fd, (struct sockaddr *)&local, sizeof(local)) < 0) {
+        LOG_ERROR("Failed to bind peer sync socket to port %u: %s", config->peersync_port,
+                  strerror(errno));
+        peersync_cleanup();
+        return SYNFLOOD_ERROR;
+    }
+
+    destination_count = 0;
+    if (config->peersync_group[0] != '\0') {
+        struct ip_mreq mreq = { .imr_multiaddr = group, .imr_interface = bind_addr };
+        unsigned char ttl = (unsigned char)config->peersync_ttl;
+        unsigned char loop = 1; /* Other instances on this host; own datagrams are skipped */
+
+        if (setsockopt(sock_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+            LOG_ERROR("Failed to join peer sync group %s: %s", config->peersync_group,
+                      strerror(errno));
+            peersync_cleanup();
+            return SYNFLOOD_ERROR;
+        }
+        setsockopt(sock_fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+        setsockopt(sock_fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+        if (bind_addr.s_addr != htonl(INADDR_ANY)) {
+            setsockopt(sock_fd, IPPROTO_IP, IP_MULTICAST_IF, &bind_addr, sizeof(bind_addr));
+        }
+
+        destinations[destination_count++] = (struct sockaddr_in){
+            .sin_family = AF_INET,
+            .sin_port = htons(config->peersync_port),
+            .sin_addr = group,
+        };
+    }
+
+    for (uint32_t i = 0; i < config->peersync_peer_count && i < SYNFLOOD_MAX_PEERS; i++) {
+        destinations[destination_count++] = (struct sockaddr_in){
+            .sin_family = AF_INET,
+            .sin_port = htons(config->peersync_peers[i].port),
+            .sin_addr = { .s_addr = config->peersync_peers[i].ip },
+        };
+    }
+
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&pause_lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+    pause_lock_ready = true;
+
+    peer_ctx = ctx;
+    node_id = peersync_random_id();
+    next_seq = 0;
+    batch_ms = config->peersync_batch_ms ? config->peersync_batch_ms : DEFAULT_PEERSYNC_BATCH_MS;
+    max_age_s = config->peersync_max_age_s ? config->peersync_max_age_s : DEFAULT_PEERSYNC_MAX_AGE_S;
+    pending_count = 0;
+    memset(&stats, 0, sizeof(stats));
+    memset(senders, 0, sizeof(senders));
+    peersync_active = true;
+
+    LOG_INFO("Peer sync on port %u: group=%s, peers=%u, node=%08x, batch=%ums",
+             config->peersync_port,
+             config->peersync_group[0] ? config->peersync_group : "(none)",
+             config->peersync_peer_count, node_id, batch_ms);
+
+    return SYNFLOOD_OK;
+}
+
+bool peersync_enabled(void) {
+    return peersync_active;
+}
+
+void peersync_announce(uint32_t ip_addr, uint32_t duration_s, peersync_reason_t reason) {
+    if (!peersync_active) {
+        return;
+    }
+
+    pthread_mutex_lock(&peersync_lock);
+    if (pending_count < PEERSYNC_MAX_PENDING) {
+        pending[pending_count++] = (peersync_block_t){
+            .ip = ip_addr,
+            .remaining_s = duration_s,
+            .reason = (uint8_t)reason,
+        };
+        stats.announced_total++;
+    } else {
+        stats.announce_dropped_total++;
+    }
+    pthread_mutex_unlock(&peersync_lock);
+}
+
+size_t peersync_flush(void) {
+    if (!peersync_active) {
+        return 0;
+    }
+
+    peersync_block_t queued[PEERSYNC_MAX_PENDING];
+    pthread_mutex_lock(&peersync_lock);
+    size_t count = pending_count;
+    memcpy(queued, pending, count * sizeof(queued[0]));
+    pending_count = 0;
+    pthread_mutex_unlock(&peersync_lock);
+
+    size_t sent = 0;
+    size_t errors = 0;
+    uint8_t buf[PEERSYNC_MAX_DATAGRAM];
+    peersync_batch_t batch = { .node_id = node_id };
+
+    for (size_t off = 0; off < count; off += batch.count) {
+        batch.count = MIN(count - off, (size_t)PEERSYNC_MAX_RECORDS);
+        batch.seq = __atomic_add_fetch(&next_seq, 1, __ATOMIC_RELAXED);
+        batch.timestamp_s = wall_clock_s();
+        memcpy(batch.blocks, &queued[off], batch.count * sizeof(batch.blocks[0]));
+
+        size_t len = peersync_encode(peer_key, &batch, buf, sizeof(buf));
+        for (size_t d = 0; d < destination_count; d++) {
+            if (sendto(sock_fd, buf, len, 0, (const struct sockaddr *)&destinations[d],
+                       sizeof(destinations[d])) == (ssize_t)len) {
+                sent++;
+            } else {
+                errors++;
+                LOG_DEBUG("Peer sync send to %s failed: %s",
+                          inet_ntoa(destinations[d].sin_addr), strerror(errno));
+            }
+        }
+    }
+
+    if (count > 0) {
+        pthread_mutex_lock(&peersync_lock);
+        stats.datagrams_sent_total += sent;
+        stats.send_errors_total += errors;
+        pthread_mutex_unlock(&peersync_lock);
+    }
+
+    return sent;
+}
+
+/* Accept a sequence number once per sender; unknown senders replace the
+ * one heard from least recently */
+static bool peersync_accept_seq(uint32_t sender, uint64_t seq, uint64_t now_s) {
+    peersync_sender_t *slot = &senders[0];
+
+    for (size_t i = 0; i < PEERSYNC_MAX_SENDERS; i++) {
+        peersync_sender_t *s = &senders[i];
+        if (s->node_id != sender) {
+            if (s->last_seen_s < slot->last_seen_s) {
+                slot = s;
+            }
+            continue;
+        }
+
+        if (seq > s->seq) {
+            uint64_t shift = seq - s->seq;
+            s->seen = (shift >= 64) ? 1 : (s->seen << shift) | 1;
+            s->seq = seq;
+        } else {
+            uint64_t back = s->seq - seq;
+            if (back >= 64 || (s->seen & (1ULL << back))) {
+                return false;
+            }
+            s->seen |= 1ULL << back;
+        }
+        s->last_seen_s = now_s;
+        return true;
+    }
+
+    slot->node_id = sender;
+    slot->seq = seq;
+    slot->seen = 1;
+    slot->last_seen_s = now_s;
+    return true;
+}
+
+typedef enum
+{
+    PEERSYNC_APPLIED,
+    PEERSYNC_DUPLICATE,
+    PEERSYNC_WHITELISTED,
+    PEERSYNC_FAILED,
+} peersync_outcome_t;
+
+/* Block one announced source through the local enforcement path */
+static peersync_outcome_t peersync_apply(const peersync_block_t *block, uint64_t now) {
+    app_context_t *ctx = peer_ctx;
+
+    whitelist_reader_online();
+    whitelist_node_t *whitelist = __atomic_load_n(&ctx->whitelist_root, __ATOMIC_ACQUIRE);
+    bool whitelisted = whitelist && whitelist_check(whitelist, block->ip);
+    whitelist_reader_offline();
+
+    if (whitelisted) {
+        return PEERSYNC_WHITELISTED;
+    }
+
+    uint32_t duration_s = MIN(block->remaining_s, 86400u);
+    uint64_t expiry = now + sec_to_ns(duration_s);
+
+    /* Another node, or this one, already blocked it at least as long */
+    ip_tracker_t *tracker = tracker_get_or_create(ctx->tracker, block->ip);
+    if (tracker && tracker->blocked && tracker->block_expiry_ns + NSEC_PER_SEC >= expiry) {
+        return PEERSYNC_DUPLICATE;
+    }
+
+    /* -exist also extends the timeout of an entry that is already present */
+    if (ipset_mgr_add(block->ip, duration_s, 0) != SYNFLOOD_OK) {
+        return PEERSYNC_FAILED;
+    }
+
+    if (tracker) {
+        tracker->blocked = 1;
+        tracker->block_expiry_ns = expiry;
+    }
+
+    logger_log_event(EVENT_PEER_BLOCKED, block->ip, 0, 0);
+    return PEERSYNC_APPLIED;
+}
+
+size_t peersync_handle_datagram(const uint8_t *buf, size_t len) {
+    if (!peersync_active) {
+        return 0;
+    }
+
+    peersync_batch_t batch;
+    if (peersync_decode(peer_key, buf, len, &batch) != SYNFLOOD_OK) {
+        LOG_DEBUG("Peer sync datagram rejected: malformed or bad tag");
+        pthread_mutex_lock(&peersync_lock);
+        stats.datagrams_rejected_total++;
+        pthread_mutex_unlock(&peersync_lock);
+        return 0;
+    }
+
+    /* Our own multicast, looped back */
+    if (batch.node_id == node_id) {
+        return 0;
+    }
+
+    uint64_t now_s = wall_clock_s();
+    uint64_t age = (now_s > batch.timestamp_s) ? now_s - batch.timestamp_s
+                                                : batch.timestamp_s - now_s;
+    if (age > max_age_s || !peersync_accept_seq(batch.node_id, batch.seq, now_s)) {
+        LOG_DEBUG("Peer sync datagram from node %08x rejected: stale or replayed",
+                  batch.node_id);
+        pthread_mutex_lock(&peersync_lock);
+        stats.datagrams_rejected_total++;
+        pthread_mutex_unlock(&peersync_lock);
+        return 0;
+    }
+
+    size_t outcomes[PEERSYNC_FAILED + 1] = {0};
+    uint64_t now = get_monotonic_ns();
+
+    pthread_rwlock_rdlock(&pause_lock);
+    for (size_t i = 0; i < batch.count; i++) {
+        const peersync_block_t *block = &batch.blocks[i];
+        if (block->ip == 0 || block->ip == 0xFFFFFFFFu || block->remaining_s == 0) {
+            continue;
+        }
+        outcomes[peersync_apply(block, now)]++;
+    }
+    pthread_rwlock_unlock(&pause_lock);
+
+    if (outcomes[PEERSYNC_APPLIED] > 0) {
+        LOG_INFO("Applied %zu blocks from node %08x", outcomes[PEERSYNC_APPLIED], batch.node_id);
+
+        pthread_mutex_lock(&peer_ctx->metrics_lock);
+        peer_ctx->metrics.blocked_ips_current = ipset_mgr_get_count();
+        pthread_mutex_unlock(&peer_ctx->metrics_lock);
+    }
+
+    pthread_mutex_lock(&peersync_lock);
+    stats.received_total += batch.count;
+    stats.applied_total += outcomes[PEERSYNC_APPLIED];
+    stats.duplicates_total += outcomes[PEERSYNC_DUPLICATE];
+    stats.whitelisted_total += outcomes[PEERSYNC_WHITELISTED];
+    stats.apply_errors_total += outcomes[PEERSYNC_FAILED];
+    pthread_mutex_unlock(&peersync_lock);
+
+    return outcomes[PEERSYNC_APPLIED];
+}
+
+static void *peersync_thread_func(void *arg) {
+    (void)arg;
+    uint8_t buf[PEERSYNC_MAX_DATAGRAM + 1]; /* +1 so oversized datagrams fail to decode */
+    uint64_t batch_ns = ms_to_ns(batch_ms);
+    uint64_t last_flush = get_monotonic_ns();
+    int timeout_ms = (int)MIN(batch_ms, (uint32_t)PEERSYNC_POLL_MS);
+
+    LOG_INFO("Peer sync thread started");
+
+    while (peersync_running) {
+        struct pollfd pfd = { .fd = sock_fd, .events = POLLIN };
+        int ret = poll(&pfd, 1, timeout_ms);
+
+        if (ret > 0 && (pfd.revents & POLLIN)) {
+            ssize_t n;
+            while ((n = recv(sock_fd, buf, sizeof(buf), MSG_DONTWAIT)) >= 0) {
+                peersync_handle_datagram(buf, (size_t)n);
+            }
+        } else if (ret < 0 && errno != EINTR) {
+            LOG_ERROR("Peer sync poll failed: %s", strerror(errno));
+            break;
+        }
+
+        uint64_t now = get_monotonic_ns();
+        if (now - last_flush >= batch_ns) {
+            peersync_flush();
+            last_flush = now;
+        }
+    }
+
+    /* Blocks detected during shutdown still reach the other nodes */
+    peersync_flush();
+
+    LOG_INFO("Peer sync thread stopped");
+    return NULL;
+}
+
+synflood_ret_t peersync_start(void) {
+    if (!peersync_active || peersync_running) {
+        return SYNFLOOD_OK;
+    }
+
+    peersync_running = true;
+    if (pthread_create(&peersync_thread, NULL, peersync_thread_func, NULL) != 0) {
+        LOG_ERROR("Failed to create peer sync thread");
+        peersync_running = false;
+        return SYNFLOOD_ERROR;
+    }
+
+    return SYNFLOOD_OK;
+}
+
+void peersync_stop(void) {
+    if (!peersync_running) {
+        return;
+    }
+
+    peersync_running = false;
+    pthread_join(peersync_thread, NULL);
+}
+
+void peersync_cleanup(void) {
+    peersync_active = false;
+
+    if (sock_fd >= 0) {
+        close(sock_fd);
+        sock_fd = -1;
+    }
+
+    if (pause_lock_ready) {
+        pthread_rwlock_destroy(&pause_lock);
+        pause_lock_ready = false;
+    }
+
+    memset(peer_key, 0, sizeof(peer_key));
+    destination_count = 0;
+    peer_ctx = NULL;
+}
+
+void peersync_pause(void) {
+    if (pause_lock_ready) {
+        pthread_rwlock_wrlock(&pause_lock);
+    }
+}
+
+void peersync_resume(void) {
+    if (pause_lock_ready) {
+        pthread_rwlock_unlock(&pause_lock);
+    }
+}
+
+void peersync_get_stats(peersync_stats_t *out) {
+    if (!out) {
+        return;
+    }
+
+    pthread_mutex_lock(&peersync_lock);
+    *out = stats;
+    pthread_mutex_unlock(&peersync_lock);
+}
@@ -0,0 +1,187 @@
+/*
+ * peersync.h - Blocklist sharing between cluster nodes
+ * TCP SYN Flood Detector
+ *
+ * Sources blocked by local detection are announced to the other nodes of
+ * the cluster over UDP, to an IPv4 multicast group and/or a list of
+ * unicast peers. Announcements are batched (up to PEERSYNC_MAX_RECORDS per
+ * datagram) and authenticated with a SipHash-2-4 tag over a shared key.
+ * Received blocks go through the local enforcement path (whitelist, ipset,
+ * tracker) and are never re-announced, so announcements cannot loop.
+ *
+ * Wire format (all integers big-endian):
+ *
+ *   magic u32 | version u8 | count u8 | reserved u16 | node_id u32 |
+ *   seq u64 | timestamp_s u64 | count * (ip u32 | remaining_s u32 |
+ *   reason u8 | pad[3]) | tag u64
+ *
+ * node_id is chosen at random on startup, seq increases per datagram and
+ * timestamp_s is the sender's wall clock. A receiver rejects datagrams
+ * whose timestamp is off by more than peersync_max_age_s and sequence
+ * numbers it has already seen from that node.
+ */
+
+#ifndef SYNFLOOD_PEERSYNC_H
+#define SYNFLOOD_PEERSYNC_H
+
+#include "common.h"
+#include <stddef.h>
+
+#define PEERSYNC_MAGIC 0x53465053u /* "SFPS" */
+#define PEERSYNC_VERSION 1
+#define PEERSYNC_KEY_LEN 16
+#define PEERSYNC_TAG_LEN 8
+#define PEERSYNC_HEADER_LEN 28
+#define PEERSYNC_RECORD_LEN 12
+
+/* Records per datagram (keeps datagrams below 1 KB) */
+#define PEERSYNC_MAX_RECORDS 64
+#define PEERSYNC_MAX_DATAGRAM \
+    (PEERSYNC_HEADER_LEN + PEERSYNC_MAX_RECORDS * PEERSYNC_RECORD_LEN + PEERSYNC_TAG_LEN)
+
+/* Announcements queued between flushes; more are dropped */
+#define PEERSYNC_MAX_PENDING 1024
+
+/* Senders remembered for replay protection */
+#define PEERSYNC_MAX_SENDERS 64
+
+/* Why the announcing node blocked the source */
+typedef enum
+{
+    PEERSYNC_REASON_RATE = 1,   /* Per-source SYN threshold */
+    PEERSYNC_REASON_VICTIM = 2, /* Tightened threshold towards an attacked destination */
+    PEERSYNC_REASON_SCAN = 3,   /* Port scan (scan_block) */
+    PEERSYNC_REASON_FLOOD = 4,  /* SYN-ACK, ACK or RST threshold */
+} peersync_reason_t;
+
+/* One announced block */
+typedef struct
+{
+    uint32_t ip;          /* Network byte order */
+    uint32_t remaining_s; /* Block time left at the sender */
+    uint8_t reason;       /* peersync_reason_t */
+} peersync_block_t;
+
+/* Decoded datagram */
+typedef struct
+{
+    uint32_t node_id;
+    uint64_t seq;
+    uint64_t timestamp_s;
+    size_t count;
+    peersync_block_t blocks[PEERSYNC_MAX_RECORDS];
+} peersync_batch_t;
+
+/* Counters exported as synflood_peersync_* metrics */
+typedef struct
+{
+    uint64_t announced_total;        /* Local blocks queued for announcement */
+    uint64_t announce_dropped_total; /* Queue full */
+    uint64_t datagrams_sent_total;
+    uint64_t send_errors_total;
+    uint64_t datagrams_rejected_total; /* Malformed, bad tag, stale or replayed */
+    uint64_t received_total;           /* Authenticated records from other nodes */
+    uint64_t applied_total;            /* Records that blocked or extended a block */
+    uint64_t duplicates_total;         /* Already blocked at least as long */
+    uint64_t whitelisted_total;        /* Ignored: source is whitelisted here */
+    uint64_t apply_errors_total;       /* ipset add failed */
+} peersync_stats_t;
+
+/**
+ * Parse a key given as 32 hex digits (surrounding whitespace ignored)
+ * @param text Key text
+ * @param key Output key
+ * @return SYNFLOOD_OK or SYNFLOOD_EINVAL
+ */
+synflood_ret_t peersync_parse_key(const char *text, uint8_t key[PEERSYNC_KEY_LEN]);
+
+/**
+ * Encode and authenticate one datagram
+ * @param key Shared key
+ * @param batch Header fields and records (count <= PEERSYNC_MAX_RECORDS)
+ * @param buf Output buffer
+ * @param size Buffer size (PEERSYNC_MAX_DATAGRAM is always enough)
+ * @return Datagram length, 0 if the batch or buffer is invalid
+ */
+size_t peersync_encode(const uint8_t key[PEERSYNC_KEY_LEN], const peersync_batch_t *batch,
+                       uint8_t *buf, size_t size);
+
+/**
+ * Verify and decode one datagram
+ * @param key Shared key
+ * @param buf Datagram
+ * @param len Datagram length
+ * @param batch Output batch
+ * @return SYNFLOOD_OK, or SYNFLOOD_EINVAL if malformed or the tag does not match
+ */
+synflood_ret_t peersync_decode(const uint8_t key[PEERSYNC_KEY_LEN], const uint8_t *buf,
+                               size_t len, peersync_batch_t *batch);
+
+/**
+ * Read the key, open and bind the socket and join the multicast group
+ * @param ctx Daemon context - tracker and whitelist used for received blocks
+ * @return SYNFLOOD_OK on success (also when peersync_port is 0)
+ */
+synflood_ret_t peersync_init(app_context_t *ctx);
+
+/**
+ * Start the thread that receives announcements and flushes batches
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t peersync_start(void);
+
+/**
+ * Stop the thread (pending announcements are sent first)
+ */
+void peersync_stop(void);
+
+/**
+ * Close the socket
+ */
+void peersync_cleanup(void);
+
+/**
+ * Hold received blocks while the whitelist is being replaced
+ */
+void peersync_pause(void);
+
+/**
+ * Continue after peersync_pause()
+ */
+void peersync_resume(void);
+
+/**
+ * Whether blocklist sharing is active
+ * @return true after a successful peersync_init() with a port configured
+ */
+bool peersync_enabled(void);
+
+/**
+ * Queue a local block for the next batch (cheap no-op when disabled)
+ * @param ip_addr Blocked source (network byte order)
+ * @param duration_s Block duration
+ * @param reason Detection reason
+ */
+void peersync_announce(uint32_t ip_addr, uint32_t duration_s, peersync_reason_t reason);
+
+/**
+ * Send all queued announcements now
+ * @return Number of datagrams sent
+ */
+size_t peersync_flush(void);
+
+/**
+ * Verify a received datagram and apply its blocks
+ * @param buf Datagram
+ * @param len Datagram length
+ * @return Records applied
+ */
+size_t peersync_handle_datagram(const uint8_t *buf, size_t len);
+
+/**
+ * Get a snapshot of the counters
+ * @param out Output statistics
+ */
+void peersync_get_stats(peersync_stats_t *out);
+
+#endif /* SYNFLOOD_PEERSYNC_H */
@@ -6,15 +6,28 @@
  */
 
 #include "common.h"
+#include "clock.h"
 #include "config/config.h"
 #include "observe/logger.h"
 #include "observe/metrics.h"
+#include "observe/control.h"
+#include "observe/events.h"
 #include "analysis/tracker.h"
 #include "analysis/whitelist.h"
+#include "analysis/engine.h"
+#include "analysis/simd.h"
+#include "analysis/victim.h"
+#include "analysis/scan.h"
+#include "analysis/asnmap.h"
+#include "analysis/asnrate.h"
+#include "analysis/sweeper.h"
 #include "enforce/ipset_mgr.h"
 #include "enforce/expiry.h"
+#include "enforce/compact.h"
+#include "enforce/peersync.h"
 #include "capture/nfqueue.h"
 #include "capture/rawsock.h"
+#include "capture/netns.h"
 
 #include <signal.h>
 #include <stdio.h>
@@ -48,6 +61,101 @@ static void signal_handler(int signum) {
     }
 }
 
+/* Create the UDP and ICMP blacklists in use; a class whose set cannot be
+ * created falls back to ipset_name */
+static void init_proto_sets(synflood_config_t *config) {
+    char *sets[FLOOD_PROTO_COUNT] = {
+        [FLOOD_CLASS_UDP - FLOOD_CLASS_FIRST_PROTO] = config->udp_ipset,
+        [FLOOD_CLASS_ICMP - FLOOD_CLASS_FIRST_PROTO] = config->icmp_ipset,
+    };
+
+    for (unsigned int c = FLOOD_CLASS_FIRST_PROTO; c < FLOOD_CLASS_COUNT; c++) {
+        const char *set = engine_class_ipset(config, (flood_class_t)c);
+        if (!set || engine_class_threshold(config, (flood_class_t)c) == 0) {
+            continue;
+        }
+        if (ipset_mgr_init_proto(set, config->block_duration_s,
+                                 config->max_tracked_ips) != SYNFLOOD_OK) {
+            LOG_WARN("Could not create ipset %s, blocking in %s instead", set, config->ipset_name);
+            sets[c - FLOOD_CLASS_FIRST_PROTO][0] = '\0';
+        }
+    }
+}
+
+/* Fast-path bypass set (populated by the kernel rules, NFQUEUE only). The
+ * fast-path engine variant is only selected once the set exists. */
+static void init_fastpath(synflood_config_t *config) {
+    if (config->use_raw_socket || config->fastpath_mark == 0) {
+        return;
+    }
+    if (ipset_mgr_init_fastpath(config->fastpath_ipset, config->fastpath_timeout_s,
+                                config->max_tracked_ips) != SYNFLOOD_OK) {
+        LOG_WARN("Fast path disabled: could not create ipset %s", config->fastpath_ipset);
+        config->fastpath_mark = 0;
+    }
+}
+
+/* Aggregation of neighbouring blocks into a hash:net set; the set and the
+ * pass buffers are created the first time compaction is enabled */
+static void init_compaction(synflood_config_t *config) {
+    if (config->compact_min_prefix == 0) {
+        return;
+    }
+    if (compact_init(config) != SYNFLOOD_OK) {
+        LOG_WARN("Blocklist compaction disabled: could not create ipset %s",
+                 config->compact_ipset);
+        config->compact_min_prefix = 0;
+    }
+}
+
+/* An evicted block is lifted: keep the tracker from treating it as active */
+static void on_block_evicted(uint32_t ip_addr, void *arg) {
+    app_context_t *ctx = arg;
+
+    ip_tracker_t *tracker = tracker_get(ctx->tracker, ip_addr);
+    if (tracker) {
+        tracker->blocked = 0;
+        tracker->block_expiry_ns = 0;
+    }
+    logger_log_event(EVENT_UNBLOCKED, ip_addr, 0, 0);
+}
+
+/* Map the origin AS snapshot and publish it with what AS tracking needs.
+ * A map that fails to load leaves the current one (if any) in use. */
+static void init_asn_tracking(synflood_config_t *config) {
+    if (config->asn_map_file[0] == '\0') {
+        if (app_ctx.asnmap) {
+            LOG_INFO("Origin AS tracking disabled");
+        }
+        asnmap_replace(&app_ctx.asnmap, NULL, app_ctx.tracker->asnmap_gen);
+        return;
+    }
+
+    asnmap_t *map = asnmap_open(config->asn_map_file);
+    if (!map) {
+        LOG_WARN("%s", app_ctx.asnmap ? "Keeping the previous ASN map"
+                                      : "Origin AS tracking disabled: no usable ASN map");
+        return;
+    }
+
+    /* The AS rate table is allocated when tracking gets enabled */
+    if (!app_ctx.asnmap && asnrate_init(config->max_tracked_asns) != SYNFLOOD_OK) {
+        LOG_WARN("Origin AS tracking disabled: could not allocate AS rate table");
+        asnmap_close(map);
+        return;
+    }
+
+    if (config->asn_block &&
+        ipset_mgr_init_net(config->asn_ipset, config->block_duration_s,
+                           config->max_tracked_ips) != SYNFLOOD_OK) {
+        LOG_WARN("AS blocking disabled: could not create ipset %s", config->asn_ipset);
+        config->asn_block = false;
+    }
+
+    /* Bumping the generation invalidates origins cached in tracker entries */
+    asnmap_replace(&app_ctx.asnmap, map, app_ctx.tracker->asnmap_gen);
+}
+
 /* Handle configuration reload - called from main loop in safe context */
 static void handle_config_reload(void) {
     if (!global_config_path || !app_ctx.config) {
@@ -64,6 +172,9 @@ static void handle_config_reload(void) {
         return;
     }
 
+    /* Whitelist edits made over the control socket must reach the file first */
+    control_flush();
+
     /* Reload whitelist if path changed or always reload for updates */
     whitelist_node_t *new_whitelist = whitelist_load(new_config.whitelist_file);
     if (!new_whitelist && new_config.whitelist_file[0] != '\0') {
@@ -71,27 +182,78 @@ static void handle_config_reload(void) {
         /* Continue with config reload even if whitelist fails */
     }
 
-    /* Update whitelist atomically */
-    if (new_whitelist) {
-        whitelist_node_t *old_whitelist = app_ctx.whitelist_root;
-        app_ctx.whitelist_root = new_whitelist;
-
-        if (old_whitelist) {
-            whitelist_free(old_whitelist);
-        }
+    /* Namespace workers and received peer blocks must not use the old
+     * whitelist or config meanwhile */
+    netns_pause();
+    peersync_pause();
 
+    /* Update whitelist atomically; the old tree is retired and freed once
+     * every online reader has passed a quiescent point. Bumping the
+     * generation invalidates verdicts cached in tracker entries. */
+    if (new_whitelist) {
+        /* Counted while still private: once published, live edits may
+         * retire its nodes, and this thread is not an online reader */
         size_t count = whitelist_count(new_whitelist);
+
+        whitelist_replace(&app_ctx.whitelist_root, new_whitelist, app_ctx.tracker->whitelist_gen);
         LOG_INFO("Reloaded %zu whitelist entries", count);
     }
 
     /* Update configuration - memcpy is atomic for aligned struct on most architectures
      * For critical production use, consider using a config pointer with RCU or double-buffering */
     synflood_config_t *old_config = app_ctx.config;
+
+    /* Victim table is only allocated once victim detection is enabled */
+    if (old_config->victim_threshold == 0 && new_config.victim_threshold != 0) {
+        if (victim_init(new_config.max_tracked_victims) != SYNFLOOD_OK) {
+            LOG_WARN("Victim detection disabled: could not allocate victim table");
+            new_config.victim_threshold = 0;
+        }
+    }
+
+    /* Likewise the scan table */
+    bool scan_was_enabled = old_config->scan_port_threshold != 0 ||
+                            old_config->scan_host_threshold != 0;
+    if (!scan_was_enabled &&
+        (new_config.scan_port_threshold != 0 || new_config.scan_host_threshold != 0)) {
+        if (scan_init(new_config.max_tracked_scanners) != SYNFLOOD_OK) {
+            LOG_WARN("Port scan detection disabled: could not allocate scan table");
+            new_config.scan_port_threshold = 0;
+            new_config.scan_host_threshold = 0;
+        }
+    }
+
+    /* Sets are created with -exist, so existing ones are kept */
+    init_proto_sets(&new_config);
+    init_fastpath(&new_config);
+    init_asn_tracking(&new_config);
+
+    /* Compaction keeps the set it was set up with */
+    if (compact_enabled() && strcmp(new_config.compact_ipset, old_config->compact_ipset) != 0) {
+        LOG_WARN("compact_ipset change takes a restart (keeping %s)", old_config->compact_ipset);
+        snprintf(new_config.compact_ipset, sizeof(new_config.compact_ipset), "%s",
+                 old_config->compact_ipset);
+    }
+    init_compaction(&new_config);
+
+    /* The clock thread is set up once */
+    if (new_config.clock_resolution_us != old_config->clock_resolution_us) {
+        LOG_WARN("clock_resolution_us change takes a restart (keeping %u)",
+                 old_config->clock_resolution_us);
+        new_config.clock_resolution_us = old_config->clock_resolution_us;
+    }
+
     *old_config = new_config;
 
     /* Update logger level if changed */
     logger_set_level(new_config.log_level);
 
+    /* Whitelist presence or feature switches may have changed */
+    engine_select(&app_ctx);
+    rawsock_reload(&new_config);
+    peersync_resume();
+    netns_resume(&app_ctx);
+
     LOG_INFO("Configuration reloaded successfully");
     LOG_INFO("  syn_threshold: %u", new_config.syn_threshold);
     LOG_INFO("  window_ms: %u", new_config.window_ms);
@@ -165,12 +327,29 @@ static synflood_ret_t initialize_subsystems(synflood_config_t *config) {
     LOG_INFO("=== TCP SYN Flood Detector v%s ===", SYNFLOOD_VERSION);
     LOG_INFO("Starting initialization...");
 
+    /* Pick hashing/lookup kernels for this CPU */
+    simd_init();
+
+    /* Cached timestamps, before anything records a time */
+    if (config->clock_resolution_us != 0) {
+        if (clock_cached_start(config->clock_resolution_us) == SYNFLOOD_OK) {
+            LOG_INFO("Cached clock: %u us resolution", config->clock_resolution_us);
+        } else {
+            LOG_WARN("Cached clock unavailable, reading the system clock");
+            config->clock_resolution_us = 0;
+        }
+    }
+
     /* Initialize metrics */
     memset(&app_ctx.metrics, 0, sizeof(metrics_t));
     pthread_mutex_init(&app_ctx.metrics_lock, NULL);
 
-    /* Create tracker table */
-    app_ctx.tracker = tracker_create(config->hash_buckets, config->max_tracked_ips);
+    /* Create tracker table (shared with other daemon processes if named) */
+    if (config->tracker_shm[0] != '\0') {
+        app_ctx.tracker = tracker_create_shared(config->tracker_shm, config->max_tracked_ips);
+    } else {
+        app_ctx.tracker = tracker_create(config->hash_buckets, config->max_tracked_ips);
+    }
     if (!app_ctx.tracker) {
         LOG_ERROR("Failed to create tracker table");
         return SYNFLOOD_ERROR;
@@ -191,6 +370,45 @@ static synflood_ret_t initialize_subsystems(synflood_config_t *config) {
         LOG_ERROR("Failed to initialize ipset manager");
         return ret;
     }
+    ipset_mgr_set_evict_callback(on_block_evicted, &app_ctx);
+
+    init_proto_sets(config);
+
+    init_fastpath(config);
+
+    init_compaction(config);
+
+    /* Per-destination (victim) rate table */
+    if (config->victim_threshold != 0) {
+        if (victim_init(config->max_tracked_victims) != SYNFLOOD_OK) {
+            LOG_WARN("Victim detection disabled: could not allocate victim table");
+            config->victim_threshold = 0;
+        }
+    }
+
+    /* Per-source port scan sketches */
+    if (config->scan_port_threshold != 0 || config->scan_host_threshold != 0) {
+        if (scan_init(config->max_tracked_scanners) != SYNFLOOD_OK) {
+            LOG_WARN("Port scan detection disabled: could not allocate scan table");
+            config->scan_port_threshold = 0;
+            config->scan_host_threshold = 0;
+        }
+    }
+
+    /* Prefix to origin AS snapshot and per-AS rates */
+    init_asn_tracking(config);
+
+    /* Blocklist sharing with other nodes */
+    if (config->peersync_port != 0) {
+        ret = peersync_init(&app_ctx);
+        if (ret != SYNFLOOD_OK) {
+            LOG_ERROR("Failed to initialize peer sync");
+            return ret;
+        }
+    }
+
+    /* Pick the packet-processing variant for this configuration */
+    engine_select(&app_ctx);
 
     /* Initialize metrics server */
     ret = metrics_init(&app_ctx, config->metrics_socket);
@@ -215,6 +433,15 @@ static synflood_ret_t initialize_subsystems(synflood_config_t *config) {
         }
     }
 
+    /* Additional network namespaces (before any other thread is started) */
+    if (config->netns_count > 0) {
+        ret = netns_init(&app_ctx);
+        if (ret != SYNFLOOD_OK) {
+            LOG_ERROR("Failed to attach to network namespaces");
+            return ret;
+        }
+    }
+
     LOG_INFO("All subsystems initialized successfully");
     return SYNFLOOD_OK;
 }
@@ -224,14 +451,21 @@ static void cleanup_subsystems(void) {
     LOG_INFO("Cleaning up subsystems...");
 
     /* Stop threads */
+    netns_stop();
+    peersync_stop();
     expiry_stop();
+    sweeper_stop();
     metrics_stop();
+    events_stop();
 
     /* Cleanup capture */
     nfqueue_cleanup();
     rawsock_cleanup();
+    netns_cleanup();
 
     /* Cleanup enforcement */
+    peersync_cleanup();
+    compact_cleanup();
     ipset_mgr_shutdown();
 
     /* Cleanup analysis */
@@ -244,11 +478,21 @@ static void cleanup_subsystems(void) {
         whitelist_free(app_ctx.whitelist_root);
         app_ctx.whitelist_root = NULL;
     }
+    whitelist_reclaim(true);
+
+    asnmap_replace(&app_ctx.asnmap, NULL, NULL);
+    asnmap_reclaim(true);
+
+    victim_cleanup();
+    scan_cleanup();
+    asnrate_cleanup();
 
     /* Cleanup observability */
     metrics_cleanup();
     pthread_mutex_destroy(&app_ctx.metrics_lock);
 
+    clock_cached_stop();
+
     logger_shutdown();
 
     LOG_INFO("Cleanup completed");
@@ -333,10 +577,26 @@ int main(int argc, char *argv[]) {
         LOG_INFO("Metrics server started");
     }
 
+    if (events_start() == SYNFLOOD_OK) {
+        LOG_INFO("Event stream started");
+    }
+
     if (expiry_start(&app_ctx, config.proc_check_interval_s) == SYNFLOOD_OK) {
         LOG_INFO("Expiration checker started");
     }
 
+    if (sweeper_start(&app_ctx) == SYNFLOOD_OK) {
+        LOG_INFO("Tracker sweeper started");
+    }
+
+    if (peersync_enabled() && peersync_start() == SYNFLOOD_OK) {
+        LOG_INFO("Peer sync started");
+    }
+
+    if (netns_start(config.netns_workers) != SYNFLOOD_OK) {
+        LOG_ERROR("Namespace monitoring failed to start");
+    }
+
     /* Start packet capture (blocking) */
     LOG_INFO("Starting packet capture...");
     LOG_INFO("Press Ctrl+C to stop");
@@ -0,0 +1,619 @@
+/*
+ * control.c - Daemon side of the binary control protocol
+ * TCP SYN Flood Detector
+ */
+
+#include "control.h"
+#include "ctlproto.h"
+#include "logger.h"
+#include "../analysis/tracker.h"
+#include "../analysis/whitelist.h"
+#include "../enforce/ipset_mgr.h"
+#include "../enforce/compact.h"
+#include "../enforce/blockcap.h"
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Entries copied out of the tracker per chunk while ranking TOP */
+#define CONTROL_TOP_CHUNK 256
+
+/* Whitelist edit waiting to be written to the file */
+typedef struct
+{
+    char path[PATH_MAX];
+    uint32_t prefix;
+    uint8_t prefix_len;
+    bool add;
+} persist_job_t;
+
+static uint64_t control_start_ns = 0;
+
+/* File writes run on their own thread, oldest edit first */
+static persist_job_t persist_queue[CONTROL_PERSIST_QUEUE];
+static size_t persist_head = 0;
+static size_t persist_count = 0;
+static bool persist_busy = false; /* A dequeued job is being written */
+static bool persist_running = false;
+static pthread_t persist_thread;
+static pthread_mutex_t persist_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t persist_wake = PTHREAD_COND_INITIALIZER; /* New job or stop */
+static pthread_cond_t persist_done = PTHREAD_COND_INITIALIZER; /* A job was written */
+
+void control_init(void) {
+    control_start_ns = get_monotonic_ns();
+}
+
+bool control_is_request(const void *data, size_t len) {
+    return len >= 4 && memcmp(data, CTL_MAGIC, 4) == 0;
+}
+
+static synflood_ret_t send_response(int fd, uint8_t op, uint16_t status,
+                                    const uint8_t *payload, size_t len) {
+    uint8_t buf[CTL_HEADER_LEN + CTL_MAX_RESPONSE];
+
+    ctl_encode_header(buf, op, status, (uint32_t)len);
+    if (len > 0) {
+        memcpy(buf + CTL_HEADER_LEN, payload, len);
+    }
+
+    ssize_t n = send(fd, buf, CTL_HEADER_LEN + len, MSG_NOSIGNAL);
+    return n == (ssize_t)(CTL_HEADER_LEN + len) ? SYNFLOOD_OK : SYNFLOOD_ERROR;
+}
+
+/* State-changing requests need root or the daemon's own user */
+static bool peer_may_change(int fd) {
+    struct ucred cred;
+    socklen_t cred_len = sizeof(cred);
+
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) < 0) {
+        return false;
+    }
+
+    return cred.uid == 0 || cred.uid == geteuid();
+}
+
+static size_t handle_status(app_context_t *ctx, uint8_t *out) {
+    ctl_status_t status = {0};
+    size_t entries, blocked;
+
+    tracker_get_stats(ctx->tracker, &entries, &blocked);
+
+    pthread_mutex_lock(&ctx->metrics_lock);
+    status.packets_total = ctx->metrics.packets_total;
+    status.syn_packets_total = ctx->metrics.syn_packets_total;
+    status.detections_total = ctx->metrics.detections_total;
+    status.whitelist_hits_total = ctx->metrics.whitelist_hits_total;
+    status.capture_drops_total = ctx->metrics.capture_drops_total;
+    status.blocked_current = ctx->metrics.blocked_ips_current;
+    status.sample_rate = ctx->metrics.sample_rate;
+    pthread_mutex_unlock(&ctx->metrics_lock);
+
+    status.uptime_s = (get_monotonic_ns() - control_start_ns) / NSEC_PER_SEC;
+    status.tracker_entries = entries;
+    status.tracker_blocked = blocked;
+    status.whitelist_gen = *ctx->tracker->whitelist_gen;
+
+    return ctl_encode_status(&status, out);
+}
+
+/* Rank sources by SYN count with a chunked tracker walk */
+static size_t handle_top(app_context_t *ctx, size_t want, uint8_t *out) {
+    ctl_top_entry_t top[CTL_TOP_MAX];
+    ip_tracker_t chunk[CONTROL_TOP_CHUNK];
+    tracker_filter_t filter = {0};
+    tracker_cursor_t cursor = {0};
+    size_t count = 0;
+
+    while (!cursor.done) {
+        size_t n = tracker_dump_chunk(ctx->tracker, &cursor, &filter, chunk, ARRAY_SIZE(chunk));
+        uint64_t now = get_monotonic_ns();
+
+        for (size_t i = 0; i < n; i++) {
+            if (count == want && chunk[i].syn_count <= top[count - 1].syn_count) {
+                continue;
+            }
+
+            /* Insertion into the descending list, dropping the smallest when full */
+            size_t pos = count < want ? count++ : count - 1;
+            while (pos > 0 && top[pos - 1].syn_count < chunk[i].syn_count) {
+                top[pos] = top[pos - 1];
+                pos--;
+            }
+
+            top[pos] = (ctl_top_entry_t){
+                .ip_addr = chunk[i].ip_addr,
+                .syn_count = chunk[i].syn_count,
+                .block_remaining_ms = chunk[i].blocked && chunk[i].block_expiry_ns > now
+                                      ? (uint32_t)MIN((chunk[i].block_expiry_ns - now) / NSEC_PER_MSEC,
+                                                      (uint64_t)UINT32_MAX)
+                                      : 0,
+                .blocked = chunk[i].blocked,
+            };
+        }
+
+        /* Only sources that could still enter the list need copying out */
+        if (count == want) {
+            filter.min_syn_count = top[count - 1].syn_count + 1;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        ctl_encode_top_entry(&top[i], out + i * CTL_TOP_ENTRY_LEN);
+    }
+
+    return count * CTL_TOP_ENTRY_LEN;
+}
+
+static uint16_t handle_block(app_context_t *ctx, uint32_t ip_addr, uint32_t duration_s) {
+    whitelist_reader_online();
+    whitelist_node_t *whitelist = __atomic_load_n(&ctx->whitelist_root, __ATOMIC_ACQUIRE);
+    bool whitelisted = whitelist && whitelist_check(whitelist, ip_addr);
+    whitelist_reader_offline();
+
+    if (whitelisted) {
+        return CTL_STATUS_REFUSED;
+    }
+
+    if (duration_s == 0) {
+        duration_s = ctx->config->block_duration_s;
+    }
+
+    if (ipset_mgr_add(ip_addr, duration_s, BLOCKCAP_RATE_MANUAL) != SYNFLOOD_OK) {
+        return CTL_STATUS_FAILED;
+    }
+
+    uint32_t syn_count = 0;
+    ip_tracker_t *tracker = tracker_get_or_create(ctx->tracker, ip_addr);
+    if (tracker) {
+        tracker->blocked = 1;
+        tracker->block_expiry_ns = get_monotonic_ns() + sec_to_ns(duration_s);
+        syn_count = tracker->syn_count;
+    }
+
+    logger_log_event(EVENT_BLOCKED, ip_addr, syn_count, 0);
+
+    pthread_mutex_lock(&ctx->metrics_lock);
+    ctx->metrics.blocked_ips_current = ipset_mgr_get_count();
+    pthread_mutex_unlock(&ctx->metrics_lock);
+
+    return CTL_STATUS_OK;
+}
+
+static uint16_t handle_unblock(app_context_t *ctx, uint32_t ip_addr) {
+    ip_tracker_t *tracker = tracker_get(ctx->tracker, ip_addr);
+    bool in_set = ipset_mgr_test(ip_addr);
+
+    /* An aggregate holding the address goes too; its other sources are
+     * blocked again if they are still flooding */
+    size_t released = compact_release(ip_addr, 32);
+
+    if (!in_set && !(tracker && tracker->blocked) && released == 0) {
+        return CTL_STATUS_NOT_FOUND;
+    }
+
+    if (in_set && ipset_mgr_remove(ip_addr) != SYNFLOOD_OK) {
+        return CTL_STATUS_FAILED;
+    }
+
+    if (tracker) {
+        tracker->blocked = 0;
+        tracker->block_expiry_ns = 0;
+    }
+
+    logger_log_event(EVENT_UNBLOCKED, ip_addr, 0, 0);
+
+    pthread_mutex_lock(&ctx->metrics_lock);
+    ctx->metrics.blocked_ips_current = ipset_mgr_get_count();
+    pthread_mutex_unlock(&ctx->metrics_lock);
+
+    return CTL_STATUS_OK;
+}
+
+/* Parse a whitelist file line into a normalized prefix; false for comments and junk */
+static bool parse_whitelist_line(const char *line, uint32_t *prefix, uint8_t *prefix_len) {
+    char buf[64];
+    line += strspn(line, " \t");
+    size_t len = strcspn(line, " \t\r\n#");
+    if (len == 0 || len >= sizeof(buf)) {
+        return false;
+    }
+    memcpy(buf, line, len);
+    buf[len] = '\0';
+
+    unsigned long bits = 32;
+    char *slash = strchr(buf, '/');
+    if (slash) {
+        char *end;
+        *slash = '\0';
+        bits = strtoul(slash + 1, &end, 10);
+        if (end == slash + 1 || *end != '\0' || bits > 32) {
+            return false;
+        }
+    }
+
+    struct in_addr addr;
+    if (inet_pton(AF_INET, buf, &addr) != 1) {
+        return false;
+    }
+
+    uint32_t mask = bits == 0 ? 0 : htonl(~((1U << (32 - bits)) - 1));
+    *prefix = addr.s_addr & mask;
+    *prefix_len = (uint8_t)bits;
+    return true;
+}
+
+/* Add or remove one CIDR in the whitelist file (rewritten via rename) */
+static uint16_t edit_whitelist_file(const char *path, uint32_t prefix, uint8_t prefix_len,
+                                    bool add) {
+    if (prefix_len > 32 || path[0] == '\0') {
+        return prefix_len > 32 ? CTL_STATUS_BAD_REQUEST : CTL_STATUS_FAILED;
+    }
+
+    uint32_t mask = prefix_len == 0 ? 0 : htonl(~((1U << (32 - prefix_len)) - 1));
+    prefix &= mask;
+
+    char tmp_path[PATH_MAX + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *in = fopen(path, "r");
+    if (!in && errno != ENOENT) {
+        return CTL_STATUS_FAILED;
+    }
+
+    FILE *out = fopen(tmp_path, "w");
+    if (!out) {
+        if (in) {
+            fclose(in);
+        }
+        return CTL_STATUS_FAILED;
+    }
+
+    bool found = false;
+    bool newline = true;
+    char line[256];
+    while (in && fgets(line, sizeof(line), in)) {
+        uint32_t p;
+        uint8_t l;
+        if (parse_whitelist_line(line, &p, &l) && p == prefix && l == prefix_len) {
+            found = true;
+            if (!add) {
+                continue;
+            }
+        }
+        fputs(line, out);
+        newline = line[strlen(line) - 1] == '\n';
+    }
+
+    if (add && !found) {
+        if (!newline) {
+            fputc('\n', out);
+        }
+        char ip_str[INET_ADDRSTRLEN];
+        struct in_addr addr = { .s_addr = prefix };
+        inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+        fprintf(out, "%s/%u\n", ip_str, prefix_len);
+    }
+
+    if (in) {
+        fclose(in);
+    }
+
+    /* Nothing to change: already present, or absent when removing */
+    if (add == found) {
+        fclose(out);
+        unlink(tmp_path);
+        return add ? CTL_STATUS_OK : CTL_STATUS_NOT_FOUND;
+    }
+
+    if (fclose(out) != 0 || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return CTL_STATUS_FAILED;
+    }
+
+    return CTL_STATUS_OK;
+}
+
+static void persist_write(const persist_job_t *job) {
+    if (edit_whitelist_file(job->path, job->prefix, job->prefix_len, job->add) ==
+        CTL_STATUS_FAILED) {
+        char ip_str[INET_ADDRSTRLEN];
+        struct in_addr addr = { .s_addr = job->prefix };
+        inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+        LOG_ERROR("Failed to %s whitelist entry %s/%u %s %s: the change is lost on reload",
+                  job->add ? "write" : "remove", ip_str, job->prefix_len,
+                  job->add ? "to" : "from", job->path);
+    }
+}
+
+static void *persist_worker(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&persist_lock);
+    while (persist_running || persist_count > 0) {
+        if (persist_count == 0) {
+            pthread_cond_wait(&persist_wake, &persist_lock);
+            continue;
+        }
+
+        persist_job_t job = persist_queue[persist_head];
+        persist_head = (persist_head + 1) % CONTROL_PERSIST_QUEUE;
+        persist_count--;
+        persist_busy = true;
+        pthread_mutex_unlock(&persist_lock);
+
+        persist_write(&job);
+
+        pthread_mutex_lock(&persist_lock);
+        persist_busy = false;
+        pthread_cond_broadcast(&persist_done);
+    }
+    pthread_mutex_unlock(&persist_lock);
+
+    return NULL;
+}
+
+/* Queue a whitelist file edit; written in place when no worker runs */
+static void persist_enqueue(const char *path, uint32_t prefix, uint8_t prefix_len, bool add) {
+    persist_job_t job = { .prefix = prefix, .prefix_len = prefix_len, .add = add };
+    snprintf(job.path, sizeof(job.path), "%s", path);
+
+    pthread_mutex_lock(&persist_lock);
+
+    if (!persist_running) {
+        pthread_mutex_unlock(&persist_lock);
+        persist_write(&job);
+        return;
+    }
+
+    /* A full queue means the disk is slow: wait rather than drop an edit */
+    while (persist_count == CONTROL_PERSIST_QUEUE) {
+        pthread_cond_wait(&persist_done, &persist_lock);
+    }
+
+    persist_queue[(persist_head + persist_count) % CONTROL_PERSIST_QUEUE] = job;
+    persist_count++;
+    pthread_cond_signal(&persist_wake);
+    pthread_mutex_unlock(&persist_lock);
+}
+
+/* Lift the blocks of sources a new whitelist entry covers */
+static void unblock_covered(app_context_t *ctx, uint32_t prefix, uint8_t prefix_len) {
+    uint32_t mask = prefix_len == 0 ? 0 : htonl(~((1U << (32 - prefix_len)) - 1));
+    ip_tracker_t chunk[CONTROL_TOP_CHUNK];
+    tracker_filter_t filter = {
+        .prefix = prefix & mask,
+        .prefix_mask = mask,
+        .blocked = TRACKER_MATCH_BLOCKED,
+    };
+    tracker_cursor_t cursor = {0};
+    size_t unblocked = 0;
+
+    /* Aggregates overlapping the entry would keep its sources blocked */
+    size_t released = compact_release(prefix & mask, prefix_len);
+
+    while (!cursor.done) {
+        size_t n = tracker_dump_chunk(ctx->tracker, &cursor, &filter, chunk, ARRAY_SIZE(chunk));
+
+        for (size_t i = 0; i < n; i++) {
+            uint32_t ip_addr = chunk[i].ip_addr;
+            if (ipset_mgr_test(ip_addr) && ipset_mgr_remove(ip_addr) != SYNFLOOD_OK) {
+                continue;
+            }
+
+            ip_tracker_t *tracker = tracker_get(ctx->tracker, ip_addr);
+            if (tracker) {
+                tracker->blocked = 0;
+                tracker->block_expiry_ns = 0;
+            }
+
+            logger_log_event(EVENT_UNBLOCKED, ip_addr, chunk[i].syn_count, 0);
+            unblocked++;
+        }
+    }
+
+    /* A single host may be in the set without a tracker entry (evicted) */
+    if (prefix_len == 32 && ipset_mgr_test(prefix) && ipset_mgr_remove(prefix) == SYNFLOOD_OK) {
+        logger_log_event(EVENT_UNBLOCKED, prefix, 0, 0);
+        unblocked++;
+    }
+
+    if (unblocked > 0 || released > 0) {
+        LOG_INFO("Unblocked %zu sources covered by the new whitelist entry", unblocked);
+
+        pthread_mutex_lock(&ctx->metrics_lock);
+        ctx->metrics.blocked_ips_current = ipset_mgr_get_count();
+        pthread_mutex_unlock(&ctx->metrics_lock);
+    }
+}
+
+/* Edit the live whitelist, then persist the change in the background */
+static uint16_t handle_whitelist(app_context_t *ctx, uint32_t prefix, uint8_t prefix_len,
+                                 bool add) {
+    if (prefix_len > 32) {
+        return CTL_STATUS_BAD_REQUEST;
+    }
+
+    /* Nowhere to persist to, and the engine variant skips the whitelist */
+    const char *path = ctx->config->whitelist_file;
+    if (path[0] == '\0') {
+        return CTL_STATUS_FAILED;
+    }
+
+    synflood_ret_t ret = add
+        ? whitelist_insert(&ctx->whitelist_root, prefix, prefix_len, ctx->tracker->whitelist_gen)
+        : whitelist_remove(&ctx->whitelist_root, prefix, prefix_len, ctx->tracker->whitelist_gen);
+    if (ret == SYNFLOOD_ENOTFOUND) {
+        return CTL_STATUS_NOT_FOUND;
+    }
+    if (ret != SYNFLOOD_OK) {
+        return CTL_STATUS_FAILED;
+    }
+
+    persist_enqueue(path, prefix, prefix_len, add);
+
+    if (add) {
+        unblock_covered(ctx, prefix, prefix_len);
+    }
+
+    return CTL_STATUS_OK;
+}
+
+synflood_ret_t control_start(void) {
+    pthread_mutex_lock(&persist_lock);
+    if (persist_running) {
+        pthread_mutex_unlock(&persist_lock);
+        return SYNFLOOD_OK;
+    }
+    persist_running = true;
+    pthread_mutex_unlock(&persist_lock);
+
+    if (pthread_create(&persist_thread, NULL, persist_worker, NULL) != 0) {
+        LOG_WARN("Failed to start whitelist writer thread; whitelist edits are written inline");
+        pthread_mutex_lock(&persist_lock);
+        persist_running = false;
+        pthread_mutex_unlock(&persist_lock);
+        return SYNFLOOD_ERROR;
+    }
+
+    return SYNFLOOD_OK;
+}
+
+void control_flush(void) {
+    pthread_mutex_lock(&persist_lock);
+    while (persist_count > 0 || persist_busy) {
+        pthread_cond_wait(&persist_done, &persist_lock);
+    }
+    pthread_mutex_unlock(&persist_lock);
+}
+
+void control_stop(void) {
+    pthread_mutex_lock(&persist_lock);
+    if (!persist_running) {
+        pthread_mutex_unlock(&persist_lock);
+        return;
+    }
+    persist_running = false;
+    pthread_cond_signal(&persist_wake);
+    pthread_mutex_unlock(&persist_lock);
+
+    /* The worker drains the queue before exiting */
+    pthread_join(persist_thread, NULL);
+}
+
+synflood_ret_t control_handle(app_context_t *ctx, int fd, const uint8_t *data, size_t len) {
+    if (!ctx || fd < 0 || !data) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    ctl_header_t hdr;
+    if (ctl_decode_header(data, len, &hdr) != SYNFLOOD_OK) {
+        return send_response(fd, 0, CTL_STATUS_BAD_REQUEST, NULL, 0);
+    }
+
+    if (hdr.version != CTL_VERSION) {
+        uint8_t version = CTL_VERSION;
+        return send_response(fd, hdr.op, CTL_STATUS_VERSION, &version, 1);
+    }
+
+    if (hdr.length > CTL_MAX_REQUEST) {
+        return send_response(fd, hdr.op, CTL_STATUS_BAD_REQUEST, NULL, 0);
+    }
+
+    /* The rest of the payload may still be in flight */
+    uint8_t payload[CTL_MAX_REQUEST];
+    size_t have = MIN(len - CTL_HEADER_LEN, (size_t)hdr.length);
+    memcpy(payload, data + CTL_HEADER_LEN, have);
+
+    if (have < hdr.length) {
+        struct timeval tv = {
+            .tv_sec = CONTROL_RECV_TIMEOUT_MS / 1000,
+            .tv_usec = (CONTROL_RECV_TIMEOUT_MS % 1000) * 1000,
+        };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        while (have < hdr.length) {
+            ssize_t n = recv(fd, payload + have, hdr.length - have, 0);
+            if (n <= 0) {
+                return SYNFLOOD_ERROR;
+            }
+            have += (size_t)n;
+        }
+    }
+
+    uint8_t out[CTL_MAX_RESPONSE];
+    size_t out_len = 0;
+    uint16_t status = CTL_STATUS_OK;
+    uint32_t addr = 0; /* Network byte order */
+
+    if (hdr.length >= 4) {
+        memcpy(&addr, payload, 4);
+    }
+
+    if (hdr.op >= CTL_OP_BLOCK && hdr.op <= CTL_OP_RELOAD && !peer_may_change(fd)) {
+        LOG_WARN("Control request op=%u denied: peer is neither root nor the daemon's user",
+                 hdr.op);
+        return send_response(fd, hdr.op, CTL_STATUS_DENIED, NULL, 0);
+    }
+
+    switch (hdr.op) {
+        case CTL_OP_STATUS:
+            out_len = handle_status(ctx, out);
+            break;
+
+        case CTL_OP_TOP: {
+            size_t want = hdr.length >= 2 ? ctl_get_be16(payload) : CTL_TOP_DEFAULT;
+            out_len = handle_top(ctx, MIN(want ? want : CTL_TOP_DEFAULT, (size_t)CTL_TOP_MAX), out);
+            break;
+        }
+
+        case CTL_OP_BLOCK:
+            if (hdr.length < 8) {
+                status = CTL_STATUS_BAD_REQUEST;
+                break;
+            }
+            status = handle_block(ctx, addr, ctl_get_be32(payload + 4));
+            break;
+
+        case CTL_OP_UNBLOCK:
+            if (hdr.length < 4) {
+                status = CTL_STATUS_BAD_REQUEST;
+                break;
+            }
+            status = handle_unblock(ctx, addr);
+            break;
+
+        case CTL_OP_WHITELIST_ADD:
+        case CTL_OP_WHITELIST_REMOVE:
+            if (hdr.length < 5) {
+                status = CTL_STATUS_BAD_REQUEST;
+                break;
+            }
+            status = handle_whitelist(ctx, addr, payload[4], hdr.op == CTL_OP_WHITELIST_ADD);
+            break;
+
+        case CTL_OP_RELOAD:
+            kill(getpid(), SIGHUP);
+            break;
+
+        default:
+            status = CTL_STATUS_UNKNOWN_OP;
+            break;
+    }
+
+    /* Changes made over the control socket leave a trace in the log */
+    if (hdr.op >= CTL_OP_BLOCK && hdr.op <= CTL_OP_RELOAD) {
+        char ip_str[INET_ADDRSTRLEN];
+        struct in_addr in = { .s_addr = addr };
+        inet_ntop(AF_INET, &in, ip_str, sizeof(ip_str));
+        LOG_INFO("Control request op=%u ip=%s: %s", hdr.op, ip_str, ctl_status_name(status));
+    }
+
+    return send_response(fd, hdr.op, status, out, out_len);
+}
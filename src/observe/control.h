@@ -0,0 +1,65 @@
+/*
+ * control.h - Daemon side of the binary control protocol
+ * TCP SYN Flood Detector
+ *
+ * The metrics server hands connections whose first bytes are the
+ * CTL_MAGIC to control_handle(), which answers one request (see
+ * ctlproto.h) and leaves closing the connection to the caller.
+ */
+
+#ifndef SYNFLOOD_CONTROL_H
+#define SYNFLOOD_CONTROL_H
+
+#include "common.h"
+#include <stddef.h>
+
+/* How long to wait for the rest of a request that arrived in pieces */
+#define CONTROL_RECV_TIMEOUT_MS 1000
+
+/* Whitelist file edits waiting for the writer thread */
+#define CONTROL_PERSIST_QUEUE 64
+
+/**
+ * Record the daemon start time reported as uptime
+ */
+void control_init(void);
+
+/**
+ * Start the thread that writes whitelist edits to the whitelist file
+ * Without it, edits are written before the request is answered.
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t control_start(void);
+
+/**
+ * Wait until every queued whitelist edit is in the file
+ * Called before the whitelist file is reloaded.
+ */
+void control_flush(void);
+
+/**
+ * Write out queued whitelist edits and stop the writer thread
+ */
+void control_stop(void);
+
+/**
+ * Check whether received bytes start a binary control request
+ * @param data Bytes received so far
+ * @param len Number of bytes
+ * @return true if the connection speaks the binary protocol
+ */
+bool control_is_request(const void *data, size_t len);
+
+/**
+ * Answer one binary control request
+ * Whitelist changes are applied to the live whitelist at once (sources
+ * the new entry covers are unblocked) and queued for the whitelist file.
+ * @param ctx Application context
+ * @param fd Client socket
+ * @param data Bytes already received (starting with the header)
+ * @param len Number of bytes already received
+ * @return SYNFLOOD_OK if a response was sent
+ */
+synflood_ret_t control_handle(app_context_t *ctx, int fd, const uint8_t *data, size_t len);
+
+#endif /* SYNFLOOD_CONTROL_H */
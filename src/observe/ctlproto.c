@@ -0,0 +1,172 @@
+/*
+ * ctlproto.c - Binary control protocol spoken on the metrics socket
+ * TCP SYN Flood Detector
+ */
+
+#include "ctlproto.h"
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+void ctl_encode_header(uint8_t *buf, uint8_t op, uint16_t status, uint32_t length) {
+    memcpy(buf, CTL_MAGIC, 4);
+    buf[4] = CTL_VERSION;
+    buf[5] = op;
+    ctl_put_be16(buf + 6, status);
+    ctl_put_be32(buf + 8, length);
+}
+
+synflood_ret_t ctl_decode_header(const uint8_t *buf, size_t len, ctl_header_t *out) {
+    if (len < CTL_HEADER_LEN || memcmp(buf, CTL_MAGIC, 4) != 0) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    out->version = buf[4];
+    out->op = buf[5];
+    out->status = ctl_get_be16(buf + 6);
+    out->length = ctl_get_be32(buf + 8);
+    return SYNFLOOD_OK;
+}
+
+size_t ctl_encode_status(const ctl_status_t *status, uint8_t *buf) {
+    const uint64_t counters[] = {
+        status->uptime_s,
+        status->packets_total,
+        status->syn_packets_total,
+        status->detections_total,
+        status->whitelist_hits_total,
+        status->capture_drops_total,
+        status->blocked_current,
+        status->tracker_entries,
+        status->tracker_blocked,
+    };
+
+    size_t off = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(counters); i++, off += 8) {
+        ctl_put_be64(buf + off, counters[i]);
+    }
+    ctl_put_be32(buf + off, status->whitelist_gen);
+    ctl_put_be32(buf + off + 4, status->sample_rate);
+
+    return off + 8;
+}
+
+void ctl_decode_status(const uint8_t *buf, size_t len, ctl_status_t *out) {
+    uint64_t *counters[] = {
+        &out->uptime_s,
+        &out->packets_total,
+        &out->syn_packets_total,
+        &out->detections_total,
+        &out->whitelist_hits_total,
+        &out->capture_drops_total,
+        &out->blocked_current,
+        &out->tracker_entries,
+        &out->tracker_blocked,
+    };
+
+    memset(out, 0, sizeof(*out));
+
+    size_t off = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(counters) && off + 8 <= len; i++, off += 8) {
+        *counters[i] = ctl_get_be64(buf + off);
+    }
+    if (off == 8 * ARRAY_SIZE(counters) && off + 8 <= len) {
+        out->whitelist_gen = ctl_get_be32(buf + off);
+        out->sample_rate = ctl_get_be32(buf + off + 4);
+    }
+}
+
+void ctl_encode_top_entry(const ctl_top_entry_t *entry, uint8_t *buf) {
+    memcpy(buf, &entry->ip_addr, 4);
+    ctl_put_be32(buf + 4, entry->syn_count);
+    ctl_put_be32(buf + 8, entry->block_remaining_ms);
+    buf[12] = entry->blocked;
+    buf[13] = buf[14] = buf[15] = 0;
+}
+
+void ctl_decode_top_entry(const uint8_t *buf, ctl_top_entry_t *out) {
+    memcpy(&out->ip_addr, buf, 4);
+    out->syn_count = ctl_get_be32(buf + 4);
+    out->block_remaining_ms = ctl_get_be32(buf + 8);
+    out->blocked = buf[12];
+}
+
+const char *ctl_status_name(uint16_t status) {
+    switch (status) {
+        case CTL_STATUS_OK:          return "ok";
+        case CTL_STATUS_BAD_REQUEST: return "bad request";
+        case CTL_STATUS_VERSION:     return "unsupported protocol version";
+        case CTL_STATUS_UNKNOWN_OP:  return "unknown operation";
+        case CTL_STATUS_NOT_FOUND:   return "not found";
+        case CTL_STATUS_REFUSED:     return "refused";
+        case CTL_STATUS_FAILED:      return "failed";
+        case CTL_STATUS_DENIED:      return "permission denied";
+        default:                     return "unknown status";
+    }
+}
+
+static synflood_ret_t recv_full(int fd, uint8_t *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = recv(fd, buf, len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return SYNFLOOD_ERROR;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+
+    return SYNFLOOD_OK;
+}
+
+synflood_ret_t ctl_call(const char *socket_path, uint8_t op, const uint8_t *payload,
+                        size_t payload_len, int timeout_ms, ctl_header_t *hdr,
+                        uint8_t *resp, size_t resp_size) {
+    if (!socket_path || !hdr || payload_len > CTL_MAX_REQUEST) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return SYNFLOOD_ERROR;
+    }
+
+    struct timeval tv = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_usec = (timeout_ms % 1000) * 1000,
+    };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+
+    uint8_t request[CTL_HEADER_LEN + CTL_MAX_REQUEST];
+    ctl_encode_header(request, op, 0, (uint32_t)payload_len);
+    if (payload_len > 0) {
+        memcpy(request + CTL_HEADER_LEN, payload, payload_len);
+    }
+
+    uint8_t raw[CTL_HEADER_LEN];
+    synflood_ret_t ret = SYNFLOOD_ERROR;
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+        send(fd, request, CTL_HEADER_LEN + payload_len, MSG_NOSIGNAL) ==
+            (ssize_t)(CTL_HEADER_LEN + payload_len) &&
+        recv_full(fd, raw, sizeof(raw)) == SYNFLOOD_OK &&
+        ctl_decode_header(raw, sizeof(raw), hdr) == SYNFLOOD_OK) {
+        size_t want = MIN((size_t)hdr->length, resp ? resp_size : 0);
+        ret = recv_full(fd, resp, want);
+        hdr->length = (uint32_t)want;
+    }
+
+    close(fd);
+    return ret;
+}
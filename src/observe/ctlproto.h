@@ -0,0 +1,210 @@
+/*
+ * ctlproto.h - Binary control protocol spoken on the metrics socket
+ * TCP SYN Flood Detector
+ *
+ * Shared by the daemon and the synflood-ctl-native client. A client sends
+ * one request and reads one response per connection. Both start with a
+ * CTL_HEADER_LEN byte header, integers big-endian:
+ *   magic "SFCP" | version u8 | op u8 | status u16 | payload length u32
+ * Requests carry status 0; responses echo the op and carry a CTL_STATUS_*.
+ * The magic never collides with the text requests (GET, SUBSCRIBE, DUMP).
+ *
+ * Compatibility: fields are only ever appended to a payload within one
+ * version, and readers ignore trailing bytes they do not know. Anything
+ * else bumps CTL_VERSION; a daemon answers a version it does not speak
+ * with CTL_STATUS_VERSION and a one-byte payload holding its own version.
+ *
+ * Payloads by op:
+ *   STATUS           request: none      response: ctl_status_t fields in order
+ *   TOP              request: count u16 response: CTL_TOP_ENTRY_LEN bytes per source
+ *   BLOCK            request: ip u32 (as on the wire), duration_s u32 (0 = configured)
+ *   UNBLOCK          request: ip u32
+ *   WHITELIST_ADD    request: prefix u32 (as on the wire), prefix_len u8
+ *   WHITELIST_REMOVE request: prefix u32, prefix_len u8
+ *   RELOAD           request: none
+ *
+ * BLOCK, UNBLOCK, WHITELIST_* and RELOAD are answered with
+ * CTL_STATUS_DENIED unless the peer runs as root or as the daemon's user.
+ */
+
+#ifndef SYNFLOOD_CTLPROTO_H
+#define SYNFLOOD_CTLPROTO_H
+
+#include "common.h"
+#include <stddef.h>
+
+#define CTL_MAGIC "SFCP"
+#define CTL_VERSION 1
+#define CTL_HEADER_LEN 12
+
+/* Largest request payload a daemon accepts */
+#define CTL_MAX_REQUEST 64
+
+/* Sources returned by one TOP request at most */
+#define CTL_TOP_MAX 100
+#define CTL_TOP_DEFAULT 10 /* When the request has no count */
+#define CTL_TOP_ENTRY_LEN 16
+
+/* Largest response payload */
+#define CTL_MAX_RESPONSE (CTL_TOP_MAX * CTL_TOP_ENTRY_LEN)
+
+/* Encoded ctl_status_t length (version 1 fields) */
+#define CTL_STATUS_LEN 80
+
+typedef enum
+{
+    CTL_OP_STATUS = 1,
+    CTL_OP_TOP = 2,
+    CTL_OP_BLOCK = 3,
+    CTL_OP_UNBLOCK = 4,
+    CTL_OP_WHITELIST_ADD = 5,
+    CTL_OP_WHITELIST_REMOVE = 6,
+    CTL_OP_RELOAD = 7,
+} ctl_op_t;
+
+typedef enum
+{
+    CTL_STATUS_OK = 0,
+    CTL_STATUS_BAD_REQUEST = 1,
+    CTL_STATUS_VERSION = 2,
+    CTL_STATUS_UNKNOWN_OP = 3,
+    CTL_STATUS_NOT_FOUND = 4,
+    CTL_STATUS_REFUSED = 5, /* e.g. blocking a whitelisted source */
+    CTL_STATUS_FAILED = 6,
+    CTL_STATUS_DENIED = 7, /* Peer may not change state */
+} ctl_status_code_t;
+
+typedef struct
+{
+    uint8_t version;
+    uint8_t op;
+    uint16_t status;
+    uint32_t length;
+} ctl_header_t;
+
+/* STATUS response */
+typedef struct
+{
+    uint64_t uptime_s;
+    uint64_t packets_total;
+    uint64_t syn_packets_total;
+    uint64_t detections_total;
+    uint64_t whitelist_hits_total;
+    uint64_t capture_drops_total;
+    uint64_t blocked_current; /* Entries in the blacklist ipset */
+    uint64_t tracker_entries;
+    uint64_t tracker_blocked;
+    uint32_t whitelist_gen;
+    uint32_t sample_rate;
+} ctl_status_t;
+
+/* One TOP response entry */
+typedef struct
+{
+    uint32_t ip_addr; /* Network byte order */
+    uint32_t syn_count;
+    uint32_t block_remaining_ms;
+    uint8_t blocked;
+} ctl_top_entry_t;
+
+static inline void ctl_put_be16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static inline void ctl_put_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static inline void ctl_put_be64(uint8_t *p, uint64_t v) {
+    ctl_put_be32(p, (uint32_t)(v >> 32));
+    ctl_put_be32(p + 4, (uint32_t)v);
+}
+
+static inline uint16_t ctl_get_be16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t ctl_get_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline uint64_t ctl_get_be64(const uint8_t *p) {
+    return ((uint64_t)ctl_get_be32(p) << 32) | ctl_get_be32(p + 4);
+}
+
+/**
+ * Encode a message header
+ * @param buf Output (CTL_HEADER_LEN bytes)
+ * @param op Operation
+ * @param status Status (0 in requests)
+ * @param length Payload length
+ */
+void ctl_encode_header(uint8_t *buf, uint8_t op, uint16_t status, uint32_t length);
+
+/**
+ * Decode a message header
+ * @param buf Input
+ * @param len Bytes available
+ * @param out Output header
+ * @return SYNFLOOD_OK, or SYNFLOOD_EINVAL if short or the magic is wrong
+ */
+synflood_ret_t ctl_decode_header(const uint8_t *buf, size_t len, ctl_header_t *out);
+
+/**
+ * Encode a STATUS response payload
+ * @param status Values
+ * @param buf Output (CTL_STATUS_LEN bytes)
+ * @return Bytes written
+ */
+size_t ctl_encode_status(const ctl_status_t *status, uint8_t *buf);
+
+/**
+ * Decode a STATUS response payload (fields beyond len are left zero)
+ * @param buf Input
+ * @param len Payload length
+ * @param out Output values
+ */
+void ctl_decode_status(const uint8_t *buf, size_t len, ctl_status_t *out);
+
+/**
+ * Encode one TOP entry
+ * @param entry Entry
+ * @param buf Output (CTL_TOP_ENTRY_LEN bytes)
+ */
+void ctl_encode_top_entry(const ctl_top_entry_t *entry, uint8_t *buf);
+
+/**
+ * Decode one TOP entry
+ * @param buf Input (CTL_TOP_ENTRY_LEN bytes)
+ * @param out Output entry
+ */
+void ctl_decode_top_entry(const uint8_t *buf, ctl_top_entry_t *out);
+
+/**
+ * Human-readable name of a response status
+ * @param status CTL_STATUS_* value
+ * @return Static string
+ */
+const char *ctl_status_name(uint16_t status);
+
+/**
+ * Send one request to the daemon and wait for its response
+ * @param socket_path Control socket path
+ * @param op Operation
+ * @param payload Request payload (may be NULL if payload_len is 0)
+ * @param payload_len Payload length
+ * @param timeout_ms Give up after this long
+ * @param hdr Output: response header
+ * @param resp Output: response payload
+ * @param resp_size Capacity of resp (longer payloads are truncated)
+ * @return SYNFLOOD_OK if a response arrived, SYNFLOOD_ERROR otherwise
+ */
+synflood_ret_t ctl_call(const char *socket_path, uint8_t op, const uint8_t *payload,
+                        size_t payload_len, int timeout_ms, ctl_header_t *hdr,
+                        uint8_t *resp, size_t resp_size);
+
+#endif /* SYNFLOOD_CTLPROTO_H */
@@ -0,0 +1,260 @@
+/*
+ * dump.c - Tracker dump and query over the control socket
+ * TCP SYN Flood Detector
+ */
+
+#include "dump.h"
+#include "logger.h"
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/* Entries copied out of the tracker per chunk */
+#define DUMP_CHUNK_ENTRIES 256
+
+/* Frames buffered before a send */
+#define DUMP_OUT_BUFFER 16384
+
+static void put_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static uint32_t ns_to_ms_clamped(uint64_t ns) {
+    uint64_t ms = ns / NSEC_PER_MSEC;
+    return ms > UINT32_MAX ? UINT32_MAX : (uint32_t)ms;
+}
+
+static synflood_ret_t parse_prefix(const char *value, size_t len, tracker_filter_t *filter) {
+    char ip_str[INET_ADDRSTRLEN + 4];
+    if (len >= sizeof(ip_str)) {
+        return SYNFLOOD_EINVAL;
+    }
+    memcpy(ip_str, value, len);
+    ip_str[len] = '\0';
+
+    unsigned long prefix_len = 32;
+    char *slash = strchr(ip_str, '/');
+    if (slash) {
+        char *end;
+        *slash = '\0';
+        prefix_len = strtoul(slash + 1, &end, 10);
+        if (end == slash + 1 || *end != '\0' || prefix_len > 32) {
+            return SYNFLOOD_EINVAL;
+        }
+    }
+
+    struct in_addr addr;
+    if (inet_pton(AF_INET, ip_str, &addr) != 1) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    filter->prefix_mask = prefix_len == 0 ? 0 : htonl(~((1U << (32 - prefix_len)) - 1));
+    filter->prefix = addr.s_addr & filter->prefix_mask;
+    return SYNFLOOD_OK;
+}
+
+static bool value_is(const char *value, size_t len, const char *word) {
+    return len == strlen(word) && strncasecmp(value, word, len) == 0;
+}
+
+synflood_ret_t dump_parse_request(const char *args, dump_request_t *req) {
+    if (!args || !req) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    memset(req, 0, sizeof(*req));
+
+    const char *p = args;
+    for (;;) {
+        p += strspn(p, " \t\r\n");
+        size_t len = strcspn(p, " \t\r\n");
+        if (len == 0) {
+            break;
+        }
+
+        const char *eq = memchr(p, '=', len);
+        if (!eq) {
+            return SYNFLOOD_EINVAL;
+        }
+
+        size_t key_len = (size_t)(eq - p);
+        const char *value = eq + 1;
+        size_t value_len = len - key_len - 1;
+
+        if (value_is(p, key_len, "prefix")) {
+            if (parse_prefix(value, value_len, &req->filter) != SYNFLOOD_OK) {
+                return SYNFLOOD_EINVAL;
+            }
+        } else if (value_is(p, key_len, "min_syn")) {
+            char num[16];
+            char *end;
+            if (value_len == 0 || value_len >= sizeof(num)) {
+                return SYNFLOOD_EINVAL;
+            }
+            memcpy(num, value, value_len);
+            num[value_len] = '\0';
+            unsigned long v = strtoul(num, &end, 10);
+            if (*end != '\0' || v > UINT32_MAX) {
+                return SYNFLOOD_EINVAL;
+            }
+            req->filter.min_syn_count = (uint32_t)v;
+        } else if (value_is(p, key_len, "blocked")) {
+            if (value_is(value, value_len, "yes")) {
+                req->filter.blocked = TRACKER_MATCH_BLOCKED;
+            } else if (value_is(value, value_len, "no")) {
+                req->filter.blocked = TRACKER_MATCH_UNBLOCKED;
+            } else if (value_is(value, value_len, "any")) {
+                req->filter.blocked = TRACKER_MATCH_ANY;
+            } else {
+                return SYNFLOOD_EINVAL;
+            }
+        } else if (value_is(p, key_len, "format")) {
+            if (value_is(value, value_len, "json")) {
+                req->format = DUMP_FORMAT_JSON;
+            } else if (value_is(value, value_len, "binary")) {
+                req->format = DUMP_FORMAT_BINARY;
+            } else {
+                return SYNFLOOD_EINVAL;
+            }
+        } else {
+            return SYNFLOOD_EINVAL;
+        }
+
+        p += len;
+    }
+
+    return SYNFLOOD_OK;
+}
+
+size_t dump_format_entry(const ip_tracker_t *entry, uint64_t now_ns, dump_format_t format,
+                         char *buf, size_t size) {
+    uint32_t idle_ms = now_ns > entry->last_seen_ns ?
+                       ns_to_ms_clamped(now_ns - entry->last_seen_ns) : 0;
+    uint32_t remaining_ms = entry->blocked && entry->block_expiry_ns > now_ns ?
+                            ns_to_ms_clamped(entry->block_expiry_ns - now_ns) : 0;
+
+    if (format == DUMP_FORMAT_BINARY) {
+        if (size < DUMP_RECORD_LEN) {
+            return 0;
+        }
+
+        uint8_t *p = (uint8_t *)buf;
+        memcpy(p, &entry->ip_addr, 4);
+        put_be32(p + 4, entry->syn_count);
+        put_be32(p + 8, idle_ms);
+        put_be32(p + 12, remaining_ms);
+        p[16] = (uint8_t)((entry->blocked ? DUMP_FLAG_BLOCKED : 0) |
+                          (entry->whitelisted ? DUMP_FLAG_WHITELISTED : 0));
+        p[17] = p[18] = p[19] = 0;
+        return DUMP_RECORD_LEN;
+    }
+
+    char ip_str[INET_ADDRSTRLEN];
+    struct in_addr addr = { .s_addr = entry->ip_addr };
+    inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+
+    int len = snprintf(buf, size,
+                       "{\"ip\":\"%s\",\"syn_count\":%u,\"blocked\":%s,\"whitelisted\":%s,"
+                       "\"idle_ms\":%u,\"block_remaining_ms\":%u}\n",
+                       ip_str, entry->syn_count, entry->blocked ? "true" : "false",
+                       entry->whitelisted ? "true" : "false", idle_ms, remaining_ms);
+
+    return (len > 0 && (size_t)len < size) ? (size_t)len : 0;
+}
+
+size_t dump_format_end(size_t count, dump_format_t format, char *buf, size_t size) {
+    if (format == DUMP_FORMAT_BINARY) {
+        if (size < DUMP_RECORD_LEN) {
+            return 0;
+        }
+
+        memset(buf, 0, DUMP_RECORD_LEN);
+        put_be32((uint8_t *)buf + 4, count > UINT32_MAX ? UINT32_MAX : (uint32_t)count);
+        ((uint8_t *)buf)[16] = DUMP_RECORD_END;
+        return DUMP_RECORD_LEN;
+    }
+
+    int len = snprintf(buf, size, "{\"end\":true,\"entries\":%zu}\n", count);
+    return (len > 0 && (size_t)len < size) ? (size_t)len : 0;
+}
+
+static synflood_ret_t send_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return SYNFLOOD_ERROR;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+
+    return SYNFLOOD_OK;
+}
+
+synflood_ret_t dump_stream(tracker_table_t *table, const dump_request_t *req, int fd,
+                           size_t *sent) {
+    if (!table || !req || fd < 0) {
+        return SYNFLOOD_EINVAL;
+    }
+
+    /* The metrics thread serves one client at a time; bound how long this one can hold it */
+    struct timeval tv = {
+        .tv_sec = DUMP_SEND_TIMEOUT_MS / 1000,
+        .tv_usec = (DUMP_SEND_TIMEOUT_MS % 1000) * 1000,
+    };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    ip_tracker_t entries[DUMP_CHUNK_ENTRIES];
+    char out[DUMP_OUT_BUFFER];
+    size_t out_len = 0;
+    size_t total = 0;
+    tracker_cursor_t cursor = {0};
+    synflood_ret_t ret = SYNFLOOD_OK;
+
+    while (!cursor.done && ret == SYNFLOOD_OK) {
+        /* Only this call touches the tracker lock; sending happens after it returns */
+        size_t n = tracker_dump_chunk(table, &cursor, &req->filter, entries, DUMP_CHUNK_ENTRIES);
+        uint64_t now = get_monotonic_ns();
+
+        for (size_t i = 0; i < n && ret == SYNFLOOD_OK; i++) {
+            if (DUMP_OUT_BUFFER - out_len < DUMP_JSON_MAX) {
+                ret = send_all(fd, out, out_len);
+                out_len = 0;
+            }
+            out_len += dump_format_entry(&entries[i], now, req->format, out + out_len,
+                                         DUMP_OUT_BUFFER - out_len);
+            total++;
+        }
+    }
+
+    if (ret == SYNFLOOD_OK && DUMP_OUT_BUFFER - out_len < DUMP_JSON_MAX) {
+        ret = send_all(fd, out, out_len);
+        out_len = 0;
+    }
+
+    if (ret == SYNFLOOD_OK) {
+        out_len += dump_format_end(total, req->format, out + out_len, DUMP_OUT_BUFFER - out_len);
+        ret = send_all(fd, out, out_len);
+    }
+
+    if (ret != SYNFLOOD_OK) {
+        LOG_WARN("Tracker dump aborted after %zu entries: client not reading", total);
+    }
+
+    if (sent) {
+        *sent = total;
+    }
+
+    return ret;
+}
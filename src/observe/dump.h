@@ -0,0 +1,94 @@
+/*
+ * dump.h - Tracker dump and query over the control socket
+ * TCP SYN Flood Detector
+ *
+ * A client sends one request line on the metrics socket:
+ *   DUMP [prefix=<ip>[/<len>]] [min_syn=<n>] [blocked=yes|no] [format=json|binary]
+ * and receives every matching tracker entry, followed by an end marker.
+ * "DUMP prefix=198.51.100.7" queries a single source. The table is walked
+ * in chunks of TRACKER_DUMP_SCAN buckets, so the tracker lock is held only
+ * while a chunk is copied out, never while sending to the client.
+ *
+ * JSON frames are one object per line:
+ *   {"ip":"198.51.100.7","syn_count":150,"blocked":true,"whitelisted":false,"idle_ms":12,"block_remaining_ms":299988}
+ *   {"end":true,"entries":1}
+ *
+ * Binary records are DUMP_RECORD_LEN bytes, integers big-endian:
+ *   ip u32 (as on the wire) | syn_count u32 | idle_ms u32 |
+ *   block_remaining_ms u32 | flags u8 (DUMP_FLAG_*) | pad[3]
+ * The end record has flags DUMP_RECORD_END and the entry count in syn_count.
+ */
+
+#ifndef SYNFLOOD_DUMP_H
+#define SYNFLOOD_DUMP_H
+
+#include "common.h"
+#include "../analysis/tracker.h"
+#include <stddef.h>
+
+#define DUMP_RECORD_LEN 20
+#define DUMP_RECORD_END 0xFF
+
+#define DUMP_FLAG_BLOCKED     0x01
+#define DUMP_FLAG_WHITELISTED 0x02
+
+/* Longest JSON frame including the newline */
+#define DUMP_JSON_MAX 160
+
+/* Give up on a client that stops reading for this long */
+#define DUMP_SEND_TIMEOUT_MS 2000
+
+typedef enum
+{
+    DUMP_FORMAT_JSON = 0,
+    DUMP_FORMAT_BINARY = 1,
+} dump_format_t;
+
+typedef struct
+{
+    tracker_filter_t filter;
+    dump_format_t format;
+} dump_request_t;
+
+/**
+ * Parse the arguments of a DUMP request
+ * @param args Text after "DUMP" (space-separated key=value pairs)
+ * @param req Output request
+ * @return SYNFLOOD_OK or SYNFLOOD_EINVAL
+ */
+synflood_ret_t dump_parse_request(const char *args, dump_request_t *req);
+
+/**
+ * Format one tracker entry
+ * @param entry Entry
+ * @param now_ns Current monotonic time (for idle and remaining block time)
+ * @param format Output format
+ * @param buf Output buffer (DUMP_JSON_MAX / DUMP_RECORD_LEN is enough)
+ * @param size Buffer size
+ * @return Bytes written, 0 if it does not fit
+ */
+size_t dump_format_entry(const ip_tracker_t *entry, uint64_t now_ns, dump_format_t format,
+                         char *buf, size_t size);
+
+/**
+ * Format the end marker
+ * @param count Entries sent
+ * @param format Output format
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @return Bytes written, 0 if it does not fit
+ */
+size_t dump_format_end(size_t count, dump_format_t format, char *buf, size_t size);
+
+/**
+ * Walk the tracker and send matching entries and the end marker to a client
+ * @param table Tracker table
+ * @param req Parsed request
+ * @param fd Client socket (blocking)
+ * @param sent Output: entries sent (may be NULL)
+ * @return SYNFLOOD_OK, or SYNFLOOD_ERROR if the client went away or stalled
+ */
+synflood_ret_t dump_stream(tracker_table_t *table, const dump_request_t *req, int fd,
+                           size_t *sent);
+
+#endif /* SYNFLOOD_DUMP_H */
@@ -0,0 +1,381 @@
+/*
+ * events.c - Detection event stream for control socket subscribers
+ * TCP SYN Flood Detector
+ */
+
+#include "events.h"
+#include "logger.h"
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <pthread.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#define EVENTS_RING_MASK (EVENTS_RING_SIZE - 1)
+
+/* Bytes buffered per subscriber while its socket is full */
+#define EVENTS_OUT_BUFFER 8192
+
+/* A slot is complete when seq == event sequence + 1; writers zero it first */
+typedef struct
+{
+    uint64_t seq;
+    uint64_t timestamp_ns;
+    uint32_t ip_addr;
+    uint32_t syn_count;
+    uint32_t syn_recv_count;
+    uint32_t type;
+} event_slot_t;
+
+static event_slot_t ring[EVENTS_RING_SIZE];
+static uint64_t ring_head = 0;
+
+typedef struct
+{
+    int fd;
+    events_format_t format;
+    uint64_t cursor;
+    bool read_closed; /* Client shut down its side; keep streaming */
+    size_t out_off;
+    size_t out_len;
+    char out[EVENTS_OUT_BUFFER];
+} events_subscriber_t;
+
+/* Slots are claimed by the metrics thread and released by the stream thread */
+static pthread_mutex_t subscribers_lock = PTHREAD_MUTEX_INITIALIZER;
+static events_subscriber_t subscribers[EVENTS_MAX_SUBSCRIBERS];
+static bool subscriber_used[EVENTS_MAX_SUBSCRIBERS];
+static uint64_t dropped_total = 0;
+
+static pthread_t events_thread;
+static volatile bool events_running = false;
+
+void events_publish(event_type_t type, uint32_t ip_addr, uint32_t syn_count,
+                    uint32_t syn_recv_count) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    uint64_t seq = __atomic_fetch_add(&ring_head, 1, __ATOMIC_RELAXED);
+    event_slot_t *slot = &ring[seq & EVENTS_RING_MASK];
+
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    __atomic_store_n(&slot->timestamp_ns,
+                     (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->ip_addr, ip_addr, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->syn_count, syn_count, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->syn_recv_count, syn_recv_count, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->type, (uint32_t)type, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+uint64_t events_head(void) {
+    return __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+}
+
+size_t events_read(uint64_t *cursor, event_record_t *out, size_t max, uint64_t *dropped) {
+    uint64_t head = events_head();
+    uint64_t pos = *cursor;
+    uint64_t lost = 0;
+    size_t n = 0;
+
+    /* Everything older than one ring length is gone */
+    if (head > EVENTS_RING_SIZE && pos < head - EVENTS_RING_SIZE) {
+        lost += head - EVENTS_RING_SIZE - pos;
+        pos = head - EVENTS_RING_SIZE;
+    }
+
+    while (pos < head && n < max) {
+        const event_slot_t *slot = &ring[pos & EVENTS_RING_MASK];
+        uint64_t before = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+
+        if (before < pos + 1) {
+            /* Still being written; pick it up next time */
+            break;
+        }
+
+        event_record_t rec = {
+            .seq = pos,
+            .timestamp_ns = __atomic_load_n(&slot->timestamp_ns, __ATOMIC_RELAXED),
+            .ip_addr = __atomic_load_n(&slot->ip_addr, __ATOMIC_RELAXED),
+            .syn_count = __atomic_load_n(&slot->syn_count, __ATOMIC_RELAXED),
+            .syn_recv_count = __atomic_load_n(&slot->syn_recv_count, __ATOMIC_RELAXED),
+            .type = (uint8_t)__atomic_load_n(&slot->type, __ATOMIC_RELAXED),
+        };
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint64_t after = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+
+        if (before != pos + 1 || after != before) {
+            /* Overwritten by a writer one lap ahead */
+            lost++;
+        } else {
+            out[n++] = rec;
+        }
+        pos++;
+    }
+
+    *cursor = pos;
+    if (dropped) {
+        *dropped = lost;
+    }
+
+    return n;
+}
+
+static void put_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static void put_be64(uint8_t *p, uint64_t v) {
+    put_be32(p, (uint32_t)(v >> 32));
+    put_be32(p + 4, (uint32_t)v);
+}
+
+size_t events_format(const event_record_t *rec, events_format_t format, char *buf, size_t size) {
+    if (format == EVENTS_FORMAT_BINARY) {
+        if (size < EVENTS_FRAME_LEN) {
+            return 0;
+        }
+
+        uint8_t *p = (uint8_t *)buf;
+        put_be64(p, rec->seq);
+        put_be64(p + 8, rec->timestamp_ns);
+        memcpy(p + 16, &rec->ip_addr, 4);
+        put_be32(p + 20, rec->syn_count);
+        put_be32(p + 24, rec->syn_recv_count);
+        p[28] = rec->type;
+        p[29] = p[30] = p[31] = 0;
+        return EVENTS_FRAME_LEN;
+    }
+
+    char ip_str[INET_ADDRSTRLEN];
+    struct in_addr addr = { .s_addr = rec->ip_addr };
+    inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+
+    int len = snprintf(buf, size,
+                       "{\"seq\":%lu,\"ts_ms\":%lu,\"event\":\"%s\",\"ip\":\"%s\","
+                       "\"syn_count\":%u,\"syn_recv\":%u}\n",
+                       rec->seq, (uint64_t)(rec->timestamp_ns / NSEC_PER_MSEC),
+                       logger_event_name((event_type_t)rec->type), ip_str, rec->syn_count,
+                       rec->syn_recv_count);
+
+    return (len > 0 && (size_t)len < size) ? (size_t)len : 0;
+}
+
+size_t events_format_dropped(uint64_t count, events_format_t format, char *buf, size_t size) {
+    if (format == EVENTS_FORMAT_BINARY) {
+        if (size < EVENTS_FRAME_LEN) {
+            return 0;
+        }
+
+        memset(buf, 0, EVENTS_FRAME_LEN);
+        put_be64((uint8_t *)buf, count);
+        ((uint8_t *)buf)[28] = EVENTS_FRAME_DROPPED;
+        return EVENTS_FRAME_LEN;
+    }
+
+    int len = snprintf(buf, size, "{\"event\":\"DROPPED\",\"count\":%lu}\n", count);
+    return (len > 0 && (size_t)len < size) ? (size_t)len : 0;
+}
+
+synflood_ret_t events_parse_format(const char *arg, events_format_t *format) {
+    while (*arg == ' ' || *arg == '\t') {
+        arg++;
+    }
+
+    size_t len = strcspn(arg, " \t\r\n");
+    if (len == 0 || (len == 4 && strncasecmp(arg, "json", 4) == 0)) {
+        *format = EVENTS_FORMAT_JSON;
+    } else if (len == 6 && strncasecmp(arg, "binary", 6) == 0) {
+        *format = EVENTS_FORMAT_BINARY;
+    } else {
+        return SYNFLOOD_EINVAL;
+    }
+
+    return SYNFLOOD_OK;
+}
+
+synflood_ret_t events_subscribe(int fd, events_format_t format) {
+    pthread_mutex_lock(&subscribers_lock);
+
+    for (size_t i = 0; i < EVENTS_MAX_SUBSCRIBERS; i++) {
+        if (!subscriber_used[i]) {
+            events_subscriber_t *sub = &subscribers[i];
+            sub->fd = fd;
+            sub->format = format;
+            sub->cursor = events_head();
+            sub->read_closed = false;
+            sub->out_off = 0;
+            sub->out_len = 0;
+            subscriber_used[i] = true;
+            pthread_mutex_unlock(&subscribers_lock);
+
+            LOG_INFO("Event subscriber connected (%s)",
+                     format == EVENTS_FORMAT_BINARY ? "binary" : "json");
+            return SYNFLOOD_OK;
+        }
+    }
+
+    pthread_mutex_unlock(&subscribers_lock);
+    LOG_WARN("Event subscription refused: %d subscribers connected", EVENTS_MAX_SUBSCRIBERS);
+    return SYNFLOOD_ERROR;
+}
+
+static void events_drop_subscriber(size_t i) {
+    close(subscribers[i].fd);
+
+    pthread_mutex_lock(&subscribers_lock);
+    subscriber_used[i] = false;
+    pthread_mutex_unlock(&subscribers_lock);
+
+    LOG_INFO("Event subscriber disconnected");
+}
+
+/* Send buffered frames, then refill from the ring while the socket takes
+ * them. Returns false when the client is gone. */
+static bool events_pump(events_subscriber_t *sub) {
+    for (;;) {
+        while (sub->out_off < sub->out_len) {
+            ssize_t n = send(sub->fd, sub->out + sub->out_off, sub->out_len - sub->out_off,
+                             MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (n < 0) {
+                /* A full socket only delays this subscriber */
+                return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+            }
+            sub->out_off += (size_t)n;
+        }
+        sub->out_off = sub->out_len = 0;
+
+        event_record_t recs[EVENTS_OUT_BUFFER / EVENTS_JSON_MAX];
+        uint64_t lost = 0;
+        size_t count = events_read(&sub->cursor, recs, ARRAY_SIZE(recs) - 1, &lost);
+
+        if (lost > 0) {
+            sub->out_len += events_format_dropped(lost, sub->format, sub->out, sizeof(sub->out));
+            __atomic_add_fetch(&dropped_total, lost, __ATOMIC_RELAXED);
+        }
+        for (size_t i = 0; i < count; i++) {
+            sub->out_len += events_format(&recs[i], sub->format, sub->out + sub->out_len,
+                                          sizeof(sub->out) - sub->out_len);
+        }
+
+        if (sub->out_len == 0) {
+            return true;
+        }
+    }
+}
+
+static void *events_thread_func(void *arg) {
+    (void)arg;
+    struct pollfd pfds[EVENTS_MAX_SUBSCRIBERS];
+    size_t index[EVENTS_MAX_SUBSCRIBERS];
+
+    LOG_INFO("Event stream thread started");
+
+    while (events_running) {
+        size_t nfds = 0;
+
+        pthread_mutex_lock(&subscribers_lock);
+        for (size_t i = 0; i < EVENTS_MAX_SUBSCRIBERS; i++) {
+            if (subscriber_used[i]) {
+                events_subscriber_t *sub = &subscribers[i];
+                pfds[nfds].fd = sub->fd;
+                pfds[nfds].events = (short)((sub->read_closed ? 0 : POLLIN) |
+                                            (sub->out_len > sub->out_off ? POLLOUT : 0));
+                pfds[nfds].revents = 0;
+                index[nfds++] = i;
+            }
+        }
+        pthread_mutex_unlock(&subscribers_lock);
+
+        if (nfds == 0) {
+            usleep(EVENTS_POLL_MS * 1000);
+            continue;
+        }
+
+        if (poll(pfds, nfds, EVENTS_POLL_MS) < 0 && errno != EINTR) {
+            LOG_ERROR("Event stream poll failed: %s", strerror(errno));
+            break;
+        }
+
+        for (size_t k = 0; k < nfds; k++) {
+            events_subscriber_t *sub = &subscribers[index[k]];
+            bool alive = !(pfds[k].revents & (POLLERR | POLLHUP | POLLNVAL));
+
+            /* Anything the client sends after SUBSCRIBE is ignored; EOF
+             * only means it will not send more */
+            if (alive && (pfds[k].revents & POLLIN)) {
+                char discard[256];
+                ssize_t n = recv(sub->fd, discard, sizeof(discard), MSG_DONTWAIT);
+                if (n == 0) {
+                    sub->read_closed = true;
+                } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    alive = false;
+                }
+            }
+
+            if (!alive || !events_pump(sub)) {
+                events_drop_subscriber(index[k]);
+            }
+        }
+    }
+
+    LOG_INFO("Event stream thread stopped");
+    return NULL;
+}
+
+synflood_ret_t events_start(void) {
+    if (events_running) {
+        return SYNFLOOD_OK;
+    }
+
+    events_running = true;
+    if (pthread_create(&events_thread, NULL, events_thread_func, NULL) != 0) {
+        LOG_ERROR("Failed to create event stream thread");
+        events_running = false;
+        return SYNFLOOD_ERROR;
+    }
+
+    return SYNFLOOD_OK;
+}
+
+void events_stop(void) {
+    if (events_running) {
+        events_running = false;
+        pthread_join(events_thread, NULL);
+    }
+
+    for (size_t i = 0; i < EVENTS_MAX_SUBSCRIBERS; i++) {
+        if (subscriber_used[i]) {
+            events_drop_subscriber(i);
+        }
+    }
+}
+
+void events_get_stats(events_stats_t *out) {
+    if (!out) {
+        return;
+    }
+
+    out->published_total = events_head();
+    out->dropped_total = __atomic_load_n(&dropped_total, __ATOMIC_RELAXED);
+    out->subscribers = 0;
+
+    pthread_mutex_lock(&subscribers_lock);
+    for (size_t i = 0; i < EVENTS_MAX_SUBSCRIBERS; i++) {
+        if (subscriber_used[i]) {
+            out->subscribers++;
+        }
+    }
+    pthread_mutex_unlock(&subscribers_lock);
+}
@@ -0,0 +1,149 @@
+/*
+ * events.h - Detection event stream for control socket subscribers
+ * TCP SYN Flood Detector
+ *
+ * Every detection event (blocked, unblocked, suspicious, ...) is also
+ * written to an in-memory ring buffer. Publishing never blocks: writers
+ * reserve a slot with one atomic increment and overwrite whatever was
+ * there. Clients that send "SUBSCRIBE json" or "SUBSCRIBE binary" on the
+ * metrics socket keep the connection open and get every new event as a
+ * frame. Each subscriber has its own cursor into the ring; one that reads
+ * too slowly falls behind, loses the overwritten events and is told how
+ * many with a DROPPED frame.
+ *
+ * JSON frames are one object per line:
+ *   {"seq":42,"ts_ms":1760781234567,"event":"BLOCKED","ip":"198.51.100.7","syn_count":150,"syn_recv":80}
+ *   {"event":"DROPPED","count":1200}
+ *
+ * Binary frames are EVENTS_FRAME_LEN bytes, integers big-endian:
+ *   seq u64 | timestamp_ns u64 (CLOCK_REALTIME) | ip u32 (as on the wire) |
+ *   syn_count u32 | syn_recv u32 | event u8 | pad[3]
+ * A DROPPED frame has event EVENTS_FRAME_DROPPED and the count in seq.
+ */
+
+#ifndef SYNFLOOD_EVENTS_H
+#define SYNFLOOD_EVENTS_H
+
+#include "common.h"
+#include <stddef.h>
+
+/* Events kept for subscribers (power of 2) */
+#define EVENTS_RING_SIZE 4096
+
+#define EVENTS_MAX_SUBSCRIBERS 16
+
+/* How often the stream thread looks for new events */
+#define EVENTS_POLL_MS 100
+
+#define EVENTS_FRAME_LEN 32
+#define EVENTS_FRAME_DROPPED 0xFF
+
+/* Longest JSON frame including the newline */
+#define EVENTS_JSON_MAX 160
+
+typedef enum
+{
+    EVENTS_FORMAT_JSON = 0,
+    EVENTS_FORMAT_BINARY = 1,
+} events_format_t;
+
+/* One event as read back from the ring */
+typedef struct
+{
+    uint64_t seq;
+    uint64_t timestamp_ns; /* CLOCK_REALTIME */
+    uint32_t ip_addr;      /* Network byte order */
+    uint32_t syn_count;
+    uint32_t syn_recv_count;
+    uint8_t type;          /* event_type_t */
+} event_record_t;
+
+/* Stream counters */
+typedef struct
+{
+    uint64_t published_total;
+    uint64_t dropped_total; /* Events subscribers missed by falling behind */
+    size_t subscribers;
+} events_stats_t;
+
+/**
+ * Add an event to the ring (lock-free, never blocks)
+ * @param type Event type
+ * @param ip_addr Source IP (network byte order)
+ * @param syn_count SYN count that triggered the event
+ * @param syn_recv_count SYN_RECV count from /proc
+ */
+void events_publish(event_type_t type, uint32_t ip_addr, uint32_t syn_count,
+                    uint32_t syn_recv_count);
+
+/**
+ * Sequence number the next event will get (a cursor starting here sees
+ * only new events)
+ * @return Next sequence number
+ */
+uint64_t events_head(void);
+
+/**
+ * Read events from the ring starting at a cursor
+ * @param cursor In: next sequence to read. Out: advanced past what was read or lost
+ * @param out Output records
+ * @param max Capacity of out
+ * @param dropped Output: events overwritten before they could be read
+ * @return Records read
+ */
+size_t events_read(uint64_t *cursor, event_record_t *out, size_t max, uint64_t *dropped);
+
+/**
+ * Format one event as a frame
+ * @param rec Event
+ * @param format Frame format
+ * @param buf Output buffer (EVENTS_JSON_MAX / EVENTS_FRAME_LEN is enough)
+ * @param size Buffer size
+ * @return Frame length, 0 if it does not fit
+ */
+size_t events_format(const event_record_t *rec, events_format_t format, char *buf, size_t size);
+
+/**
+ * Format a DROPPED frame
+ * @param count Events lost
+ * @param format Frame format
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @return Frame length, 0 if it does not fit
+ */
+size_t events_format_dropped(uint64_t count, events_format_t format, char *buf, size_t size);
+
+/**
+ * Parse the argument of a SUBSCRIBE request ("json", "binary", empty = json)
+ * @param arg Argument text (may be followed by whitespace)
+ * @param format Output format
+ * @return SYNFLOOD_OK or SYNFLOOD_EINVAL
+ */
+synflood_ret_t events_parse_format(const char *arg, events_format_t *format);
+
+/**
+ * Hand a connected client to the stream thread, which owns and closes it
+ * @param fd Client socket
+ * @param format Frame format
+ * @return SYNFLOOD_OK, or SYNFLOOD_ERROR if all subscriber slots are taken
+ */
+synflood_ret_t events_subscribe(int fd, events_format_t format);
+
+/**
+ * Start the thread streaming events to subscribers
+ * @return SYNFLOOD_OK on success
+ */
+synflood_ret_t events_start(void);
+
+/**
+ * Stop the stream thread and disconnect all subscribers
+ */
+void events_stop(void);
+
+/**
+ * Get stream counters
+ * @param out Output statistics
+ */
+void events_get_stats(events_stats_t *out);
+
+#endif /* SYNFLOOD_EVENTS_H */
@@ -4,6 +4,7 @@
  */
 
 #include "logger.h"
+#include "events.h"
 #include <systemd/sd-journal.h>
 #include <syslog.h>
 #include <stdio.h>
@@ -42,6 +43,8 @@ static const char *event_type_strings[] = {
     [EVENT_BLOCKED]     = "BLOCKED",
     [EVENT_UNBLOCKED]   = "UNBLOCKED",
     [EVENT_WHITELISTED] = "WHITELISTED",
+    [EVENT_PEER_BLOCKED] = "PEER_BLOCKED",
+    [EVENT_SCAN]        = "SCAN",
 };
 
 synflood_ret_t logger_init(log_level_t level, bool use_syslog) {
@@ -142,15 +145,23 @@ void logger_log(log_level_t level, const char *format, ...) {
     }
 }
 
+const char *logger_event_name(event_type_t event_type) {
+    if ((size_t)event_type < ARRAY_SIZE(event_type_strings) && event_type_strings[event_type]) {
+        return event_type_strings[event_type];
+    }
+    return "UNKNOWN";
+}
+
 void logger_log_event(event_type_t event_type, uint32_t ip_addr,
                       uint32_t syn_count, uint32_t syn_recv_count) {
+    /* Control socket subscribers see every event, whatever the log level */
+    events_publish(event_type, ip_addr, syn_count, syn_recv_count);
+
     char ip_str[INET_ADDRSTRLEN];
     struct in_addr addr = { .s_addr = ip_addr };
     inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
 
-    const char *event_str = (event_type < ARRAY_SIZE(event_type_strings))
-                            ? event_type_strings[event_type]
-                            : "UNKNOWN";
+    const char *event_str = logger_event_name(event_type);
 
     if (use_systemd_journal) {
         /* Structured logging with fields for easy querying */
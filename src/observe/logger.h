@@ -47,6 +47,13 @@ void logger_log(log_level_t level, const char *format, ...)
 void logger_log_event(event_type_t event_type, uint32_t ip_addr,
                       uint32_t syn_count, uint32_t syn_recv_count);
 
+/**
+ * Name of an event type as used in logs and event streams
+ * @param event_type Type of event
+ * @return Static string, "UNKNOWN" for unknown types
+ */
+const char *logger_event_name(event_type_t event_type);
+
 /**
  * Log an error with errno information
  * @param format Printf-style format string
@@ -5,8 +5,22 @@
 
 #include "metrics.h"
 #include "logger.h"
+#include "events.h"
+#include "dump.h"
+#include "control.h"
+#include "../analysis/engine.h"
 #include "../analysis/tracker.h"
+#include "../analysis/victim.h"
+#include "../analysis/scan.h"
+#include "../analysis/asnrate.h"
+#include "../analysis/sweeper.h"
+#include "../capture/netns.h"
+#include "../enforce/peersync.h"
+#include "../enforce/compact.h"
+#include "../enforce/blockcap.h"
+#include <arpa/inet.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/un.h>
 #include <unistd.h>
 #include <pthread.h>
@@ -19,6 +33,333 @@ static pthread_t metrics_thread;
 static volatile bool metrics_running = false;
 static char socket_path[PATH_MAX] = {0};
 
+/* Per-destination series exported (busiest first) */
+#define METRICS_TOP_VICTIMS 16
+
+/* Per-origin-AS series exported (busiest first) */
+#define METRICS_TOP_ASNS 16
+
+/* Append per-destination (victim) metrics for the busiest destinations */
+static void format_victim_metrics(char *buffer, size_t size) {
+    uint64_t now = get_monotonic_ns();
+    size_t tracked, attacked;
+    uint64_t attacks_total;
+    victim_get_counts(&tracked, &attacked, &attacks_total, now);
+
+    victim_stats_t top[METRICS_TOP_VICTIMS];
+    size_t count = victim_get_top(top, METRICS_TOP_VICTIMS, now);
+
+    size_t len = strlen(buffer);
+    len += (size_t)snprintf(buffer + len, size - len,
+                            "\n"
+                            "# HELP synflood_victims_tracked Destinations in the victim table\n"
+                            "# TYPE synflood_victims_tracked gauge\n"
+                            "synflood_victims_tracked %zu\n"
+                            "\n"
+                            "# HELP synflood_victims_under_attack Destinations currently under attack\n"
+                            "# TYPE synflood_victims_under_attack gauge\n"
+                            "synflood_victims_under_attack %zu\n"
+                            "\n"
+                            "# HELP synflood_victim_attacks_total Attacks detected against a destination\n"
+                            "# TYPE synflood_victim_attacks_total counter\n"
+                            "synflood_victim_attacks_total %lu\n"
+                            "\n"
+                            "# HELP synflood_victim_syn_rate SYN/s towards a destination (busiest only)\n"
+                            "# TYPE synflood_victim_syn_rate gauge\n",
+                            tracked, attacked, attacks_total);
+
+    for (size_t i = 0; i < count && len < size; i++) {
+        char ip_str[INET_ADDRSTRLEN];
+        struct in_addr addr = { .s_addr = top[i].dst_ip };
+        inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+
+        len += (size_t)snprintf(buffer + len, size - len,
+                                "synflood_victim_syn_rate{dst=\"%s\",port=\"%u\",under_attack=\"%d\"} %u\n",
+                                ip_str, top[i].dst_port, top[i].under_attack ? 1 : 0,
+                                top[i].syn_rate);
+    }
+}
+
+/* Append per-origin-AS metrics for the busiest ASes */
+static void format_asn_metrics(char *buffer, size_t size) {
+    uint64_t now = get_monotonic_ns();
+    size_t tracked, over;
+    uint64_t episodes_total;
+    asnrate_get_counts(&tracked, &over, &episodes_total, now);
+
+    asnrate_stats_t top[METRICS_TOP_ASNS];
+    size_t count = asnrate_get_top(top, METRICS_TOP_ASNS, now);
+
+    size_t len = strlen(buffer);
+    len += (size_t)snprintf(buffer + len, size - len,
+                            "\n"
+                            "# HELP synflood_asns_tracked Origin ASes in the AS rate table\n"
+                            "# TYPE synflood_asns_tracked gauge\n"
+                            "synflood_asns_tracked %zu\n"
+                            "\n"
+                            "# HELP synflood_asns_over_threshold Origin ASes currently over asn_threshold\n"
+                            "# TYPE synflood_asns_over_threshold gauge\n"
+                            "synflood_asns_over_threshold %zu\n"
+                            "\n"
+                            "# HELP synflood_asn_episodes_total Times an origin AS went over asn_threshold\n"
+                            "# TYPE synflood_asn_episodes_total counter\n"
+                            "synflood_asn_episodes_total %lu\n"
+                            "\n"
+                            "# HELP synflood_asn_syn_rate SYN/s from an origin AS (busiest only)\n"
+                            "# TYPE synflood_asn_syn_rate gauge\n",
+                            tracked, over, episodes_total);
+
+    for (size_t i = 0; i < count && len < size; i++) {
+        len += (size_t)snprintf(buffer + len, size - len,
+                                "synflood_asn_syn_rate{asn=\"%u\",over_threshold=\"%d\"} %u\n",
+                                top[i].asn, top[i].over_threshold ? 1 : 0, top[i].syn_rate);
+    }
+}
+
+/* Append port scan detection metrics */
+static void format_scan_metrics(char *buffer, size_t size) {
+    size_t tracked;
+    uint64_t detected[SCAN_KIND_COUNT];
+    scan_get_counts(&tracked, detected);
+
+    size_t len = strlen(buffer);
+    snprintf(buffer + len, size - len,
+             "\n"
+             "# HELP synflood_scan_sources_tracked Sources in the port scan table\n"
+             "# TYPE synflood_scan_sources_tracked gauge\n"
+             "synflood_scan_sources_tracked %zu\n"
+             "\n"
+             "# HELP synflood_scans_detected_total Sources over a scan threshold, by kind\n"
+             "# TYPE synflood_scans_detected_total counter\n"
+             "synflood_scans_detected_total{kind=\"vertical\"} %lu\n"
+             "synflood_scans_detected_total{kind=\"horizontal\"} %lu\n",
+             tracked, detected[SCAN_VERTICAL], detected[SCAN_HORIZONTAL]);
+}
+
+/* Append per flag class packet and detection counters */
+static void format_class_metrics(app_context_t *ctx, char *buffer, size_t size) {
+    static const char *class_names[FLOOD_CLASS_COUNT] = {
+        [FLOOD_CLASS_SYN] = "syn",
+        [FLOOD_CLASS_SYNACK] = "synack",
+        [FLOOD_CLASS_ACK] = "ack",
+        [FLOOD_CLASS_RST] = "rst",
+        [FLOOD_CLASS_UDP] = "udp",
+        [FLOOD_CLASS_ICMP] = "icmp",
+    };
+    uint64_t packets[FLOOD_CLASS_COUNT];
+    uint64_t detections[FLOOD_CLASS_COUNT];
+
+    pthread_mutex_lock(&ctx->metrics_lock);
+    memcpy(packets, ctx->metrics.class_packets_total, sizeof(packets));
+    memcpy(detections, ctx->metrics.class_detections_total, sizeof(detections));
+    pthread_mutex_unlock(&ctx->metrics_lock);
+
+    size_t len = strlen(buffer);
+    len += (size_t)snprintf(buffer + len, size - len,
+                            "\n"
+                            "# HELP synflood_class_packets_total Packets analysed, by flood class\n"
+                            "# TYPE synflood_class_packets_total counter\n");
+    for (size_t c = 0; c < FLOOD_CLASS_COUNT && len < size; c++) {
+        len += (size_t)snprintf(buffer + len, size - len,
+                                "synflood_class_packets_total{class=\"%s\"} %lu\n",
+                                class_names[c], packets[c]);
+    }
+    if (len >= size) {
+        return;
+    }
+
+    len += (size_t)snprintf(buffer + len, size - len,
+                            "\n"
+                            "# HELP synflood_class_detections_total Sources blocked, by flood class\n"
+                            "# TYPE synflood_class_detections_total counter\n");
+    for (size_t c = 0; c < FLOOD_CLASS_COUNT && len < size; c++) {
+        len += (size_t)snprintf(buffer + len, size - len,
+                                "synflood_class_detections_total{class=\"%s\"} %lu\n",
+                                class_names[c], detections[c]);
+    }
+}
+
+/* Append per-namespace metrics, one labelled series per monitored namespace */
+static void format_netns_metrics(char *buffer, size_t size) {
+    static const struct
+    {
+        const char *name;
+        const char *type;
+        const char *help;
+    } series[] = {
+        { "synflood_netns_packets_total", "counter", "Packets captured in a namespace" },
+        { "synflood_netns_syn_packets_total", "counter", "SYN packets analysed in a namespace" },
+        { "synflood_netns_detections_total", "counter", "Sources blocked in a namespace" },
+        { "synflood_netns_false_positives_total", "counter", "Suspicious sources not confirmed" },
+        { "synflood_netns_blocked_ips", "gauge", "Sources currently blocked in a namespace" },
+        { "synflood_netns_tracked_ips", "gauge", "Sources tracked in a namespace" },
+    };
+
+    size_t count = netns_count();
+    size_t len = strlen(buffer);
+
+    for (size_t s = 0; s < ARRAY_SIZE(series) && len < size; s++) {
+        len += (size_t)snprintf(buffer + len, size - len, "\n# HELP %s %s\n# TYPE %s %s\n",
+                                series[s].name, series[s].help, series[s].name, series[s].type);
+
+        for (size_t i = 0; i < count && len < size; i++) {
+            netns_stats_t stats;
+            if (!netns_get_stats(i, &stats)) {
+                continue;
+            }
+
+            uint64_t values[] = {
+                stats.metrics.packets_total,
+                stats.metrics.syn_packets_total,
+                stats.metrics.detections_total,
+                stats.metrics.false_positives_total,
+                stats.metrics.blocked_ips_current,
+                stats.tracked_ips,
+            };
+
+            len += (size_t)snprintf(buffer + len, size - len, "%s{netns=\"%s\"} %lu\n",
+                                    series[s].name, stats.name, values[s]);
+        }
+    }
+}
+
+/* Append blacklist capacity counters */
+static void format_blockcap_metrics(char *buffer, size_t size) {
+    blockcap_stats_t stats;
+    blockcap_get_stats(&stats);
+
+    size_t len = strlen(buffer);
+    snprintf(buffer + len, size - len,
+             "\n"
+             "# HELP synflood_blacklist_capacity Entries the blacklist set can hold\n"
+             "# TYPE synflood_blacklist_capacity gauge\n"
+             "synflood_blacklist_capacity %zu\n"
+             "\n"
+             "# HELP synflood_blacklist_tracked Blacklist entries tracked for capacity management\n"
+             "# TYPE synflood_blacklist_tracked gauge\n"
+             "synflood_blacklist_tracked %zu\n"
+             "\n"
+             "# HELP synflood_blacklist_rejected_total Blocks refused: set full of higher-rate blocks\n"
+             "# TYPE synflood_blacklist_rejected_total counter\n"
+             "synflood_blacklist_rejected_total %lu\n"
+             "\n"
+             "# HELP synflood_blacklist_evicted_total Blocks evicted to make room for higher-rate ones\n"
+             "# TYPE synflood_blacklist_evicted_total counter\n"
+             "synflood_blacklist_evicted_total %lu\n",
+             stats.capacity, stats.live, stats.rejected_total, stats.evicted_total);
+}
+
+/* Append tracker sweeper counters */
+static void format_sweeper_metrics(char *buffer, size_t size) {
+    sweeper_stats_t stats;
+    sweeper_get_stats(&stats);
+
+    size_t len = strlen(buffer);
+    snprintf(buffer + len, size - len,
+             "\n"
+             "# HELP synflood_tracker_sweep_buckets_total Tracker buckets examined by the sweeper\n"
+             "# TYPE synflood_tracker_sweep_buckets_total counter\n"
+             "synflood_tracker_sweep_buckets_total %lu\n"
+             "\n"
+             "# HELP synflood_tracker_sweep_freed_total Idle or cleared tracker entries freed\n"
+             "# TYPE synflood_tracker_sweep_freed_total counter\n"
+             "synflood_tracker_sweep_freed_total %lu\n"
+             "\n"
+             "# HELP synflood_tracker_sweep_tick_seconds Time spent in the last sweeper tick\n"
+             "# TYPE synflood_tracker_sweep_tick_seconds gauge\n"
+             "synflood_tracker_sweep_tick_seconds %.6f\n"
+             "\n"
+             "# HELP synflood_tracker_sweep_tick_max_seconds Longest sweeper tick since start\n"
+             "# TYPE synflood_tracker_sweep_tick_max_seconds gauge\n"
+             "synflood_tracker_sweep_tick_max_seconds %.6f\n",
+             stats.buckets_total, stats.freed_total,
+             (double)stats.last_tick_ns / NSEC_PER_SEC, (double)stats.max_tick_ns / NSEC_PER_SEC);
+}
+
+/* Append blocklist compaction counters */
+static void format_compact_metrics(char *buffer, size_t size) {
+    compact_stats_t stats;
+    compact_get_stats(&stats);
+
+    size_t len = strlen(buffer);
+    snprintf(buffer + len, size - len,
+             "\n"
+             "# HELP synflood_compact_runs_total Compaction passes that changed the blocklist\n"
+             "# TYPE synflood_compact_runs_total counter\n"
+             "synflood_compact_runs_total %lu\n"
+             "\n"
+             "# HELP synflood_compact_nets_added_total CIDR entries created by compaction\n"
+             "# TYPE synflood_compact_nets_added_total counter\n"
+             "synflood_compact_nets_added_total %lu\n"
+             "\n"
+             "# HELP synflood_compact_retired_total Blocked addresses replaced by a CIDR entry\n"
+             "# TYPE synflood_compact_retired_total counter\n"
+             "synflood_compact_retired_total %lu\n"
+             "\n"
+             "# HELP synflood_compact_errors_total Compaction passes that failed to list or update a set\n"
+             "# TYPE synflood_compact_errors_total counter\n"
+             "synflood_compact_errors_total %lu\n"
+             "\n"
+             "# HELP synflood_compact_nets_current CIDR entries in the compacted set\n"
+             "# TYPE synflood_compact_nets_current gauge\n"
+             "synflood_compact_nets_current %lu\n",
+             stats.runs_total, stats.nets_added_total, stats.retired_total,
+             stats.errors_total, stats.nets_current);
+}
+
+/* Append blocklist sharing counters */
+static void format_peersync_metrics(char *buffer, size_t size) {
+    peersync_stats_t stats;
+    peersync_get_stats(&stats);
+
+    size_t len = strlen(buffer);
+    snprintf(buffer + len, size - len,
+             "\n"
+             "# HELP synflood_peersync_announced_total Local blocks announced to other nodes\n"
+             "# TYPE synflood_peersync_announced_total counter\n"
+             "synflood_peersync_announced_total %lu\n"
+             "\n"
+             "# HELP synflood_peersync_announce_dropped_total Announcements dropped (queue full)\n"
+             "# TYPE synflood_peersync_announce_dropped_total counter\n"
+             "synflood_peersync_announce_dropped_total %lu\n"
+             "\n"
+             "# HELP synflood_peersync_datagrams_sent_total Datagrams sent to the group and peers\n"
+             "# TYPE synflood_peersync_datagrams_sent_total counter\n"
+             "synflood_peersync_datagrams_sent_total %lu\n"
+             "\n"
+             "# HELP synflood_peersync_send_errors_total Datagrams that could not be sent\n"
+             "# TYPE synflood_peersync_send_errors_total counter\n"
+             "synflood_peersync_send_errors_total %lu\n"
+             "\n"
+             "# HELP synflood_peersync_rejected_total Datagrams rejected (bad tag, stale or replayed)\n"
+             "# TYPE synflood_peersync_rejected_total counter\n"
+             "synflood_peersync_rejected_total %lu\n"
+             "\n"
+             "# HELP synflood_peersync_received_total Blocks received from other nodes\n"
+             "# TYPE synflood_peersync_received_total counter\n"
+             "synflood_peersync_received_total %lu\n"
+             "\n"
+             "# HELP synflood_peersync_applied_total Received blocks applied locally\n"
+             "# TYPE synflood_peersync_applied_total counter\n"
+             "synflood_peersync_applied_total %lu\n"
+             "\n"
+             "# HELP synflood_peersync_duplicates_total Received blocks already in place\n"
+             "# TYPE synflood_peersync_duplicates_total counter\n"
+             "synflood_peersync_duplicates_total %lu\n"
+             "\n"
+             "# HELP synflood_peersync_whitelisted_total Received blocks ignored by the local whitelist\n"
+             "# TYPE synflood_peersync_whitelisted_total counter\n"
+             "synflood_peersync_whitelisted_total %lu\n"
+             "\n"
+             "# HELP synflood_peersync_apply_errors_total Received blocks the ipset add failed for\n"
+             "# TYPE synflood_peersync_apply_errors_total counter\n"
+             "synflood_peersync_apply_errors_total %lu\n",
+             stats.announced_total, stats.announce_dropped_total, stats.datagrams_sent_total,
+             stats.send_errors_total, stats.datagrams_rejected_total, stats.received_total,
+             stats.applied_total, stats.duplicates_total, stats.whitelisted_total,
+             stats.apply_errors_total);
+}
+
 /* Format metrics in Prometheus-compatible format */
 static void format_metrics(app_context_t *ctx, char *buffer, size_t size) {
     pthread_mutex_lock(&ctx->metrics_lock);
@@ -51,6 +392,26 @@ static void format_metrics(app_context_t *ctx, char *buffer, size_t size) {
              "# TYPE synflood_whitelist_hits_total counter\n"
              "synflood_whitelist_hits_total %lu\n"
              "\n"
+             "# HELP synflood_packets_dropped_total Packets dropped in-path from blocked sources\n"
+             "# TYPE synflood_packets_dropped_total counter\n"
+             "synflood_packets_dropped_total %lu\n"
+             "\n"
+             "# HELP synflood_fastpath_marked_total Packets marked to bypass NFQUEUE\n"
+             "# TYPE synflood_fastpath_marked_total counter\n"
+             "synflood_fastpath_marked_total %lu\n"
+             "\n"
+             "# HELP synflood_capture_drops_total Packets dropped by the kernel before capture\n"
+             "# TYPE synflood_capture_drops_total counter\n"
+             "synflood_capture_drops_total %lu\n"
+             "\n"
+             "# HELP synflood_shed_packets_total Packets skipped by overload sampling\n"
+             "# TYPE synflood_shed_packets_total counter\n"
+             "synflood_shed_packets_total %lu\n"
+             "\n"
+             "# HELP synflood_sample_rate Current 1-in-N sampling rate (1 = every packet)\n"
+             "# TYPE synflood_sample_rate gauge\n"
+             "synflood_sample_rate %u\n"
+             "\n"
              "# HELP synflood_tracker_entries Current tracker table entries\n"
              "# TYPE synflood_tracker_entries gauge\n"
              "synflood_tracker_entries %zu\n"
@@ -64,10 +425,69 @@ static void format_metrics(app_context_t *ctx, char *buffer, size_t size) {
              ctx->metrics.detections_total,
              ctx->metrics.false_positives_total,
              ctx->metrics.whitelist_hits_total,
+             ctx->metrics.packets_dropped_total,
+             ctx->metrics.fastpath_marked_total,
+             ctx->metrics.capture_drops_total,
+             ctx->metrics.shed_packets_total,
+             ctx->metrics.sample_rate ? ctx->metrics.sample_rate : 1,
              entry_count,
              blocked_count);
 
     pthread_mutex_unlock(&ctx->metrics_lock);
+
+    if (engine_flood_classes(ctx->config) != 1u << FLOOD_CLASS_SYN) {
+        format_class_metrics(ctx, buffer, size);
+    }
+
+    if (ctx->config->victim_threshold != 0) {
+        format_victim_metrics(buffer, size);
+    }
+
+    if (ctx->config->scan_port_threshold != 0 || ctx->config->scan_host_threshold != 0) {
+        format_scan_metrics(buffer, size);
+    }
+
+    if (ctx->asnmap) {
+        format_asn_metrics(buffer, size);
+    }
+
+    if (netns_count() > 0) {
+        format_netns_metrics(buffer, size);
+    }
+
+    if (peersync_enabled()) {
+        format_peersync_metrics(buffer, size);
+    }
+
+    if (blockcap_enabled()) {
+        format_blockcap_metrics(buffer, size);
+    }
+
+    if (compact_enabled()) {
+        format_compact_metrics(buffer, size);
+    }
+
+    if (sweeper_enabled()) {
+        format_sweeper_metrics(buffer, size);
+    }
+
+    events_stats_t events;
+    events_get_stats(&events);
+    size_t len = strlen(buffer);
+    snprintf(buffer + len, size - len,
+             "\n"
+             "# HELP synflood_events_published_total Detection events written to the event stream\n"
+             "# TYPE synflood_events_published_total counter\n"
+             "synflood_events_published_total %lu\n"
+             "\n"
+             "# HELP synflood_events_dropped_total Events stream subscribers missed by falling behind\n"
+             "# TYPE synflood_events_dropped_total counter\n"
+             "synflood_events_dropped_total %lu\n"
+             "\n"
+             "# HELP synflood_event_subscribers Connected event stream subscribers\n"
+             "# TYPE synflood_event_subscribers gauge\n"
+             "synflood_event_subscribers %zu\n",
+             events.published_total, events.dropped_total, events.subscribers);
 }
 
 static void *metrics_server_thread(void *arg) {
@@ -93,8 +513,48 @@ static void *metrics_server_thread(void *arg) {
         if (n > 0) {
             request[n] = '\0';
 
+            /* Event stream: the connection stays open and is handed over */
+            if (strncmp(request, "SUBSCRIBE", 9) == 0) {
+                events_format_t format;
+                const char *error = NULL;
+
+                if (events_parse_format(request + 9, &format) != SYNFLOOD_OK) {
+                    error = "ERROR unknown format (use json or binary)\n";
+                } else if (events_subscribe(client_fd, format) != SYNFLOOD_OK) {
+                    error = "ERROR too many subscribers\n";
+                }
+
+                if (!error) {
+                    continue;
+                }
+                send(client_fd, error, strlen(error), MSG_NOSIGNAL);
+                close(client_fd);
+                continue;
+            }
+
+            /* Binary control protocol (synflood-ctl-native) */
+            if (control_is_request(request, (size_t)n)) {
+                control_handle(ctx, client_fd, (const uint8_t *)request, (size_t)n);
+                close(client_fd);
+                continue;
+            }
+
+            /* Tracker dump: streamed in chunks, then the connection is closed */
+            if (strncmp(request, "DUMP", 4) == 0) {
+                dump_request_t dump;
+                if (dump_parse_request(request + 4, &dump) != SYNFLOOD_OK) {
+                    const char *error = "ERROR usage: DUMP [prefix=<ip>[/<len>]] [min_syn=<n>] "
+                                        "[blocked=yes|no] [format=json|binary]\n";
+                    send(client_fd, error, strlen(error), MSG_NOSIGNAL);
+                } else {
+                    dump_stream(ctx->tracker, &dump, client_fd, NULL);
+                }
+                close(client_fd);
+                continue;
+            }
+
             /* Format and send metrics */
-            char response[8192];
+            char response[32768];
             format_metrics(ctx, response, sizeof(response));
 
             send(client_fd, response, strlen(response), 0);
@@ -137,6 +597,15 @@ synflood_ret_t metrics_init(app_context_t *ctx, const char *socket_path_arg) {
         return SYNFLOOD_ERROR;
     }
 
+    /* Control requests act on the daemon: keep other users off the socket */
+    if (chmod(socket_path, 0600) < 0) {
+        LOG_ERROR("Failed to restrict metrics socket %s: %s", socket_path, strerror(errno));
+        close(metrics_sock_fd);
+        unlink(socket_path);
+        metrics_sock_fd = -1;
+        return SYNFLOOD_ERROR;
+    }
+
     /* Listen for connections */
     if (listen(metrics_sock_fd, 5) < 0) {
         LOG_ERROR("Failed to listen on metrics socket");
@@ -147,6 +616,7 @@ synflood_ret_t metrics_init(app_context_t *ctx, const char *socket_path_arg) {
     }
 
     ctx->metrics_socket_fd = metrics_sock_fd;
+    control_init();
 
     LOG_INFO("Metrics server initialized: socket=%s", socket_path);
 
@@ -165,9 +635,13 @@ synflood_ret_t metrics_start(app_context_t *ctx) {
 
     metrics_running = true;
 
+    /* Not fatal: whitelist edits are then written inline */
+    control_start();
+
     if (pthread_create(&metrics_thread, NULL, metrics_server_thread, ctx) != 0) {
         LOG_ERROR("Failed to create metrics server thread");
         metrics_running = false;
+        control_stop();
         return SYNFLOOD_ERROR;
     }
 
@@ -188,6 +662,7 @@ void metrics_stop(void) {
     }
 
     pthread_join(metrics_thread, NULL);
+    control_stop();
 }
 
 void metrics_cleanup(void) {
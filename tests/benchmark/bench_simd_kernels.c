@@ -0,0 +1,91 @@
+/*
+ * bench_simd_kernels.c - Scalar vs SSE4.2 vs AVX2 kernel throughput
+ *
+ * Runs each CPU-dispatched kernel at every level the CPU supports.
+ *
+ * Usage: bench_simd_kernels [iterations]
+ */
+
+#include "../../include/common.h"
+#include "../../src/analysis/simd.h"
+#include "../../src/observe/logger.h"
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define HASH_BATCH   4096
+#define FIND_KEYS    256
+#define CIDR_COUNT   64
+
+/* Keeps results observable so loops are not optimized away */
+static volatile uint64_t sink;
+
+int main(int argc, char *argv[]) {
+    size_t iterations = argc > 1 ? strtoul(argv[1], NULL, 0) : 2000;
+    if (iterations == 0) {
+        fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    logger_init(LOG_LEVEL_ERROR, false);
+
+    static uint32_t ips[HASH_BATCH], buckets[HASH_BATCH];
+    static uint32_t keys[FIND_KEYS];
+    static uint32_t prefixes[CIDR_COUNT], masks[CIDR_COUNT];
+    static const char hex[] = "C0A80101";
+
+    for (uint32_t i = 0; i < HASH_BATCH; i++) {
+        ips[i] = htonl(0x0A000000 + i * 2654435761u);
+    }
+    for (uint32_t i = 0; i < FIND_KEYS; i++) {
+        keys[i] = i + 1;
+    }
+    for (uint32_t i = 0; i < CIDR_COUNT; i++) {
+        masks[i] = htonl(0xFFFF0000);
+        prefixes[i] = htonl(0xAC000000 + (i << 16));  /* Never matches 10/8 */
+    }
+
+    printf("%-8s %14s %14s %14s %14s\n", "level", "hash ns/ip", "find ns/key",
+           "cidr ns/prefix", "hex8 ns/call");
+
+    const simd_level_t levels[] = { SIMD_LEVEL_SCALAR, SIMD_LEVEL_SSE42, SIMD_LEVEL_AVX2 };
+    for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+        if (simd_set_level(levels[l]) != SYNFLOOD_OK) {
+            printf("%-8s (not supported by this CPU)\n", simd_level_name(levels[l]));
+            continue;
+        }
+
+        uint64_t start = get_monotonic_ns();
+        for (size_t it = 0; it < iterations; it++) {
+            simd_hash_batch(ips, buckets, HASH_BATCH, 1u << 20);
+            sink += buckets[it % HASH_BATCH];
+        }
+        double hash_ns = (double)(get_monotonic_ns() - start) / ((double)iterations * HASH_BATCH);
+
+        start = get_monotonic_ns();
+        for (size_t it = 0; it < iterations * 16; it++) {
+            sink += simd_find_u32(keys, FIND_KEYS, 0);  /* Miss: full scan */
+        }
+        double find_ns = (double)(get_monotonic_ns() - start) / ((double)iterations * 16 * FIND_KEYS);
+
+        start = get_monotonic_ns();
+        for (size_t it = 0; it < iterations * 64; it++) {
+            sink += simd_cidr_any(prefixes, masks, CIDR_COUNT, ips[it % HASH_BATCH]);
+        }
+        double cidr_ns = (double)(get_monotonic_ns() - start) / ((double)iterations * 64 * CIDR_COUNT);
+
+        start = get_monotonic_ns();
+        for (size_t it = 0; it < iterations * 1024; it++) {
+            uint32_t value;
+            simd_hex8(hex, &value);
+            sink += value;
+        }
+        double hex_ns = (double)(get_monotonic_ns() - start) / ((double)iterations * 1024);
+
+        printf("%-8s %14.3f %14.3f %14.3f %14.2f\n", simd_level_name(levels[l]),
+               hash_ns, find_ns, cidr_ns, hex_ns);
+    }
+
+    logger_shutdown();
+    return EXIT_SUCCESS;
+}
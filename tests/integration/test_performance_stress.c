@@ -6,6 +6,7 @@
 
 #include "../unity/unity.h"
 #include "../../include/common.h"
+#include "../../src/clock.h"
 #include "../../src/analysis/tracker.h"
 #include "../../src/analysis/whitelist.h"
 #include "../../src/observe/logger.h"
@@ -107,6 +108,9 @@ TEST_CASE(test_high_block_rate) {
 TEST_CASE(test_high_expiry_rate) {
     /* Test system processing many block expirations */
 
+    clock_virtual_t clock;
+    clock_virtual_start(&clock, sec_to_ns(1000));
+
     tracker_table_t *tracker = tracker_create(2048, 5000);
     uint64_t now = get_monotonic_ns();
 
@@ -119,15 +123,19 @@ TEST_CASE(test_high_expiry_rate) {
         t->block_expiry_ns = now + sec_to_ns(60);  /* All expire in 60s */
     }
 
-    /* Check expiry after 70 seconds */
-    uint64_t check_time = now + sec_to_ns(70);
-
-    /* Get expired in batches */
     uint32_t expired_ips[100];
+
+    /* Nothing has expired 59 seconds in */
+    clock_virtual_advance(&clock, sec_to_ns(59));
+    TEST_ASSERT_EQUAL(0, tracker_get_expired_blocks(tracker, get_monotonic_ns(), expired_ips, 100));
+
+    /* Get expired in batches 70 seconds in */
+    clock_virtual_advance(&clock, sec_to_ns(11));
     size_t total_expired = 0;
 
-    for (int batch = 0; batch < 10; batch++) {
-        size_t expired_count = tracker_get_expired_blocks(tracker, check_time, expired_ips, 100);
+    for (int batch = 0; batch < 11; batch++) {
+        size_t expired_count = tracker_get_expired_blocks(tracker, get_monotonic_ns(),
+                                                          expired_ips, 100);
         total_expired += expired_count;
 
         /* Unblock this batch */
@@ -151,6 +159,7 @@ TEST_CASE(test_high_expiry_rate) {
     TEST_ASSERT_EQUAL_UINT32(0, blocked_count);
 
     tracker_destroy(tracker);
+    clock_install(NULL);
 }
 
 TEST_CASE(test_whitelist_large_scale) {
@@ -245,42 +254,110 @@ TEST_CASE(test_mixed_operations_stress) {
     whitelist_free(whitelist);
 }
 
+/* Window accounting as the engine does it, on the installed clock */
+static void count_syn(ip_tracker_t *t, uint64_t window_ns) {
+    uint64_t now = get_monotonic_ns();
+    if (now - t->window_start_ns > window_ns) {
+        t->window_start_ns = now;
+        t->syn_count = 0;
+    }
+    t->syn_count++;
+}
+
 TEST_CASE(test_rapid_window_resets) {
     /* Test rapid detection window resets */
 
+    clock_virtual_t clock;
+    clock_virtual_start(&clock, sec_to_ns(1000));
+
     tracker_table_t *tracker = tracker_create(256, 1000);
     uint32_t window_ms = 1000;
     uint64_t window_ns = ms_to_ns(window_ms);
 
     uint32_t ip = inet_addr("203.0.113.100");
-    uint64_t time = get_monotonic_ns();
-
-    ip_tracker_t *t = tracker_get_or_create(tracker, ip);
 
     /* Simulate 100 window resets */
     for (int cycle = 0; cycle < 100; cycle++) {
-        t->window_start_ns = time;
-        t->syn_count = 0;
+        uint64_t cycle_start = get_monotonic_ns();
 
-        /* Count SYNs within window */
+        /* 50 SYNs 10ms apart, all within one window */
         for (int i = 0; i < 50; i++) {
-            t->syn_count++;
-            t->last_seen_ns = time + ms_to_ns(i * 10);
+            ip_tracker_t *t = tracker_get_or_create(tracker, ip);
+            count_syn(t, window_ns);
+            TEST_ASSERT_EQUAL_UINT64(get_monotonic_ns(), t->last_seen_ns);
+            clock_virtual_advance(&clock, ms_to_ns(10));
         }
 
+        ip_tracker_t *t = tracker_get(tracker, ip);
         TEST_ASSERT_EQUAL_UINT32(50, t->syn_count);
+        TEST_ASSERT_EQUAL_UINT64(cycle_start, t->window_start_ns);
+
+        /* Advance past the window */
+        clock_virtual_set(&clock, cycle_start + window_ns + ms_to_ns(100));
+    }
+
+    tracker_destroy(tracker);
+    clock_install(NULL);
+}
+
+TEST_CASE(test_simulated_hours_of_traffic) {
+    /* Six hours of traffic in virtual time: a low-rate background plus an
+     * attacker that returns every hour, with blocks expiring in between */
 
-        /* Advance to next window */
-        time += window_ns + ms_to_ns(100);
+    clock_virtual_t clock;
+    clock_virtual_start(&clock, sec_to_ns(1000));
 
-        /* Reset window */
-        if (time - t->window_start_ns > window_ns) {
-            t->window_start_ns = time;
-            t->syn_count = 0;
+    tracker_table_t *tracker = tracker_create(1024, 2000);
+    uint64_t window_ns = ms_to_ns(1000);
+    uint32_t syn_threshold = 100;
+    uint32_t attacker = inet_addr("198.51.100.7");
+    uint32_t expired_ips[64];
+    int blocks = 0;
+    int unblocks = 0;
+
+    for (uint32_t second = 0; second < 6 * 3600; second++) {
+        /* Background: one SYN from each of a rotating set of clients */
+        uint32_t client = htonl(0x0A000000 | (second % 1500));
+        count_syn(tracker_get_or_create(tracker, client), window_ns);
+
+        /* Attacker: 200 SYN/s during the first minute of every hour */
+        if (second % 3600 < 60) {
+            ip_tracker_t *t = tracker_get_or_create(tracker, attacker);
+            for (int i = 0; i < 200 && !t->blocked; i++) {
+                count_syn(t, window_ns);
+                if (t->syn_count > syn_threshold) {
+                    t->blocked = 1;
+                    t->block_expiry_ns = get_monotonic_ns() + sec_to_ns(300);
+                    blocks++;
+                }
+            }
         }
+
+        /* Expiry pass, as the expiry thread would run it */
+        size_t n = tracker_get_expired_blocks(tracker, get_monotonic_ns(), expired_ips, 64);
+        for (size_t i = 0; i < n; i++) {
+            ip_tracker_t *t = tracker_get(tracker, expired_ips[i]);
+            if (t) {
+                t->blocked = 0;
+                t->syn_count = 0;
+                unblocks++;
+            }
+        }
+
+        clock_virtual_advance(&clock, sec_to_ns(1));
     }
 
+    /* Blocked once per hour, unblocked 300s later each time */
+    TEST_ASSERT_EQUAL_INT(6, blocks);
+    TEST_ASSERT_EQUAL_INT(6, unblocks);
+
+    size_t entry_count, blocked_count;
+    tracker_get_stats(tracker, &entry_count, &blocked_count);
+    TEST_ASSERT_EQUAL_UINT32(0, blocked_count);
+    TEST_ASSERT_EQUAL_UINT32(1501, entry_count);
+
     tracker_destroy(tracker);
+    clock_install(NULL);
 }
 
 TEST_CASE(test_hash_collision_performance) {
@@ -417,6 +494,7 @@ int main(void) {
     RUN_TEST(test_whitelist_large_scale);
     RUN_TEST(test_mixed_operations_stress);
     RUN_TEST(test_rapid_window_resets);
+    RUN_TEST(test_simulated_hours_of_traffic);
     RUN_TEST(test_hash_collision_performance);
     RUN_TEST(test_memory_efficiency);
     RUN_TEST(test_distributed_attack_simulation);
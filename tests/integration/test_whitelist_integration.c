@@ -336,6 +336,42 @@ TEST_CASE(test_whitelist_unblock_previously_blocked) {
     whitelist_free(whitelist);
 }
 
+TEST_CASE(test_whitelist_verdict_cached_in_tracker) {
+    /* Test that the whitelist verdict is cached per entry until the generation changes */
+
+    tracker_table_t *tracker = tracker_create(256, 1000);
+    whitelist_node_t *whitelist = NULL;
+    whitelist_add(&whitelist, "10.0.0.0/8");
+
+    uint32_t trusted_ip = inet_addr("10.1.2.3");
+    uint32_t other_ip = inet_addr("203.0.113.7");
+
+    ip_tracker_t *trusted = tracker_get_or_create(tracker, trusted_ip);
+    ip_tracker_t *other = tracker_get_or_create(tracker, other_ip);
+
+    /* Fresh entries are always evaluated against the trie */
+    TEST_ASSERT_TRUE(whitelist_check_cached(whitelist, 1, trusted));
+    TEST_ASSERT_FALSE(whitelist_check_cached(whitelist, 1, other));
+    TEST_ASSERT_EQUAL_UINT32(1, trusted->whitelist_gen);
+
+    /* Same generation: cached verdict is used without consulting the trie */
+    TEST_ASSERT_TRUE(whitelist_check_cached(NULL, 1, trusted));
+
+    /* Simulated reload with the range removed: new generation re-evaluates */
+    whitelist_free(whitelist);
+    whitelist = NULL;
+    whitelist_add(&whitelist, "203.0.113.0/24");
+
+    TEST_ASSERT_FALSE(whitelist_check_cached(whitelist, 2, trusted));
+    TEST_ASSERT_TRUE(whitelist_check_cached(whitelist, 2, other));
+
+    /* Whitelisted sources never accumulate SYN counts */
+    TEST_ASSERT_EQUAL_UINT32(0, other->syn_count);
+
+    tracker_destroy(tracker);
+    whitelist_free(whitelist);
+}
+
 int main(void) {
     UnityBegin("test_whitelist_integration.c");
 
@@ -347,6 +383,7 @@ int main(void) {
     RUN_TEST(test_whitelist_localhost_and_special);
     RUN_TEST(test_whitelist_large_scale);
     RUN_TEST(test_whitelist_unblock_previously_blocked);
+    RUN_TEST(test_whitelist_verdict_cached_in_tracker);
 
     return UnityEnd();
 }
@@ -0,0 +1,334 @@
+/*
+ * test_asn.c - Unit tests for the prefix to origin AS map and AS rate table
+ */
+
+#include "../unity/unity.h"
+#include "../../include/common.h"
+#include "../../src/analysis/asnmap.h"
+#include "../../src/analysis/asnrate.h"
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static char snapshot_path[] = "/tmp/synflood_test_rib_XXXXXX";
+static char map_path[64];
+
+/* Write a snapshot and build a map from it */
+static asnmap_t *build_map(const char *snapshot, size_t *prefixes, size_t *ranges) {
+    strcpy(snapshot_path, "/tmp/synflood_test_rib_XXXXXX");
+    int fd = mkstemp(snapshot_path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL_INT((int)strlen(snapshot), (int)write(fd, snapshot, strlen(snapshot)));
+    close(fd);
+
+    snprintf(map_path, sizeof(map_path), "%s.map", snapshot_path);
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, asnmap_build(snapshot_path, map_path, prefixes, ranges));
+    return asnmap_open(map_path);
+}
+
+static void remove_files(void) {
+    unlink(snapshot_path);
+    unlink(map_path);
+}
+
+static uint32_t lookup(const asnmap_t *map, const char *ip) {
+    return asnmap_lookup(map, inet_addr(ip));
+}
+
+TEST_CASE(test_asnmap_longest_prefix_wins) {
+    size_t prefixes, ranges;
+    asnmap_t *map = build_map("# comment\n"
+                              "10.0.0.0/8 100\n"
+                              "10.1.0.0/16\tAS200\n"
+                              "10.1.2.0/24 300_301\n"
+                              "10.1.2.128/25 {400,401}\n"
+                              "2001:db8::/32 500\n"
+                              "192.0.2.0/24 600\n"
+                              "garbage\n"
+                              "198.51.100.0/24 700\n"
+                              "198.51.100.0/24 800\n"
+                              "0.0.0.0/0 900\n",
+                              &prefixes, &ranges);
+    TEST_ASSERT_NOT_NULL(map);
+    TEST_ASSERT_EQUAL_INT(8, prefixes);
+
+    TEST_ASSERT_EQUAL_UINT32(100, lookup(map, "10.0.0.1"));
+    TEST_ASSERT_EQUAL_UINT32(100, lookup(map, "10.255.255.255"));
+    TEST_ASSERT_EQUAL_UINT32(200, lookup(map, "10.1.0.0"));
+    TEST_ASSERT_EQUAL_UINT32(200, lookup(map, "10.1.1.255"));
+    TEST_ASSERT_EQUAL_UINT32(300, lookup(map, "10.1.2.0"));
+    TEST_ASSERT_EQUAL_UINT32(300, lookup(map, "10.1.2.127"));
+    TEST_ASSERT_EQUAL_UINT32(400, lookup(map, "10.1.2.128"));
+    TEST_ASSERT_EQUAL_UINT32(400, lookup(map, "10.1.2.255"));
+    TEST_ASSERT_EQUAL_UINT32(200, lookup(map, "10.1.3.0"));
+    TEST_ASSERT_EQUAL_UINT32(100, lookup(map, "10.2.0.0"));
+    TEST_ASSERT_EQUAL_UINT32(600, lookup(map, "192.0.2.77"));
+
+    /* Duplicate prefix: the later line wins */
+    TEST_ASSERT_EQUAL_UINT32(800, lookup(map, "198.51.100.1"));
+
+    /* The default route covers everything else */
+    TEST_ASSERT_EQUAL_UINT32(900, lookup(map, "0.0.0.0"));
+    TEST_ASSERT_EQUAL_UINT32(900, lookup(map, "9.255.255.255"));
+    TEST_ASSERT_EQUAL_UINT32(900, lookup(map, "11.0.0.0"));
+    TEST_ASSERT_EQUAL_UINT32(900, lookup(map, "255.255.255.255"));
+
+    asnmap_close(map);
+    remove_files();
+}
+
+TEST_CASE(test_asnmap_bgpdump_and_unrouted_space) {
+    size_t prefixes, ranges;
+    asnmap_t *map = build_map(
+        "TABLE_DUMP2|1700000000|B|192.0.2.1|64496|203.0.113.0/24|64496 3356 13335|IGP|192.0.2.1|0|0||NAG||\n"
+        "TABLE_DUMP2|1700000000|B|192.0.2.1|64496|2001:db8::/32|64496 6939|IGP|2001:db8::1|0|0||NAG||\n"
+        "TABLE_DUMP2|1700000000|B|192.0.2.1|64496|203.0.112.0/24|64496 {64511,64510}|IGP|192.0.2.1|0|0||NAG||\n"
+        "TABLE_DUMP2|1700000000|B|192.0.2.1|64496|198.18.0.0/15|64496 174|IGP|192.0.2.1|0|0||NAG||\n",
+        &prefixes, &ranges);
+    TEST_ASSERT_NOT_NULL(map);
+    TEST_ASSERT_EQUAL_INT(3, prefixes);
+
+    /* 0/unrouted, 198.18/15, gap, 203.0.112/24, 203.0.113/24, rest */
+    TEST_ASSERT_EQUAL_INT(6, ranges);
+
+    TEST_ASSERT_EQUAL_UINT32(13335, lookup(map, "203.0.113.9"));
+    TEST_ASSERT_EQUAL_UINT32(64511, lookup(map, "203.0.112.9"));
+    TEST_ASSERT_EQUAL_UINT32(174, lookup(map, "198.19.255.255"));
+    TEST_ASSERT_EQUAL_UINT32(0, lookup(map, "198.17.255.255"));
+    TEST_ASSERT_EQUAL_UINT32(0, lookup(map, "198.20.0.0"));
+    TEST_ASSERT_EQUAL_UINT32(0, lookup(map, "203.0.114.0"));
+    TEST_ASSERT_EQUAL_UINT32(0, lookup(map, "1.1.1.1"));
+    TEST_ASSERT_EQUAL_UINT32(0, asnmap_lookup(NULL, inet_addr("1.1.1.1")));
+
+    asnmap_close(map);
+    remove_files();
+}
+
+TEST_CASE(test_asnmap_lookups_match_linear_scan) {
+    /* Many prefixes sharing /16s, nested and adjacent */
+    size_t size = 64 * 1024;
+    char *snapshot = malloc(size);
+    TEST_ASSERT_NOT_NULL(snapshot);
+    size_t len = 0;
+
+    struct { uint32_t net; uint8_t len; uint32_t asn; } routes[600];
+    size_t n = 0;
+    srand(7);
+    for (; n < ARRAY_SIZE(routes); n++) {
+        uint8_t prefix_len = (uint8_t)(16 + rand() % 13);
+        uint32_t net = (0x0A000000u | ((uint32_t)(rand() % 4) << 16) | ((uint32_t)rand() & 0xFFFF)) &
+                       (0xFFFFFFFFu << (32 - prefix_len));
+        routes[n].net = net;
+        routes[n].len = prefix_len;
+        routes[n].asn = 1000 + (uint32_t)n;
+        len += (size_t)snprintf(snapshot + len, size - len, "%u.%u.%u.%u/%u %u\n", net >> 24,
+                                (net >> 16) & 0xFF, (net >> 8) & 0xFF, net & 0xFF, prefix_len,
+                                routes[n].asn);
+    }
+
+    size_t prefixes, ranges;
+    asnmap_t *map = build_map(snapshot, &prefixes, &ranges);
+    TEST_ASSERT_NOT_NULL(map);
+    TEST_ASSERT_EQUAL_INT((int)n, (int)prefixes);
+
+    for (int i = 0; i < 20000; i++) {
+        uint32_t addr = 0x0A000000u | ((uint32_t)(rand() % 5) << 16) | ((uint32_t)rand() & 0xFFFF);
+
+        /* Reference: longest match, later line among equals */
+        uint32_t expected = 0;
+        int best = -1;
+        for (size_t r = 0; r < n; r++) {
+            uint32_t mask = 0xFFFFFFFFu << (32 - routes[r].len);
+            if ((addr & mask) == routes[r].net && routes[r].len >= best) {
+                best = routes[r].len;
+                expected = routes[r].asn;
+            }
+        }
+        TEST_ASSERT_EQUAL_UINT32(expected, asnmap_lookup(map, htonl(addr)));
+    }
+
+    asnmap_close(map);
+    remove_files();
+    free(snapshot);
+}
+
+TEST_CASE(test_asnmap_prefixes_of_an_as) {
+    size_t prefixes, ranges;
+    asnmap_t *map = build_map("10.0.0.0/23 100\n"
+                              "10.0.2.0/24 100\n"
+                              "10.0.3.0/25 100\n"
+                              "10.0.1.0/24 200\n"
+                              "192.0.2.0/24 100\n",
+                              &prefixes, &ranges);
+    TEST_ASSERT_NOT_NULL(map);
+
+    uint32_t nets[8];
+    uint8_t lens[8];
+
+    /* 10.0.0.0/24, 10.0.2.0/24 + 10.0.3.0/25 merged, 192.0.2.0/24 */
+    size_t count = asnmap_prefixes(map, 100, nets, lens, ARRAY_SIZE(nets));
+    TEST_ASSERT_EQUAL_INT(4, count);
+    TEST_ASSERT_EQUAL_UINT32(inet_addr("10.0.0.0"), nets[0]);
+    TEST_ASSERT_EQUAL_INT(24, lens[0]);
+    TEST_ASSERT_EQUAL_UINT32(inet_addr("10.0.2.0"), nets[1]);
+    TEST_ASSERT_EQUAL_INT(24, lens[1]);
+    TEST_ASSERT_EQUAL_UINT32(inet_addr("10.0.3.0"), nets[2]);
+    TEST_ASSERT_EQUAL_INT(25, lens[2]);
+    TEST_ASSERT_EQUAL_UINT32(inet_addr("192.0.2.0"), nets[3]);
+    TEST_ASSERT_EQUAL_INT(24, lens[3]);
+
+    /* Truncated output still reports the full count */
+    TEST_ASSERT_EQUAL_INT(4, asnmap_prefixes(map, 100, nets, lens, 2));
+    TEST_ASSERT_EQUAL_INT(1, asnmap_prefixes(map, 200, nets, lens, ARRAY_SIZE(nets)));
+    TEST_ASSERT_EQUAL_INT(0, asnmap_prefixes(map, 300, nets, lens, ARRAY_SIZE(nets)));
+
+    asnmap_close(map);
+    remove_files();
+}
+
+TEST_CASE(test_asnmap_rejects_bad_files) {
+    size_t prefixes, ranges;
+    asnmap_t *map = build_map("10.0.0.0/8 100\n", &prefixes, &ranges);
+    TEST_ASSERT_NOT_NULL(map);
+    asnmap_close(map);
+
+    /* Truncated */
+    TEST_ASSERT_EQUAL_INT(0, truncate(map_path, 1000));
+    TEST_ASSERT_NULL(asnmap_open(map_path));
+
+    /* Not a map at all */
+    TEST_ASSERT_NULL(asnmap_open(snapshot_path));
+    TEST_ASSERT_NULL(asnmap_open("/nonexistent/asn.map"));
+
+    /* A snapshot without IPv4 routes builds nothing */
+    FILE *fp = fopen(snapshot_path, "w");
+    TEST_ASSERT_NOT_NULL(fp);
+    fputs("2001:db8::/32 100\n# nothing else\n", fp);
+    fclose(fp);
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, asnmap_build(snapshot_path, map_path, NULL, NULL));
+
+    remove_files();
+}
+
+TEST_CASE(test_asnmap_cached_lookup_follows_generation) {
+    size_t prefixes, ranges;
+    asnmap_t *map = build_map("10.0.0.0/8 100\n", &prefixes, &ranges);
+    TEST_ASSERT_NOT_NULL(map);
+
+    ip_tracker_t entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.ip_addr = inet_addr("10.1.2.3");
+
+    asnmap_t *published = NULL;
+    uint32_t generation = 1;
+    asnmap_replace(&published, map, &generation);
+    TEST_ASSERT_EQUAL_UINT32(2, generation);
+    TEST_ASSERT_EQUAL_UINT32(100, asnmap_lookup_cached(published, generation, &entry));
+
+    /* Cached until the generation changes */
+    entry.asn = 42;
+    TEST_ASSERT_EQUAL_UINT32(42, asnmap_lookup_cached(published, generation, &entry));
+
+    asnmap_replace(&published, NULL, &generation);
+    TEST_ASSERT_NULL(published);
+    TEST_ASSERT_EQUAL_UINT32(0, asnmap_lookup_cached(published, generation, &entry));
+
+    asnmap_reclaim(true);
+    remove_files();
+}
+
+TEST_CASE(test_asnrate_threshold_and_hold) {
+    synflood_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.window_ms = 1000;
+    config.asn_threshold = 500;
+    config.asn_hold_s = 5;
+
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, asnrate_init(100));
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, asnrate_init(64));
+
+    uint64_t now = sec_to_ns(100);
+    bool started = true;
+
+    /* Threshold is exclusive, like syn_threshold */
+    TEST_ASSERT_FALSE(asnrate_record(13335, 500, now, &config, &started));
+    TEST_ASSERT_FALSE(started);
+    TEST_ASSERT_TRUE(asnrate_record(13335, 1, now + 1, &config, &started));
+    TEST_ASSERT_TRUE(started);
+    TEST_ASSERT_TRUE(asnrate_record(13335, 1, now + 2, &config, &started));
+    TEST_ASSERT_FALSE(started);
+
+    /* Another AS is counted separately */
+    TEST_ASSERT_FALSE(asnrate_record(64496, 10, now + 3, &config, NULL));
+
+    /* Held through quiet windows, then released */
+    TEST_ASSERT_TRUE(asnrate_record(13335, 1, now + sec_to_ns(3), &config, NULL));
+    TEST_ASSERT_FALSE(asnrate_record(13335, 1, now + sec_to_ns(6), &config, NULL));
+
+    size_t tracked, over;
+    uint64_t episodes;
+    asnrate_get_counts(&tracked, &over, &episodes, now + sec_to_ns(6));
+    TEST_ASSERT_EQUAL_INT(2, tracked);
+    TEST_ASSERT_EQUAL_INT(0, over);
+    TEST_ASSERT_EQUAL_UINT64(1, episodes);
+
+    /* Rates only: nothing is ever over a zero threshold */
+    config.asn_threshold = 0;
+    TEST_ASSERT_FALSE(asnrate_record(13335, 100000, now + sec_to_ns(20), &config, &started));
+    TEST_ASSERT_FALSE(started);
+
+    asnrate_stats_t top[4];
+    TEST_ASSERT_EQUAL_INT(2, asnrate_get_top(top, ARRAY_SIZE(top), now + sec_to_ns(20)));
+    TEST_ASSERT_EQUAL_UINT32(13335, top[0].asn);
+
+    asnrate_cleanup();
+}
+
+TEST_CASE(test_asnrate_queues_blocks_once) {
+    synflood_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.window_ms = 1000;
+    config.asn_threshold = 10;
+    config.asn_hold_s = 5;
+
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, asnrate_init(64));
+
+    uint64_t now = sec_to_ns(100);
+    uint32_t queued[4];
+
+    /* Without asn_block nothing is queued */
+    TEST_ASSERT_TRUE(asnrate_record(64496, 11, now, &config, NULL));
+    TEST_ASSERT_EQUAL_INT(0, asnrate_take_blocks(queued, ARRAY_SIZE(queued)));
+
+    /* Queued when the AS goes over, taken once */
+    config.asn_block = true;
+    TEST_ASSERT_TRUE(asnrate_record(13335, 11, now, &config, NULL));
+    TEST_ASSERT_TRUE(asnrate_record(13335, 1, now + 1, &config, NULL));
+    TEST_ASSERT_EQUAL_INT(1, asnrate_take_blocks(queued, ARRAY_SIZE(queued)));
+    TEST_ASSERT_EQUAL_UINT32(13335, queued[0]);
+    TEST_ASSERT_EQUAL_INT(0, asnrate_take_blocks(queued, ARRAY_SIZE(queued)));
+
+    /* A new episode queues it again */
+    TEST_ASSERT_FALSE(asnrate_record(13335, 1, now + sec_to_ns(7), &config, NULL));
+    TEST_ASSERT_TRUE(asnrate_record(13335, 11, now + sec_to_ns(7) + 1, &config, NULL));
+    TEST_ASSERT_EQUAL_INT(1, asnrate_take_blocks(queued, ARRAY_SIZE(queued)));
+
+    asnrate_cleanup();
+}
+
+int main(void) {
+    UnityBegin("test_asn.c");
+
+    RUN_TEST(test_asnmap_longest_prefix_wins);
+    RUN_TEST(test_asnmap_bgpdump_and_unrouted_space);
+    RUN_TEST(test_asnmap_lookups_match_linear_scan);
+    RUN_TEST(test_asnmap_prefixes_of_an_as);
+    RUN_TEST(test_asnmap_rejects_bad_files);
+    RUN_TEST(test_asnmap_cached_lookup_follows_generation);
+    RUN_TEST(test_asnrate_threshold_and_hold);
+    RUN_TEST(test_asnrate_queues_blocks_once);
+
+    return UnityEnd();
+}
@@ -0,0 +1,182 @@
+/*
+ * test_blockcap.c - Unit tests for blacklist capacity management
+ */
+
+#include "../unity/unity.h"
+#include "../../include/common.h"
+#include "../../src/enforce/blockcap.h"
+#include <arpa/inet.h>
+#include <string.h>
+
+#define NOW    sec_to_ns(1000)
+#define LATER  sec_to_ns(1300)
+
+static uint32_t ip(uint32_t n) {
+    return htonl(0xC6336400U + n); /* 198.51.100.0 + n */
+}
+
+TEST_CASE(test_blockcap_init_rejects_zero) {
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, blockcap_init(0));
+    TEST_ASSERT_FALSE(blockcap_enabled());
+}
+
+TEST_CASE(test_blockcap_rejects_lower_rate_when_full) {
+    uint32_t evicted[BLOCKCAP_EVICT_MAX];
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, blockcap_init(4));
+    TEST_ASSERT_TRUE(blockcap_enabled());
+
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(0, blockcap_admit(ip(i), 100 + i, LATER, NOW, evicted, BLOCKCAP_EVICT_MAX));
+    }
+
+    /* Worth no more than the least valuable block: refused */
+    TEST_ASSERT_EQUAL(-1, blockcap_admit(ip(10), 50, LATER, NOW, evicted, BLOCKCAP_EVICT_MAX));
+    TEST_ASSERT_EQUAL(-1, blockcap_admit(ip(11), 100, LATER, NOW, evicted, BLOCKCAP_EVICT_MAX));
+
+    blockcap_stats_t stats;
+    blockcap_get_stats(&stats);
+    TEST_ASSERT_EQUAL(4, stats.capacity);
+    TEST_ASSERT_EQUAL(4, stats.live);
+    TEST_ASSERT_EQUAL_UINT64(2, stats.rejected_total);
+    TEST_ASSERT_EQUAL_UINT64(0, stats.evicted_total);
+
+    blockcap_cleanup();
+}
+
+TEST_CASE(test_blockcap_evicts_least_valuable_batch) {
+    uint32_t evicted[BLOCKCAP_EVICT_MAX];
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, blockcap_init(256));
+
+    /* Rates 1000..1255, except four weak blocks */
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t rate = (i % 64 == 7) ? 10 + i : 1000 + i;
+        TEST_ASSERT_EQUAL(0, blockcap_admit(ip(i), rate, LATER, NOW, evicted, BLOCKCAP_EVICT_MAX));
+    }
+
+    /* A batch of up to capacity / 64 blocks goes, weakest first */
+    ssize_t n = blockcap_admit(ip(300), 5000, LATER, NOW, evicted, BLOCKCAP_EVICT_MAX);
+    TEST_ASSERT_EQUAL(4, n);
+    TEST_ASSERT_EQUAL_UINT32(ip(7), evicted[0]);
+    TEST_ASSERT_EQUAL_UINT32(ip(71), evicted[1]);
+    TEST_ASSERT_EQUAL_UINT32(ip(135), evicted[2]);
+    TEST_ASSERT_EQUAL_UINT32(ip(199), evicted[3]);
+
+    /* The batch left room: the next blocks need no eviction */
+    TEST_ASSERT_EQUAL(0, blockcap_admit(ip(301), 1, LATER, NOW, evicted, BLOCKCAP_EVICT_MAX));
+    TEST_ASSERT_EQUAL(0, blockcap_admit(ip(302), 1, LATER, NOW, evicted, BLOCKCAP_EVICT_MAX));
+    TEST_ASSERT_EQUAL(0, blockcap_admit(ip(303), 1, LATER, NOW, evicted, BLOCKCAP_EVICT_MAX));
+
+    /* Only blocks worth less than the new one are evicted */
+    n = blockcap_admit(ip(304), 1001, LATER, NOW, evicted, BLOCKCAP_EVICT_MAX);
+    TEST_ASSERT_EQUAL(4, n);
+    TEST_ASSERT_EQUAL_UINT32(ip(0), evicted[3]);
+    for (uint32_t i = 306; i < 309; i++) {
+        TEST_ASSERT_EQUAL(0, blockcap_admit(ip(i), 2000, LATER, NOW, evicted, BLOCKCAP_EVICT_MAX));
+    }
+    n = blockcap_admit(ip(305), 1002, LATER, NOW, evicted, BLOCKCAP_EVICT_MAX);
+    TEST_ASSERT_EQUAL(2, n); /* ip(1) and ip(304), both at 1001 */
+    TEST_ASSERT_TRUE(evicted[0] == ip(1) || evicted[1] == ip(1));
+
+    blockcap_stats_t stats;
+    blockcap_get_stats(&stats);
+    TEST_ASSERT_EQUAL(255, stats.live);
+    TEST_ASSERT_EQUAL_UINT64(10, stats.evicted_total);
+
+    blockcap_cleanup();
+}
+
+TEST_CASE(test_blockcap_refresh_needs_no_room) {
+    uint32_t evicted[BLOCKCAP_EVICT_MAX];
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, blockcap_init(2));
+
+    TEST_ASSERT_EQUAL(0, blockcap_admit(ip(1), 100, LATER, NOW, evicted, BLOCKCAP_EVICT_MAX));
+    TEST_ASSERT_EQUAL(0, blockcap_admit(ip(2), 200, LATER, NOW, evicted, BLOCKCAP_EVICT_MAX));
+
+    /* Blocking again while blocked only raises its value */
+    TEST_ASSERT_EQUAL(0, blockcap_admit(ip(1), 500, LATER, NOW, evicted, BLOCKCAP_EVICT_MAX));
+
+    TEST_ASSERT_EQUAL(1, blockcap_admit(ip(3), 300, LATER, NOW, evicted, BLOCKCAP_EVICT_MAX));
+    TEST_ASSERT_EQUAL_UINT32(ip(2), evicted[0]);
+
+    blockcap_cleanup();
+}
+
+TEST_CASE(test_blockcap_expired_entries_make_room) {
+    uint32_t evicted[BLOCKCAP_EVICT_MAX];
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, blockcap_init(2));
+
+    TEST_ASSERT_EQUAL(0, blockcap_admit(ip(1), 900, NOW + sec_to_ns(10), NOW, evicted, 4));
+    TEST_ASSERT_EQUAL(0, blockcap_admit(ip(2), 900, LATER, NOW, evicted, 4));
+
+    /* After the first block ran out, even a weak block fits */
+    TEST_ASSERT_EQUAL(0, blockcap_admit(ip(3), 1, LATER, NOW + sec_to_ns(20), evicted, 4));
+
+    blockcap_stats_t stats;
+    blockcap_get_stats(&stats);
+    TEST_ASSERT_EQUAL(2, stats.live);
+    TEST_ASSERT_EQUAL_UINT64(1, stats.expired_total);
+    TEST_ASSERT_EQUAL_UINT64(0, stats.evicted_total);
+
+    blockcap_cleanup();
+}
+
+TEST_CASE(test_blockcap_repeat_offenders_weigh_more) {
+    uint32_t evicted[BLOCKCAP_EVICT_MAX];
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, blockcap_init(2));
+
+    TEST_ASSERT_EQUAL(0, blockcap_admit(ip(1), 100, LATER, NOW, evicted, 4));
+    TEST_ASSERT_EQUAL(0, blockcap_admit(ip(2), 150, LATER, NOW, evicted, 4));
+
+    /* Unblocked and blocked again: counts double */
+    blockcap_remove(ip(1));
+    TEST_ASSERT_EQUAL(0, blockcap_admit(ip(1), 100, LATER, NOW, evicted, 4));
+
+    TEST_ASSERT_EQUAL(1, blockcap_admit(ip(3), 160, LATER, NOW, evicted, 4));
+    TEST_ASSERT_EQUAL_UINT32(ip(2), evicted[0]);
+
+    blockcap_cleanup();
+}
+
+TEST_CASE(test_blockcap_manual_blocks_stay) {
+    uint32_t evicted[BLOCKCAP_EVICT_MAX];
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, blockcap_init(2));
+
+    TEST_ASSERT_EQUAL(0, blockcap_admit(ip(1), BLOCKCAP_RATE_MANUAL, LATER, NOW, evicted, 4));
+    TEST_ASSERT_EQUAL(0, blockcap_admit(ip(2), BLOCKCAP_RATE_MANUAL, LATER, NOW, evicted, 4));
+    TEST_ASSERT_EQUAL(-1, blockcap_admit(ip(3), 60000, LATER, NOW, evicted, 4));
+
+    blockcap_cleanup();
+}
+
+TEST_CASE(test_blockcap_history_is_bounded) {
+    uint32_t evicted[BLOCKCAP_EVICT_MAX];
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, blockcap_init(64));
+
+    /* Far more distinct sources than records: history is recycled */
+    for (uint32_t i = 0; i < 10000; i++) {
+        TEST_ASSERT_TRUE(blockcap_admit(ip(i), 100, LATER, NOW, evicted, 4) >= 0);
+        blockcap_remove(ip(i));
+    }
+
+    blockcap_stats_t stats;
+    blockcap_get_stats(&stats);
+    TEST_ASSERT_EQUAL(0, stats.live);
+    TEST_ASSERT_EQUAL_UINT64(10000, stats.admitted_total);
+
+    blockcap_cleanup();
+}
+
+int main(void) {
+    UnityBegin("test_blockcap.c");
+
+    RUN_TEST(test_blockcap_init_rejects_zero);
+    RUN_TEST(test_blockcap_rejects_lower_rate_when_full);
+    RUN_TEST(test_blockcap_evicts_least_valuable_batch);
+    RUN_TEST(test_blockcap_refresh_needs_no_room);
+    RUN_TEST(test_blockcap_expired_entries_make_room);
+    RUN_TEST(test_blockcap_repeat_offenders_weigh_more);
+    RUN_TEST(test_blockcap_manual_blocks_stay);
+    RUN_TEST(test_blockcap_history_is_bounded);
+
+    return UnityEnd();
+}
@@ -4,6 +4,7 @@
 
 #include "../unity/unity.h"
 #include "../../include/common.h"
+#include "../../src/clock.h"
 #include <arpa/inet.h>
 
 TEST_CASE(test_ip_hash_consistency) {
@@ -74,6 +75,45 @@ TEST_CASE(test_get_monotonic_ns) {
     TEST_ASSERT_GREATER_THAN(time1 - 1, time2); /* time2 >= time1 */
 }
 
+TEST_CASE(test_virtual_clock) {
+    clock_virtual_t clock;
+    clock_virtual_start(&clock, sec_to_ns(100));
+
+    /* Time stands still until advanced */
+    TEST_ASSERT_EQUAL_UINT64(sec_to_ns(100), get_monotonic_ns());
+    TEST_ASSERT_EQUAL_UINT64(sec_to_ns(100), get_monotonic_ns());
+
+    TEST_ASSERT_EQUAL_UINT64(sec_to_ns(3700), clock_virtual_advance(&clock, sec_to_ns(3600)));
+    TEST_ASSERT_EQUAL_UINT64(sec_to_ns(3700), get_monotonic_ns());
+
+    /* Never goes backwards */
+    clock_virtual_set(&clock, sec_to_ns(50));
+    TEST_ASSERT_EQUAL_UINT64(sec_to_ns(3700), get_monotonic_ns());
+    clock_virtual_set(&clock, sec_to_ns(4000));
+    TEST_ASSERT_EQUAL_UINT64(sec_to_ns(4000), get_monotonic_ns());
+
+    clock_install(NULL);
+    TEST_ASSERT_NOT_EQUAL(sec_to_ns(4000), get_monotonic_ns());
+}
+
+TEST_CASE(test_cached_clock) {
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, clock_cached_start(0));
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, clock_cached_start(1000));
+
+    uint64_t cached = get_monotonic_ns();
+    uint64_t system = clock_system_ns();
+    TEST_ASSERT_TRUE(cached <= system);
+    TEST_ASSERT_TRUE(system - cached < ms_to_ns(100));
+
+    /* Refreshed in the background */
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = 20 * 1000 * 1000 };
+    nanosleep(&pause, NULL);
+    TEST_ASSERT_TRUE(get_monotonic_ns() > cached);
+
+    clock_cached_stop();
+    TEST_ASSERT_TRUE(synflood_clock == NULL);
+}
+
 int main(void) {
     UnityBegin("test_common.c");
 
@@ -83,6 +123,8 @@ int main(void) {
     RUN_TEST(test_ms_to_ns_conversion);
     RUN_TEST(test_sec_to_ns_conversion);
     RUN_TEST(test_get_monotonic_ns);
+    RUN_TEST(test_virtual_clock);
+    RUN_TEST(test_cached_clock);
 
     return UnityEnd();
 }
@@ -0,0 +1,163 @@
+/*
+ * test_compact.c - Unit tests for blocklist compaction
+ */
+
+#include "../unity/unity.h"
+#include "../../include/common.h"
+#include "../../src/enforce/compact.h"
+#include "../../src/analysis/whitelist.h"
+#include <arpa/inet.h>
+#include <string.h>
+
+#define BASE 0x0A000000U /* 10.0.0.0 */
+
+static ipset_entry_t entries[1024];
+static compact_net_t out[256];
+
+static void set_entry(size_t i, uint32_t host_addr, uint32_t timeout_s) {
+    entries[i].addr = htonl(host_addr);
+    entries[i].prefix_len = 32;
+    entries[i].timeout_s = timeout_s;
+}
+
+static bool net_contains(const compact_net_t *net, uint32_t host_addr) {
+    uint32_t mask = ~0U << (32 - net->prefix_len);
+    return (ntohl(net->net) & mask) == (host_addr & mask);
+}
+
+TEST_CASE(test_compact_rejects_bad_parameters) {
+    set_entry(0, BASE, 60);
+    set_entry(1, BASE + 1, 60);
+
+    TEST_ASSERT_EQUAL(0, compact_cover(entries, 2, 0, 50, NULL, out, 256));
+    TEST_ASSERT_EQUAL(0, compact_cover(entries, 2, 32, 50, NULL, out, 256));
+    TEST_ASSERT_EQUAL(0, compact_cover(entries, 2, 24, 0, NULL, out, 256));
+    TEST_ASSERT_EQUAL(0, compact_cover(entries, 2, 24, 101, NULL, out, 256));
+    TEST_ASSERT_EQUAL(0, compact_cover(NULL, 2, 24, 50, NULL, out, 256));
+}
+
+TEST_CASE(test_compact_dense_prefix_becomes_one_net) {
+    /* 200 of 256 addresses blocked, with different remaining times */
+    for (size_t i = 0; i < 200; i++) {
+        set_entry(i, BASE + (uint32_t)i, 60 + (uint32_t)(i % 7));
+    }
+    entries[150].timeout_s = 3600;
+
+    size_t n = compact_cover(entries, 200, 24, 50, NULL, out, 256);
+    TEST_ASSERT_EQUAL(1, n);
+    TEST_ASSERT_EQUAL_UINT32(htonl(BASE), out[0].net);
+    TEST_ASSERT_EQUAL(24, out[0].prefix_len);
+    TEST_ASSERT_EQUAL(0, out[0].first);
+    TEST_ASSERT_EQUAL(200, out[0].count);
+
+    /* The aggregate lasts as long as its longest block */
+    TEST_ASSERT_EQUAL_UINT32(3600, out[0].timeout_s);
+}
+
+TEST_CASE(test_compact_never_wider_than_min_prefix) {
+    /* Two full /24s side by side stay two /24s */
+    for (size_t i = 0; i < 512; i++) {
+        set_entry(i, BASE + (uint32_t)i, 60);
+    }
+
+    size_t n = compact_cover(entries, 512, 24, 50, NULL, out, 256);
+    TEST_ASSERT_EQUAL(2, n);
+    TEST_ASSERT_EQUAL_UINT32(htonl(BASE), out[0].net);
+    TEST_ASSERT_EQUAL_UINT32(htonl(BASE + 256), out[1].net);
+    TEST_ASSERT_EQUAL(24, out[0].prefix_len);
+    TEST_ASSERT_EQUAL(24, out[1].prefix_len);
+    TEST_ASSERT_EQUAL(256, out[1].first);
+}
+
+TEST_CASE(test_compact_sparse_addresses_stay_single) {
+    set_entry(0, BASE, 60);
+    set_entry(1, BASE + 1, 60);
+    set_entry(2, BASE + 100, 60);
+    set_entry(3, BASE + 200, 60);
+    set_entry(4, BASE + 0x10000, 60); /* Another /24 */
+
+    /* Only the adjacent pair is dense enough: half of 10.0.0.0/30 */
+    size_t n = compact_cover(entries, 5, 24, 50, NULL, out, 256);
+    TEST_ASSERT_EQUAL(1, n);
+    TEST_ASSERT_EQUAL_UINT32(htonl(BASE), out[0].net);
+    TEST_ASSERT_EQUAL(30, out[0].prefix_len);
+    TEST_ASSERT_EQUAL(2, out[0].count);
+
+    /* A single address is never aggregated, even at 1% density */
+    n = compact_cover(entries + 2, 1, 24, 1, NULL, out, 256);
+    TEST_ASSERT_EQUAL(0, n);
+}
+
+TEST_CASE(test_compact_skips_whitelisted_ranges) {
+    /* 10.0.0.0-199 blocked except the whitelisted 10.0.0.5 */
+    size_t count = 0;
+    for (uint32_t i = 0; i < 200; i++) {
+        if (i != 5) {
+            set_entry(count++, BASE + i, 60);
+        }
+    }
+
+    whitelist_node_t *root = NULL;
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, whitelist_insert(&root, htonl(BASE + 5), 32, NULL));
+    whitelist_flat_t *flat = whitelist_flatten(root);
+    TEST_ASSERT_NOT_NULL(flat);
+
+    size_t n = compact_cover(entries, count, 24, 50, flat, out, 256);
+    TEST_ASSERT_GREATER_THAN(1, n);
+
+    size_t covered = 0;
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT_FALSE(net_contains(&out[i], BASE + 5));
+        covered += out[i].count;
+
+        /* Every covered address lies inside its aggregate */
+        for (size_t j = out[i].first; j < out[i].first + out[i].count; j++) {
+            TEST_ASSERT_TRUE(net_contains(&out[i], ntohl(entries[j].addr)));
+        }
+        if (i > 0) {
+            TEST_ASSERT_TRUE(out[i].first >= out[i - 1].first + out[i - 1].count);
+        }
+    }
+    TEST_ASSERT_GREATER_THAN(150, covered);
+
+    whitelist_flat_free(flat);
+    whitelist_free(root);
+    whitelist_reclaim(true);
+}
+
+TEST_CASE(test_compact_respects_output_capacity) {
+    /* Four separate pairs, room for two aggregates */
+    for (uint32_t i = 0; i < 4; i++) {
+        set_entry(2 * i, BASE + i * 0x100, 60);
+        set_entry(2 * i + 1, BASE + i * 0x100 + 1, 60);
+    }
+
+    TEST_ASSERT_EQUAL(4, compact_cover(entries, 8, 24, 50, NULL, out, 256));
+    TEST_ASSERT_EQUAL(2, compact_cover(entries, 8, 24, 50, NULL, out, 2));
+}
+
+TEST_CASE(test_compact_disabled_is_a_no_op) {
+    synflood_config_t config;
+    memset(&config, 0, sizeof(config));
+
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, compact_init(&config));
+    TEST_ASSERT_FALSE(compact_enabled());
+    TEST_ASSERT_EQUAL(0, compact_run(NULL));
+    TEST_ASSERT_EQUAL(0, compact_release(htonl(BASE), 24));
+
+    compact_cleanup();
+}
+
+int main(void) {
+    UnityBegin("test_compact.c");
+
+    RUN_TEST(test_compact_rejects_bad_parameters);
+    RUN_TEST(test_compact_dense_prefix_becomes_one_net);
+    RUN_TEST(test_compact_never_wider_than_min_prefix);
+    RUN_TEST(test_compact_sparse_addresses_stay_single);
+    RUN_TEST(test_compact_skips_whitelisted_ranges);
+    RUN_TEST(test_compact_respects_output_capacity);
+    RUN_TEST(test_compact_disabled_is_a_no_op);
+
+    return UnityEnd();
+}
@@ -6,6 +6,7 @@
 #include "../../include/common.h"
 #include "../../src/config/config.h"
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -28,17 +29,38 @@ void create_test_config(void) {
     fprintf(f, "  syn_threshold = 150;\n");
     fprintf(f, "  window_ms = 2000;\n");
     fprintf(f, "  proc_check_interval_s = 10;\n");
+    fprintf(f, "  validate_syn_recv = false;\n");
+    fprintf(f, "  ack_threshold = 5000;\n");
+    fprintf(f, "  synack_threshold = 300;\n");
+    fprintf(f, "  udp_threshold = 800;\n");
+    fprintf(f, "  victim_threshold = 2000;\n");
+    fprintf(f, "  victim_source_threshold = 15;\n");
+    fprintf(f, "  scan_port_threshold = 200;\n");
+    fprintf(f, "  scan_block = true;\n");
+    fprintf(f, "  asn_map_file = \"/var/lib/synflood-detector/asn.map\";\n");
+    fprintf(f, "  asn_threshold = 3000;\n");
     fprintf(f, "};\n\n");
     fprintf(f, "enforcement:\n");
     fprintf(f, "{\n");
     fprintf(f, "  block_duration_s = 600;\n");
     fprintf(f, "  ipset_name = \"test_blacklist\";\n");
+    fprintf(f, "  udp_ipset = \"test_blacklist_udp\";\n");
+    fprintf(f, "  inpath_drop = true;\n");
     fprintf(f, "};\n\n");
     fprintf(f, "limits:\n");
     fprintf(f, "{\n");
     fprintf(f, "  max_tracked_ips = 5000;\n");
     fprintf(f, "  hash_buckets = 2048;\n");
+    fprintf(f, "  max_tracked_victims = 256;\n");
     fprintf(f, "};\n\n");
+    fprintf(f, "capture:\n");
+    fprintf(f, "{\n");
+    fprintf(f, "  netns_workers = 4;\n");
+    fprintf(f, "};\n\n");
+    fprintf(f, "namespaces = (\n");
+    fprintf(f, "  { name = \"web\"; path = \"/var/run/netns/web\"; syn_threshold = 50; },\n");
+    fprintf(f, "  { name = \"db\"; path = \"/proc/1234/ns/net\"; ipset_name = \"db_block\"; }\n");
+    fprintf(f, ");\n\n");
     fprintf(f, "logging:\n");
     fprintf(f, "{\n");
     fprintf(f, "  level = \"debug\";\n");
@@ -62,10 +84,41 @@ TEST_CASE(test_config_load_valid) {
     TEST_ASSERT_EQUAL_UINT32(150, config.syn_threshold);
     TEST_ASSERT_EQUAL_UINT32(2000, config.window_ms);
     TEST_ASSERT_EQUAL_UINT32(10, config.proc_check_interval_s);
+    TEST_ASSERT_FALSE(config.validate_syn_recv);
+    TEST_ASSERT_EQUAL_UINT32(300, config.synack_threshold);
+    TEST_ASSERT_EQUAL_UINT32(5000, config.ack_threshold);
+    TEST_ASSERT_EQUAL_UINT32(0, config.rst_threshold);
+    TEST_ASSERT_EQUAL_UINT32(800, config.udp_threshold);
+    TEST_ASSERT_EQUAL_UINT32(0, config.icmp_threshold);
+    TEST_ASSERT_EQUAL_UINT32(2000, config.victim_threshold);
+    TEST_ASSERT_EQUAL_UINT32(15, config.victim_source_threshold);
+    TEST_ASSERT_EQUAL_UINT32(DEFAULT_VICTIM_HOLD_S, config.victim_hold_s);
+    TEST_ASSERT_EQUAL_UINT32(256, config.max_tracked_victims);
+    TEST_ASSERT_EQUAL_UINT32(200, config.scan_port_threshold);
+    TEST_ASSERT_EQUAL_UINT32(0, config.scan_host_threshold);
+    TEST_ASSERT_EQUAL_UINT32(DEFAULT_SCAN_WINDOW_S, config.scan_window_s);
+    TEST_ASSERT_TRUE(config.scan_block);
+    TEST_ASSERT_EQUAL_UINT32(DEFAULT_MAX_TRACKED_SCANNERS, config.max_tracked_scanners);
+    TEST_ASSERT_EQUAL_STRING("/var/lib/synflood-detector/asn.map", config.asn_map_file);
+    TEST_ASSERT_EQUAL_UINT32(3000, config.asn_threshold);
+    TEST_ASSERT_EQUAL_UINT32(DEFAULT_ASN_SOURCE_THRESHOLD, config.asn_source_threshold);
+    TEST_ASSERT_FALSE(config.asn_block);
+    TEST_ASSERT_EQUAL_STRING(DEFAULT_ASN_IPSET_NAME, config.asn_ipset);
+    TEST_ASSERT_EQUAL_UINT32(4, config.netns_workers);
+    TEST_ASSERT_EQUAL_UINT32(2, config.netns_count);
+    TEST_ASSERT_EQUAL_STRING("web", config.namespaces[0].name);
+    TEST_ASSERT_EQUAL_STRING("/var/run/netns/web", config.namespaces[0].path);
+    TEST_ASSERT_EQUAL_UINT32(50, config.namespaces[0].syn_threshold);
+    TEST_ASSERT_EQUAL_STRING("", config.namespaces[0].ipset_name);
+    TEST_ASSERT_EQUAL_UINT32(0, config.namespaces[1].syn_threshold);
+    TEST_ASSERT_EQUAL_STRING("db_block", config.namespaces[1].ipset_name);
     TEST_ASSERT_EQUAL_UINT32(600, config.block_duration_s);
     TEST_ASSERT_EQUAL_UINT32(5000, config.max_tracked_ips);
     TEST_ASSERT_EQUAL_UINT32(2048, config.hash_buckets);
     TEST_ASSERT_EQUAL_STRING("test_blacklist", config.ipset_name);
+    TEST_ASSERT_EQUAL_STRING("test_blacklist_udp", config.udp_ipset);
+    TEST_ASSERT_EQUAL_STRING("", config.icmp_ipset);
+    TEST_ASSERT_TRUE(config.inpath_drop);
     TEST_ASSERT_EQUAL_INT(LOG_LEVEL_DEBUG, config.log_level);
     TEST_ASSERT_FALSE(config.use_syslog);
 
@@ -81,6 +134,9 @@ TEST_CASE(test_config_load_defaults) {
     TEST_ASSERT_EQUAL_UINT32(DEFAULT_SYN_THRESHOLD, config.syn_threshold);
     TEST_ASSERT_EQUAL_UINT32(DEFAULT_WINDOW_MS, config.window_ms);
     TEST_ASSERT_EQUAL_UINT32(DEFAULT_BLOCK_DURATION_S, config.block_duration_s);
+    TEST_ASSERT_FALSE(config.inpath_drop);
+    TEST_ASSERT_TRUE(config.validate_syn_recv);
+    TEST_ASSERT_EQUAL_UINT32(0, config.victim_threshold);
 }
 
 TEST_CASE(test_config_validate_valid) {
@@ -128,6 +184,73 @@ TEST_CASE(test_config_validate_invalid_hash_buckets) {
     TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, ret);
 }
 
+TEST_CASE(test_config_validate_netns) {
+    synflood_config_t config = {
+        .syn_threshold = 100,
+        .window_ms = 1000,
+        .block_duration_s = 300,
+        .proc_check_interval_s = 5,
+        .max_tracked_ips = 10000,
+        .hash_buckets = 4096,
+        .ipset_name = "test",
+        .netns_workers = 2,
+        .netns_count = 2,
+        .namespaces = {
+            { .name = "a", .path = "/var/run/netns/a" },
+            { .name = "b", .path = "/var/run/netns/b" },
+        },
+    };
+
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, config_validate(&config));
+
+    /* Names label metrics and must be unique */
+    strcpy(config.namespaces[1].name, "a");
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, config_validate(&config));
+    strcpy(config.namespaces[1].name, "b");
+
+    config.namespaces[1].path[0] = '\0';
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, config_validate(&config));
+    strcpy(config.namespaces[1].path, "/var/run/netns/b");
+
+    config.netns_workers = 0;
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, config_validate(&config));
+}
+
+TEST_CASE(test_config_validate_peersync) {
+    synflood_config_t config = {
+        .syn_threshold = 100,
+        .window_ms = 1000,
+        .block_duration_s = 300,
+        .proc_check_interval_s = 5,
+        .max_tracked_ips = 10000,
+        .hash_buckets = 4096,
+        .ipset_name = "test",
+        .peersync_port = 7946,
+        .peersync_group = "239.255.77.1",
+        .peersync_key_file = "/etc/synflood-detector/peersync.key",
+        .peersync_batch_ms = 200,
+        .peersync_max_age_s = 30,
+        .peersync_ttl = 1,
+    };
+
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, config_validate(&config));
+
+    /* Group must be multicast */
+    strcpy(config.peersync_group, "10.0.0.1");
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, config_validate(&config));
+
+    /* Peers alone are enough */
+    config.peersync_group[0] = '\0';
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, config_validate(&config));
+    config.peersync_peers[0] = (peer_addr_t){ .ip = 0x0C00000A, .port = 7946 };
+    config.peersync_peer_count = 1;
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, config_validate(&config));
+
+    /* Unauthenticated sharing is not allowed */
+    config.peersync_key_file[0] = '\0';
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, config_validate(&config));
+}
+
 TEST_CASE(test_config_parse_log_level) {
     TEST_ASSERT_EQUAL_INT(LOG_LEVEL_DEBUG, config_parse_log_level("debug"));
     TEST_ASSERT_EQUAL_INT(LOG_LEVEL_INFO, config_parse_log_level("info"));
@@ -144,6 +267,8 @@ int main(void) {
     RUN_TEST(test_config_validate_valid);
     RUN_TEST(test_config_validate_invalid_threshold);
     RUN_TEST(test_config_validate_invalid_hash_buckets);
+    RUN_TEST(test_config_validate_netns);
+    RUN_TEST(test_config_validate_peersync);
     RUN_TEST(test_config_parse_log_level);
 
     return UnityEnd();
@@ -0,0 +1,398 @@
+/*
+ * test_control.c - Unit tests for the binary control protocol
+ */
+
+#include "../unity/unity.h"
+#include "../../include/common.h"
+#include "../../src/observe/control.h"
+#include "../../src/observe/ctlproto.h"
+#include "../../src/analysis/tracker.h"
+#include "../../src/analysis/whitelist.h"
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static app_context_t ctx;
+static synflood_config_t config;
+static volatile sig_atomic_t sighup_count = 0;
+
+static void on_sighup(int signum) {
+    (void)signum;
+    sighup_count++;
+}
+
+static void setup(void) {
+    memset(&ctx, 0, sizeof(ctx));
+    memset(&config, 0, sizeof(config));
+    config.block_duration_s = 300;
+    snprintf(config.whitelist_file, sizeof(config.whitelist_file),
+             "/tmp/synflood_test_control_%d.conf", (int)getpid());
+
+    ctx.config = &config;
+    ctx.tracker = tracker_create(256, 1000);
+    *ctx.tracker->whitelist_gen = 7;
+    whitelist_add(&ctx.whitelist_root, "192.0.2.0/24");
+    pthread_mutex_init(&ctx.metrics_lock, NULL);
+    control_init();
+}
+
+static void teardown(void) {
+    tracker_destroy(ctx.tracker);
+    whitelist_free(ctx.whitelist_root);
+    whitelist_reclaim(true);
+    pthread_mutex_destroy(&ctx.metrics_lock);
+    unlink(config.whitelist_file);
+}
+
+/* Run one request through control_handle over a socketpair */
+static uint16_t roundtrip(uint8_t op, const uint8_t *payload, size_t len,
+                          uint8_t *resp, size_t *resp_len) {
+    int fds[2];
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    uint8_t req[CTL_HEADER_LEN + CTL_MAX_REQUEST];
+    ctl_encode_header(req, op, 0, (uint32_t)len);
+    memcpy(req + CTL_HEADER_LEN, payload, len);
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, control_handle(&ctx, fds[0], req, CTL_HEADER_LEN + len));
+
+    uint8_t raw[CTL_HEADER_LEN + CTL_MAX_RESPONSE];
+    ssize_t n = recv(fds[1], raw, sizeof(raw), 0);
+    close(fds[0]);
+    close(fds[1]);
+
+    ctl_header_t hdr;
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, ctl_decode_header(raw, (size_t)n, &hdr));
+    TEST_ASSERT_EQUAL_UINT8(op, hdr.op);
+    TEST_ASSERT_EQUAL_INT(CTL_HEADER_LEN + hdr.length, n);
+
+    if (resp) {
+        memcpy(resp, raw + CTL_HEADER_LEN, hdr.length);
+        *resp_len = hdr.length;
+    }
+    return hdr.status;
+}
+
+TEST_CASE(test_ctlproto_encoding) {
+    uint8_t buf[CTL_STATUS_LEN];
+    ctl_header_t hdr;
+
+    ctl_encode_header(buf, CTL_OP_TOP, CTL_STATUS_NOT_FOUND, 1600);
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, ctl_decode_header(buf, CTL_HEADER_LEN, &hdr));
+    TEST_ASSERT_EQUAL_UINT8(CTL_VERSION, hdr.version);
+    TEST_ASSERT_EQUAL_UINT8(CTL_OP_TOP, hdr.op);
+    TEST_ASSERT_EQUAL_UINT32(CTL_STATUS_NOT_FOUND, hdr.status);
+    TEST_ASSERT_EQUAL_UINT32(1600, hdr.length);
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, ctl_decode_header(buf, CTL_HEADER_LEN - 1, &hdr));
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, ctl_decode_header((const uint8_t *)"GET /metrics\n", 13, &hdr));
+
+    ctl_status_t in = {
+        .uptime_s = 1, .packets_total = 2, .syn_packets_total = 3, .detections_total = 4,
+        .whitelist_hits_total = 5, .capture_drops_total = 6, .blocked_current = 7,
+        .tracker_entries = 8, .tracker_blocked = 9, .whitelist_gen = 10, .sample_rate = 11,
+    };
+    ctl_status_t out;
+    TEST_ASSERT_EQUAL_INT(CTL_STATUS_LEN, ctl_encode_status(&in, buf));
+    ctl_decode_status(buf, CTL_STATUS_LEN, &out);
+    TEST_ASSERT_EQUAL_INT(0, memcmp(&in, &out, sizeof(in)));
+
+    /* A shorter payload from an older daemon leaves newer fields zero */
+    ctl_decode_status(buf, 16, &out);
+    TEST_ASSERT_EQUAL_UINT64(2, out.packets_total);
+    TEST_ASSERT_EQUAL_UINT64(0, out.syn_packets_total);
+    TEST_ASSERT_EQUAL_UINT32(0, out.sample_rate);
+
+    ctl_top_entry_t e = { .ip_addr = inet_addr("198.51.100.7"), .syn_count = 150,
+                          .block_remaining_ms = 2500, .blocked = 1 };
+    ctl_top_entry_t d;
+    ctl_encode_top_entry(&e, buf);
+    ctl_decode_top_entry(buf, &d);
+    TEST_ASSERT_EQUAL_UINT32(e.ip_addr, d.ip_addr);
+    TEST_ASSERT_EQUAL_UINT32(150, d.syn_count);
+    TEST_ASSERT_EQUAL_UINT32(2500, d.block_remaining_ms);
+    TEST_ASSERT_EQUAL_UINT8(1, d.blocked);
+}
+
+TEST_CASE(test_control_status_and_top) {
+    setup();
+
+    for (uint32_t i = 1; i <= 500; i++) {
+        tracker_get_or_create(ctx.tracker, htonl(0x0A000000 + i))->syn_count = i;
+    }
+    ctx.metrics.packets_total = 12345;
+
+    uint8_t resp[CTL_MAX_RESPONSE];
+    size_t len;
+    TEST_ASSERT_EQUAL_INT(CTL_STATUS_OK, roundtrip(CTL_OP_STATUS, NULL, 0, resp, &len));
+    TEST_ASSERT_EQUAL_INT(CTL_STATUS_LEN, len);
+    ctl_status_t status;
+    ctl_decode_status(resp, len, &status);
+    TEST_ASSERT_EQUAL_UINT64(12345, status.packets_total);
+    TEST_ASSERT_EQUAL_UINT64(500, status.tracker_entries);
+    TEST_ASSERT_EQUAL_UINT32(7, status.whitelist_gen);
+
+    uint8_t want[2];
+    ctl_put_be16(want, 5);
+    TEST_ASSERT_EQUAL_INT(CTL_STATUS_OK, roundtrip(CTL_OP_TOP, want, 2, resp, &len));
+    TEST_ASSERT_EQUAL_INT(5 * CTL_TOP_ENTRY_LEN, len);
+
+    /* Busiest first, regardless of hash order */
+    for (uint32_t i = 0; i < 5; i++) {
+        ctl_top_entry_t e;
+        ctl_decode_top_entry(resp + i * CTL_TOP_ENTRY_LEN, &e);
+        TEST_ASSERT_EQUAL_UINT32(500 - i, e.syn_count);
+        TEST_ASSERT_EQUAL_UINT32(htonl(0x0A000000 + 500 - i), e.ip_addr);
+    }
+
+    teardown();
+}
+
+TEST_CASE(test_control_rejects_bad_requests) {
+    setup();
+
+    uint8_t resp[CTL_MAX_RESPONSE];
+    size_t len;
+    TEST_ASSERT_EQUAL_INT(CTL_STATUS_UNKNOWN_OP, roundtrip(99, NULL, 0, resp, &len));
+    TEST_ASSERT_EQUAL_INT(CTL_STATUS_BAD_REQUEST, roundtrip(CTL_OP_BLOCK, resp, 3, resp, &len));
+
+    /* Blocking a whitelisted source is refused before touching the ipset */
+    uint8_t block[8];
+    uint32_t ip = inet_addr("192.0.2.10");
+    memcpy(block, &ip, 4);
+    ctl_put_be32(block + 4, 60);
+    TEST_ASSERT_EQUAL_INT(CTL_STATUS_REFUSED, roundtrip(CTL_OP_BLOCK, block, 8, resp, &len));
+    TEST_ASSERT_NULL(tracker_get(ctx.tracker, ip));
+
+    /* Whitelist edits need a file to persist to */
+    uint8_t cidr[5] = {0};
+    memcpy(cidr, &ip, 4);
+    cidr[4] = 33;
+    TEST_ASSERT_EQUAL_INT(CTL_STATUS_BAD_REQUEST,
+                          roundtrip(CTL_OP_WHITELIST_ADD, cidr, 5, resp, &len));
+    cidr[4] = 32;
+    char whitelist_file[sizeof(config.whitelist_file)];
+    memcpy(whitelist_file, config.whitelist_file, sizeof(whitelist_file));
+    config.whitelist_file[0] = '\0';
+    TEST_ASSERT_EQUAL_INT(CTL_STATUS_FAILED, roundtrip(CTL_OP_WHITELIST_ADD, cidr, 5, resp, &len));
+    memcpy(config.whitelist_file, whitelist_file, sizeof(whitelist_file));
+
+    /* A client from the future learns which version this daemon speaks */
+    int fds[2];
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    uint8_t req[CTL_HEADER_LEN];
+    ctl_encode_header(req, CTL_OP_STATUS, 0, 0);
+    req[4] = CTL_VERSION + 1;
+    control_handle(&ctx, fds[0], req, sizeof(req));
+    uint8_t raw[CTL_HEADER_LEN + 1];
+    TEST_ASSERT_EQUAL_INT(sizeof(raw), recv(fds[1], raw, sizeof(raw), 0));
+    ctl_header_t hdr;
+    ctl_decode_header(raw, sizeof(raw), &hdr);
+    TEST_ASSERT_EQUAL_UINT32(CTL_STATUS_VERSION, hdr.status);
+    TEST_ASSERT_EQUAL_UINT8(CTL_VERSION, raw[CTL_HEADER_LEN]);
+    close(fds[0]);
+    close(fds[1]);
+
+    teardown();
+}
+
+TEST_CASE(test_control_whitelist_live_edit) {
+    setup();
+    signal(SIGHUP, on_sighup);
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, control_start());
+
+    FILE *fp = fopen(config.whitelist_file, "w");
+    fputs("# local\n127.0.0.0/8\n10.1.0.0/16", fp); /* No trailing newline */
+    fclose(fp);
+
+    ip_tracker_t *covered = tracker_get_or_create(ctx.tracker, inet_addr("203.0.113.9"));
+    covered->blocked = 1;
+    covered->block_expiry_ns = get_monotonic_ns() + sec_to_ns(300);
+    tracker_get_or_create(ctx.tracker, inet_addr("198.51.100.1"))->blocked = 1;
+
+    uint8_t cidr[5];
+    uint32_t prefix = inet_addr("203.0.113.0");
+    memcpy(cidr, &prefix, 4);
+    cidr[4] = 24;
+
+    /* Live at once: new tree, new generation, covered sources released */
+    sighup_count = 0;
+    TEST_ASSERT_EQUAL_INT(CTL_STATUS_OK, roundtrip(CTL_OP_WHITELIST_ADD, cidr, 5, NULL, NULL));
+    TEST_ASSERT_TRUE(whitelist_check(ctx.whitelist_root, inet_addr("203.0.113.9")));
+    TEST_ASSERT_TRUE(whitelist_check(ctx.whitelist_root, inet_addr("192.0.2.1")));
+    TEST_ASSERT_EQUAL_UINT32(8, *ctx.tracker->whitelist_gen);
+    TEST_ASSERT_EQUAL_UINT8(0, tracker_get(ctx.tracker, inet_addr("203.0.113.9"))->blocked);
+    TEST_ASSERT_EQUAL_UINT8(1, tracker_get(ctx.tracker, inet_addr("198.51.100.1"))->blocked);
+
+    control_flush();
+    whitelist_node_t *loaded = whitelist_load(config.whitelist_file);
+    TEST_ASSERT_TRUE(whitelist_check(loaded, inet_addr("203.0.113.9")));
+    TEST_ASSERT_TRUE(whitelist_check(loaded, inet_addr("10.1.2.3")));
+    whitelist_free(loaded);
+
+    /* Adding again changes nothing */
+    TEST_ASSERT_EQUAL_INT(CTL_STATUS_OK, roundtrip(CTL_OP_WHITELIST_ADD, cidr, 5, NULL, NULL));
+    TEST_ASSERT_EQUAL_UINT32(8, *ctx.tracker->whitelist_gen);
+
+    TEST_ASSERT_EQUAL_INT(CTL_STATUS_OK, roundtrip(CTL_OP_WHITELIST_REMOVE, cidr, 5, NULL, NULL));
+    TEST_ASSERT_FALSE(whitelist_check(ctx.whitelist_root, inet_addr("203.0.113.9")));
+    TEST_ASSERT_EQUAL_UINT32(9, *ctx.tracker->whitelist_gen);
+    TEST_ASSERT_EQUAL_INT(CTL_STATUS_NOT_FOUND,
+                          roundtrip(CTL_OP_WHITELIST_REMOVE, cidr, 5, NULL, NULL));
+
+    /* Stopping writes out what is still queued */
+    control_stop();
+    loaded = whitelist_load(config.whitelist_file);
+    TEST_ASSERT_FALSE(whitelist_check(loaded, inet_addr("203.0.113.9")));
+    TEST_ASSERT_TRUE(whitelist_check(loaded, inet_addr("127.0.0.1")));
+    whitelist_free(loaded);
+
+    /* No reload involved */
+    TEST_ASSERT_EQUAL_INT(0, sighup_count);
+
+    signal(SIGHUP, SIG_DFL);
+    teardown();
+}
+
+static int listen_fd = -1;
+
+/* Minimal stand-in for the metrics server: one connection, one request */
+static void *server_thread(void *arg) {
+    (void)arg;
+    int fd = accept(listen_fd, NULL, NULL);
+    uint8_t buf[256];
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n > 0 && control_is_request(buf, (size_t)n)) {
+        control_handle(&ctx, fd, buf, (size_t)n);
+    }
+    close(fd);
+    return NULL;
+}
+
+TEST_CASE(test_control_client_call) {
+    setup();
+
+    char path[108];
+    snprintf(path, sizeof(path), "/tmp/synflood_test_control_%d.sock", (int)getpid());
+    unlink(path);
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int len = snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    TEST_ASSERT_TRUE(len > 0 && (size_t)len < sizeof(addr.sun_path));
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    TEST_ASSERT_EQUAL_INT(0, bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)));
+    TEST_ASSERT_EQUAL_INT(0, listen(listen_fd, 1));
+
+    pthread_t tid;
+    pthread_create(&tid, NULL, server_thread, NULL);
+
+    uint8_t resp[CTL_MAX_RESPONSE];
+    ctl_header_t hdr;
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK,
+                          ctl_call(path, CTL_OP_STATUS, NULL, 0, 1000, &hdr, resp, sizeof(resp)));
+    TEST_ASSERT_EQUAL_UINT32(CTL_STATUS_OK, hdr.status);
+    TEST_ASSERT_EQUAL_UINT32(CTL_STATUS_LEN, hdr.length);
+
+    pthread_join(tid, NULL);
+    close(listen_fd);
+    unlink(path);
+
+    /* Nobody listening */
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_ERROR,
+                          ctl_call(path, CTL_OP_STATUS, NULL, 0, 100, &hdr, resp, sizeof(resp)));
+
+    teardown();
+}
+
+TEST_CASE(test_control_denies_other_users) {
+    /* Needs root to connect as another user */
+    if (geteuid() != 0) {
+        return;
+    }
+    setup();
+
+    char path[108];
+    snprintf(path, sizeof(path), "/tmp/synflood_test_control_%d.sock", (int)getpid());
+    unlink(path);
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int len = snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    TEST_ASSERT_TRUE(len > 0 && (size_t)len < sizeof(addr.sun_path));
+    int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    TEST_ASSERT_EQUAL_INT(0, bind(server_fd, (struct sockaddr *)&addr, sizeof(addr)));
+    TEST_ASSERT_EQUAL_INT(0, chmod(path, 0666));
+    TEST_ASSERT_EQUAL_INT(0, listen(server_fd, 2));
+
+    /* The child reports the status of STATUS and of BLOCK in its exit code */
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (setuid(65534) != 0) {
+            _exit(0xff);
+        }
+        int result = 0;
+        uint8_t ops[2] = { CTL_OP_STATUS, CTL_OP_BLOCK };
+        for (int i = 0; i < 2; i++) {
+            uint8_t req[CTL_HEADER_LEN + 8] = {0};
+            uint32_t len = ops[i] == CTL_OP_BLOCK ? 8 : 0;
+            ctl_encode_header(req, ops[i], 0, len);
+            uint32_t ip = inet_addr("198.51.100.7");
+            memcpy(req + CTL_HEADER_LEN, &ip, 4);
+
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            uint8_t raw[CTL_HEADER_LEN + CTL_MAX_RESPONSE];
+            ctl_header_t hdr;
+            if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+                send(fd, req, CTL_HEADER_LEN + len, 0) < 0) {
+                _exit(0xfe);
+            }
+            ssize_t n = recv(fd, raw, sizeof(raw), MSG_WAITALL);
+            if (ctl_decode_header(raw, (size_t)n, &hdr) != SYNFLOOD_OK) {
+                _exit(0xfd);
+            }
+            result = (result << 4) | hdr.status;
+            close(fd);
+        }
+        _exit(result);
+    }
+    TEST_ASSERT_TRUE(pid > 0);
+
+    for (int i = 0; i < 2; i++) {
+        int fd = accept(server_fd, NULL, NULL);
+        uint8_t buf[256];
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n > 0 && control_is_request(buf, (size_t)n)) {
+            control_handle(&ctx, fd, buf, (size_t)n);
+        }
+        close(fd);
+    }
+
+    int wstatus;
+    TEST_ASSERT_EQUAL_INT(pid, waitpid(pid, &wstatus, 0));
+    TEST_ASSERT_TRUE(WIFEXITED(wstatus));
+    TEST_ASSERT_EQUAL_INT((CTL_STATUS_OK << 4) | CTL_STATUS_DENIED, WEXITSTATUS(wstatus));
+
+    /* Nothing was blocked */
+    TEST_ASSERT_NULL(tracker_get(ctx.tracker, inet_addr("198.51.100.7")));
+
+    close(server_fd);
+    unlink(path);
+    teardown();
+}
+
+int main(void) {
+    UnityBegin("test_control.c");
+
+    RUN_TEST(test_ctlproto_encoding);
+    RUN_TEST(test_control_status_and_top);
+    RUN_TEST(test_control_rejects_bad_requests);
+    RUN_TEST(test_control_whitelist_live_edit);
+    RUN_TEST(test_control_client_call);
+    RUN_TEST(test_control_denies_other_users);
+
+    return UnityEnd();
+}
@@ -0,0 +1,154 @@
+/*
+ * test_dump.c - Unit tests for the tracker dump command
+ */
+
+#include "../unity/unity.h"
+#include "../../include/common.h"
+#include "../../src/observe/dump.h"
+#include <arpa/inet.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+TEST_CASE(test_dump_parse_request) {
+    dump_request_t req;
+
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, dump_parse_request("\r\n", &req));
+    TEST_ASSERT_EQUAL_UINT32(0, req.filter.prefix_mask);
+    TEST_ASSERT_EQUAL_INT(TRACKER_MATCH_ANY, req.filter.blocked);
+    TEST_ASSERT_EQUAL_INT(DUMP_FORMAT_JSON, req.format);
+
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK,
+                          dump_parse_request(" prefix=10.1.2.3/16 min_syn=50 blocked=yes"
+                                             " format=binary\n", &req));
+    TEST_ASSERT_EQUAL_UINT32(inet_addr("10.1.0.0"), req.filter.prefix);
+    TEST_ASSERT_EQUAL_UINT32(inet_addr("255.255.0.0"), req.filter.prefix_mask);
+    TEST_ASSERT_EQUAL_UINT32(50, req.filter.min_syn_count);
+    TEST_ASSERT_EQUAL_INT(TRACKER_MATCH_BLOCKED, req.filter.blocked);
+    TEST_ASSERT_EQUAL_INT(DUMP_FORMAT_BINARY, req.format);
+
+    /* A bare address queries one source */
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, dump_parse_request(" prefix=198.51.100.7", &req));
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFF, req.filter.prefix_mask);
+
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, dump_parse_request(" prefix=10.0.0.0/33", &req));
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, dump_parse_request(" min_syn=lots", &req));
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, dump_parse_request(" blocked=maybe", &req));
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, dump_parse_request(" colour=red", &req));
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, dump_parse_request(" everything", &req));
+}
+
+TEST_CASE(test_dump_formats) {
+    uint64_t now = sec_to_ns(1000);
+    ip_tracker_t entry = {
+        .ip_addr = inet_addr("198.51.100.7"),
+        .syn_count = 150,
+        .last_seen_ns = now - ms_to_ns(12),
+        .blocked = 1,
+        .block_expiry_ns = now + sec_to_ns(300),
+    };
+    char buf[DUMP_JSON_MAX];
+
+    size_t len = dump_format_entry(&entry, now, DUMP_FORMAT_JSON, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("{\"ip\":\"198.51.100.7\",\"syn_count\":150,\"blocked\":true,"
+                             "\"whitelisted\":false,\"idle_ms\":12,"
+                             "\"block_remaining_ms\":300000}\n",
+                             buf);
+    TEST_ASSERT_EQUAL_INT(strlen(buf), len);
+
+    len = dump_format_entry(&entry, now, DUMP_FORMAT_BINARY, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_INT(DUMP_RECORD_LEN, len);
+    const uint8_t *p = (const uint8_t *)buf;
+    TEST_ASSERT_EQUAL_UINT8(198, p[0]);
+    TEST_ASSERT_EQUAL_UINT8(150, p[7]);
+    TEST_ASSERT_EQUAL_UINT8(12, p[11]);
+    TEST_ASSERT_EQUAL_UINT8(DUMP_FLAG_BLOCKED, p[16]);
+
+    dump_format_end(3, DUMP_FORMAT_JSON, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("{\"end\":true,\"entries\":3}\n", buf);
+
+    TEST_ASSERT_EQUAL_INT(DUMP_RECORD_LEN, dump_format_end(3, DUMP_FORMAT_BINARY, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_UINT8(3, p[7]);
+    TEST_ASSERT_EQUAL_UINT8(DUMP_RECORD_END, p[16]);
+}
+
+typedef struct
+{
+    int fd;
+    size_t len;
+    char buf[1 << 20];
+} reader_t;
+
+/* Drain the client side concurrently so large dumps cannot fill the socket */
+static void *reader_thread(void *arg) {
+    reader_t *r = arg;
+    ssize_t n;
+    while ((n = recv(r->fd, r->buf + r->len, sizeof(r->buf) - 1 - r->len, 0)) > 0) {
+        r->len += (size_t)n;
+    }
+    r->buf[r->len] = '\0';
+    return NULL;
+}
+
+TEST_CASE(test_dump_stream_binary) {
+    tracker_table_t *table = tracker_create(1024, 10000);
+    for (uint32_t i = 0; i < 5000; i++) {
+        tracker_get_or_create(table, htonl(0x0A000000 + i))->syn_count = i;
+    }
+
+    int fds[2];
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    static reader_t reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.fd = fds[1];
+    pthread_t tid;
+    pthread_create(&tid, NULL, reader_thread, &reader);
+
+    dump_request_t req;
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, dump_parse_request(" min_syn=4000 format=binary", &req));
+    size_t sent = 0;
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, dump_stream(table, &req, fds[0], &sent));
+    close(fds[0]);
+    pthread_join(tid, NULL);
+    close(fds[1]);
+
+    TEST_ASSERT_EQUAL_INT(1000, sent);
+    TEST_ASSERT_EQUAL_INT((sent + 1) * DUMP_RECORD_LEN, reader.len);
+
+    const uint8_t *end = (const uint8_t *)reader.buf + sent * DUMP_RECORD_LEN;
+    TEST_ASSERT_EQUAL_UINT8(DUMP_RECORD_END, end[16]);
+    TEST_ASSERT_EQUAL_UINT32(1000, ((uint32_t)end[6] << 8) | end[7]);
+
+    tracker_destroy(table);
+}
+
+TEST_CASE(test_dump_stream_client_gone) {
+    tracker_table_t *table = tracker_create(16, 100);
+    tracker_get_or_create(table, inet_addr("203.0.113.1"));
+
+    int fds[2];
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    close(fds[1]);
+
+    dump_request_t req;
+    dump_parse_request("", &req);
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_ERROR, dump_stream(table, &req, fds[0], NULL));
+
+    close(fds[0]);
+    tracker_destroy(table);
+}
+
+int main(void) {
+    UnityBegin("test_dump.c");
+
+    RUN_TEST(test_dump_parse_request);
+    RUN_TEST(test_dump_formats);
+    RUN_TEST(test_dump_stream_binary);
+    RUN_TEST(test_dump_stream_client_gone);
+
+    return UnityEnd();
+}
@@ -0,0 +1,543 @@
+/*
+ * test_engine.c - Unit tests for the specialized detection engine
+ */
+
+#include "../unity/unity.h"
+#include "../../include/common.h"
+#include "../../src/analysis/engine.h"
+#include "../../src/analysis/tracker.h"
+#include "../../src/analysis/whitelist.h"
+#include "../../src/analysis/victim.h"
+#include "../../src/analysis/scan.h"
+#include "../../src/analysis/asnmap.h"
+#include "../../src/analysis/asnrate.h"
+#include "../../src/analysis/procparse.h"
+#include <arpa/inet.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static synflood_config_t config;
+static app_context_t ctx;
+
+static void setup(void) {
+    memset(&config, 0, sizeof(config));
+    config.syn_threshold = 100;
+    config.window_ms = 1000;
+    config.block_duration_s = 300;
+    config.fastpath_max_syn = 10;
+    config.validate_syn_recv = true;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.config = &config;
+    ctx.tracker = tracker_create(64, 128);
+    pthread_mutex_init(&ctx.metrics_lock, NULL);
+}
+
+static void teardown(void) {
+    tracker_destroy(ctx.tracker);
+    whitelist_free(ctx.whitelist_root);
+    pthread_mutex_destroy(&ctx.metrics_lock);
+}
+
+TEST_CASE(test_engine_flags_follow_config) {
+    setup();
+
+    TEST_ASSERT_EQUAL_UINT32(ENGINE_F_VALIDATE, engine_flags(&ctx));
+
+    whitelist_add(&ctx.whitelist_root, "10.0.0.0/8");
+    config.inpath_drop = true;
+    config.fastpath_mark = 0x10;
+    TEST_ASSERT_EQUAL_UINT32(ENGINE_F_WHITELIST | ENGINE_F_VALIDATE |
+                             ENGINE_F_INPATH_DROP | ENGINE_F_FASTPATH, engine_flags(&ctx));
+
+    /* Raw socket capture cannot drop or mark */
+    config.use_raw_socket = true;
+    TEST_ASSERT_EQUAL_UINT32(ENGINE_F_WHITELIST | ENGINE_F_VALIDATE, engine_flags(&ctx));
+
+    teardown();
+}
+
+TEST_CASE(test_engine_select_switches_variant) {
+    setup();
+
+    unsigned int flags = engine_select(&ctx);
+    TEST_ASSERT_TRUE(engine_process_syn == engine_variant(flags));
+
+    /* Reload without validation picks a different variant */
+    config.validate_syn_recv = false;
+    flags = engine_select(&ctx);
+    TEST_ASSERT_EQUAL_UINT32(0, flags);
+    TEST_ASSERT_TRUE(engine_process_syn == engine_variant(0));
+    TEST_ASSERT_EQUAL_STRING("base", engine_variant_name(0));
+    TEST_ASSERT_EQUAL_STRING("whitelist+drop+victim",
+                             engine_variant_name(ENGINE_F_WHITELIST | ENGINE_F_INPATH_DROP |
+                                                 ENGINE_F_VICTIM));
+
+    engine_process_syn = engine_process_dynamic;
+    teardown();
+}
+
+TEST_CASE(test_engine_whitelist_variants) {
+    setup();
+    whitelist_add(&ctx.whitelist_root, "10.0.0.0/8");
+    engine_packet_t pkt = { .src_ip = inet_addr("10.1.2.3"), .dst_ip = inet_addr("192.0.2.80"),
+                            .dst_port = 80, .weight = 1 };
+    bool fastpath = false;
+
+    /* Whitelisted source reported as known-good only when fast path is on */
+    TEST_ASSERT_EQUAL(ENGINE_ACCEPT, engine_variant(ENGINE_F_WHITELIST)(&ctx, &pkt, &fastpath));
+    TEST_ASSERT_FALSE(fastpath);
+    TEST_ASSERT_EQUAL(ENGINE_ACCEPT,
+                      engine_variant(ENGINE_F_WHITELIST | ENGINE_F_FASTPATH)(&ctx, &pkt, &fastpath));
+    TEST_ASSERT_TRUE(fastpath);
+    TEST_ASSERT_EQUAL_UINT64(2, ctx.metrics.whitelist_hits_total);
+
+    /* Only a compact entry is kept for the whitelisted source */
+    TEST_ASSERT_NULL(tracker_get(ctx.tracker, pkt.src_ip));
+    TEST_ASSERT_TRUE(tracker_whitelisted(ctx.tracker, pkt.src_ip, 1));
+    TEST_ASSERT_FALSE(tracker_whitelisted(ctx.tracker, pkt.src_ip, 2));
+    TEST_ASSERT_FALSE(tracker_whitelisted(ctx.tracker, inet_addr("10.1.2.4"), 1));
+
+    /* Variant without whitelist counts the packet instead */
+    TEST_ASSERT_EQUAL(ENGINE_ACCEPT, engine_variant(0)(&ctx, &pkt, &fastpath));
+    TEST_ASSERT_EQUAL_UINT64(2, ctx.metrics.whitelist_hits_total);
+    TEST_ASSERT_EQUAL_UINT64(1, ctx.metrics.syn_packets_total);
+
+    teardown();
+}
+
+TEST_CASE(test_engine_inpath_drop_variants_match_dynamic) {
+    setup();
+    engine_packet_t pkt = { .src_ip = inet_addr("192.0.2.1"), .dst_ip = inet_addr("192.0.2.80"),
+                            .dst_port = 80, .weight = 1 };
+    bool fastpath = false;
+
+    ip_tracker_t *entry = tracker_get_or_create(ctx.tracker, pkt.src_ip);
+    entry->blocked = 1;
+    entry->block_expiry_ns = get_monotonic_ns() + sec_to_ns(60);
+
+    TEST_ASSERT_EQUAL(ENGINE_ACCEPT, engine_variant(ENGINE_F_VALIDATE)(&ctx, &pkt, &fastpath));
+    TEST_ASSERT_EQUAL(ENGINE_DROP,
+                      engine_variant(ENGINE_F_VALIDATE | ENGINE_F_INPATH_DROP)(&ctx, &pkt, &fastpath));
+    TEST_ASSERT_EQUAL_UINT64(1, ctx.metrics.packets_dropped_total);
+
+    /* Dynamic engine decides the same from the configuration */
+    TEST_ASSERT_EQUAL(ENGINE_ACCEPT, engine_process_dynamic(&ctx, &pkt, &fastpath));
+    config.inpath_drop = true;
+    TEST_ASSERT_EQUAL(ENGINE_DROP, engine_process_dynamic(&ctx, &pkt, &fastpath));
+    TEST_ASSERT_FALSE(fastpath);
+
+    teardown();
+}
+
+TEST_CASE(test_engine_victim_tightens_source_threshold) {
+    setup();
+    config.validate_syn_recv = false;
+    config.victim_threshold = 50;
+    config.victim_source_threshold = 5;
+    config.victim_hold_s = 10;
+    victim_init(64);
+
+    engine_process_fn process = engine_variant(ENGINE_F_INPATH_DROP | ENGINE_F_VICTIM);
+    engine_packet_t pkt = { .dst_ip = inet_addr("192.0.2.80"), .dst_port = 443, .weight = 1 };
+    bool fastpath = false;
+
+    /* Distributed flood: 60 sources, one SYN each, all below syn_threshold */
+    for (uint32_t i = 0; i < 60; i++) {
+        pkt.src_ip = htonl(0x0A010000 + i);
+        TEST_ASSERT_EQUAL(ENGINE_ACCEPT, process(&ctx, &pkt, &fastpath));
+    }
+
+    size_t attacked;
+    victim_get_counts(NULL, &attacked, NULL, get_monotonic_ns());
+    TEST_ASSERT_EQUAL_INT(1, attacked);
+
+    /* A source sending more than victim_source_threshold to the victim is caught */
+    pkt.src_ip = inet_addr("198.51.100.7");
+    engine_verdict_t verdict = ENGINE_ACCEPT;
+    for (int i = 0; i < 6; i++) {
+        verdict = process(&ctx, &pkt, &fastpath);
+    }
+    TEST_ASSERT_EQUAL(ENGINE_DROP, verdict);
+
+    /* The same rate towards another service keeps the normal threshold */
+    pkt.src_ip = inet_addr("198.51.100.8");
+    pkt.dst_port = 22;
+    for (int i = 0; i < 6; i++) {
+        verdict = process(&ctx, &pkt, &fastpath);
+    }
+    TEST_ASSERT_EQUAL(ENGINE_ACCEPT, verdict);
+
+    victim_cleanup();
+    teardown();
+}
+
+TEST_CASE(test_engine_asn_tightens_source_threshold) {
+    setup();
+    config.validate_syn_recv = false;
+    config.asn_threshold = 50;
+    config.asn_source_threshold = 5;
+    config.asn_hold_s = 10;
+    asnrate_init(64);
+
+    char snapshot[] = "/tmp/synflood_test_asn_XXXXXX";
+    int fd = mkstemp(snapshot);
+    TEST_ASSERT_TRUE(fd >= 0);
+    const char *routes = "10.1.0.0/16 64500\n198.51.100.0/24 64501\n";
+    TEST_ASSERT_EQUAL_INT((int)strlen(routes), (int)write(fd, routes, strlen(routes)));
+    close(fd);
+    char map_path[64];
+    snprintf(map_path, sizeof(map_path), "%s.map", snapshot);
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, asnmap_build(snapshot, map_path, NULL, NULL));
+    asnmap_replace(&ctx.asnmap, asnmap_open(map_path), ctx.tracker->asnmap_gen);
+    TEST_ASSERT_NOT_NULL(ctx.asnmap);
+
+    config.inpath_drop = true;
+    TEST_ASSERT_EQUAL_UINT32(ENGINE_F_INPATH_DROP | ENGINE_F_ASN, engine_flags(&ctx));
+
+    engine_process_fn process = engine_variant(ENGINE_F_INPATH_DROP | ENGINE_F_ASN);
+    engine_packet_t pkt = { .dst_ip = inet_addr("192.0.2.80"), .dst_port = 443, .weight = 1 };
+    bool fastpath = false;
+
+    /* Flood spread over one AS: 60 sources, one SYN each, all below syn_threshold */
+    for (uint32_t i = 0; i < 60; i++) {
+        pkt.src_ip = htonl(0x0A010000 + i);
+        TEST_ASSERT_EQUAL(ENGINE_ACCEPT, process(&ctx, &pkt, &fastpath));
+    }
+    ip_tracker_t *entry = tracker_get_or_create(ctx.tracker, htonl(0x0A010000));
+    TEST_ASSERT_EQUAL_UINT32(64500, entry->asn);
+
+    size_t over;
+    asnrate_get_counts(NULL, &over, NULL, get_monotonic_ns());
+    TEST_ASSERT_EQUAL_INT(1, over);
+
+    /* A source of that AS sending more than asn_source_threshold is caught */
+    pkt.src_ip = inet_addr("10.1.200.7");
+    engine_verdict_t verdict = ENGINE_ACCEPT;
+    for (int i = 0; i < 6; i++) {
+        verdict = process(&ctx, &pkt, &fastpath);
+    }
+    TEST_ASSERT_EQUAL(ENGINE_DROP, verdict);
+
+    /* The same rate from another AS keeps the normal threshold */
+    pkt.src_ip = inet_addr("198.51.100.8");
+    for (int i = 0; i < 6; i++) {
+        verdict = process(&ctx, &pkt, &fastpath);
+    }
+    TEST_ASSERT_EQUAL(ENGINE_ACCEPT, verdict);
+    TEST_ASSERT_EQUAL_UINT64(0, ctx.metrics.false_positives_total);
+
+    asnmap_replace(&ctx.asnmap, NULL, ctx.tracker->asnmap_gen);
+    asnmap_reclaim(true);
+    unlink(snapshot);
+    unlink(map_path);
+    asnrate_cleanup();
+    teardown();
+}
+
+TEST_CASE(test_engine_scan_blocks_scanner) {
+    setup();
+    config.scan_port_threshold = 20;
+    config.scan_window_s = 60;
+    config.scan_block = true;
+    scan_init(64);
+
+    /* SYN_RECV validation does not apply to scans */
+    engine_process_fn process = engine_variant(ENGINE_F_VALIDATE | ENGINE_F_INPATH_DROP |
+                                               ENGINE_F_SCAN);
+    engine_packet_t pkt = { .src_ip = inet_addr("198.51.100.9"),
+                            .dst_ip = inet_addr("192.0.2.80"), .weight = 1 };
+    bool fastpath = false;
+
+    /* One SYN per port, far below syn_threshold */
+    for (uint16_t port = 1; port <= 20; port++) {
+        pkt.dst_port = port;
+        TEST_ASSERT_EQUAL(ENGINE_ACCEPT, process(&ctx, &pkt, &fastpath));
+    }
+    engine_verdict_t verdict = ENGINE_ACCEPT;
+    for (uint16_t port = 21; port <= 40 && verdict == ENGINE_ACCEPT; port++) {
+        pkt.dst_port = port;
+        verdict = process(&ctx, &pkt, &fastpath);
+    }
+    TEST_ASSERT_EQUAL(ENGINE_DROP, verdict);
+    TEST_ASSERT_EQUAL_UINT64(0, ctx.metrics.false_positives_total);
+
+    /* Without scan_block the scan is only reported */
+    config.scan_block = false;
+    pkt.src_ip = inet_addr("198.51.100.10");
+    for (uint16_t port = 1; port <= 40; port++) {
+        pkt.dst_port = port;
+        TEST_ASSERT_EQUAL(ENGINE_ACCEPT, process(&ctx, &pkt, &fastpath));
+    }
+
+    uint64_t detected[SCAN_KIND_COUNT];
+    scan_get_counts(NULL, detected);
+    TEST_ASSERT_EQUAL_UINT64(2, detected[SCAN_VERTICAL]);
+    TEST_ASSERT_EQUAL_UINT64(0, detected[SCAN_HORIZONTAL]);
+
+    scan_cleanup();
+    teardown();
+}
+
+TEST_CASE(test_engine_tcp_class_from_flags) {
+    TEST_ASSERT_EQUAL_INT(FLOOD_CLASS_SYN, engine_tcp_class(0x02));
+    TEST_ASSERT_EQUAL_INT(FLOOD_CLASS_SYN, engine_tcp_class(0x03));    /* SYN+FIN */
+    TEST_ASSERT_EQUAL_INT(FLOOD_CLASS_SYNACK, engine_tcp_class(0x12));
+    TEST_ASSERT_EQUAL_INT(FLOOD_CLASS_ACK, engine_tcp_class(0x10));
+    TEST_ASSERT_EQUAL_INT(FLOOD_CLASS_ACK, engine_tcp_class(0x18));    /* PSH+ACK */
+    TEST_ASSERT_EQUAL_INT(FLOOD_CLASS_RST, engine_tcp_class(0x04));
+    TEST_ASSERT_EQUAL_INT(FLOOD_CLASS_RST, engine_tcp_class(0x14));    /* RST+ACK */
+    TEST_ASSERT_EQUAL_INT(FLOOD_CLASS_RST, engine_tcp_class(0x16));
+    TEST_ASSERT_EQUAL_INT(FLOOD_CLASS_NONE, engine_tcp_class(0x00));
+    TEST_ASSERT_EQUAL_INT(FLOOD_CLASS_NONE, engine_tcp_class(0x29));   /* FIN+PSH+URG */
+
+    /* Capture filters admit SYNs plus every class with a threshold */
+    setup();
+    TEST_ASSERT_EQUAL_UINT32(1u << FLOOD_CLASS_SYN, engine_flood_classes(&config));
+    config.synack_threshold = 500;
+    config.rst_threshold = 200;
+    TEST_ASSERT_EQUAL_UINT32((1u << FLOOD_CLASS_SYN) | (1u << FLOOD_CLASS_SYNACK) |
+                             (1u << FLOOD_CLASS_RST), engine_flood_classes(&config));
+    config.icmp_threshold = 50;
+    TEST_ASSERT_EQUAL_UINT32((1u << FLOOD_CLASS_SYN) | (1u << FLOOD_CLASS_SYNACK) |
+                             (1u << FLOOD_CLASS_RST) | (1u << FLOOD_CLASS_ICMP),
+                             engine_flood_classes(&config));
+    teardown();
+}
+
+TEST_CASE(test_engine_parse_ipv4_protocols) {
+    unsigned char buf[48];
+    engine_packet_t pkt;
+
+    /* 20-byte IPv4 header from 198.51.100.1 to 192.0.2.80 */
+    memset(buf, 0, sizeof(buf));
+    buf[0] = 0x45;
+    memcpy(&buf[12], (unsigned char[]){ 198, 51, 100, 1 }, 4);
+    memcpy(&buf[16], (unsigned char[]){ 192, 0, 2, 80 }, 4);
+
+    /* TCP SYN to port 443 */
+    buf[9] = IPPROTO_TCP;
+    buf[22] = 0x01;
+    buf[23] = 0xbb;
+    buf[33] = 0x02;
+    memset(&pkt, 0, sizeof(pkt));
+    TEST_ASSERT_TRUE(engine_parse_ipv4(buf, 40, &pkt));
+    TEST_ASSERT_EQUAL_UINT32(inet_addr("198.51.100.1"), pkt.src_ip);
+    TEST_ASSERT_EQUAL_UINT32(inet_addr("192.0.2.80"), pkt.dst_ip);
+    TEST_ASSERT_EQUAL_INT(443, pkt.dst_port);
+    TEST_ASSERT_EQUAL_INT(FLOOD_CLASS_SYN, pkt.flood_class);
+    TEST_ASSERT_FALSE(engine_parse_ipv4(buf, 39, &pkt));
+
+    /* UDP to port 53 */
+    buf[9] = IPPROTO_UDP;
+    buf[22] = 0;
+    buf[23] = 53;
+    TEST_ASSERT_TRUE(engine_parse_ipv4(buf, 28, &pkt));
+    TEST_ASSERT_EQUAL_INT(53, pkt.dst_port);
+    TEST_ASSERT_EQUAL_INT(FLOOD_CLASS_UDP, pkt.flood_class);
+    TEST_ASSERT_FALSE(engine_parse_ipv4(buf, 27, &pkt));
+
+    /* ICMP has no port */
+    buf[9] = IPPROTO_ICMP;
+    TEST_ASSERT_TRUE(engine_parse_ipv4(buf, 28, &pkt));
+    TEST_ASSERT_EQUAL_INT(0, pkt.dst_port);
+    TEST_ASSERT_EQUAL_INT(FLOOD_CLASS_ICMP, pkt.flood_class);
+
+    /* Later fragments carry no L4 header; the first fragment counts */
+    buf[9] = IPPROTO_UDP;
+    buf[6] = 0x20;
+    buf[7] = 0x00;
+    TEST_ASSERT_TRUE(engine_parse_ipv4(buf, 28, &pkt));
+    buf[7] = 0xb9;
+    TEST_ASSERT_FALSE(engine_parse_ipv4(buf, 28, &pkt));
+    buf[6] = 0;
+    buf[7] = 0;
+
+    /* Other protocols, IPv6 and bad header lengths are rejected */
+    buf[9] = IPPROTO_GRE;
+    TEST_ASSERT_FALSE(engine_parse_ipv4(buf, 28, &pkt));
+    buf[9] = IPPROTO_UDP;
+    buf[0] = 0x44;
+    TEST_ASSERT_FALSE(engine_parse_ipv4(buf, 28, &pkt));
+    buf[0] = 0x65;
+    TEST_ASSERT_FALSE(engine_parse_ipv4(buf, 28, &pkt));
+    TEST_ASSERT_FALSE(engine_parse_ipv4(buf, 19, &pkt));
+}
+
+TEST_CASE(test_engine_udp_flood_blocks_per_protocol) {
+    setup();
+    config.udp_threshold = 30;
+    config.inpath_drop = true;
+    strcpy(config.ipset_name, "synflood_blacklist");
+    strcpy(config.udp_ipset, "synflood_blacklist_udp");
+
+    TEST_ASSERT_NULL(engine_class_ipset(&config, FLOOD_CLASS_SYN));
+    TEST_ASSERT_NULL(engine_class_ipset(&config, FLOOD_CLASS_ICMP));
+    TEST_ASSERT_EQUAL_STRING("synflood_blacklist_udp", engine_class_ipset(&config, FLOOD_CLASS_UDP));
+
+    engine_process_fn process = engine_variant(ENGINE_F_VALIDATE | ENGINE_F_INPATH_DROP);
+    engine_packet_t pkt = { .src_ip = inet_addr("198.51.100.30"),
+                            .dst_ip = inet_addr("192.0.2.53"), .dst_port = 53,
+                            .flood_class = FLOOD_CLASS_UDP, .weight = 1 };
+    bool fastpath = false;
+
+    for (int i = 0; i < 30; i++) {
+        TEST_ASSERT_EQUAL(ENGINE_ACCEPT, process(&ctx, &pkt, &fastpath));
+    }
+    /* ICMP has no threshold: not counted */
+    pkt.flood_class = FLOOD_CLASS_ICMP;
+    TEST_ASSERT_EQUAL(ENGINE_ACCEPT, process(&ctx, &pkt, &fastpath));
+
+    ip_tracker_t *entry = tracker_get(ctx.tracker, pkt.src_ip);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_UINT32(30, entry->flood_count[FLOOD_CLASS_UDP - 1]);
+    TEST_ASSERT_EQUAL_UINT32(0, entry->flood_count[FLOOD_CLASS_ICMP - 1]);
+    TEST_ASSERT_EQUAL_UINT64(0, ctx.metrics.class_packets_total[FLOOD_CLASS_ICMP]);
+
+    /* The 31st datagram crosses udp_threshold, without SYN_RECV validation */
+    pkt.flood_class = FLOOD_CLASS_UDP;
+    TEST_ASSERT_EQUAL(ENGINE_DROP, process(&ctx, &pkt, &fastpath));
+    TEST_ASSERT_EQUAL_UINT64(0, ctx.metrics.false_positives_total);
+
+    /* While the source is only blocked for UDP, its SYNs are still analysed */
+    entry->set_block_expiry_ns[FLOOD_CLASS_UDP - FLOOD_CLASS_FIRST_PROTO] =
+        get_monotonic_ns() + sec_to_ns(60);
+    TEST_ASSERT_EQUAL(ENGINE_DROP, process(&ctx, &pkt, &fastpath));
+    pkt.flood_class = FLOOD_CLASS_SYN;
+    TEST_ASSERT_EQUAL(ENGINE_ACCEPT, process(&ctx, &pkt, &fastpath));
+    TEST_ASSERT_FALSE(entry->blocked);
+    TEST_ASSERT_EQUAL_UINT32(1, entry->syn_count);
+
+    teardown();
+}
+
+TEST_CASE(test_engine_new_source_not_fastpathed) {
+    setup();
+    config.fastpath_mark = 0x10;
+
+    /* The first SYN of a source has no completed window behind it */
+    engine_process_fn process = engine_variant(ENGINE_F_INPATH_DROP | ENGINE_F_FASTPATH);
+    engine_packet_t pkt = { .dst_ip = inet_addr("192.0.2.80"), .dst_port = 80,
+                            .flood_class = FLOOD_CLASS_SYN, .weight = 1 };
+
+    for (uint32_t i = 0; i < 32; i++) {
+        bool fastpath = false;
+        pkt.src_ip = htonl(0xC6336400u + i);  /* 198.51.100.0/27 */
+        TEST_ASSERT_EQUAL(ENGINE_ACCEPT, process(&ctx, &pkt, &fastpath));
+        TEST_ASSERT_FALSE(fastpath);
+    }
+
+    teardown();
+}
+
+TEST_CASE(test_engine_flag_classes_counted_separately) {
+    setup();
+    config.ack_threshold = 20;
+
+    /* SYN_RECV validation does not apply to ACK floods */
+    engine_process_fn process = engine_variant(ENGINE_F_VALIDATE | ENGINE_F_INPATH_DROP |
+                                               ENGINE_F_FASTPATH);
+    engine_packet_t pkt = { .src_ip = inet_addr("198.51.100.20"),
+                            .dst_ip = inet_addr("192.0.2.80"), .dst_port = 80,
+                            .flood_class = FLOOD_CLASS_ACK, .weight = 1 };
+    bool fastpath = false;
+
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_EQUAL(ENGINE_ACCEPT, process(&ctx, &pkt, &fastpath));
+    }
+    pkt.flood_class = FLOOD_CLASS_SYN;
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(ENGINE_ACCEPT, process(&ctx, &pkt, &fastpath));
+    }
+
+    ip_tracker_t *entry = tracker_get(ctx.tracker, pkt.src_ip);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_UINT32(5, entry->syn_count);
+    TEST_ASSERT_EQUAL_UINT32(20, entry->flood_count[FLOOD_CLASS_ACK - 1]);
+
+    /* RST has no threshold: not counted */
+    pkt.flood_class = FLOOD_CLASS_RST;
+    TEST_ASSERT_EQUAL(ENGINE_ACCEPT, process(&ctx, &pkt, &fastpath));
+    TEST_ASSERT_EQUAL_UINT32(0, entry->flood_count[FLOOD_CLASS_RST - 1]);
+    TEST_ASSERT_EQUAL_UINT64(0, ctx.metrics.class_packets_total[FLOOD_CLASS_RST]);
+
+    /* The 21st ACK crosses ack_threshold */
+    pkt.flood_class = FLOOD_CLASS_ACK;
+    TEST_ASSERT_EQUAL(ENGINE_DROP, process(&ctx, &pkt, &fastpath));
+    TEST_ASSERT_EQUAL_UINT64(0, ctx.metrics.false_positives_total);
+    TEST_ASSERT_EQUAL_UINT64(21, ctx.metrics.class_packets_total[FLOOD_CLASS_ACK]);
+    TEST_ASSERT_EQUAL_UINT64(5, ctx.metrics.syn_packets_total);
+
+    /* A new window restarts every class; only a SYN is reported for the fast path */
+    pkt.src_ip = inet_addr("198.51.100.21");
+    TEST_ASSERT_EQUAL(ENGINE_ACCEPT, process(&ctx, &pkt, &fastpath));
+    entry = tracker_get(ctx.tracker, pkt.src_ip);
+    entry->window_start_ns -= ms_to_ns(2 * config.window_ms);
+    TEST_ASSERT_EQUAL(ENGINE_ACCEPT, process(&ctx, &pkt, &fastpath));
+    TEST_ASSERT_FALSE(fastpath);
+    TEST_ASSERT_EQUAL_UINT32(1, entry->flood_count[FLOOD_CLASS_ACK - 1]);
+
+    entry->window_start_ns -= ms_to_ns(2 * config.window_ms);
+    pkt.flood_class = FLOOD_CLASS_SYN;
+    TEST_ASSERT_EQUAL(ENGINE_ACCEPT, process(&ctx, &pkt, &fastpath));
+    TEST_ASSERT_TRUE(fastpath);
+    TEST_ASSERT_EQUAL_UINT32(1, entry->syn_count);
+    TEST_ASSERT_EQUAL_UINT32(0, entry->flood_count[FLOOD_CLASS_ACK - 1]);
+
+    teardown();
+}
+
+TEST_CASE(test_engine_netns_validates_in_namespace) {
+    setup();
+    config.syn_threshold = 3;
+
+    /* Stand-in for /proc/net/tcp opened inside a namespace: no SYN_RECV */
+    char path[] = "/tmp/synflood_test_proc_tcp_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    const char *table =
+        "  sl  local_address rem_address   st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode\n"
+        "   0: 0100007F:0050 0100000A:C350 01 00000000:00000000 00:00000000 00000000     0        0 1 1\n";
+    TEST_ASSERT_EQUAL_INT((int)strlen(table), (int)write(fd, table, strlen(table)));
+
+    netns_binding_t binding = { .ns_fd = -1, .proc_tcp_fd = fd, .ipset_name = "test" };
+    ctx.netns = &binding;
+
+    engine_packet_t pkt = { .src_ip = inet_addr("10.0.0.1"), .dst_ip = inet_addr("192.0.2.80"),
+                            .dst_port = 80, .weight = 1 };
+    bool fastpath = false;
+    for (int i = 0; i < 5; i++) {
+        engine_variant(ENGINE_F_VALIDATE)(&ctx, &pkt, &fastpath);
+    }
+
+    /* Unconfirmed by the namespace's table: suspicious, not blocked.
+     * The fd is rewound and re-read on every check. */
+    TEST_ASSERT_EQUAL_UINT64(2, ctx.metrics.false_positives_total);
+    TEST_ASSERT_EQUAL_UINT64(0, ctx.metrics.detections_total);
+    TEST_ASSERT_EQUAL_UINT32(0, procparse_count_syn_recv_from_ip_fd(fd, pkt.src_ip));
+
+    close(fd);
+    unlink(path);
+    teardown();
+}
+
+int main(void) {
+    UnityBegin("test_engine.c");
+
+    RUN_TEST(test_engine_flags_follow_config);
+    RUN_TEST(test_engine_select_switches_variant);
+    RUN_TEST(test_engine_whitelist_variants);
+    RUN_TEST(test_engine_inpath_drop_variants_match_dynamic);
+    RUN_TEST(test_engine_victim_tightens_source_threshold);
+    RUN_TEST(test_engine_asn_tightens_source_threshold);
+    RUN_TEST(test_engine_scan_blocks_scanner);
+    RUN_TEST(test_engine_tcp_class_from_flags);
+    RUN_TEST(test_engine_new_source_not_fastpathed);
+    RUN_TEST(test_engine_flag_classes_counted_separately);
+    RUN_TEST(test_engine_parse_ipv4_protocols);
+    RUN_TEST(test_engine_udp_flood_blocks_per_protocol);
+    RUN_TEST(test_engine_netns_validates_in_namespace);
+
+    return UnityEnd();
+}
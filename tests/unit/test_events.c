@@ -0,0 +1,189 @@
+/*
+ * test_events.c - Unit tests for the detection event stream
+ */
+
+#include "../unity/unity.h"
+#include "../../include/common.h"
+#include "../../src/observe/events.h"
+#include "../../src/observe/logger.h"
+#include <arpa/inet.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* Read what the stream thread sends until nothing arrives for timeout_ms */
+static size_t read_stream(int fd, char *buf, size_t size, int timeout_ms) {
+    size_t len = 0;
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+    while (len < size - 1 && poll(&pfd, 1, timeout_ms) > 0) {
+        ssize_t n = recv(fd, buf + len, size - 1 - len, 0);
+        if (n <= 0) {
+            break;
+        }
+        len += (size_t)n;
+    }
+
+    buf[len] = '\0';
+    return len;
+}
+
+TEST_CASE(test_events_publish_and_read) {
+    uint64_t cursor = events_head();
+
+    events_publish(EVENT_BLOCKED, inet_addr("198.51.100.7"), 150, 80);
+    events_publish(EVENT_UNBLOCKED, inet_addr("198.51.100.7"), 0, 0);
+
+    event_record_t recs[8];
+    uint64_t dropped;
+    size_t n = events_read(&cursor, recs, ARRAY_SIZE(recs), &dropped);
+
+    TEST_ASSERT_EQUAL_INT(2, n);
+    TEST_ASSERT_EQUAL_UINT64(0, dropped);
+    TEST_ASSERT_EQUAL_UINT64(events_head(), cursor);
+    TEST_ASSERT_EQUAL_UINT8(EVENT_BLOCKED, recs[0].type);
+    TEST_ASSERT_EQUAL_UINT32(inet_addr("198.51.100.7"), recs[0].ip_addr);
+    TEST_ASSERT_EQUAL_UINT32(150, recs[0].syn_count);
+    TEST_ASSERT_EQUAL_UINT32(80, recs[0].syn_recv_count);
+    TEST_ASSERT_EQUAL_UINT64(recs[0].seq + 1, recs[1].seq);
+
+    /* Nothing new */
+    TEST_ASSERT_EQUAL_INT(0, events_read(&cursor, recs, ARRAY_SIZE(recs), &dropped));
+}
+
+TEST_CASE(test_events_slow_reader_loses_oldest) {
+    uint64_t cursor = events_head();
+
+    for (uint32_t i = 0; i < EVENTS_RING_SIZE + 10; i++) {
+        events_publish(EVENT_SUSPICIOUS, htonl(i), i, 0);
+    }
+
+    event_record_t rec;
+    uint64_t dropped;
+    TEST_ASSERT_EQUAL_INT(1, events_read(&cursor, &rec, 1, &dropped));
+    TEST_ASSERT_EQUAL_UINT64(10, dropped);
+    TEST_ASSERT_EQUAL_UINT32(10, rec.syn_count);
+}
+
+TEST_CASE(test_events_frame_formats) {
+    event_record_t rec = {
+        .seq = 42,
+        .timestamp_ns = 1760781234567000000ULL,
+        .ip_addr = inet_addr("198.51.100.7"),
+        .syn_count = 150,
+        .syn_recv_count = 80,
+        .type = EVENT_BLOCKED,
+    };
+    char buf[EVENTS_JSON_MAX];
+
+    size_t len = events_format(&rec, EVENTS_FORMAT_JSON, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("{\"seq\":42,\"ts_ms\":1760781234567,\"event\":\"BLOCKED\","
+                             "\"ip\":\"198.51.100.7\",\"syn_count\":150,\"syn_recv\":80}\n",
+                             buf);
+    TEST_ASSERT_EQUAL_INT(strlen(buf), len);
+
+    len = events_format(&rec, EVENTS_FORMAT_BINARY, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_INT(EVENTS_FRAME_LEN, len);
+    const uint8_t *p = (const uint8_t *)buf;
+    TEST_ASSERT_EQUAL_UINT8(42, p[7]);
+    TEST_ASSERT_EQUAL_UINT8(198, p[16]);
+    TEST_ASSERT_EQUAL_UINT8(150, p[23]);
+    TEST_ASSERT_EQUAL_UINT8(80, p[27]);
+    TEST_ASSERT_EQUAL_UINT8(EVENT_BLOCKED, p[28]);
+
+    events_format_dropped(7, EVENTS_FORMAT_JSON, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("{\"event\":\"DROPPED\",\"count\":7}\n", buf);
+
+    events_format_t format;
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, events_parse_format(" binary\r\n", &format));
+    TEST_ASSERT_EQUAL_INT(EVENTS_FORMAT_BINARY, format);
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, events_parse_format("\n", &format));
+    TEST_ASSERT_EQUAL_INT(EVENTS_FORMAT_JSON, format);
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, events_parse_format(" xml", &format));
+}
+
+TEST_CASE(test_events_stream_to_subscriber) {
+    int fds[2];
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, events_start());
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, events_subscribe(fds[0], EVENTS_FORMAT_JSON));
+
+    /* Events from the detection path reach the subscriber via the logger */
+    logger_log_event(EVENT_BLOCKED, inet_addr("203.0.113.1"), 120, 70);
+    logger_log_event(EVENT_UNBLOCKED, inet_addr("203.0.113.1"), 0, 0);
+
+    char buf[1024];
+    read_stream(fds[1], buf, sizeof(buf), 500);
+    TEST_ASSERT_NOT_NULL(strstr(buf, "\"event\":\"BLOCKED\",\"ip\":\"203.0.113.1\""));
+    TEST_ASSERT_NOT_NULL(strstr(buf, "\"event\":\"UNBLOCKED\""));
+
+    /* Disconnect is noticed and the slot freed */
+    close(fds[1]);
+    logger_log_event(EVENT_SUSPICIOUS, inet_addr("203.0.113.2"), 1, 0);
+    events_stats_t stats;
+    for (int i = 0; i < 50; i++) {
+        events_get_stats(&stats);
+        if (stats.subscribers == 0) {
+            break;
+        }
+        usleep(20000);
+    }
+    TEST_ASSERT_EQUAL_INT(0, stats.subscribers);
+
+    events_stop();
+}
+
+TEST_CASE(test_events_slow_subscriber_drops_frames) {
+    int fds[2];
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    int small = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+    setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, events_start());
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, events_subscribe(fds[0], EVENTS_FORMAT_BINARY));
+
+    /* The subscriber reads nothing; publishing must not wait for it */
+    uint64_t start = get_monotonic_ns();
+    for (uint32_t i = 0; i < 4 * EVENTS_RING_SIZE; i++) {
+        events_publish(EVENT_SUSPICIOUS, htonl(i + 1), i, 0);
+        if ((i & 1023) == 0) {
+            usleep(20000); /* Let the stream thread fill the socket */
+        }
+    }
+    TEST_ASSERT_TRUE(get_monotonic_ns() - start < sec_to_ns(5));
+
+    /* Drain: the frames that fit, then a DROPPED frame, then the rest */
+    static char buf[EVENTS_RING_SIZE * 2 * EVENTS_FRAME_LEN];
+    size_t len = read_stream(fds[1], buf, sizeof(buf), 500);
+    TEST_ASSERT_EQUAL_INT(0, len % EVENTS_FRAME_LEN);
+
+    bool saw_dropped = false;
+    for (size_t off = 0; off < len; off += EVENTS_FRAME_LEN) {
+        if ((uint8_t)buf[off + 28] == EVENTS_FRAME_DROPPED) {
+            saw_dropped = true;
+        }
+    }
+    TEST_ASSERT_TRUE(saw_dropped);
+
+    events_stats_t stats;
+    events_get_stats(&stats);
+    TEST_ASSERT_TRUE(stats.dropped_total > 0);
+
+    events_stop();
+    close(fds[1]);
+}
+
+int main(void) {
+    UnityBegin("test_events.c");
+
+    RUN_TEST(test_events_publish_and_read);
+    RUN_TEST(test_events_slow_reader_loses_oldest);
+    RUN_TEST(test_events_frame_formats);
+    RUN_TEST(test_events_stream_to_subscriber);
+    RUN_TEST(test_events_slow_subscriber_drops_frames);
+
+    return UnityEnd();
+}
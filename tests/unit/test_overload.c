@@ -0,0 +1,178 @@
+/*
+ * test_overload.c - Unit tests for the capture overload controller
+ */
+
+#include "../unity/unity.h"
+#include "../../include/common.h"
+#include "../../src/capture/overload.h"
+#include <arpa/inet.h>
+
+TEST_CASE(test_overload_disabled_admits_everything) {
+    overload_init(1);
+
+    for (int i = 0; i < 1000; i++) {
+        TEST_ASSERT_EQUAL_UINT32(1, overload_sample(htonl(0x0A000000 | i)));
+    }
+
+    /* Drops never change the rate when shedding is disabled */
+    overload_update(0, 0, 0);
+    TEST_ASSERT_FALSE(overload_update(100, 1000, OVERLOAD_TICK_NS));
+
+    uint32_t rate;
+    uint64_t shed;
+    overload_get_stats(&rate, &shed, NULL);
+    TEST_ASSERT_EQUAL_UINT32(1, rate);
+    TEST_ASSERT_EQUAL_UINT64(0, shed);
+}
+
+TEST_CASE(test_overload_doubles_on_drops) {
+    overload_init(8);
+    uint64_t now = 0;
+
+    overload_update(0, 0, now);  /* Baseline */
+
+    uint32_t rate;
+    TEST_ASSERT_TRUE(overload_update(10, 0, now += OVERLOAD_TICK_NS));
+    overload_get_stats(&rate, NULL, NULL);
+    TEST_ASSERT_EQUAL_UINT32(2, rate);
+
+    TEST_ASSERT_TRUE(overload_update(20, 0, now += OVERLOAD_TICK_NS));
+    TEST_ASSERT_TRUE(overload_update(30, 0, now += OVERLOAD_TICK_NS));
+    overload_get_stats(&rate, NULL, NULL);
+    TEST_ASSERT_EQUAL_UINT32(8, rate);
+
+    /* Capped at max */
+    TEST_ASSERT_FALSE(overload_update(40, 0, now += OVERLOAD_TICK_NS));
+    overload_get_stats(&rate, NULL, NULL);
+    TEST_ASSERT_EQUAL_UINT32(8, rate);
+}
+
+TEST_CASE(test_overload_backlog_growth_is_pressure) {
+    overload_init(64);
+    uint64_t now = 0;
+
+    overload_update(0, 100, now);
+
+    /* Growing but below the minimum backlog: no pressure */
+    TEST_ASSERT_FALSE(overload_update(0, 200, now += OVERLOAD_TICK_NS));
+
+    /* Above minimum and growing */
+    TEST_ASSERT_TRUE(overload_update(0, OVERLOAD_BACKLOG_MIN + 10, now += OVERLOAD_TICK_NS));
+
+    /* Large but shrinking backlog is not pressure */
+    TEST_ASSERT_FALSE(overload_update(0, OVERLOAD_BACKLOG_MIN + 5, now += OVERLOAD_TICK_NS));
+}
+
+TEST_CASE(test_overload_recovers_after_calm_ticks) {
+    overload_init(4);
+    uint64_t now = 0;
+    uint32_t rate;
+
+    overload_update(0, 0, now);
+    overload_update(5, 0, now += OVERLOAD_TICK_NS);
+    overload_update(9, 0, now += OVERLOAD_TICK_NS);
+    overload_get_stats(&rate, NULL, NULL);
+    TEST_ASSERT_EQUAL_UINT32(4, rate);
+
+    for (int i = 0; i < OVERLOAD_CALM_TICKS; i++) {
+        overload_update(9, 0, now += OVERLOAD_TICK_NS);
+    }
+    overload_get_stats(&rate, NULL, NULL);
+    TEST_ASSERT_EQUAL_UINT32(2, rate);
+
+    for (int i = 0; i < OVERLOAD_CALM_TICKS; i++) {
+        overload_update(9, 0, now += OVERLOAD_TICK_NS);
+    }
+    overload_get_stats(&rate, NULL, NULL);
+    TEST_ASSERT_EQUAL_UINT32(1, rate);
+}
+
+TEST_CASE(test_overload_sampling_preserves_scaled_counts) {
+    overload_init(16);
+    uint64_t now = 0;
+
+    overload_update(0, 0, now);
+    for (int i = 1; i <= 4; i++) {
+        overload_update(i, 0, now += OVERLOAD_TICK_NS);
+    }
+
+    uint32_t rate;
+    overload_get_stats(&rate, NULL, NULL);
+    TEST_ASSERT_EQUAL_UINT32(16, rate);
+
+    /* A heavy hitter: scaled count should stay close to the true count */
+    uint32_t heavy_ip = inet_addr("203.0.113.50");
+    uint64_t scaled = 0;
+    const uint64_t sent = 64000;
+    for (uint64_t i = 0; i < sent; i++) {
+        scaled += overload_sample(heavy_ip);
+    }
+
+    TEST_ASSERT_GREATER_THAN(sent * 9 / 10, scaled);
+    TEST_ASSERT_LESS_THAN(sent * 11 / 10, scaled);
+
+    uint64_t shed;
+    overload_get_stats(NULL, &shed, NULL);
+    TEST_ASSERT_GREATER_THAN(sent / 2, shed);
+}
+
+TEST_CASE(test_overload_sampling_unbiased_across_sources) {
+    overload_init(16);
+    uint64_t now = 0;
+
+    overload_update(0, 0, now);
+    for (int i = 1; i <= 4; i++) {
+        overload_update(i, 0, now += OVERLOAD_TICK_NS);
+    }
+
+    /* Many light sources: none is shed as a whole, and the total is kept */
+    const uint32_t sources = 1024;
+    const uint32_t per_source = 64;
+    uint64_t scaled = 0;
+    uint32_t seen = 0;
+    for (uint32_t s = 0; s < sources; s++) {
+        uint32_t ip = htonl(0xC6336400 + s);
+        uint64_t count = 0;
+        for (uint32_t i = 0; i < per_source; i++) {
+            count += overload_sample(ip);
+        }
+        scaled += count;
+        seen += count != 0;
+    }
+
+    uint64_t sent = (uint64_t)sources * per_source;
+    TEST_ASSERT_GREATER_THAN(sent * 9 / 10, scaled);
+    TEST_ASSERT_LESS_THAN(sent * 11 / 10, scaled);
+    TEST_ASSERT_GREATER_THAN(sources * 9 / 10, seen);
+}
+
+TEST_CASE(test_overload_tick_due) {
+    overload_init(8);
+
+    TEST_ASSERT_TRUE(overload_tick_due(0));
+    overload_update(0, 0, 1000);
+    TEST_ASSERT_FALSE(overload_tick_due(1000 + OVERLOAD_TICK_NS - 1));
+    TEST_ASSERT_TRUE(overload_tick_due(1000 + OVERLOAD_TICK_NS));
+}
+
+TEST_CASE(test_overload_invalid_max_disables) {
+    overload_init(12);  /* Not a power of 2 */
+    overload_update(0, 0, 0);
+    TEST_ASSERT_FALSE(overload_update(50, 0, OVERLOAD_TICK_NS));
+    TEST_ASSERT_EQUAL_UINT32(1, overload_sample(inet_addr("10.0.0.1")));
+}
+
+int main(void) {
+    UnityBegin("test_overload.c");
+
+    RUN_TEST(test_overload_disabled_admits_everything);
+    RUN_TEST(test_overload_doubles_on_drops);
+    RUN_TEST(test_overload_backlog_growth_is_pressure);
+    RUN_TEST(test_overload_recovers_after_calm_ticks);
+    RUN_TEST(test_overload_sampling_preserves_scaled_counts);
+    RUN_TEST(test_overload_sampling_unbiased_across_sources);
+    RUN_TEST(test_overload_tick_due);
+    RUN_TEST(test_overload_invalid_max_disables);
+
+    return UnityEnd();
+}
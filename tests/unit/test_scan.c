@@ -0,0 +1,153 @@
+/*
+ * test_scan.c - Unit tests for per-source port scan detection
+ */
+
+#include "../unity/unity.h"
+#include "../../include/common.h"
+#include "../../src/analysis/scan.h"
+#include <arpa/inet.h>
+#include <string.h>
+
+static synflood_config_t config;
+
+static void setup(size_t entries) {
+    memset(&config, 0, sizeof(config));
+    config.scan_port_threshold = 100;
+    config.scan_host_threshold = 50;
+    config.scan_window_s = 10;
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, scan_init(entries));
+}
+
+/* First port (1-based count) at which the source is flagged, 0 if never */
+static uint32_t ports_until_flagged(uint32_t src, uint32_t dst, uint32_t max_ports, uint64_t now) {
+    for (uint32_t port = 1; port <= max_ports; port++) {
+        if (scan_record(src, dst, (uint16_t)port, now, &config)) {
+            return port;
+        }
+    }
+    return 0;
+}
+
+TEST_CASE(test_scan_init_rejects_bad_size) {
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, scan_init(0));
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, scan_init(100));
+    scan_cleanup();
+}
+
+TEST_CASE(test_scan_estimate_tracks_distinct_count) {
+    TEST_ASSERT_EQUAL_UINT32(0, scan_estimate(0));
+    TEST_ASSERT_EQUAL_UINT32(1, scan_estimate(1));
+
+    /* Sketch saturation caps the estimate */
+    TEST_ASSERT_TRUE(scan_estimate(SCAN_SKETCH_BITS) >= 2 * SCAN_MAX_THRESHOLD);
+
+    for (uint32_t bits = 1; bits < SCAN_SKETCH_BITS; bits++) {
+        TEST_ASSERT_TRUE(scan_estimate(bits) >= bits);
+        TEST_ASSERT_TRUE(scan_estimate(bits + 1) >= scan_estimate(bits));
+    }
+}
+
+TEST_CASE(test_scan_vertical_threshold) {
+    setup(64);
+    uint32_t src = inet_addr("198.51.100.1");
+    uint32_t dst = inet_addr("192.0.2.10");
+    uint64_t now = sec_to_ns(100);
+
+    /* A sequential port sweep is flagged close to the threshold */
+    uint32_t flagged_at = ports_until_flagged(src, dst, 1000, now);
+    TEST_ASSERT_TRUE(flagged_at > 90);
+    TEST_ASSERT_TRUE(flagged_at < 115);
+
+    /* Repeated SYNs to the same port never add up */
+    uint32_t client = inet_addr("198.51.100.2");
+    for (int i = 0; i < 5000; i++) {
+        TEST_ASSERT_FALSE(scan_record(client, dst, 443, now, &config));
+    }
+
+    uint64_t detected[SCAN_KIND_COUNT];
+    scan_get_counts(NULL, detected);
+    TEST_ASSERT_EQUAL_UINT64(1, detected[SCAN_VERTICAL]);
+    TEST_ASSERT_EQUAL_UINT64(0, detected[SCAN_HORIZONTAL]);
+
+    scan_cleanup();
+}
+
+TEST_CASE(test_scan_horizontal_threshold) {
+    setup(64);
+    config.scan_port_threshold = 0;
+    uint32_t src = inet_addr("198.51.100.3");
+    uint64_t now = sec_to_ns(100);
+
+    /* One port across a /24 and beyond */
+    bool flagged = false;
+    uint32_t hosts = 0;
+    while (!flagged && hosts < 1000) {
+        hosts++;
+        flagged = scan_record(src, htonl(0xC0000200 + hosts), 22, now, &config);
+    }
+    TEST_ASSERT_TRUE(flagged);
+    TEST_ASSERT_TRUE(hosts > 45 && hosts < 60);
+
+    uint64_t detected[SCAN_KIND_COUNT];
+    scan_get_counts(NULL, detected);
+    TEST_ASSERT_EQUAL_UINT64(0, detected[SCAN_VERTICAL]);
+    TEST_ASSERT_EQUAL_UINT64(1, detected[SCAN_HORIZONTAL]);
+
+    scan_cleanup();
+}
+
+TEST_CASE(test_scan_window_resets) {
+    setup(64);
+    uint32_t src = inet_addr("198.51.100.4");
+    uint32_t dst = inet_addr("192.0.2.10");
+    uint64_t now = sec_to_ns(100);
+
+    /* 80 ports per window stays below 100 */
+    for (int w = 0; w < 5; w++) {
+        uint64_t start = now + sec_to_ns(11) * (uint64_t)w;
+        TEST_ASSERT_EQUAL_UINT32(0, ports_until_flagged(src, dst, 80, start));
+    }
+
+    /* A flagged source stays flagged for the rest of its window only */
+    TEST_ASSERT_TRUE(ports_until_flagged(src, dst, 1000, now + sec_to_ns(100)) > 0);
+    TEST_ASSERT_TRUE(scan_record(src, dst, 1, now + sec_to_ns(105), &config));
+    TEST_ASSERT_FALSE(scan_record(src, dst, 1, now + sec_to_ns(111), &config));
+
+    scan_cleanup();
+}
+
+TEST_CASE(test_scan_table_keeps_flagged_sources) {
+    setup(8);
+    uint32_t dst = inet_addr("192.0.2.10");
+    uint64_t now = sec_to_ns(100);
+
+    uint32_t scanner = inet_addr("203.0.113.1");
+    TEST_ASSERT_TRUE(ports_until_flagged(scanner, dst, 1000, now) > 0);
+
+    /* Thousands of other sources cycle through the small table */
+    for (uint32_t i = 0; i < 5000; i++) {
+        scan_record(htonl(0x0A000000 + i), dst, 80, now + i, &config);
+    }
+
+    size_t tracked;
+    scan_get_counts(&tracked, NULL);
+    TEST_ASSERT_EQUAL_INT(8, tracked);
+
+    /* The scanner was not recycled: still flagged without another sweep */
+    TEST_ASSERT_TRUE(scan_record(scanner, dst, 1, now + sec_to_ns(1), &config));
+
+    scan_cleanup();
+}
+
+int main(void) {
+    UnityBegin("test_scan.c");
+
+    RUN_TEST(test_scan_init_rejects_bad_size);
+    RUN_TEST(test_scan_estimate_tracks_distinct_count);
+    RUN_TEST(test_scan_vertical_threshold);
+    RUN_TEST(test_scan_horizontal_threshold);
+    RUN_TEST(test_scan_window_resets);
+    RUN_TEST(test_scan_table_keeps_flagged_sources);
+
+    return UnityEnd();
+}
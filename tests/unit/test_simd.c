@@ -0,0 +1,125 @@
+/*
+ * test_simd.c - Unit tests for CPU-dispatched kernels
+ *
+ * Every level the CPU supports must give the same results as scalar code.
+ */
+
+#include "../unity/unity.h"
+#include "../../include/common.h"
+#include "../../src/analysis/simd.h"
+#include <arpa/inet.h>
+#include <string.h>
+
+static const simd_level_t levels[] = { SIMD_LEVEL_SCALAR, SIMD_LEVEL_SSE42, SIMD_LEVEL_AVX2 };
+#define LEVEL_COUNT (sizeof(levels) / sizeof(levels[0]))
+
+TEST_CASE(test_simd_init_selects_supported_level) {
+    simd_level_t level = simd_init();
+
+    TEST_ASSERT_TRUE(simd_level_supported(level));
+    TEST_ASSERT_EQUAL(level, simd_get_level());
+    TEST_ASSERT_TRUE(simd_level_supported(SIMD_LEVEL_SCALAR));
+    TEST_ASSERT_EQUAL_STRING("scalar", simd_level_name(SIMD_LEVEL_SCALAR));
+}
+
+TEST_CASE(test_simd_hash_batch_matches_ip_hash) {
+    uint32_t ips[37];  /* Not a multiple of any vector width */
+    uint32_t out[37];
+    for (uint32_t i = 0; i < 37; i++) {
+        ips[i] = htonl(0xC0A80000 + i * 7919);
+    }
+
+    for (size_t l = 0; l < LEVEL_COUNT; l++) {
+        if (simd_set_level(levels[l]) != SYNFLOOD_OK) {
+            continue;
+        }
+        memset(out, 0xFF, sizeof(out));
+        simd_hash_batch(ips, out, 37, 4096);
+        for (size_t i = 0; i < 37; i++) {
+            TEST_ASSERT_EQUAL_UINT32(ip_hash(ips[i], 4096), out[i]);
+        }
+    }
+}
+
+TEST_CASE(test_simd_find_u32_positions) {
+    uint32_t keys[21];
+    for (uint32_t i = 0; i < 21; i++) {
+        keys[i] = 1000 + i;
+    }
+    keys[17] = 1003;  /* Duplicate: first occurrence wins */
+
+    for (size_t l = 0; l < LEVEL_COUNT; l++) {
+        if (simd_set_level(levels[l]) != SYNFLOOD_OK) {
+            continue;
+        }
+        TEST_ASSERT_EQUAL_INT(0, simd_find_u32(keys, 21, 1000));
+        TEST_ASSERT_EQUAL_INT(3, simd_find_u32(keys, 21, 1003));
+        TEST_ASSERT_EQUAL_INT(20, simd_find_u32(keys, 21, 1020));  /* Tail */
+        TEST_ASSERT_EQUAL_INT(21, simd_find_u32(keys, 21, 42));
+        TEST_ASSERT_EQUAL_INT(0, simd_find_u32(keys, 0, 1000));
+    }
+}
+
+TEST_CASE(test_simd_cidr_any) {
+    uint32_t prefixes[11], masks[11];
+    for (uint32_t i = 0; i < 11; i++) {
+        masks[i] = htonl(0xFFFFFF00);
+        prefixes[i] = htonl(0x0A000000 + (i << 8));  /* 10.0.i.0/24 */
+    }
+
+    for (size_t l = 0; l < LEVEL_COUNT; l++) {
+        if (simd_set_level(levels[l]) != SYNFLOOD_OK) {
+            continue;
+        }
+        TEST_ASSERT_TRUE(simd_cidr_any(prefixes, masks, 11, inet_addr("10.0.0.1")));
+        TEST_ASSERT_TRUE(simd_cidr_any(prefixes, masks, 11, inet_addr("10.0.10.200")));
+        TEST_ASSERT_FALSE(simd_cidr_any(prefixes, masks, 11, inet_addr("10.0.11.1")));
+        TEST_ASSERT_FALSE(simd_cidr_any(prefixes, masks, 0, inet_addr("10.0.0.1")));
+    }
+}
+
+TEST_CASE(test_simd_hex8) {
+    const char *valid[] = { "0100007F", "c0a80101", "FFFFFFFF", "00000000", "DeadBeef" };
+    const uint32_t expected[] = { 0x0100007F, 0xC0A80101, 0xFFFFFFFF, 0, 0xDEADBEEF };
+    const char *invalid[] = { "0100007G", "C0A8:101", "0100007F" + 1, "12 45678", "\x80" "1234567" };
+
+    for (size_t l = 0; l < LEVEL_COUNT; l++) {
+        if (simd_set_level(levels[l]) != SYNFLOOD_OK) {
+            continue;
+        }
+        for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); i++) {
+            uint32_t value = 0;
+            TEST_ASSERT_TRUE(simd_hex8(valid[i], &value));
+            TEST_ASSERT_EQUAL_UINT32(expected[i], value);
+        }
+        for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+            char buf[16] = {0};
+            uint32_t value;
+            strncpy(buf, invalid[i], sizeof(buf) - 1);
+            TEST_ASSERT_FALSE(simd_hex8(buf, &value));
+        }
+    }
+}
+
+TEST_CASE(test_simd_unsupported_level_rejected) {
+    simd_set_level(SIMD_LEVEL_SCALAR);
+
+    if (!simd_level_supported(SIMD_LEVEL_AVX2)) {
+        TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, simd_set_level(SIMD_LEVEL_AVX2));
+        TEST_ASSERT_EQUAL(SIMD_LEVEL_SCALAR, simd_get_level());
+    }
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, simd_set_level((simd_level_t)7));
+}
+
+int main(void) {
+    UnityBegin("test_simd.c");
+
+    RUN_TEST(test_simd_init_selects_supported_level);
+    RUN_TEST(test_simd_hash_batch_matches_ip_hash);
+    RUN_TEST(test_simd_find_u32_positions);
+    RUN_TEST(test_simd_cidr_any);
+    RUN_TEST(test_simd_hex8);
+    RUN_TEST(test_simd_unsupported_level_rejected);
+
+    return UnityEnd();
+}
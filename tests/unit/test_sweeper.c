@@ -0,0 +1,114 @@
+/*
+ * test_sweeper.c - Unit tests for the tracker sweeper
+ */
+
+#include "../unity/unity.h"
+#include "../../include/common.h"
+#include "../../src/analysis/sweeper.h"
+#include "../../src/analysis/tracker.h"
+#include "../../src/clock.h"
+#include <arpa/inet.h>
+
+static clock_virtual_t vclock;
+
+/* Tick for the given simulated time */
+static size_t run_ticks(tracker_table_t *table, uint32_t idle_timeout_s, uint64_t duration_ns) {
+    size_t freed = 0;
+    for (uint64_t t = 0; t < duration_ns; t += ms_to_ns(SWEEPER_TICK_MS)) {
+        clock_virtual_advance(&vclock, ms_to_ns(SWEEPER_TICK_MS));
+        freed += sweeper_tick(table, idle_timeout_s);
+    }
+    return freed;
+}
+
+TEST_CASE(test_sweeper_frees_idle_entries) {
+    clock_virtual_start(&vclock, sec_to_ns(1000));
+    tracker_table_t *table = tracker_create(1024, 100000);
+
+    /* A flood from 5000 sources, one of them blocked */
+    for (uint32_t i = 0; i < 5000; i++) {
+        tracker_get_or_create(table, htonl(0xC6120000 + i));
+    }
+    ip_tracker_t *blocked = tracker_get(table, htonl(0xC6120000));
+    blocked->blocked = 1;
+    blocked->block_expiry_ns = get_monotonic_ns() + sec_to_ns(3600);
+
+    /* One source keeps sending */
+    uint32_t active = inet_addr("192.0.2.1");
+    for (int s = 0; s < 40; s++) {
+        tracker_get_or_create(table, active);
+        run_ticks(table, 10, sec_to_ns(1));
+    }
+
+    /* Idle for 40s with a 10s timeout: only the live sources remain */
+    size_t entry_count;
+    tracker_get_stats(table, &entry_count, NULL);
+    TEST_ASSERT_EQUAL_INT(2, entry_count);
+    TEST_ASSERT_NOT_NULL(tracker_get(table, active));
+    TEST_ASSERT_NOT_NULL(tracker_get(table, htonl(0xC6120000)));
+    TEST_ASSERT_NULL(tracker_get(table, htonl(0xC6120001)));
+
+    tracker_destroy(table);
+    clock_install(NULL);
+}
+
+TEST_CASE(test_sweeper_slice_is_bounded) {
+    clock_virtual_start(&vclock, sec_to_ns(1000));
+    tracker_table_t *table = tracker_create(1024, 100000);
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        tracker_get_or_create(table, htonl(0xC6120000 + i));
+    }
+    clock_virtual_advance(&vclock, sec_to_ns(20));
+
+    /* 10s timeout: the table is covered every 5s, 50 ticks of 21 buckets */
+    sweeper_stats_t before, after;
+    sweeper_get_stats(&before);
+    size_t freed = sweeper_tick(table, 10);
+    sweeper_get_stats(&after);
+
+    TEST_ASSERT_EQUAL_UINT64(21, after.buckets_total - before.buckets_total);
+    TEST_ASSERT_EQUAL_UINT64(freed, after.freed_total - before.freed_total);
+    TEST_ASSERT_TRUE(freed < 1000);
+
+    freed += run_ticks(table, 10, sec_to_ns(5));
+    TEST_ASSERT_EQUAL_INT(1000, freed);
+
+    tracker_destroy(table);
+    clock_install(NULL);
+}
+
+TEST_CASE(test_sweeper_disabled_only_reclaims_cleared) {
+    clock_virtual_start(&vclock, sec_to_ns(1000));
+    tracker_table_t *table = tracker_create(1024, 100000);
+
+    for (uint32_t i = 0; i < 100; i++) {
+        tracker_get_or_create(table, htonl(0xC6120000 + i));
+    }
+    clock_virtual_advance(&vclock, sec_to_ns(3600));
+
+    /* No timeout: idle entries stay and a tick does nothing */
+    sweeper_stats_t before, after;
+    sweeper_get_stats(&before);
+    TEST_ASSERT_EQUAL_INT(0, sweeper_tick(table, 0));
+    sweeper_get_stats(&after);
+    TEST_ASSERT_EQUAL_UINT64(before.ticks_total, after.ticks_total);
+
+    /* Cleared entries are still reclaimed */
+    tracker_clear(table);
+    TEST_ASSERT_EQUAL_INT(100, sweeper_tick(table, 0));
+    TEST_ASSERT_FALSE(tracker_sweep_pending(table));
+
+    tracker_destroy(table);
+    clock_install(NULL);
+}
+
+int main(void) {
+    UnityBegin("test_sweeper.c");
+
+    RUN_TEST(test_sweeper_frees_idle_entries);
+    RUN_TEST(test_sweeper_slice_is_bounded);
+    RUN_TEST(test_sweeper_disabled_only_reclaims_cleared);
+
+    return UnityEnd();
+}
@@ -5,6 +5,7 @@
 #include "../unity/unity.h"
 #include "../../include/common.h"
 #include "../../src/analysis/tracker.h"
+#include "../../src/clock.h"
 #include <arpa/inet.h>
 
 TEST_CASE(test_tracker_create_destroy) {
@@ -167,6 +168,114 @@ TEST_CASE(test_tracker_clear) {
     tracker_destroy(table);
 }
 
+TEST_CASE(test_tracker_clear_lazy_reclaim) {
+    tracker_table_t *table = tracker_create(16, 10000);
+    uint32_t ip1 = inet_addr("192.168.1.1");
+    uint32_t ip2 = inet_addr("192.168.1.2");
+
+    for (uint32_t i = 0; i < 100; i++) {
+        ip_tracker_t *t = tracker_get_or_create(table, htonl(0x0A000000 + i));
+        t->blocked = 1;
+        t->block_expiry_ns = 1;
+    }
+    tracker_get_or_create(table, ip1)->syn_count = 42;
+
+    tracker_clear(table);
+    TEST_ASSERT_TRUE(tracker_sweep_pending(table));
+
+    /* Cleared entries are gone at once, before any memory is freed */
+    uint32_t expired[8];
+    size_t entry_count, blocked_count;
+    tracker_get_stats(table, &entry_count, &blocked_count);
+    TEST_ASSERT_EQUAL_INT(0, entry_count);
+    TEST_ASSERT_EQUAL_INT(0, blocked_count);
+    TEST_ASSERT_NULL(tracker_get(table, ip1));
+    TEST_ASSERT_EQUAL_INT(0, tracker_get_expired_blocks(table, UINT64_MAX, expired, 8));
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_ENOTFOUND, tracker_remove(table, htonl(0x0A000001)));
+
+    /* Seen again: a fresh entry */
+    ip_tracker_t *t = tracker_get_or_create(table, ip1);
+    TEST_ASSERT_EQUAL_UINT32(0, t->syn_count);
+    tracker_get_or_create(table, ip2);
+
+    /* The sweep frees what lookups did not, a few buckets at a time */
+    size_t freed = 0;
+    while (tracker_sweep_pending(table)) {
+        freed += tracker_sweep(table, 4);
+    }
+    TEST_ASSERT_EQUAL_INT(99, freed);
+    TEST_ASSERT_EQUAL_INT(0, table->stale_count);
+
+    tracker_get_stats(table, &entry_count, NULL);
+    TEST_ASSERT_EQUAL_INT(2, entry_count);
+    TEST_ASSERT_NOT_NULL(tracker_get(table, ip1));
+    TEST_ASSERT_NOT_NULL(tracker_get(table, ip2));
+
+    tracker_destroy(table);
+}
+
+TEST_CASE(test_tracker_clear_older) {
+    clock_virtual_t clock;
+    clock_virtual_start(&clock, sec_to_ns(1000));
+
+    tracker_table_t *table = tracker_create(64, 10000);
+    uint32_t idle = inet_addr("192.168.1.1");
+    uint32_t active = inet_addr("192.168.1.2");
+
+    tracker_get_or_create(table, idle);
+    tracker_get_or_create(table, active);
+
+    clock_virtual_advance(&clock, sec_to_ns(60));
+    tracker_get_or_create(table, active);
+    clock_virtual_advance(&clock, sec_to_ns(1));
+
+    /* Everything idle for 30 seconds goes */
+    tracker_clear_older(table, get_monotonic_ns() - sec_to_ns(30));
+    TEST_ASSERT_NULL(tracker_get(table, idle));
+    TEST_ASSERT_NOT_NULL(tracker_get(table, active));
+
+    while (tracker_sweep_pending(table)) {
+        tracker_sweep(table, TRACKER_SWEEP_SCAN);
+    }
+
+    size_t entry_count;
+    tracker_get_stats(table, &entry_count, NULL);
+    TEST_ASSERT_EQUAL_INT(1, entry_count);
+
+    /* New entries are not affected by the earlier cutoff */
+    tracker_get_or_create(table, idle);
+    TEST_ASSERT_NOT_NULL(tracker_get(table, idle));
+
+    tracker_destroy(table);
+    clock_install(NULL);
+}
+
+TEST_CASE(test_tracker_clear_reclaims_before_evicting) {
+    tracker_table_t *table = tracker_create(16, 4);
+
+    for (uint32_t i = 0; i < 4; i++) {
+        tracker_get_or_create(table, htonl(0x0A000000 + i));
+    }
+    tracker_clear(table);
+
+    /* The table refills to max_entries without evicting live entries */
+    for (uint32_t i = 0; i < 4; i++) {
+        tracker_get_or_create(table, htonl(0x0B000000 + i));
+    }
+    for (uint32_t i = 0; i < 4; i++) {
+        TEST_ASSERT_NOT_NULL(tracker_get(table, htonl(0x0B000000 + i)));
+    }
+
+    /* Over the limit: the LRU scan reclaims every cleared node, then evicts */
+    tracker_get_or_create(table, htonl(0x0C000000));
+    size_t entry_count;
+    tracker_get_stats(table, &entry_count, NULL);
+    TEST_ASSERT_EQUAL_INT(4, entry_count);
+    TEST_ASSERT_EQUAL_INT(0, table->stale_count);
+
+    tracker_destroy(table);
+}
+
 TEST_CASE(test_tracker_expired_blocks) {
     tracker_table_t *table = tracker_create(1024, 10000);
 
@@ -199,6 +308,113 @@ TEST_CASE(test_tracker_expired_blocks) {
     tracker_destroy(table);
 }
 
+TEST_CASE(test_tracker_get_batch) {
+    tracker_table_t *table = tracker_create(16, 1000);
+
+    /* More IPs than one batch chunk, with misses interleaved */
+    uint32_t ips[150];
+    ip_tracker_t *entries[150];
+    for (uint32_t i = 0; i < 150; i++) {
+        ips[i] = htonl(0x0A000000 + i);
+        if (i % 3 != 0) {
+            tracker_get_or_create(table, ips[i]);
+        }
+    }
+
+    TEST_ASSERT_EQUAL_INT(100, tracker_get_batch(table, ips, 150, entries));
+    for (uint32_t i = 0; i < 150; i++) {
+        TEST_ASSERT_TRUE(entries[i] == tracker_get(table, ips[i]));
+    }
+
+    tracker_destroy(table);
+}
+
+TEST_CASE(test_tracker_dump_chunk) {
+    /* Few buckets: long chains force resuming in the middle of one */
+    tracker_table_t *table = tracker_create(4, 1000);
+
+    for (uint32_t i = 0; i < 100; i++) {
+        ip_tracker_t *t = tracker_get_or_create(table, htonl(0x0A000000 + i));
+        t->syn_count = i;
+        t->blocked = (i % 10 == 0);
+    }
+    tracker_get_or_create(table, inet_addr("192.168.1.1"))->syn_count = 500;
+
+    /* Unfiltered walk in chunks of 7 sees every entry exactly once */
+    tracker_cursor_t cursor = {0};
+    ip_tracker_t out[7];
+    bool seen[100] = {false};
+    size_t total = 0;
+    while (!cursor.done) {
+        size_t n = tracker_dump_chunk(table, &cursor, NULL, out, ARRAY_SIZE(out));
+        for (size_t i = 0; i < n; i++) {
+            uint32_t host = ntohl(out[i].ip_addr);
+            if ((host & 0xFF000000) == 0x0A000000) {
+                TEST_ASSERT_FALSE(seen[host & 0xFF]);
+                seen[host & 0xFF] = true;
+            }
+        }
+        total += n;
+    }
+    TEST_ASSERT_EQUAL_INT(101, total);
+
+    /* Prefix, rate and blocked filters combine */
+    tracker_filter_t filter = {
+        .prefix = inet_addr("10.0.0.0"),
+        .prefix_mask = inet_addr("255.0.0.0"),
+        .min_syn_count = 50,
+        .blocked = TRACKER_MATCH_BLOCKED,
+    };
+    memset(&cursor, 0, sizeof(cursor));
+    total = 0;
+    while (!cursor.done) {
+        size_t n = tracker_dump_chunk(table, &cursor, &filter, out, ARRAY_SIZE(out));
+        for (size_t i = 0; i < n; i++) {
+            TEST_ASSERT_TRUE(out[i].blocked);
+            TEST_ASSERT_TRUE(out[i].syn_count >= 50);
+        }
+        total += n;
+    }
+    TEST_ASSERT_EQUAL_INT(5, total); /* 50, 60, 70, 80, 90 */
+
+    tracker_destroy(table);
+}
+
+TEST_CASE(test_tracker_dump_chunk_survives_inserts) {
+    /* One bucket: every chunk resumes in the middle of the chain */
+    tracker_table_t *table = tracker_create(1, 1000);
+
+    for (uint32_t i = 0; i < 50; i++) {
+        tracker_get_or_create(table, htonl(0x0A000000 + i * 2));
+    }
+
+    tracker_cursor_t cursor = {0};
+    ip_tracker_t out[8];
+    uint8_t seen[100] = {0};
+    uint32_t inserted = 0;
+    while (!cursor.done) {
+        size_t n = tracker_dump_chunk(table, &cursor, NULL, out, ARRAY_SIZE(out));
+        for (size_t i = 0; i < n; i++) {
+            seen[ntohl(out[i].ip_addr) & 0xFF]++;
+        }
+
+        /* Head insertions between chunks must not shift the resume point */
+        if (inserted < 10) {
+            tracker_get_or_create(table, htonl(0x0A000000 + inserted * 2 + 1));
+            inserted++;
+        }
+    }
+
+    for (uint32_t i = 0; i < 100; i++) {
+        TEST_ASSERT_TRUE(seen[i] <= 1);
+        if (i % 2 == 0) {
+            TEST_ASSERT_EQUAL_INT(1, seen[i]);
+        }
+    }
+
+    tracker_destroy(table);
+}
+
 int main(void) {
     UnityBegin("test_tracker.c");
 
@@ -210,7 +426,13 @@ int main(void) {
     RUN_TEST(test_tracker_syn_count);
     RUN_TEST(test_tracker_blocked_flag);
     RUN_TEST(test_tracker_clear);
+    RUN_TEST(test_tracker_clear_lazy_reclaim);
+    RUN_TEST(test_tracker_clear_older);
+    RUN_TEST(test_tracker_clear_reclaims_before_evicting);
     RUN_TEST(test_tracker_expired_blocks);
+    RUN_TEST(test_tracker_get_batch);
+    RUN_TEST(test_tracker_dump_chunk);
+    RUN_TEST(test_tracker_dump_chunk_survives_inserts);
 
     return UnityEnd();
 }
@@ -0,0 +1,334 @@
+/*
+ * test_tracker_shared.c - Unit tests for the shared-memory tracker backend
+ */
+
+#include "../unity/unity.h"
+#include "../../include/common.h"
+#include "../../src/analysis/tracker.h"
+#include "../../src/analysis/whitelist.h"
+#include "../../src/clock.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static char shm_name[64];
+static clock_virtual_t vclock;
+
+static void setup(void) {
+    snprintf(shm_name, sizeof(shm_name), "/synflood_test_%d", (int)getpid());
+    tracker_shared_unlink(shm_name);
+}
+
+static void teardown(void) {
+    tracker_shared_unlink(shm_name);
+}
+
+TEST_CASE(test_shared_tracker_basic_operations) {
+    setup();
+    tracker_table_t *table = tracker_create_shared(shm_name, 1000);
+    TEST_ASSERT_NOT_NULL(table);
+
+    uint32_t ip = inet_addr("192.0.2.1");
+    ip_tracker_t *entry = tracker_get_or_create(table, ip);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_UINT32(ip, entry->ip_addr);
+    TEST_ASSERT_EQUAL_UINT32(0, entry->syn_count);
+    TEST_ASSERT_TRUE(entry == tracker_get_or_create(table, ip));
+    TEST_ASSERT_TRUE(entry == tracker_get(table, ip));
+
+    size_t count;
+    tracker_get_stats(table, &count, NULL);
+    TEST_ASSERT_EQUAL_INT(1, count);
+
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, tracker_remove(table, ip));
+    TEST_ASSERT_NULL(tracker_get(table, ip));
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_ENOTFOUND, tracker_remove(table, ip));
+
+    tracker_destroy(table);
+    teardown();
+}
+
+TEST_CASE(test_shared_tracker_visible_across_mappings) {
+    setup();
+    tracker_table_t *a = tracker_create_shared(shm_name, 1000);
+    tracker_table_t *b = tracker_create_shared(shm_name, 1000);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+
+    uint32_t ip = inet_addr("192.0.2.2");
+    ip_tracker_t *entry_a = tracker_get_or_create(a, ip);
+    entry_a->syn_count = 42;
+
+    /* Different mapping address, same entry */
+    ip_tracker_t *entry_b = tracker_get(b, ip);
+    TEST_ASSERT_NOT_NULL(entry_b);
+    TEST_ASSERT_TRUE(entry_a != entry_b);
+    TEST_ASSERT_EQUAL_UINT32(42, entry_b->syn_count);
+
+    /* Geometry must match */
+    TEST_ASSERT_NULL(tracker_create_shared(shm_name, 5000));
+
+    tracker_destroy(a);
+    tracker_destroy(b);
+    teardown();
+}
+
+TEST_CASE(test_shared_tracker_bounded_eviction) {
+    setup();
+    tracker_table_t *table = tracker_create_shared(shm_name, 100);
+    TEST_ASSERT_NOT_NULL(table);
+
+    /* 50 inserts per second: older entries are past the eviction grace period */
+    clock_virtual_start(&vclock, sec_to_ns(1000));
+    for (uint32_t i = 1; i <= 5000; i++) {
+        clock_virtual_advance(&vclock, ms_to_ns(20));
+        TEST_ASSERT_NOT_NULL(tracker_get_or_create(table, htonl(0x0A000000 + i)));
+    }
+
+    size_t count;
+    tracker_get_stats(table, &count, NULL);
+    TEST_ASSERT_TRUE(count <= 100);
+
+    /* Most recent insert is always present */
+    TEST_ASSERT_NOT_NULL(tracker_get(table, htonl(0x0A000000 + 5000)));
+
+    /* Entries seen within the grace period are never evicted: the table
+     * goes over capacity, then refuses sources it has no idle slot for */
+    size_t refused = 0;
+    for (uint32_t i = 1; i <= 1000; i++) {
+        if (!tracker_get_or_create(table, htonl(0x0B000000 + i))) {
+            refused++;
+        }
+    }
+    TEST_ASSERT_TRUE(refused > 0);
+    TEST_ASSERT_NOT_NULL(tracker_get(table, htonl(0x0A000000 + 5000)));
+    for (uint32_t i = 4951; i <= 5000; i++) {
+        TEST_ASSERT_NOT_NULL(tracker_get(table, htonl(0x0A000000 + i)));
+    }
+
+    clock_install(NULL);
+    tracker_destroy(table);
+    teardown();
+}
+
+TEST_CASE(test_shared_tracker_processes_aggregate) {
+    setup();
+    tracker_table_t *table = tracker_create_shared(shm_name, 4096);
+    TEST_ASSERT_NOT_NULL(table);
+
+    /* Four processes insert the same 1000 sources and count one SYN each */
+    pid_t children[4];
+    for (int c = 0; c < 4; c++) {
+        children[c] = fork();
+        if (children[c] == 0) {
+            tracker_table_t *own = tracker_create_shared(shm_name, 4096);
+            if (!own) {
+                _exit(1);
+            }
+            for (uint32_t i = 1; i <= 1000; i++) {
+                ip_tracker_t *entry = tracker_get_or_create(own, htonl(0xC6120000 + i));
+                if (!entry) {
+                    _exit(1);
+                }
+                __atomic_add_fetch(&entry->syn_count, 1, __ATOMIC_RELAXED);
+            }
+            _exit(0);
+        }
+    }
+
+    for (int c = 0; c < 4; c++) {
+        int status;
+        waitpid(children[c], &status, 0);
+        TEST_ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    /* No duplicates, no lost updates */
+    size_t count;
+    tracker_get_stats(table, &count, NULL);
+    TEST_ASSERT_EQUAL_INT(1000, count);
+    for (uint32_t i = 1; i <= 1000; i++) {
+        ip_tracker_t *entry = tracker_get(table, htonl(0xC6120000 + i));
+        TEST_ASSERT_NOT_NULL(entry);
+        TEST_ASSERT_EQUAL_UINT32(4, entry->syn_count);
+    }
+
+    tracker_destroy(table);
+    teardown();
+}
+
+TEST_CASE(test_shared_tracker_survives_killed_writers) {
+    setup();
+    tracker_table_t *table = tracker_create_shared(shm_name, 256);
+    TEST_ASSERT_NOT_NULL(table);
+
+    /* Writers churning the table are killed at random points, possibly
+     * while holding a stripe lock */
+    for (int round = 0; round < 20; round++) {
+        pid_t child = fork();
+        if (child == 0) {
+            tracker_table_t *own = tracker_create_shared(shm_name, 256);
+            for (uint32_t i = 1; own; i++) {
+                tracker_get_or_create(own, htonl(0xCB000000 + (i & 0xFFFF) + 1));
+                tracker_remove(own, htonl(0xCB000000 + ((i * 7) & 0xFFFF) + 1));
+            }
+            _exit(0);
+        }
+        usleep(2000);
+        kill(child, SIGKILL);
+        waitpid(child, NULL, 0);
+    }
+
+    /* Every stripe is usable again (once the writers' entries are idle) */
+    clock_virtual_start(&vclock, get_monotonic_ns() + sec_to_ns(2));
+    for (uint32_t i = 1; i <= 256; i++) {
+        TEST_ASSERT_NOT_NULL(tracker_get_or_create(table, htonl(0xC0A80000 + i)));
+    }
+    TEST_ASSERT_NOT_NULL(tracker_get(table, htonl(0xC0A80000 + 256)));
+
+    /* Clearing takes every stripe lock, repairing any left by a dead writer */
+    size_t count;
+    tracker_clear(table);
+    tracker_get_stats(table, &count, NULL);
+    TEST_ASSERT_EQUAL_INT(0, count);
+
+    clock_install(NULL);
+    tracker_destroy(table);
+    teardown();
+}
+
+TEST_CASE(test_shared_tracker_eviction_spares_entries_in_use) {
+    setup();
+    tracker_table_t *table = tracker_create_shared(shm_name, 64);
+    TEST_ASSERT_NOT_NULL(table);
+
+    /* An entry this process holds, like the engine while processing a packet */
+    uint32_t held_ip = inet_addr("192.0.2.77");
+    ip_tracker_t *held = tracker_get_or_create(table, held_ip);
+    TEST_ASSERT_NOT_NULL(held);
+
+    /* Another process floods the full table with new sources */
+    pid_t child = fork();
+    if (child == 0) {
+        tracker_table_t *own = tracker_create_shared(shm_name, 64);
+        for (uint32_t i = 1; own && i <= 20000; i++) {
+            ip_tracker_t *entry = tracker_get_or_create(own, htonl(0x0A000000 + i));
+            if (entry) {
+                __atomic_add_fetch(&entry->syn_count, 1, __ATOMIC_RELAXED);
+            }
+        }
+        _exit(own ? 0 : 1);
+    }
+
+    /* Meanwhile entries looked up here keep their IP while in use */
+    uint32_t ip = inet_addr("198.51.100.0");
+    size_t misplaced = 0;
+    int status;
+    while (waitpid(child, &status, WNOHANG) == 0) {
+        ip = htonl(ntohl(ip) + 1);
+        ip_tracker_t *entry = tracker_get_or_create(table, ip);
+        if (entry) {
+            __atomic_add_fetch(&entry->syn_count, 1, __ATOMIC_RELAXED);
+            if (__atomic_load_n(&entry->ip_addr, __ATOMIC_ACQUIRE) != ip) {
+                misplaced++;
+            }
+        }
+        held->syn_count++;
+    }
+    TEST_ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    TEST_ASSERT_EQUAL_INT(0, misplaced);
+
+    /* The held entry was never handed to another source */
+    TEST_ASSERT_EQUAL_UINT32(held_ip, held->ip_addr);
+    TEST_ASSERT_TRUE(held == tracker_get(table, held_ip));
+
+    tracker_destroy(table);
+    teardown();
+}
+
+TEST_CASE(test_shared_tracker_dump_chunk) {
+    setup();
+    tracker_table_t *table = tracker_create_shared(shm_name, 4096);
+    TEST_ASSERT_NOT_NULL(table);
+
+    for (uint32_t i = 0; i < 3000; i++) {
+        tracker_get_or_create(table, htonl(0xC6336400 + i))->blocked = (i < 30);
+    }
+
+    tracker_filter_t filter = { .blocked = TRACKER_MATCH_BLOCKED };
+    tracker_cursor_t cursor = {0};
+    ip_tracker_t out[64];
+    size_t total = 0;
+    size_t calls = 0;
+    while (!cursor.done) {
+        total += tracker_dump_chunk(table, &cursor, &filter, out, ARRAY_SIZE(out));
+        calls++;
+    }
+
+    TEST_ASSERT_EQUAL_INT(30, total);
+    TEST_ASSERT_TRUE(calls > 1); /* The slot array is walked in pieces */
+
+    tracker_destroy(table);
+    teardown();
+}
+
+TEST_CASE(test_shared_tracker_generations_shared) {
+    setup();
+    tracker_table_t *a = tracker_create_shared(shm_name, 1000);
+    tracker_table_t *b = tracker_create_shared(shm_name, 1000);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+
+    TEST_ASSERT_EQUAL_UINT32(1, *a->whitelist_gen);
+    TEST_ASSERT_EQUAL_UINT32(1, *b->asnmap_gen);
+
+    /* A reload in one process invalidates verdicts cached by all of them */
+    whitelist_node_t *root = NULL;
+    whitelist_replace(&root, NULL, a->whitelist_gen);
+    TEST_ASSERT_EQUAL_UINT32(2, *b->whitelist_gen);
+    TEST_ASSERT_EQUAL_UINT32(1, *b->asnmap_gen);
+
+    tracker_destroy(a);
+    tracker_destroy(b);
+    teardown();
+}
+
+TEST_CASE(test_shared_tracker_reinitializes_abandoned_segment) {
+    setup();
+
+    /* A creator that died after sizing the segment never wrote the magic */
+    int fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL_INT(0, ftruncate(fd, 4096));
+    close(fd);
+
+    tracker_table_t *table = tracker_create_shared(shm_name, 1000);
+    TEST_ASSERT_NOT_NULL(table);
+
+    uint32_t ip = inet_addr("192.0.2.9");
+    TEST_ASSERT_NOT_NULL(tracker_get_or_create(table, ip));
+    TEST_ASSERT_EQUAL_UINT32(1, *table->whitelist_gen);
+
+    tracker_destroy(table);
+    teardown();
+}
+
+int main(void) {
+    UnityBegin("test_tracker_shared.c");
+
+    RUN_TEST(test_shared_tracker_basic_operations);
+    RUN_TEST(test_shared_tracker_visible_across_mappings);
+    RUN_TEST(test_shared_tracker_bounded_eviction);
+    RUN_TEST(test_shared_tracker_processes_aggregate);
+    RUN_TEST(test_shared_tracker_survives_killed_writers);
+    RUN_TEST(test_shared_tracker_eviction_spares_entries_in_use);
+    RUN_TEST(test_shared_tracker_dump_chunk);
+    RUN_TEST(test_shared_tracker_generations_shared);
+    RUN_TEST(test_shared_tracker_reinitializes_abandoned_segment);
+
+    return UnityEnd();
+}
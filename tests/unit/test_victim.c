@@ -0,0 +1,112 @@
+/*
+ * test_victim.c - Unit tests for the per-destination (victim) rate table
+ */
+
+#include "../unity/unity.h"
+#include "../../include/common.h"
+#include "../../src/analysis/victim.h"
+#include <arpa/inet.h>
+#include <string.h>
+
+static synflood_config_t config;
+
+static void setup(size_t entries) {
+    memset(&config, 0, sizeof(config));
+    config.window_ms = 1000;
+    config.victim_threshold = 100;
+    config.victim_hold_s = 5;
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, victim_init(entries));
+}
+
+TEST_CASE(test_victim_init_rejects_bad_size) {
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, victim_init(0));
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, victim_init(100));
+    victim_cleanup();
+}
+
+TEST_CASE(test_victim_attack_starts_and_holds) {
+    setup(64);
+    uint32_t dst = inet_addr("192.0.2.10");
+    uint64_t now = sec_to_ns(100);
+
+    /* Threshold is exclusive, like syn_threshold */
+    TEST_ASSERT_FALSE(victim_record(dst, 80, 100, now, &config));
+    TEST_ASSERT_TRUE(victim_record(dst, 80, 1, now + 1, &config));
+
+    /* Another port on the same address is a different victim */
+    TEST_ASSERT_FALSE(victim_record(dst, 443, 1, now + 2, &config));
+
+    /* Quiet windows keep the attack state until the hold time passes */
+    TEST_ASSERT_TRUE(victim_record(dst, 80, 1, now + sec_to_ns(2), &config));
+    TEST_ASSERT_FALSE(victim_record(dst, 80, 1, now + sec_to_ns(6), &config));
+
+    uint64_t attacks;
+    victim_get_counts(NULL, NULL, &attacks, now);
+    TEST_ASSERT_EQUAL_UINT64(1, attacks);
+
+    victim_cleanup();
+}
+
+TEST_CASE(test_victim_top_sorted_by_rate) {
+    setup(64);
+    uint64_t now = sec_to_ns(100);
+
+    /* Complete one window per destination with different rates */
+    for (uint16_t port = 1; port <= 5; port++) {
+        victim_record(inet_addr("192.0.2.20"), port, port * 10, now, &config);
+        victim_record(inet_addr("192.0.2.20"), port, 1, now + sec_to_ns(2), &config);
+    }
+    victim_record(inet_addr("192.0.2.30"), 80, 500, now + sec_to_ns(2), &config);
+
+    victim_stats_t top[3];
+    size_t n = victim_get_top(top, 3, now + sec_to_ns(2));
+    TEST_ASSERT_EQUAL_INT(3, n);
+
+    /* Attacked destination first, then by completed-window rate */
+    TEST_ASSERT_TRUE(top[0].under_attack);
+    TEST_ASSERT_EQUAL_UINT32(80, top[0].dst_port);
+    TEST_ASSERT_EQUAL_UINT32(5, top[1].dst_port);
+    TEST_ASSERT_EQUAL_UINT32(50, top[1].syn_rate);
+    TEST_ASSERT_EQUAL_UINT32(4, top[2].dst_port);
+
+    size_t tracked;
+    victim_get_counts(&tracked, NULL, NULL, now + sec_to_ns(2));
+    TEST_ASSERT_EQUAL_INT(6, tracked);
+
+    victim_cleanup();
+}
+
+TEST_CASE(test_victim_table_stays_bounded) {
+    setup(16);
+    uint64_t now = sec_to_ns(100);
+
+    /* Port scan across thousands of destinations recycles idle slots */
+    for (uint32_t i = 0; i < 5000; i++) {
+        victim_record(htonl(0xC0000200 + (i & 0xFF)), (uint16_t)i, 1, now + i, &config);
+    }
+
+    size_t tracked;
+    victim_get_counts(&tracked, NULL, NULL, now);
+    TEST_ASSERT_TRUE(tracked <= 16);
+
+    /* An attacked destination is never recycled */
+    uint32_t vip = inet_addr("203.0.113.1");
+    TEST_ASSERT_TRUE(victim_record(vip, 80, 200, now + 10000, &config));
+    for (uint32_t i = 0; i < 5000; i++) {
+        victim_record(htonl(0xC6336400 + (i & 0xFF)), (uint16_t)i, 1, now + 20000 + i, &config);
+    }
+    TEST_ASSERT_TRUE(victim_record(vip, 80, 1, now + 30000, &config));
+
+    victim_cleanup();
+}
+
+int main(void) {
+    UnityBegin("test_victim.c");
+
+    RUN_TEST(test_victim_init_rejects_bad_size);
+    RUN_TEST(test_victim_attack_starts_and_holds);
+    RUN_TEST(test_victim_top_sorted_by_rate);
+    RUN_TEST(test_victim_table_stays_bounded);
+
+    return UnityEnd();
+}
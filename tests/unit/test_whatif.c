@@ -0,0 +1,154 @@
+/*
+ * test_whatif.c - Unit tests for the what-if replay
+ */
+
+#include "../unity/unity.h"
+#include "../../include/common.h"
+#include "../../src/analysis/whatif.h"
+#include "../../src/analysis/whitelist.h"
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include <string.h>
+
+static whatif_packet_t packets[20000];
+static size_t packet_count;
+
+static void add(uint64_t ms, const char *ip, uint8_t kind) {
+    packets[packet_count++] = (whatif_packet_t){
+        .ts_ns = ms_to_ns(ms), .src_ip = inet_addr(ip), .kind = kind };
+}
+
+static whatif_config_t config(uint32_t threshold, uint32_t window_ms, uint32_t block_s) {
+    whatif_config_t c = { .syn_threshold = threshold, .window_ms = window_ms,
+                          .block_duration_s = block_s };
+    snprintf(c.name, sizeof(c.name), "t%u", threshold);
+    return c;
+}
+
+/* 10s: a flood source at 100 SYN/s, a client at 5 SYN/s that completes
+ * handshakes, a busy client at 60 SYN/s that also completes them */
+static void build_capture(void) {
+    packet_count = 0;
+    for (uint64_t ms = 0; ms < 10000; ms += 10) {
+        add(ms, "198.51.100.7", WHATIF_SYN);
+        if (ms % 200 == 0) {
+            add(ms, "192.0.2.1", WHATIF_SYN);
+            add(ms + 1, "192.0.2.1", WHATIF_HANDSHAKE);
+        }
+        if (ms % 20 == 0 && ms % 60 != 0) {
+            add(ms, "192.0.2.2", WHATIF_SYN);
+            add(ms + 1, "192.0.2.2", WHATIF_HANDSHAKE);
+        }
+    }
+}
+
+TEST_CASE(test_whatif_thresholds) {
+    build_capture();
+    whatif_config_t configs[] = { config(10, 1000, 300), config(50, 1000, 300),
+                                  config(200, 1000, 300) };
+    whatif_result_t results[3];
+    whatif_summary_t summary;
+
+    TEST_ASSERT_EQUAL(SYNFLOOD_OK, whatif_replay(configs, 3, packets, packet_count, NULL, 1,
+                                                 results, &summary));
+
+    TEST_ASSERT_EQUAL_UINT64(3, summary.sources_total);
+    TEST_ASSERT_EQUAL_UINT64(2, summary.handshake_sources);
+
+    /* Low threshold catches both busy sources, one of them a real client */
+    TEST_ASSERT_EQUAL_UINT64(2, results[0].blocked_sources);
+    TEST_ASSERT_EQUAL_UINT64(1, results[0].est_false_positives);
+
+    /* Middle threshold catches only the flood, within its first second */
+    TEST_ASSERT_EQUAL_UINT64(1, results[1].blocked_sources);
+    TEST_ASSERT_EQUAL_UINT64(0, results[1].est_false_positives);
+    TEST_ASSERT_EQUAL_UINT64(500, results[1].first_block_ms);
+    TEST_ASSERT_EQUAL_UINT64(500, results[1].detect_ms_max);
+
+    /* The flood sends under 200 SYN per window */
+    TEST_ASSERT_EQUAL_UINT64(0, results[2].blocked_sources);
+    TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, results[2].first_block_ms);
+}
+
+TEST_CASE(test_whatif_block_expiry) {
+    build_capture();
+    whatif_config_t configs[] = { config(50, 1000, 2), config(50, 1000, 300) };
+    whatif_result_t results[2];
+
+    TEST_ASSERT_EQUAL(SYNFLOOD_OK, whatif_replay(configs, 2, packets, packet_count, NULL, 1,
+                                                 results, NULL));
+
+    /* A long block drops everything after detection; a short one lets the
+     * source back in to be caught again */
+    TEST_ASSERT_EQUAL_UINT64(1, results[1].blocks_total);
+    TEST_ASSERT_EQUAL_UINT64(1000 - 51, results[1].syns_dropped);
+    TEST_ASSERT_TRUE(results[0].blocks_total > 1);
+    TEST_ASSERT_EQUAL_UINT64(1, results[0].blocked_sources);
+    TEST_ASSERT_TRUE(results[0].syns_dropped < results[1].syns_dropped);
+}
+
+TEST_CASE(test_whatif_whitelist) {
+    build_capture();
+    whitelist_node_t *whitelist = NULL;
+    TEST_ASSERT_EQUAL(SYNFLOOD_OK, whitelist_add(&whitelist, "198.51.100.0/24"));
+
+    whatif_config_t configs[] = { config(50, 1000, 300) };
+    whatif_result_t results[1];
+    whatif_summary_t summary;
+
+    TEST_ASSERT_EQUAL(SYNFLOOD_OK, whatif_replay(configs, 1, packets, packet_count, whitelist, 1,
+                                                 results, &summary));
+    TEST_ASSERT_EQUAL_UINT64(0, results[0].blocked_sources);
+    TEST_ASSERT_EQUAL_UINT64(1000, summary.whitelisted_syns);
+    TEST_ASSERT_EQUAL_UINT64(2, summary.sources_total);
+
+    whitelist_free(whitelist);
+}
+
+TEST_CASE(test_whatif_threads_match) {
+    /* Many sources so every shard has work */
+    packet_count = 0;
+    char ip[32];
+    for (uint64_t ms = 0; ms < 4000; ms++) {
+        uint32_t host = (uint32_t)(ms * 7919 % 40);
+        snprintf(ip, sizeof(ip), "10.0.%u.1", host);
+        add(ms, ip, (ms % 5 == 0) ? WHATIF_HANDSHAKE : WHATIF_SYN);
+    }
+
+    whatif_config_t configs[] = { config(5, 500, 1), config(20, 1000, 2), config(40, 2000, 60) };
+    whatif_result_t single[3], parallel[3];
+    whatif_summary_t s1, s4;
+
+    TEST_ASSERT_EQUAL(SYNFLOOD_OK, whatif_replay(configs, 3, packets, packet_count, NULL, 1,
+                                                 single, &s1));
+    TEST_ASSERT_EQUAL(SYNFLOOD_OK, whatif_replay(configs, 3, packets, packet_count, NULL, 4,
+                                                 parallel, &s4));
+
+    TEST_ASSERT_TRUE(single[0].blocked_sources > 0);
+    TEST_ASSERT_TRUE(memcmp(single, parallel, sizeof(single)) == 0);
+    TEST_ASSERT_TRUE(memcmp(&s1, &s4, sizeof(s1)) == 0);
+}
+
+TEST_CASE(test_whatif_invalid) {
+    whatif_config_t configs[1] = { config(10, 1000, 300) };
+    whatif_result_t results[1];
+
+    TEST_ASSERT_EQUAL(SYNFLOOD_EINVAL, whatif_replay(configs, 0, packets, 1, NULL, 1,
+                                                     results, NULL));
+    TEST_ASSERT_EQUAL(SYNFLOOD_EINVAL, whatif_replay(configs, WHATIF_MAX_CONFIGS + 1, packets,
+                                                     1, NULL, 1, results, NULL));
+    TEST_ASSERT_EQUAL(SYNFLOOD_OK, whatif_replay(configs, 1, NULL, 0, NULL, 1, results, NULL));
+    TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, results[0].first_block_ms);
+}
+
+int main(void) {
+    UnityBegin("test_whatif.c");
+
+    RUN_TEST(test_whatif_thresholds);
+    RUN_TEST(test_whatif_block_expiry);
+    RUN_TEST(test_whatif_whitelist);
+    RUN_TEST(test_whatif_threads_match);
+    RUN_TEST(test_whatif_invalid);
+
+    return UnityEnd();
+}
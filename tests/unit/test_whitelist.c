@@ -7,6 +7,7 @@
 #include "../../src/analysis/whitelist.h"
 #include <arpa/inet.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -129,6 +130,164 @@ TEST_CASE(test_whitelist_empty) {
     TEST_ASSERT_FALSE(whitelist_check(root, inet_addr("10.0.0.1")));
 }
 
+TEST_CASE(test_whitelist_check_batch) {
+    whitelist_node_t *root = NULL;
+    whitelist_add(&root, "192.168.1.0/24");
+    whitelist_add(&root, "10.0.0.0/8");
+    whitelist_add(&root, "172.16.5.5");
+
+    whitelist_flat_t *flat = whitelist_flatten(root);
+    TEST_ASSERT_NOT_NULL(flat);
+    TEST_ASSERT_EQUAL_INT(3, flat->count);
+
+    uint32_t ips[] = {
+        inet_addr("192.168.1.7"), inet_addr("192.168.2.7"), inet_addr("10.20.30.40"),
+        inet_addr("172.16.5.5"), inet_addr("172.16.5.6"), inet_addr("8.8.8.8"),
+    };
+    bool verdicts[6];
+
+    TEST_ASSERT_EQUAL_INT(3, whitelist_check_batch(flat, ips, 6, verdicts));
+    for (size_t i = 0; i < 6; i++) {
+        TEST_ASSERT_EQUAL(whitelist_check(root, ips[i]), verdicts[i]);
+    }
+
+    whitelist_flat_free(flat);
+    whitelist_free(root);
+}
+
+/* In-order walk: prefixes must be strictly increasing */
+static bool whitelist_ordered(whitelist_node_t *node, uint32_t *last, bool *first) {
+    if (!node) {
+        return true;
+    }
+    if (!whitelist_ordered(node->left, last, first)) {
+        return false;
+    }
+    if (!*first && node->prefix <= *last) {
+        return false;
+    }
+    *first = false;
+    *last = node->prefix;
+    return whitelist_ordered(node->right, last, first);
+}
+
+TEST_CASE(test_whitelist_live_edit) {
+    whitelist_node_t *root = NULL;
+    volatile uint32_t gen = 5;
+
+    whitelist_add(&root, "10.0.0.0/8");
+    whitelist_add(&root, "192.168.1.0/24");
+    whitelist_add(&root, "172.16.0.0/12");
+    whitelist_node_t *before = root;
+
+    /* Readers holding the old root keep seeing the old tree */
+    whitelist_reader_online();
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, whitelist_insert(&root, inet_addr("203.0.113.7"), 24, &gen));
+    TEST_ASSERT_TRUE(root != before);
+    TEST_ASSERT_EQUAL_UINT32(6, gen);
+    TEST_ASSERT_TRUE(whitelist_check(root, inet_addr("203.0.113.200")));
+    TEST_ASSERT_FALSE(whitelist_check(before, inet_addr("203.0.113.200")));
+    TEST_ASSERT_TRUE(whitelist_check(before, inet_addr("10.1.2.3")));
+    TEST_ASSERT_TRUE(whitelist_contains(root, inet_addr("203.0.113.0"), 24));
+    TEST_ASSERT_EQUAL_INT(4, whitelist_count(root));
+
+    /* Present already: nothing published */
+    whitelist_node_t *current = root;
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, whitelist_insert(&root, inet_addr("203.0.113.0"), 24, &gen));
+    TEST_ASSERT_TRUE(root == current);
+    TEST_ASSERT_EQUAL_UINT32(6, gen);
+
+    /* Same network, other length: replaced */
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, whitelist_insert(&root, inet_addr("10.0.0.0"), 16, &gen));
+    TEST_ASSERT_FALSE(whitelist_check(root, inet_addr("10.1.2.3")));
+    TEST_ASSERT_TRUE(whitelist_check(root, inet_addr("10.0.2.3")));
+    TEST_ASSERT_EQUAL_INT(4, whitelist_count(root));
+
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_ENOTFOUND, whitelist_remove(&root, inet_addr("10.0.0.0"), 8, &gen));
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, whitelist_remove(&root, inet_addr("10.0.0.0"), 16, &gen));
+    TEST_ASSERT_FALSE(whitelist_check(root, inet_addr("10.0.2.3")));
+    TEST_ASSERT_TRUE(whitelist_check(root, inet_addr("172.20.0.1")));
+    TEST_ASSERT_EQUAL_INT(3, whitelist_count(root));
+    TEST_ASSERT_EQUAL_UINT32(8, gen);
+
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_EINVAL, whitelist_insert(&root, 0, 33, &gen));
+
+    whitelist_reader_offline();
+    whitelist_free(root);
+    whitelist_reclaim(true);
+}
+
+TEST_CASE(test_whitelist_reclaim_waits_for_readers) {
+    whitelist_node_t *root = NULL;
+    whitelist_add(&root, "10.0.0.0/8");
+    whitelist_reclaim(true);
+
+    whitelist_reader_online();
+    whitelist_node_t *held = __atomic_load_n(&root, __ATOMIC_ACQUIRE);
+
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, whitelist_insert(&root, inet_addr("192.0.2.0"), 24, NULL));
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, whitelist_remove(&root, inet_addr("10.0.0.0"), 8, NULL));
+    TEST_ASSERT_EQUAL_INT(2, whitelist_retired_count());
+
+    /* Still online and not quiescent since the edits: nothing may go */
+    whitelist_reclaim(false);
+    TEST_ASSERT_EQUAL_INT(2, whitelist_retired_count());
+    TEST_ASSERT_TRUE(whitelist_check(held, inet_addr("10.1.2.3")));
+
+    whitelist_quiescent();
+    whitelist_reclaim(false);
+    TEST_ASSERT_EQUAL_INT(0, whitelist_retired_count());
+
+    /* Offline readers do not hold anything up */
+    TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, whitelist_insert(&root, inet_addr("198.51.100.0"), 24, NULL));
+    whitelist_reader_online(); /* Nested */
+    whitelist_reader_offline();
+    TEST_ASSERT_EQUAL_INT(1, whitelist_retired_count());
+    whitelist_reader_offline();
+    whitelist_reclaim(false);
+    TEST_ASSERT_EQUAL_INT(0, whitelist_retired_count());
+
+    whitelist_free(root);
+}
+
+TEST_CASE(test_whitelist_live_edit_matches_reference) {
+    whitelist_node_t *root = NULL;
+    bool present[64] = {false};
+    size_t expected = 0;
+
+    srand(1234);
+    for (int op = 0; op < 2000; op++) {
+        size_t i = (size_t)rand() % ARRAY_SIZE(present);
+        uint32_t prefix = htonl(0x0A000000U | ((uint32_t)i << 8));
+
+        if (rand() % 2) {
+            TEST_ASSERT_EQUAL_INT(SYNFLOOD_OK, whitelist_insert(&root, prefix, 24, NULL));
+            expected += present[i] ? 0 : 1;
+            present[i] = true;
+        } else {
+            TEST_ASSERT_EQUAL_INT(present[i] ? SYNFLOOD_OK : SYNFLOOD_ENOTFOUND,
+                                  whitelist_remove(&root, prefix, 24, NULL));
+            expected -= present[i] ? 1 : 0;
+            present[i] = false;
+        }
+
+        TEST_ASSERT_EQUAL_INT(expected, whitelist_count(root));
+        TEST_ASSERT_EQUAL(present[i], whitelist_check(root, prefix | htonl(1)));
+
+        uint32_t last = 0;
+        bool first = true;
+        TEST_ASSERT_TRUE(whitelist_ordered(root, &last, &first));
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(present); i++) {
+        uint32_t prefix = htonl(0x0A000000U | ((uint32_t)i << 8));
+        TEST_ASSERT_EQUAL(present[i], whitelist_contains(root, prefix, 24));
+    }
+
+    whitelist_free(root);
+    whitelist_reclaim(true);
+}
+
 int main(void) {
     UnityBegin("test_whitelist.c");
 
@@ -138,6 +297,10 @@ int main(void) {
     RUN_TEST(test_whitelist_load_file);
     RUN_TEST(test_whitelist_count);
     RUN_TEST(test_whitelist_empty);
+    RUN_TEST(test_whitelist_check_batch);
+    RUN_TEST(test_whitelist_live_edit);
+    RUN_TEST(test_whitelist_reclaim_waits_for_readers);
+    RUN_TEST(test_whitelist_live_edit_matches_reference);
 
     return UnityEnd();
 }
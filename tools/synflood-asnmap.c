@@ -0,0 +1,116 @@
+/*
+ * synflood-asnmap.c - Build and query prefix to origin AS maps
+ * TCP SYN Flood Detector
+ *
+ * Converts a text routing table snapshot (pyasn-style "PREFIX ASN" lines
+ * or "bgpdump -m" output of a RIB dump) into the mapped lookup file read
+ * by the daemon's asn_map_file setting (see src/analysis/asnmap.h), and
+ * looks addresses up in an existing file.
+ */
+
+#include "common.h"
+#include "../src/analysis/asnmap.h"
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EXIT_USAGE 2
+
+static void print_usage(const char *prog_name) {
+    fprintf(stderr,
+            "Usage: %s -o MAP SNAPSHOT\n"
+            "       %s -l MAP ADDRESS...\n"
+            "\n"
+            "Builds the prefix to origin AS map used by asn_map_file, or looks up\n"
+            "addresses in one.\n"
+            "\n"
+            "SNAPSHOT holds one IPv4 route per line, either \"PREFIX/LEN ASN\" (as\n"
+            "written by pyasn_util_convert.py; \"AS13335\", \"13335_209242\" and\n"
+            "\"{64512,64513}\" take the first AS) or \"bgpdump -m\" output, whose AS\n"
+            "path ends in the origin. IPv6 routes and comments are skipped. The\n"
+            "more specific prefix wins; among duplicates, the last line.\n"
+            "\n"
+            "Options:\n"
+            "  -o, --output MAP    Write the map built from SNAPSHOT (replaced atomically,\n"
+            "                      reload the daemon afterwards)\n"
+            "  -l, --lookup MAP    Print the origin AS of each ADDRESS (0 = not routed)\n"
+            "  -h, --help          Show this help message\n"
+            "  -v, --version       Show version information\n",
+            prog_name, prog_name);
+}
+
+static int lookup(const char *map_path, char **addresses, int count) {
+    asnmap_t *map = asnmap_open(map_path);
+    if (!map) {
+        return EXIT_FAILURE;
+    }
+
+    int ret = EXIT_SUCCESS;
+    for (int i = 0; i < count; i++) {
+        struct in_addr addr;
+        if (inet_pton(AF_INET, addresses[i], &addr) != 1) {
+            fprintf(stderr, "Invalid IPv4 address: %s\n", addresses[i]);
+            ret = EXIT_USAGE;
+            continue;
+        }
+        printf("%s %u\n", addresses[i], asnmap_lookup(map, addr.s_addr));
+    }
+
+    asnmap_close(map);
+    return ret;
+}
+
+int main(int argc, char *argv[]) {
+    const char *output = NULL;
+    const char *map_path = NULL;
+    int opt;
+
+    static struct option long_options[] = {
+        {"output",  required_argument, 0, 'o'},
+        {"lookup",  required_argument, 0, 'l'},
+        {"help",    no_argument,       0, 'h'},
+        {"version", no_argument,       0, 'v'},
+        {0, 0, 0, 0}
+    };
+
+    while ((opt = getopt_long(argc, argv, "o:l:hv", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'o':
+                output = optarg;
+                break;
+            case 'l':
+                map_path = optarg;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            case 'v':
+                printf("synflood-asnmap v%s\n", SYNFLOOD_VERSION);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_USAGE;
+        }
+    }
+
+    if (map_path && !output && optind < argc) {
+        return lookup(map_path, &argv[optind], argc - optind);
+    }
+
+    if (!output || map_path || optind != argc - 1) {
+        print_usage(argv[0]);
+        return EXIT_USAGE;
+    }
+
+    size_t prefixes, ranges;
+    synflood_ret_t ret = asnmap_build(argv[optind], output, &prefixes, &ranges);
+    if (ret != SYNFLOOD_OK) {
+        fprintf(stderr, "Cannot build %s from %s (%d)\n", output, argv[optind], ret);
+        return EXIT_FAILURE;
+    }
+
+    printf("%s: %zu prefixes, %zu ranges\n", output, prefixes, ranges);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,245 @@
+/*
+ * synflood-ctl-native.c - Compiled control client for monitoring and scripting
+ * TCP SYN Flood Detector
+ *
+ * Talks the binary control protocol (src/observe/ctlproto.h) straight to
+ * the daemon's socket: one connect, one request, one response. Meant for
+ * frequent polling where spawning the synflood-ctl shell script and its
+ * socat/ipset/journalctl helpers costs too much.
+ */
+
+#include "common.h"
+#include "../src/observe/ctlproto.h"
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Exit codes */
+#define EXIT_DAEMON_ERROR 1 /* Daemon answered with a non-OK status */
+#define EXIT_USAGE        2
+#define EXIT_UNREACHABLE  3 /* No answer from the socket */
+
+#define DEFAULT_TIMEOUT_MS 2000
+
+static void print_usage(const char *prog_name) {
+    fprintf(stderr,
+            "Usage: %s [OPTIONS] COMMAND [ARGS]\n"
+            "\n"
+            "Commands:\n"
+            "  status                       Counters, one \"name value\" per line\n"
+            "  top [N]                      N busiest sources (default %d, max %d)\n"
+            "  block IP [SECONDS]           Block a source (default: configured duration)\n"
+            "  unblock IP                   Unblock a source\n"
+            "  whitelist add|remove CIDR    Edit the live whitelist (saved to its file)\n"
+            "  reload                       Reload configuration and whitelist\n"
+            "\n"
+            "Options:\n"
+            "  -s, --socket PATH    Control socket (default: %s)\n"
+            "  -t, --timeout MS     Give up after MS milliseconds (default: %d)\n"
+            "  -h, --help           Show this help message\n"
+            "  -v, --version        Show version information\n"
+            "\n"
+            "Exit status: 0 ok, 1 daemon refused or failed, 2 usage, 3 daemon unreachable\n",
+            prog_name, CTL_TOP_DEFAULT, CTL_TOP_MAX, DEFAULT_METRICS_SOCKET, DEFAULT_TIMEOUT_MS);
+}
+
+static bool parse_ip(const char *text, uint32_t *ip_addr) {
+    struct in_addr addr;
+    if (inet_pton(AF_INET, text, &addr) != 1) {
+        return false;
+    }
+    *ip_addr = addr.s_addr;
+    return true;
+}
+
+static bool parse_cidr(const char *text, uint32_t *prefix, uint8_t *prefix_len) {
+    char buf[INET_ADDRSTRLEN + 4];
+    if (strlen(text) >= sizeof(buf)) {
+        return false;
+    }
+    strcpy(buf, text);
+
+    unsigned long bits = 32;
+    char *slash = strchr(buf, '/');
+    if (slash) {
+        char *end;
+        *slash = '\0';
+        bits = strtoul(slash + 1, &end, 10);
+        if (end == slash + 1 || *end != '\0' || bits > 32) {
+            return false;
+        }
+    }
+
+    *prefix_len = (uint8_t)bits;
+    return parse_ip(buf, prefix);
+}
+
+static bool parse_u32(const char *text, uint32_t *out) {
+    char *end;
+    unsigned long v = strtoul(text, &end, 10);
+    if (end == text || *end != '\0' || v > UINT32_MAX) {
+        return false;
+    }
+    *out = (uint32_t)v;
+    return true;
+}
+
+static void print_status(const uint8_t *payload, size_t len) {
+    ctl_status_t s;
+    ctl_decode_status(payload, len, &s);
+
+    printf("uptime_s %lu\n", s.uptime_s);
+    printf("packets_total %lu\n", s.packets_total);
+    printf("syn_packets_total %lu\n", s.syn_packets_total);
+    printf("detections_total %lu\n", s.detections_total);
+    printf("whitelist_hits_total %lu\n", s.whitelist_hits_total);
+    printf("capture_drops_total %lu\n", s.capture_drops_total);
+    printf("blocked_current %lu\n", s.blocked_current);
+    printf("tracker_entries %lu\n", s.tracker_entries);
+    printf("tracker_blocked %lu\n", s.tracker_blocked);
+    printf("whitelist_gen %u\n", s.whitelist_gen);
+    printf("sample_rate %u\n", s.sample_rate);
+}
+
+static void print_top(const uint8_t *payload, size_t len) {
+    printf("%-16s %10s %8s %14s\n", "SOURCE", "SYNS", "BLOCKED", "BLOCK_LEFT_S");
+
+    for (size_t off = 0; off + CTL_TOP_ENTRY_LEN <= len; off += CTL_TOP_ENTRY_LEN) {
+        ctl_top_entry_t e;
+        ctl_decode_top_entry(payload + off, &e);
+
+        char ip_str[INET_ADDRSTRLEN];
+        struct in_addr addr = { .s_addr = e.ip_addr };
+        inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+
+        printf("%-16s %10u %8s %14u\n", ip_str, e.syn_count, e.blocked ? "yes" : "no",
+               e.block_remaining_ms / 1000);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *socket_path = DEFAULT_METRICS_SOCKET;
+    int timeout_ms = DEFAULT_TIMEOUT_MS;
+    int opt;
+
+    static struct option long_options[] = {
+        {"socket",  required_argument, 0, 's'},
+        {"timeout", required_argument, 0, 't'},
+        {"help",    no_argument,       0, 'h'},
+        {"version", no_argument,       0, 'v'},
+        {0, 0, 0, 0}
+    };
+
+    while ((opt = getopt_long(argc, argv, "+s:t:hv", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                socket_path = optarg;
+                break;
+            case 't':
+                timeout_ms = atoi(optarg);
+                if (timeout_ms <= 0) {
+                    timeout_ms = DEFAULT_TIMEOUT_MS;
+                }
+                break;
+            case 'v':
+                printf("synflood-ctl-native v%s (protocol %d)\n", SYNFLOOD_VERSION, CTL_VERSION);
+                return EXIT_SUCCESS;
+            case 'h':
+            default:
+                print_usage(argv[0]);
+                return (opt == 'h') ? EXIT_SUCCESS : EXIT_USAGE;
+        }
+    }
+
+    if (optind >= argc) {
+        print_usage(argv[0]);
+        return EXIT_USAGE;
+    }
+
+    const char *cmd = argv[optind];
+    int nargs = argc - optind - 1;
+    char **args = argv + optind + 1;
+
+    uint8_t op;
+    uint8_t req[CTL_MAX_REQUEST];
+    size_t req_len = 0;
+    bool ok = true;
+
+    if (strcmp(cmd, "status") == 0) {
+        op = CTL_OP_STATUS;
+    } else if (strcmp(cmd, "top") == 0) {
+        uint32_t n = CTL_TOP_DEFAULT;
+        op = CTL_OP_TOP;
+        ok = nargs == 0 || (parse_u32(args[0], &n) && n > 0 && n <= CTL_TOP_MAX);
+        ctl_put_be16(req, (uint16_t)n);
+        req_len = 2;
+    } else if (strcmp(cmd, "block") == 0) {
+        uint32_t ip_addr = 0;
+        uint32_t duration_s = 0;
+        op = CTL_OP_BLOCK;
+        ok = (nargs == 1 || nargs == 2) && parse_ip(args[0], &ip_addr) &&
+             (nargs == 1 || parse_u32(args[1], &duration_s));
+        memcpy(req, &ip_addr, 4);
+        ctl_put_be32(req + 4, duration_s);
+        req_len = 8;
+    } else if (strcmp(cmd, "unblock") == 0) {
+        uint32_t ip_addr = 0;
+        op = CTL_OP_UNBLOCK;
+        ok = nargs == 1 && parse_ip(args[0], &ip_addr);
+        memcpy(req, &ip_addr, 4);
+        req_len = 4;
+    } else if (strcmp(cmd, "whitelist") == 0) {
+        uint32_t prefix = 0;
+        uint8_t prefix_len = 0;
+        ok = nargs == 2 && parse_cidr(args[1], &prefix, &prefix_len);
+        if (ok && strcmp(args[0], "add") == 0) {
+            op = CTL_OP_WHITELIST_ADD;
+        } else if (ok && strcmp(args[0], "remove") == 0) {
+            op = CTL_OP_WHITELIST_REMOVE;
+        } else {
+            op = 0;
+            ok = false;
+        }
+        memcpy(req, &prefix, 4);
+        req[4] = prefix_len;
+        req_len = 5;
+    } else if (strcmp(cmd, "reload") == 0) {
+        op = CTL_OP_RELOAD;
+    } else {
+        op = 0;
+        ok = false;
+    }
+
+    if (!ok) {
+        print_usage(argv[0]);
+        return EXIT_USAGE;
+    }
+
+    static uint8_t resp[CTL_MAX_RESPONSE];
+    ctl_header_t hdr;
+    if (ctl_call(socket_path, op, req, req_len, timeout_ms, &hdr, resp, sizeof(resp)) !=
+        SYNFLOOD_OK) {
+        fprintf(stderr, "No response from %s\n", socket_path);
+        return EXIT_UNREACHABLE;
+    }
+
+    if (hdr.status != CTL_STATUS_OK) {
+        if (hdr.status == CTL_STATUS_VERSION && hdr.length >= 1) {
+            fprintf(stderr, "Daemon speaks protocol version %u, this client %u\n",
+                    resp[0], CTL_VERSION);
+        } else {
+            fprintf(stderr, "%s: %s\n", cmd, ctl_status_name(hdr.status));
+        }
+        return EXIT_DAEMON_ERROR;
+    }
+
+    if (op == CTL_OP_STATUS) {
+        print_status(resp, hdr.length);
+    } else if (op == CTL_OP_TOP) {
+        print_top(resp, hdr.length);
+    }
+
+    return EXIT_SUCCESS;
+}
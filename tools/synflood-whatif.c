@@ -0,0 +1,461 @@
+/*
+ * synflood-whatif.c - Compare detection settings on recorded traffic
+ * TCP SYN Flood Detector
+ *
+ * Reads a pcap capture (tcpdump -w) and replays its TCP SYNs through the
+ * detection rule under many threshold/window/block settings at once (see
+ * src/analysis/whatif.h), then prints per setting how fast sources were
+ * blocked, how many, how much of the SYN traffic that stopped, and how many
+ * blocked sources look like real clients because they also completed
+ * handshakes.
+ */
+
+#include "common.h"
+#include "../src/analysis/whatif.h"
+#include "../src/analysis/whitelist.h"
+#include "../src/config/config.h"
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define EXIT_USAGE 2
+
+#define PCAP_MAGIC_US 0xA1B2C3D4u
+#define PCAP_MAGIC_NS 0xA1B23C4Du
+
+#define LINKTYPE_ETHERNET   1
+#define LINKTYPE_RAW        101
+#define LINKTYPE_LINUX_SLL  113
+#define LINKTYPE_IPV4       228
+#define LINKTYPE_LINUX_SLL2 276
+
+#define TCP_FLAG_SYN 0x02
+#define TCP_FLAG_RST 0x04
+#define TCP_FLAG_ACK 0x10
+
+/* Grid used when no settings are given */
+static const uint32_t default_thresholds[] = { 20, 50, 100, 200, 500 };
+static const uint32_t default_windows[] = { 500, 1000, 2000 };
+
+typedef struct
+{
+    whatif_packet_t *packets;
+    size_t count;
+    size_t cap;
+    uint64_t frames;      /* Records in the file */
+    uint64_t skipped;     /* Not IPv4 TCP, or truncated */
+} capture_t;
+
+static void print_usage(const char *prog_name) {
+    fprintf(stderr,
+            "Usage: %s [OPTIONS] CAPTURE.pcap\n"
+            "\n"
+            "Replays the TCP SYNs of a capture under several detection settings at once\n"
+            "and compares the outcome. Without -c, -t or -w a grid of thresholds\n"
+            "20,50,100,200,500 and windows 500,1000,2000 ms is used.\n"
+            "\n"
+            "Options:\n"
+            "  -c, --config FILE       Add the settings of a configuration file, e.g. a\n"
+            "                          preset from conf/presets (repeatable)\n"
+            "  -t, --thresholds LIST   syn_threshold values for the grid (e.g. 50,100,200)\n"
+            "  -w, --windows LIST      window_ms values for the grid (e.g. 500,1000)\n"
+            "  -b, --block SECONDS     block_duration_s for the grid (default: %d)\n"
+            "  -W, --whitelist FILE    Never block sources in this whitelist\n"
+            "  -j, --threads N         Worker threads (default: online CPUs)\n"
+            "  -f, --format FORMAT     table or csv (default: table)\n"
+            "  -h, --help              Show this help message\n"
+            "  -v, --version           Show version information\n"
+            "\n"
+            "At most %d settings per run. The /proc SYN_RECV validation cannot be\n"
+            "replayed, so results match validate_syn_recv = false.\n",
+            prog_name, DEFAULT_BLOCK_DURATION_S, WHATIF_MAX_CONFIGS);
+}
+
+static bool parse_u32(const char *text, uint32_t *out) {
+    char *end;
+    unsigned long v = strtoul(text, &end, 10);
+    if (end == text || *end != '\0' || v > UINT32_MAX) {
+        return false;
+    }
+    *out = (uint32_t)v;
+    return true;
+}
+
+/* Comma separated positive integers */
+static size_t parse_list(char *text, uint32_t *out, size_t max) {
+    size_t n = 0;
+    for (char *tok = strtok(text, ","); tok; tok = strtok(NULL, ",")) {
+        if (n == max || !parse_u32(tok, &out[n]) || out[n] == 0) {
+            return 0;
+        }
+        n++;
+    }
+    return n;
+}
+
+static inline uint16_t rd16(const uint8_t *p) {
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static inline uint32_t swap32(uint32_t v, bool swap) {
+    return swap ? __builtin_bswap32(v) : v;
+}
+
+/* Offset of the IPv4 header in a frame, or -1 */
+static long ip_offset(uint32_t linktype, const uint8_t *frame, size_t len) {
+    switch (linktype) {
+        case LINKTYPE_ETHERNET: {
+            size_t off = 12;
+            while (off + 2 <= len && (rd16(frame + off) == 0x8100 || rd16(frame + off) == 0x88A8)) {
+                off += 4; /* VLAN tags */
+            }
+            return off + 2 <= len && rd16(frame + off) == 0x0800 ? (long)off + 2 : -1;
+        }
+        case LINKTYPE_LINUX_SLL:
+            return len >= 16 && rd16(frame + 14) == 0x0800 ? 16 : -1;
+        case LINKTYPE_LINUX_SLL2:
+            return len >= 20 && rd16(frame) == 0x0800 ? 20 : -1;
+        case LINKTYPE_RAW:
+        case LINKTYPE_IPV4:
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+static bool capture_add(capture_t *cap, uint64_t ts_ns, uint32_t src_ip, uint8_t kind) {
+    if (cap->count == cap->cap) {
+        size_t new_cap = cap->cap ? cap->cap * 2 : 65536;
+        whatif_packet_t *grown = realloc(cap->packets, new_cap * sizeof(*grown));
+        if (!grown) {
+            return false;
+        }
+        cap->packets = grown;
+        cap->cap = new_cap;
+    }
+
+    cap->packets[cap->count++] = (whatif_packet_t){ .ts_ns = ts_ns, .src_ip = src_ip, .kind = kind };
+    return true;
+}
+
+/* Classify one frame; false only when out of memory */
+static bool capture_frame(capture_t *cap, uint32_t linktype, uint64_t ts_ns,
+                          const uint8_t *frame, size_t len) {
+    long off = ip_offset(linktype, frame, len);
+    if (off < 0 || (size_t)off + 20 > len) {
+        cap->skipped++;
+        return true;
+    }
+
+    const uint8_t *ip = frame + off;
+    size_t ihl = (size_t)(ip[0] & 0x0F) * 4;
+    bool first_fragment = (rd16(ip + 6) & 0x1FFF) == 0;
+    if ((ip[0] >> 4) != 4 || ihl < 20 || ip[9] != IPPROTO_TCP || !first_fragment ||
+        (size_t)off + ihl + 14 > len) {
+        cap->skipped++;
+        return true;
+    }
+
+    uint32_t src_ip;
+    memcpy(&src_ip, ip + 12, sizeof(src_ip)); /* Stays in network byte order */
+    uint8_t flags = ip[ihl + 13];
+
+    if ((flags & TCP_FLAG_SYN) && !(flags & TCP_FLAG_ACK)) {
+        return capture_add(cap, ts_ns, src_ip, WHATIF_SYN);
+    }
+    if ((flags & TCP_FLAG_ACK) && !(flags & (TCP_FLAG_SYN | TCP_FLAG_RST))) {
+        return capture_add(cap, ts_ns, src_ip, WHATIF_HANDSHAKE);
+    }
+    return true;
+}
+
+static synflood_ret_t capture_read(const char *path, capture_t *cap) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        perror(path);
+        return SYNFLOOD_ERROR;
+    }
+
+    uint32_t hdr[6];
+    if (fread(hdr, sizeof(hdr), 1, fp) != 1) {
+        fprintf(stderr, "%s: not a pcap file\n", path);
+        fclose(fp);
+        return SYNFLOOD_EINVAL;
+    }
+
+    bool swap = hdr[0] == __builtin_bswap32(PCAP_MAGIC_US) ||
+                hdr[0] == __builtin_bswap32(PCAP_MAGIC_NS);
+    uint32_t magic = swap32(hdr[0], swap);
+    if (magic != PCAP_MAGIC_US && magic != PCAP_MAGIC_NS) {
+        fprintf(stderr, "%s: not a pcap file (pcapng is not supported, convert with editcap -F pcap)\n",
+                path);
+        fclose(fp);
+        return SYNFLOOD_EINVAL;
+    }
+    uint64_t frac_ns = magic == PCAP_MAGIC_NS ? 1 : 1000;
+    uint32_t snaplen = swap32(hdr[4], swap);
+    uint32_t linktype = swap32(hdr[5], swap) & 0x0FFFFFFF;
+
+    if (linktype != LINKTYPE_ETHERNET && linktype != LINKTYPE_RAW && linktype != LINKTYPE_IPV4 &&
+        linktype != LINKTYPE_LINUX_SLL && linktype != LINKTYPE_LINUX_SLL2) {
+        fprintf(stderr, "%s: unsupported link type %u\n", path, linktype);
+        fclose(fp);
+        return SYNFLOOD_EINVAL;
+    }
+
+    size_t buf_len = MAX(snaplen, 65535u);
+    uint8_t *frame = malloc(buf_len);
+    if (!frame) {
+        fclose(fp);
+        return SYNFLOOD_ENOMEM;
+    }
+
+    synflood_ret_t ret = SYNFLOOD_OK;
+    uint32_t rec[4];
+    while (fread(rec, sizeof(rec), 1, fp) == 1) {
+        uint64_t ts_ns = (uint64_t)swap32(rec[0], swap) * NSEC_PER_SEC +
+                         (uint64_t)swap32(rec[1], swap) * frac_ns;
+        uint32_t incl_len = swap32(rec[2], swap);
+
+        if (incl_len > buf_len) {
+            fprintf(stderr, "%s: corrupt record (%u bytes)\n", path, incl_len);
+            ret = SYNFLOOD_EINVAL;
+            break;
+        }
+        if (fread(frame, 1, incl_len, fp) != incl_len) {
+            break; /* Capture cut short: use what was read */
+        }
+
+        cap->frames++;
+        if (!capture_frame(cap, linktype, ts_ns, frame, incl_len)) {
+            ret = SYNFLOOD_ENOMEM;
+            break;
+        }
+    }
+
+    free(frame);
+    fclose(fp);
+    return ret;
+}
+
+static bool add_config(whatif_config_t *configs, size_t *count, const char *name,
+                       uint32_t threshold, uint32_t window_ms, uint32_t block_s) {
+    if (*count == WHATIF_MAX_CONFIGS) {
+        fprintf(stderr, "Too many settings (max %d)\n", WHATIF_MAX_CONFIGS);
+        return false;
+    }
+
+    whatif_config_t *c = &configs[(*count)++];
+    snprintf(c->name, sizeof(c->name), "%s", name);
+    c->syn_threshold = threshold;
+    c->window_ms = window_ms;
+    c->block_duration_s = block_s;
+    return true;
+}
+
+static void print_results(const whatif_config_t *configs, const whatif_result_t *results,
+                          size_t count, const whatif_summary_t *summary, bool csv) {
+    if (csv) {
+        printf("config,syn_threshold,window_ms,block_duration_s,blocked_sources,blocks,"
+               "first_block_ms,detect_avg_ms,detect_max_ms,syns_dropped,est_false_positives\n");
+    } else {
+        printf("%-24s %7s %7s %7s %8s %8s %9s %9s %9s %8s %7s\n", "CONFIG", "THRESH", "WIN_MS",
+               "BLOCK_S", "BLOCKED", "BLOCKS", "FIRST_S", "AVG_MS", "MAX_MS", "DROPPED", "EST_FP");
+    }
+
+    for (size_t c = 0; c < count; c++) {
+        const whatif_config_t *cfg = &configs[c];
+        const whatif_result_t *r = &results[c];
+        uint64_t avg = r->blocked_sources ? r->detect_ms_total / r->blocked_sources : 0;
+        double dropped = summary->syns_total
+                         ? 100.0 * (double)r->syns_dropped / (double)summary->syns_total : 0.0;
+
+        if (csv) {
+            printf("%s,%u,%u,%u,%lu,%lu,%ld,%lu,%lu,%lu,%lu\n", cfg->name, cfg->syn_threshold,
+                   cfg->window_ms, cfg->block_duration_s, r->blocked_sources, r->blocks_total,
+                   r->first_block_ms == UINT64_MAX ? -1L : (long)r->first_block_ms, avg,
+                   r->detect_ms_max, r->syns_dropped, r->est_false_positives);
+            continue;
+        }
+
+        char first[16];
+        if (r->first_block_ms == UINT64_MAX) {
+            snprintf(first, sizeof(first), "-");
+        } else {
+            snprintf(first, sizeof(first), "%.3f", (double)r->first_block_ms / MSEC_PER_SEC);
+        }
+        printf("%-24.24s %7u %7u %7u %8lu %8lu %9s %9lu %9lu %7.1f%% %7lu\n", cfg->name,
+               cfg->syn_threshold, cfg->window_ms, cfg->block_duration_s, r->blocked_sources,
+               r->blocks_total, first, avg, r->detect_ms_max, dropped, r->est_false_positives);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    whatif_config_t configs[WHATIF_MAX_CONFIGS];
+    size_t config_count = 0;
+    uint32_t thresholds[WHATIF_MAX_CONFIGS];
+    uint32_t windows[WHATIF_MAX_CONFIGS];
+    size_t threshold_count = 0;
+    size_t window_count = 0;
+    uint32_t block_s = DEFAULT_BLOCK_DURATION_S;
+    const char *whitelist_path = NULL;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    bool csv = false;
+    int opt;
+
+    static struct option long_options[] = {
+        {"config",     required_argument, 0, 'c'},
+        {"thresholds", required_argument, 0, 't'},
+        {"windows",    required_argument, 0, 'w'},
+        {"block",      required_argument, 0, 'b'},
+        {"whitelist",  required_argument, 0, 'W'},
+        {"threads",    required_argument, 0, 'j'},
+        {"format",     required_argument, 0, 'f'},
+        {"help",       no_argument,       0, 'h'},
+        {"version",    no_argument,       0, 'v'},
+        {0, 0, 0, 0}
+    };
+
+    while ((opt = getopt_long(argc, argv, "c:t:w:b:W:j:f:hv", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'c': {
+                synflood_config_t cfg;
+                if (config_load(optarg, &cfg) != SYNFLOOD_OK) {
+                    fprintf(stderr, "Cannot use configuration %s\n", optarg);
+                    return EXIT_USAGE;
+                }
+                char path[PATH_MAX];
+                snprintf(path, sizeof(path), "%s", optarg);
+                if (!add_config(configs, &config_count, basename(path), cfg.syn_threshold,
+                                cfg.window_ms, cfg.block_duration_s)) {
+                    return EXIT_USAGE;
+                }
+                break;
+            }
+            case 't':
+                threshold_count = parse_list(optarg, thresholds, WHATIF_MAX_CONFIGS);
+                if (threshold_count == 0) {
+                    fprintf(stderr, "Invalid threshold list: %s\n", optarg);
+                    return EXIT_USAGE;
+                }
+                break;
+            case 'w':
+                window_count = parse_list(optarg, windows, WHATIF_MAX_CONFIGS);
+                if (window_count == 0) {
+                    fprintf(stderr, "Invalid window list: %s\n", optarg);
+                    return EXIT_USAGE;
+                }
+                break;
+            case 'b':
+                if (!parse_u32(optarg, &block_s) || block_s == 0) {
+                    fprintf(stderr, "Invalid block duration: %s\n", optarg);
+                    return EXIT_USAGE;
+                }
+                break;
+            case 'W':
+                whitelist_path = optarg;
+                break;
+            case 'j': {
+                uint32_t n;
+                if (!parse_u32(optarg, &n) || n == 0) {
+                    fprintf(stderr, "Invalid thread count: %s\n", optarg);
+                    return EXIT_USAGE;
+                }
+                threads = n;
+                break;
+            }
+            case 'f':
+                if (strcmp(optarg, "csv") == 0) {
+                    csv = true;
+                } else if (strcmp(optarg, "table") != 0) {
+                    fprintf(stderr, "Unknown format: %s\n", optarg);
+                    return EXIT_USAGE;
+                }
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            case 'v':
+                printf("synflood-whatif v%s\n", SYNFLOOD_VERSION);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_USAGE;
+        }
+    }
+
+    if (optind != argc - 1) {
+        print_usage(argv[0]);
+        return EXIT_USAGE;
+    }
+
+    /* Grid: every threshold with every window */
+    if (config_count == 0 && threshold_count == 0 && window_count == 0) {
+        threshold_count = ARRAY_SIZE(default_thresholds);
+        memcpy(thresholds, default_thresholds, sizeof(default_thresholds));
+        window_count = ARRAY_SIZE(default_windows);
+        memcpy(windows, default_windows, sizeof(default_windows));
+    }
+    if (threshold_count > 0 || window_count > 0) {
+        if (threshold_count == 0) {
+            thresholds[threshold_count++] = DEFAULT_SYN_THRESHOLD;
+        }
+        if (window_count == 0) {
+            windows[window_count++] = DEFAULT_WINDOW_MS;
+        }
+
+        for (size_t w = 0; w < window_count; w++) {
+            for (size_t t = 0; t < threshold_count; t++) {
+                char name[64];
+                snprintf(name, sizeof(name), "t%u/w%u", thresholds[t], windows[w]);
+                if (!add_config(configs, &config_count, name, thresholds[t], windows[w], block_s)) {
+                    return EXIT_USAGE;
+                }
+            }
+        }
+    }
+
+    whitelist_node_t *whitelist = NULL;
+    if (whitelist_path) {
+        whitelist = whitelist_load(whitelist_path);
+        if (!whitelist) {
+            fprintf(stderr, "Cannot load whitelist %s\n", whitelist_path);
+            return EXIT_USAGE;
+        }
+    }
+
+    capture_t cap = { 0 };
+    synflood_ret_t ret = capture_read(argv[optind], &cap);
+    if (ret != SYNFLOOD_OK && cap.count == 0) {
+        whitelist_free(whitelist);
+        return EXIT_FAILURE;
+    }
+
+    whatif_result_t results[WHATIF_MAX_CONFIGS];
+    whatif_summary_t summary;
+    ret = whatif_replay(configs, config_count, cap.packets, cap.count, whitelist,
+                        (unsigned)MAX(threads, 1L), results, &summary);
+    if (ret != SYNFLOOD_OK) {
+        fprintf(stderr, "Replay failed (%d)\n", ret);
+        free(cap.packets);
+        whitelist_free(whitelist);
+        return EXIT_FAILURE;
+    }
+
+    if (!csv) {
+        printf("Capture: %lu frames, %lu SYNs from %lu sources over %.1f s "
+               "(%lu sources completed handshakes, %lu SYNs whitelisted)\n\n",
+               cap.frames, summary.syns_total, summary.sources_total,
+               (double)summary.duration_ms / MSEC_PER_SEC, summary.handshake_sources,
+               summary.whitelisted_syns);
+    }
+    print_results(configs, results, config_count, &summary, csv);
+
+    free(cap.packets);
+    whitelist_free(whitelist);
+    return EXIT_SUCCESS;
+}
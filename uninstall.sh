@@ -202,6 +202,8 @@ remove_binary() {
     else
         info "Binary not found"
     fi
+
+    rm -f "${BIN_DIR}/synflood-ctl-native"
 }
 
 remove_systemd_service() {